@@ -0,0 +1,110 @@
+//
+//  TBCanvasInstrumentation.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Set TB_CANVAS_INSTRUMENTATION to 1 in the preprocessor definitions to compile the instrumentation in.
+ When it is 0 all instrumentation macros expand to nothing.
+ */
+#ifndef TB_CANVAS_INSTRUMENTATION
+#define TB_CANVAS_INSTRUMENTATION 0
+#endif
+
+/**
+ A named counter or timer. Entries are created on first use and live as long as the process.
+ */
+typedef struct {
+    const char *name;
+    uint64_t count;
+    uint64_t countInFrame;
+    uint64_t maxCountPerFrame;
+    double totalTime;
+    double maxTime;
+} TBCanvasInstrumentationEntry;
+
+/**
+ A running scoped timer.
+ */
+typedef struct {
+    TBCanvasInstrumentationEntry *entry;
+    double start;
+} TBCanvasInstrumentationScope;
+
+FOUNDATION_EXPORT TBCanvasInstrumentationEntry *TBCanvasInstrumentationEntryNamed(const char *name);
+FOUNDATION_EXPORT void TBCanvasInstrumentationCount(TBCanvasInstrumentationEntry *entry, uint64_t count);
+FOUNDATION_EXPORT TBCanvasInstrumentationScope TBCanvasInstrumentationBeginScope(TBCanvasInstrumentationEntry *entry);
+FOUNDATION_EXPORT void TBCanvasInstrumentationEndScope(TBCanvasInstrumentationScope *scope);
+FOUNDATION_EXPORT void TBCanvasInstrumentationMarkFrame(void);
+
+#if TB_CANVAS_INSTRUMENTATION
+
+#define TB_CANVAS_ENTRY_(name) \
+    static TBCanvasInstrumentationEntry *_tbEntry = NULL; \
+    if (_tbEntry == NULL) _tbEntry = TBCanvasInstrumentationEntryNamed(name)
+
+// Measures the time until the end of the enclosing scope. Use once per scope.
+#define TB_CANVAS_SCOPED_TIMER(name) \
+    TB_CANVAS_ENTRY_(name); \
+    __attribute__((cleanup(TBCanvasInstrumentationEndScope), unused)) TBCanvasInstrumentationScope _tbScope = TBCanvasInstrumentationBeginScope(_tbEntry)
+
+// Adds a given amount to a counter.
+#define TB_CANVAS_COUNT_ADD(name, amount) \
+    do { TB_CANVAS_ENTRY_(name); TBCanvasInstrumentationCount(_tbEntry, (amount)); } while (0)
+
+// Marks the end of a frame. Per frame maxima of all counters are updated.
+#define TB_CANVAS_MARK_FRAME() TBCanvasInstrumentationMarkFrame()
+
+#else
+
+#define TB_CANVAS_SCOPED_TIMER(name)
+#define TB_CANVAS_COUNT_ADD(name, amount) do {} while (0)
+#define TB_CANVAS_MARK_FRAME() do {} while (0)
+
+#endif
+
+// Increments a counter by one.
+#define TB_CANVAS_COUNT(name) TB_CANVAS_COUNT_ADD(name, 1)
+
+/**
+ This class exposes the counters and timers collected by the instrumentation macros.
+ 
+ Instrumentation is meant to be used from the main thread only.
+ */
+@interface TBCanvasInstrumentation : NSObject
+
+/**
+ Returns all collected counters and timers.
+ 
+ The keys are the names of the entries. Each value is a dictionary with the keys
+ `count`, `maxCountPerFrame`, `totalTime` and `maxTime`. Timers with recorded events also have
+ the keys `p50`, `p90` and `p99` over the most recent events. Times are in seconds.
+ 
+ @return The statistics. Empty when the instrumentation is compiled out.
+ */
++ (NSDictionary *)statistics;
+
+/**
+ Resets all counters, timers and recorded trace events.
+ */
++ (void)reset;
+
+/**
+ Writes the recorded timer events in the Trace Event JSON format (chrome://tracing, Perfetto, speedscope).
+ 
+ Only the most recent timer events are kept in a fixed size buffer.
+ 
+ @param url   The URL of the trace file
+ @param error On return the error when the file could not be written.
+ 
+ @return `YES` when the trace has been written.
+ */
++ (BOOL)writeTraceToURL:(NSURL *)url error:(NSError **)error;
+
+@end
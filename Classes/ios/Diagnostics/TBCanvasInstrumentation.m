@@ -0,0 +1,158 @@
+//
+//  TBCanvasInstrumentation.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <QuartzCore/QuartzCore.h>
+
+#import "TBCanvasInstrumentation.h"
+
+#define MAX_ENTRIES        64
+#define MAX_TRACE_EVENTS   65536
+
+typedef struct {
+    TBCanvasInstrumentationEntry *entry;
+    double start;
+    double duration;
+} TBCanvasInstrumentationTraceEvent;
+
+static TBCanvasInstrumentationEntry entries[MAX_ENTRIES];
+static NSUInteger entryCount = 0;
+
+static TBCanvasInstrumentationTraceEvent *traceEvents = NULL;
+static NSUInteger traceEventCount = 0;
+static NSUInteger nextTraceEvent = 0;
+
+TBCanvasInstrumentationEntry *TBCanvasInstrumentationEntryNamed(const char *name)
+{
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    
+    // All further entries share the last slot.
+    NSUInteger index = MIN(entryCount, MAX_ENTRIES - 1);
+    if (entryCount < MAX_ENTRIES) {
+        entries[index].name = name;
+        entryCount++;
+    }
+    return &entries[index];
+}
+
+void TBCanvasInstrumentationCount(TBCanvasInstrumentationEntry *entry, uint64_t count)
+{
+    entry->count += count;
+    entry->countInFrame += count;
+}
+
+TBCanvasInstrumentationScope TBCanvasInstrumentationBeginScope(TBCanvasInstrumentationEntry *entry)
+{
+    TBCanvasInstrumentationScope scope = {entry, CACurrentMediaTime()};
+    return scope;
+}
+
+void TBCanvasInstrumentationEndScope(TBCanvasInstrumentationScope *scope)
+{
+    double duration = CACurrentMediaTime() - scope->start;
+    
+    TBCanvasInstrumentationEntry *entry = scope->entry;
+    entry->count++;
+    entry->countInFrame++;
+    entry->totalTime += duration;
+    entry->maxTime = MAX(entry->maxTime, duration);
+    
+    // Ring buffer of the most recent events.
+    if (traceEvents == NULL) {
+        traceEvents = calloc(MAX_TRACE_EVENTS, sizeof(TBCanvasInstrumentationTraceEvent));
+    }
+    TBCanvasInstrumentationTraceEvent event = {entry, scope->start, duration};
+    traceEvents[nextTraceEvent] = event;
+    nextTraceEvent = (nextTraceEvent + 1) % MAX_TRACE_EVENTS;
+    traceEventCount = MIN(traceEventCount + 1, MAX_TRACE_EVENTS);
+}
+
+void TBCanvasInstrumentationMarkFrame(void)
+{
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        entries[i].maxCountPerFrame = MAX(entries[i].maxCountPerFrame, entries[i].countInFrame);
+        entries[i].countInFrame = 0;
+    }
+}
+
+@implementation TBCanvasInstrumentation
+
++ (NSDictionary *)statistics
+{
+    NSMutableDictionary *statistics = [[NSMutableDictionary alloc] initWithCapacity:entryCount];
+    
+    // Group the durations of the recorded timer events by entry.
+    NSMutableArray *durations = [[NSMutableArray alloc] initWithCapacity:entryCount];
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        [durations addObject:[[NSMutableArray alloc] init]];
+    }
+    for (NSUInteger i = 0; i < traceEventCount; i++) {
+        TBCanvasInstrumentationTraceEvent event = traceEvents[i];
+        [durations[event.entry - entries] addObject:@(event.duration)];
+    }
+    
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        TBCanvasInstrumentationEntry entry = entries[i];
+        NSMutableDictionary *values = [@{@"count": @(entry.count),
+                                         @"maxCountPerFrame": @(MAX(entry.maxCountPerFrame, entry.countInFrame)),
+                                         @"totalTime": @(entry.totalTime),
+                                         @"maxTime": @(entry.maxTime)} mutableCopy];
+        
+        NSArray *sorted = [durations[i] sortedArrayUsingSelector:@selector(compare:)];
+        if (sorted.count > 0) {
+            NSUInteger last = sorted.count - 1;
+            values[@"p50"] = sorted[(NSUInteger)(last * 0.5)];
+            values[@"p90"] = sorted[(NSUInteger)(last * 0.9)];
+            values[@"p99"] = sorted[(NSUInteger)(last * 0.99)];
+        }
+        statistics[@(entry.name)] = values;
+    }
+    return statistics;
+}
+
++ (void)reset
+{
+    for (NSUInteger i = 0; i < entryCount; i++) {
+        const char *name = entries[i].name;
+        memset(&entries[i], 0, sizeof(TBCanvasInstrumentationEntry));
+        entries[i].name = name;
+    }
+    traceEventCount = 0;
+    nextTraceEvent = 0;
+}
+
++ (BOOL)writeTraceToURL:(NSURL *)url error:(NSError **)error
+{
+    NSMutableArray *events = [[NSMutableArray alloc] initWithCapacity:traceEventCount];
+    NSUInteger first = (nextTraceEvent + MAX_TRACE_EVENTS - traceEventCount) % MAX_TRACE_EVENTS;
+    
+    for (NSUInteger i = 0; i < traceEventCount; i++) {
+        TBCanvasInstrumentationTraceEvent event = traceEvents[(first + i) % MAX_TRACE_EVENTS];
+        
+        // Complete events with timestamps in microseconds.
+        [events addObject:@{@"name": @(event.entry->name),
+                            @"cat": @"TBCollectionCanvas",
+                            @"ph": @"X",
+                            @"ts": @(event.start * 1000000.0),
+                            @"dur": @(event.duration * 1000000.0),
+                            @"pid": @([[NSProcessInfo processInfo] processIdentifier]),
+                            @"tid": @1}];
+    }
+    
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{@"traceEvents": events, @"displayTimeUnit": @"ms"} options:0 error:error];
+    if (data == nil) {
+        return NO;
+    }
+    return [data writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+@end
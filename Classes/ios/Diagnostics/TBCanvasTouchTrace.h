@@ -0,0 +1,130 @@
+//
+//  TBCanvasTouchTrace.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+@class TBCollectionCanvasContentView;
+
+/**
+ The error domain of errors returned when reading or writing a TBCanvasTouchTrace.
+ */
+extern NSString * const TBCanvasTouchTraceErrorDomain;
+
+/**
+ The kind of TBCanvasItemView a recorded event has been delivered by.
+ */
+typedef NS_ENUM(uint8_t, TBCanvasTouchTraceTarget) {
+    TBCanvasTouchTraceTargetNode = 0,
+    TBCanvasTouchTraceTargetCreateHandle,
+    TBCanvasTouchTraceTargetMoveHandle,
+    TBCanvasTouchTraceTargetMenu
+};
+
+/**
+ The touch phase or menu action of a recorded event.
+ */
+typedef NS_ENUM(uint8_t, TBCanvasTouchTracePhase) {
+    TBCanvasTouchTracePhaseBegan = 0,
+    TBCanvasTouchTracePhaseMoved,
+    TBCanvasTouchTracePhaseEnded,
+    TBCanvasTouchTracePhaseCancelled,
+    TBCanvasTouchTracePhaseCollapse,
+    TBCanvasTouchTracePhaseExpand,
+    TBCanvasTouchTracePhaseDelete
+};
+
+/**
+ A single event of the touch stream handled by a TBCollectionCanvasContentView.
+ 
+ Node views are referenced by section and tag. Move handles are referenced by the section and tag of the parent node
+ and the index of their connection inside the parent's childConnections.
+ */
+typedef struct {
+    TBCanvasTouchTraceTarget target;
+    TBCanvasTouchTracePhase phase;
+    int32_t nodeTag;
+    int32_t connectionIndex;
+    CGPoint location;
+    NSTimeInterval timestamp;
+    uint16_t section;
+} TBCanvasTouchTraceEvent;
+
+/**
+ This class records the touch stream of a TBCollectionCanvasContentView and replays it deterministically.
+ 
+ Traces are stored in a compact binary format of fixed size records. Timestamps are stored as 64 bit microseconds.
+ */
+@interface TBCanvasTouchTrace : NSObject
+
+/**
+ *  The number of recorded events.
+ */
+@property (assign, nonatomic, readonly) NSUInteger eventCount;
+
+/**
+ Initializes a TBCanvasTouchTrace object with the contents of a trace file.
+ 
+ @param url   The URL of the trace file
+ @param error On return the error when the file could not be read or is no valid trace.
+ 
+ @return The initialized TBCanvasTouchTrace object. Otherwise nil.
+ */
+- (id)initWithContentsOfURL:(NSURL *)url error:(NSError **)error;
+
+/**
+ Appends an event to the trace. The timestamp is taken when the event is recorded.
+ 
+ @param event The given event
+ */
+- (void)recordEvent:(TBCanvasTouchTraceEvent)event;
+
+/**
+ Returns the event at a given index.
+ 
+ @param index The index of the event
+ 
+ @return The recorded event
+ */
+- (TBCanvasTouchTraceEvent)eventAtIndex:(NSUInteger)index;
+
+/**
+ Removes all recorded events.
+ */
+- (void)removeAllEvents;
+
+/**
+ Writes the trace to a file.
+ 
+ @param url   The URL of the trace file
+ @param error On return the error when the file could not be written.
+ 
+ @return `YES` when the trace has been written.
+ */
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error;
+
+/**
+ Feeds all recorded events through a given canvas as fast as possible and measures the time spent on each event.
+ 
+ @param collectionCanvasContentView The TBCollectionCanvasContentView to replay the events on
+ 
+ @return The per event latencies in seconds as NSNumber objects in recording order.
+ */
+- (NSArray *)replayOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView;
+
+/**
+ Returns percentiles of a given array of latencies.
+ 
+ @param latencies The latencies returned by replayOnCanvasContentView:
+ 
+ @return A dictionary with the keys `p50`, `p90`, `p99` and `max` in seconds.
+ */
++ (NSDictionary *)percentilesForLatencies:(NSArray *)latencies;
+
+@end
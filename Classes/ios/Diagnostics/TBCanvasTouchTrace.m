@@ -0,0 +1,197 @@
+//
+//  TBCanvasTouchTrace.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <QuartzCore/QuartzCore.h>
+#import <libkern/OSByteOrder.h>
+
+#import "TBCanvasTouchTrace.h"
+#import "TBCollectionCanvasContentView.h"
+
+NSString * const TBCanvasTouchTraceErrorDomain = @"TBCanvasTouchTraceErrorDomain";
+
+static const char       TRACE_MAGIC[4]        = {'T', 'B', 'T', 'R'};
+static const uint16_t   TRACE_VERSION         = 2;
+static const uint16_t   TRACE_VERSION_1       = 1;
+static const NSUInteger TRACE_HEADER_SIZE     = 8;
+static const NSUInteger TRACE_RECORD_SIZE     = 28;
+static const NSUInteger TRACE_RECORD_SIZE_1   = 24;
+
+@interface TBCanvasTouchTrace()
+{
+    TBCanvasTouchTraceEvent *events;
+    NSUInteger capacity;
+    CFTimeInterval startTime;
+}
+
+@end
+
+@implementation TBCanvasTouchTrace
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        events = NULL;
+        capacity = 0;
+        _eventCount = 0;
+        startTime = 0.0;
+    }
+    return self;
+}
+
+- (id)initWithContentsOfURL:(NSURL *)url error:(NSError **)error
+{
+    self = [self init];
+    if (self) {
+        NSData *data = [NSData dataWithContentsOfURL:url options:0 error:error];
+        if (data == nil) {
+            return nil;
+        }
+        
+        // Version 1 stored timestamps as 32 bit microseconds, which wrap after about 71 minutes.
+        const uint8_t *bytes = data.bytes;
+        uint16_t version = (data.length < TRACE_HEADER_SIZE) ? 0 : OSReadLittleInt16(bytes, 4);
+        NSUInteger recordSize = (version == TRACE_VERSION_1) ? TRACE_RECORD_SIZE_1 : TRACE_RECORD_SIZE;
+        if (data.length < TRACE_HEADER_SIZE || memcmp(bytes, TRACE_MAGIC, 4) != 0 || (version != TRACE_VERSION && version != TRACE_VERSION_1)
+            || (data.length - TRACE_HEADER_SIZE) % recordSize != 0) {
+            if (error) {
+                *error = [NSError errorWithDomain:TBCanvasTouchTraceErrorDomain code:1 userInfo:@{NSLocalizedDescriptionKey: @"Not a valid touch trace file."}];
+            }
+            return nil;
+        }
+        
+        NSUInteger count = (data.length - TRACE_HEADER_SIZE) / recordSize;
+        for (NSUInteger i = 0; i < count; i++) {
+            const uint8_t *record = bytes + TRACE_HEADER_SIZE + i * recordSize;
+            
+            TBCanvasTouchTraceEvent event;
+            event.target = record[0];
+            event.phase = record[1];
+            event.section = OSReadLittleInt16(record, 2);
+            event.nodeTag = (int32_t)OSReadLittleInt32(record, 4);
+            event.connectionIndex = (int32_t)OSReadLittleInt32(record, 8);
+            
+            uint32_t x = OSReadLittleInt32(record, 12);
+            uint32_t y = OSReadLittleInt32(record, 16);
+            float fx, fy;
+            memcpy(&fx, &x, sizeof(float));
+            memcpy(&fy, &y, sizeof(float));
+            event.location = CGPointMake(fx, fy);
+            uint64_t microseconds = (version == TRACE_VERSION_1) ? OSReadLittleInt32(record, 20) : OSReadLittleInt64(record, 20);
+            event.timestamp = microseconds / 1000000.0;
+            
+            [self appendEvent:event];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(events);
+}
+
+#pragma mark - Recording
+
+- (void)appendEvent:(TBCanvasTouchTraceEvent)event
+{
+    if (_eventCount == capacity) {
+        capacity = MAX(capacity * 2, 256);
+        events = realloc(events, capacity * sizeof(TBCanvasTouchTraceEvent));
+    }
+    events[_eventCount++] = event;
+}
+
+- (void)recordEvent:(TBCanvasTouchTraceEvent)event
+{
+    CFTimeInterval now = CACurrentMediaTime();
+    if (_eventCount == 0) {
+        startTime = now;
+    }
+    event.timestamp = now - startTime;
+    [self appendEvent:event];
+}
+
+- (TBCanvasTouchTraceEvent)eventAtIndex:(NSUInteger)index
+{
+    if (index >= _eventCount) {
+        [NSException raise:NSRangeException format:@"### Error: TBCanvasTouchTrace: index %lu beyond bounds %lu", (unsigned long)index, (unsigned long)_eventCount];
+    }
+    return events[index];
+}
+
+- (void)removeAllEvents
+{
+    _eventCount = 0;
+}
+
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error
+{
+    NSMutableData *data = [[NSMutableData alloc] initWithCapacity:TRACE_HEADER_SIZE + _eventCount * TRACE_RECORD_SIZE];
+    
+    uint8_t header[TRACE_HEADER_SIZE] = {0};
+    memcpy(header, TRACE_MAGIC, 4);
+    OSWriteLittleInt16(header, 4, TRACE_VERSION);
+    [data appendBytes:header length:TRACE_HEADER_SIZE];
+    
+    for (NSUInteger i = 0; i < _eventCount; i++) {
+        TBCanvasTouchTraceEvent event = events[i];
+        uint8_t record[TRACE_RECORD_SIZE] = {0};
+        
+        float fx = event.location.x;
+        float fy = event.location.y;
+        uint32_t x, y;
+        memcpy(&x, &fx, sizeof(float));
+        memcpy(&y, &fy, sizeof(float));
+        
+        record[0] = event.target;
+        record[1] = event.phase;
+        OSWriteLittleInt16(record, 2, event.section);
+        OSWriteLittleInt32(record, 4, (uint32_t)event.nodeTag);
+        OSWriteLittleInt32(record, 8, (uint32_t)event.connectionIndex);
+        OSWriteLittleInt32(record, 12, x);
+        OSWriteLittleInt32(record, 16, y);
+        OSWriteLittleInt64(record, 20, (uint64_t)MAX(event.timestamp * 1000000.0, 0.0));
+        
+        [data appendBytes:record length:TRACE_RECORD_SIZE];
+    }
+    
+    return [data writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+#pragma mark - Replaying
+
+- (NSArray *)replayOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView
+{
+    NSMutableArray *latencies = [[NSMutableArray alloc] initWithCapacity:_eventCount];
+    
+    for (NSUInteger i = 0; i < _eventCount; i++) {
+        CFTimeInterval start = CACurrentMediaTime();
+        [collectionCanvasContentView processTouchTraceEvent:events[i]];
+        [latencies addObject:@(CACurrentMediaTime() - start)];
+    }
+    return latencies;
+}
+
++ (NSDictionary *)percentilesForLatencies:(NSArray *)latencies
+{
+    if (latencies.count == 0) {
+        return @{};
+    }
+    
+    NSArray *sorted = [latencies sortedArrayUsingSelector:@selector(compare:)];
+    NSUInteger last = sorted.count - 1;
+    
+    return @{@"p50": sorted[(NSUInteger)(last * 0.5)],
+             @"p90": sorted[(NSUInteger)(last * 0.9)],
+             @"p99": sorted[(NSUInteger)(last * 0.99)],
+             @"max": sorted[last]};
+}
+
+@end
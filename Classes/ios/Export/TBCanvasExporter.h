@@ -0,0 +1,108 @@
+//
+//  TBCanvasExporter.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+extern NSString * const TBCanvasExporterErrorDomain;
+
+/**
+ The file format written by a TBCanvasExporter.
+ */
+typedef NS_ENUM(NSInteger, TBCanvasExportFormat) {
+    TBCanvasExportFormatSVG = 0,
+    TBCanvasExportFormatPNG
+};
+
+/**
+ This class writes the nodes and connections of a list of TBCanvasRenderModel objects to an SVG or PNG file.
+ 
+ The output is streamed. SVG elements are written tile by tile from spatial queries. PNG images are rasterized strip by strip
+ into a single reused bitmap and compressed row by row. Memory use depends on the tile size and the strip buffer - not on the
+ number of nodes or the size of the image.
+ 
+ The exporter uses neither UIKit nor the view hierarchy and can run on any thread. The render models must not be edited during an export.
+ */
+@interface TBCanvasExporter : NSObject
+
+/**
+ *  The exported TBCanvasRenderModel objects. Drawn in the order of the list.
+ */
+@property (strong, nonatomic, readonly) NSArray *renderModels;
+
+/**
+ *  The exported rectangle in canvas coordinates. Defaults to the bounds of all render models plus a margin.
+ */
+@property (assign, nonatomic) CGRect rect;
+
+/**
+ *  The number of PNG pixels per canvas point. Defaults to `1.0`.
+ */
+@property (assign, nonatomic) CGFloat scale;
+
+/**
+ *  The edge length of the tiles queried while writing SVG. Defaults to `1024.0`.
+ */
+@property (assign, nonatomic) CGFloat tileSize;
+
+/**
+ *  The maximum size of the strip bitmap used while writing PNG in bytes. A strip is at least one row high. Defaults to 8 MB.
+ */
+@property (assign, nonatomic) NSUInteger maximumBufferSize;
+
+/**
+ Initializes the TBCanvasExporter object with a list of render models.
+ 
+ @param renderModels The list of TBCanvasRenderModel objects
+ 
+ @return The initialized TBCanvasExporter object
+ */
+- (id)initWithRenderModels:(NSArray *)renderModels;
+
+/**
+ Writes the canvas as SVG to an open output stream.
+ 
+ @param stream The open output stream
+ @param error  Returns the error when the stream fails
+ 
+ @return `YES` when the canvas has been written.
+ */
+- (BOOL)writeSVGToStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/**
+ Writes the canvas as PNG to an open output stream.
+ 
+ @param stream The open output stream
+ @param error  Returns the error when the stream fails or the image can not be rasterized
+ 
+ @return `YES` when the canvas has been written.
+ */
+- (BOOL)writePNGToStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/**
+ Writes the canvas to a file. A partially written file is removed.
+ 
+ @param url    The URL of the file
+ @param format The file format
+ @param error  Returns the error when the file can not be written
+ 
+ @return `YES` when the canvas has been written.
+ */
+- (BOOL)writeToURL:(NSURL *)url format:(TBCanvasExportFormat)format error:(NSError **)error;
+
+/**
+ Writes the canvas to a file on a background queue.
+ 
+ @param url        The URL of the file
+ @param format     The file format
+ @param completion Called on the main queue when done. error is `nil` when the canvas has been written
+ */
+- (void)exportToURL:(NSURL *)url format:(TBCanvasExportFormat)format completion:(void (^)(NSError *error))completion;
+
+@end
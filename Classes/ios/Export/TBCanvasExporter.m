@@ -0,0 +1,454 @@
+//
+//  TBCanvasExporter.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <libkern/OSByteOrder.h>
+#import <zlib.h>
+
+#import "TBCanvasExporter.h"
+#import "TBCanvasRenderModel.h"
+
+NSString * const TBCanvasExporterErrorDomain = @"TBCanvasExporterErrorDomain";
+
+static CGFloat    EXPORT_MARGIN         = 20.0;
+static CGFloat    EXPORT_TILE_SIZE      = 1024.0;
+static NSUInteger EXPORT_BUFFER_SIZE    = 8 * 1024 * 1024;
+static NSUInteger EXPORT_CHUNK_SIZE     = 64 * 1024;
+
+// Mirror the drawing of TBCanvasRenderModel.
+static CGFloat    EDGE_LINE_WIDTH       = 10.0;
+static CGFloat    NODE_BORDER_WIDTH     = 1.0;
+
+static const uint8_t PNG_SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+static NSError *TBCanvasExporterError(NSInteger code, NSString *description)
+{
+    return [NSError errorWithDomain:TBCanvasExporterErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: description}];
+}
+
+@interface TBCanvasExporter()
+
+/** @name Streaming */
+
+/**
+ Writes a list of bytes to a given stream. Retries until all bytes have been written.
+ 
+ @param bytes  The list of bytes
+ @param length The number of bytes
+ @param stream The given stream
+ @param error  Returns the error of the stream
+ 
+ @return `YES` when all bytes have been written.
+ */
+- (BOOL)writeBytes:(const void *)bytes length:(NSUInteger)length toStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/**
+ Writes a string encoded as UTF-8 to a given stream.
+ 
+ @param string The string
+ @param stream The given stream
+ @param error  Returns the error of the stream
+ 
+ @return `YES` when the string has been written.
+ */
+- (BOOL)writeString:(NSString *)string toStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/** @name SVG */
+
+/**
+ Returns the number of tile columns and rows covering the exported rectangle.
+ 
+ @return The number of columns as width and the number of rows as height.
+ */
+- (CGSize)tileGridSize;
+
+/**
+ Returns `YES` when a given tile owns the item covering a given rectangle.
+ Every item is owned by exactly one tile - the tile containing the top left corner of its rectangle - and is written only once.
+ 
+ @param column The column of the tile
+ @param row    The row of the tile
+ @param rect   The rectangle of the item
+ 
+ @return `YES` when the tile owns the item.
+ */
+- (BOOL)tileAtColumn:(NSUInteger)column row:(NSUInteger)row ownsRect:(CGRect)rect;
+
+/**
+ Calls a block for every tile and writes the SVG elements it appends after each tile.
+ 
+ @param stream The stream to write to
+ @param error  Returns the error of the stream
+ @param block  The block appending the elements owned by a tile
+ 
+ @return `YES` when all tiles have been written.
+ */
+- (BOOL)writeTilesToStream:(NSOutputStream *)stream error:(NSError **)error usingBlock:(void (^)(CGRect tileRect, NSUInteger column, NSUInteger row, NSMutableString *svg))block;
+
+/** @name PNG */
+
+/**
+ Writes a single PNG chunk to a given stream.
+ 
+ @param type   The four letter type of the chunk
+ @param bytes  The data of the chunk
+ @param length The length of the data
+ @param stream The given stream
+ @param error  Returns the error of the stream
+ 
+ @return `YES` when the chunk has been written.
+ */
+- (BOOL)writeChunkOfType:(const char *)type bytes:(const void *)bytes length:(NSUInteger)length toStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/**
+ Compresses the pending input of a deflate stream. Writes an IDAT chunk whenever the output buffer is full and when the stream is finished.
+ 
+ @param zstream The deflate stream. Its output buffer must start at chunk
+ @param flush   `Z_NO_FLUSH` or `Z_FINISH`
+ @param chunk   The output buffer of EXPORT_CHUNK_SIZE bytes
+ @param stream  The stream to write to
+ @param error   Returns the error of the stream or the compression
+ 
+ @return `YES` when the input has been compressed.
+ */
+- (BOOL)deflate:(z_stream *)zstream flush:(int)flush chunk:(uint8_t *)chunk toStream:(NSOutputStream *)stream error:(NSError **)error;
+
+@end
+
+@implementation TBCanvasExporter
+
+- (id)initWithRenderModels:(NSArray *)renderModels
+{
+    self = [super init];
+    if (self) {
+        _renderModels = [renderModels copy];
+        _scale = 1.0;
+        _tileSize = EXPORT_TILE_SIZE;
+        _maximumBufferSize = EXPORT_BUFFER_SIZE;
+        
+        CGRect bounds = CGRectNull;
+        for (TBCanvasRenderModel *renderModel in _renderModels) {
+            bounds = CGRectUnion(bounds, [renderModel bounds]);
+        }
+        _rect = CGRectIsNull(bounds) ? CGRectNull : CGRectInset(bounds, -EXPORT_MARGIN, -EXPORT_MARGIN);
+    }
+    return self;
+}
+
+#pragma mark - Streaming
+
+- (BOOL)writeBytes:(const void *)bytes length:(NSUInteger)length toStream:(NSOutputStream *)stream error:(NSError **)error
+{
+    const uint8_t *cursor = bytes;
+    
+    while (length > 0) {
+        NSInteger written = [stream write:cursor maxLength:length];
+        if (written <= 0) {
+            if (error) {
+                *error = stream.streamError;
+                if (*error == nil) {
+                    *error = TBCanvasExporterError(1, @"The output stream could not be written.");
+                }
+            }
+            return NO;
+        }
+        cursor += written;
+        length -= written;
+    }
+    return YES;
+}
+
+- (BOOL)writeString:(NSString *)string toStream:(NSOutputStream *)stream error:(NSError **)error
+{
+    const char *bytes = string.UTF8String;
+    return [self writeBytes:bytes length:strlen(bytes) toStream:stream error:error];
+}
+
+- (BOOL)writeToURL:(NSURL *)url format:(TBCanvasExportFormat)format error:(NSError **)error
+{
+    NSOutputStream *stream = [NSOutputStream outputStreamWithURL:url append:NO];
+    [stream open];
+    
+    BOOL success = NO;
+    if (format == TBCanvasExportFormatSVG) {
+        success = [self writeSVGToStream:stream error:error];
+    } else {
+        success = [self writePNGToStream:stream error:error];
+    }
+    [stream close];
+    
+    if (success == NO) {
+        [[NSFileManager defaultManager] removeItemAtURL:url error:NULL];
+    }
+    return success;
+}
+
+- (void)exportToURL:(NSURL *)url format:(TBCanvasExportFormat)format completion:(void (^)(NSError *error))completion
+{
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError *error = nil;
+        BOOL success = [self writeToURL:url format:format error:&error];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (completion) {
+                completion(success ? nil : error);
+            }
+        });
+    });
+}
+
+#pragma mark - SVG
+
+- (CGSize)tileGridSize
+{
+    return CGSizeMake(MAX(1.0, ceil(_rect.size.width / _tileSize)), MAX(1.0, ceil(_rect.size.height / _tileSize)));
+}
+
+- (BOOL)tileAtColumn:(NSUInteger)column row:(NSUInteger)row ownsRect:(CGRect)rect
+{
+    // Items reaching into the exported rectangle from outside belong to the nearest tile.
+    CGSize gridSize = [self tileGridSize];
+    CGFloat ownerColumn = MAX(0.0, MIN(floor((rect.origin.x - _rect.origin.x) / _tileSize), gridSize.width - 1.0));
+    CGFloat ownerRow = MAX(0.0, MIN(floor((rect.origin.y - _rect.origin.y) / _tileSize), gridSize.height - 1.0));
+    return (ownerColumn == column && ownerRow == row);
+}
+
+- (BOOL)writeTilesToStream:(NSOutputStream *)stream error:(NSError **)error usingBlock:(void (^)(CGRect tileRect, NSUInteger column, NSUInteger row, NSMutableString *svg))block
+{
+    CGSize gridSize = [self tileGridSize];
+    NSError *tileError = nil;
+    
+    for (NSUInteger row = 0; row < gridSize.height; row++) {
+        for (NSUInteger column = 0; column < gridSize.width; column++) {
+            BOOL success = NO;
+            
+            // Only the elements of a single tile are held in memory.
+            @autoreleasepool {
+                CGRect tileRect = CGRectMake(_rect.origin.x + column * _tileSize, _rect.origin.y + row * _tileSize, _tileSize, _tileSize);
+                tileRect = CGRectIntersection(tileRect, _rect);
+                
+                NSMutableString *svg = [[NSMutableString alloc] init];
+                block(tileRect, column, row, svg);
+                success = [self writeString:svg toStream:stream error:&tileError];
+            }
+            if (success == NO) {
+                if (error) {
+                    *error = tileError;
+                }
+                return NO;
+            }
+        }
+    }
+    return YES;
+}
+
+- (BOOL)writeSVGToStream:(NSOutputStream *)stream error:(NSError **)error
+{
+    if (CGRectIsNull(_rect) || CGRectIsEmpty(_rect)) {
+        if (error) {
+            *error = TBCanvasExporterError(2, @"The exported rectangle is empty.");
+        }
+        return NO;
+    }
+    
+    NSString *header = [NSString stringWithFormat:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%.1f\" height=\"%.1f\" viewBox=\"%.1f %.1f %.1f %.1f\">\n"
+                        "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"#ffffff\"/>\n"
+                        "<g fill=\"none\" stroke=\"#aaaaaa\" stroke-width=\"%.1f\" stroke-linecap=\"round\">\n",
+                        _rect.size.width, _rect.size.height, _rect.origin.x, _rect.origin.y, _rect.size.width, _rect.size.height,
+                        _rect.origin.x, _rect.origin.y, _rect.size.width, _rect.size.height,
+                        EDGE_LINE_WIDTH];
+    if ([self writeString:header toStream:stream error:error] == NO) {
+        return NO;
+    }
+    
+    // Connections first - nodes are drawn on top of them.
+    BOOL success = [self writeTilesToStream:stream error:error usingBlock:^(CGRect tileRect, NSUInteger column, NSUInteger row, NSMutableString *svg) {
+        for (TBCanvasRenderModel *renderModel in _renderModels) {
+            [renderModel enumerateEdgesInRect:tileRect usingBlock:^(CGRect edgeRect, CGPoint start, CGPoint controlPoint, CGPoint end) {
+                if ([self tileAtColumn:column row:row ownsRect:edgeRect]) {
+                    [svg appendFormat:@"<path d=\"M%.1f %.1fQ%.1f %.1f %.1f %.1f\"/>\n", start.x, start.y, controlPoint.x, controlPoint.y, end.x, end.y];
+                }
+            }];
+        }
+    }];
+    if (success == NO) {
+        return NO;
+    }
+    
+    NSString *separator = [NSString stringWithFormat:@"</g>\n<g fill=\"#ffffff\" stroke=\"#aaaaaa\" stroke-width=\"%.1f\">\n", NODE_BORDER_WIDTH];
+    if ([self writeString:separator toStream:stream error:error] == NO) {
+        return NO;
+    }
+    
+    success = [self writeTilesToStream:stream error:error usingBlock:^(CGRect tileRect, NSUInteger column, NSUInteger row, NSMutableString *svg) {
+        for (TBCanvasRenderModel *renderModel in _renderModels) {
+            [renderModel enumerateNodesInRect:tileRect usingBlock:^(CGRect nodeRect) {
+                if ([self tileAtColumn:column row:row ownsRect:nodeRect]) {
+                    CGRect borderRect = CGRectInset(nodeRect, NODE_BORDER_WIDTH * 0.5, NODE_BORDER_WIDTH * 0.5);
+                    [svg appendFormat:@"<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\"/>\n", borderRect.origin.x, borderRect.origin.y, borderRect.size.width, borderRect.size.height];
+                }
+            }];
+        }
+    }];
+    if (success == NO) {
+        return NO;
+    }
+    
+    return [self writeString:@"</g>\n</svg>\n" toStream:stream error:error];
+}
+
+#pragma mark - PNG
+
+- (BOOL)writeChunkOfType:(const char *)type bytes:(const void *)bytes length:(NSUInteger)length toStream:(NSOutputStream *)stream error:(NSError **)error
+{
+    uint8_t header[8];
+    OSWriteBigInt32(header, 0, (uint32_t)length);
+    memcpy(header + 4, type, 4);
+    
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    if (length > 0) {
+        crc = crc32(crc, bytes, (uInt)length);
+    }
+    
+    uint8_t footer[4];
+    OSWriteBigInt32(footer, 0, (uint32_t)crc);
+    
+    return ([self writeBytes:header length:8 toStream:stream error:error] &&
+            [self writeBytes:bytes length:length toStream:stream error:error] &&
+            [self writeBytes:footer length:4 toStream:stream error:error]);
+}
+
+- (BOOL)deflate:(z_stream *)zstream flush:(int)flush chunk:(uint8_t *)chunk toStream:(NSOutputStream *)stream error:(NSError **)error
+{
+    int result = Z_OK;
+    
+    do {
+        result = deflate(zstream, flush);
+        if (result == Z_STREAM_ERROR) {
+            if (error) {
+                *error = TBCanvasExporterError(3, @"The image could not be compressed.");
+            }
+            return NO;
+        }
+        
+        if (zstream->avail_out == 0 || flush == Z_FINISH) {
+            NSUInteger length = EXPORT_CHUNK_SIZE - zstream->avail_out;
+            if (length > 0 && [self writeChunkOfType:"IDAT" bytes:chunk length:length toStream:stream error:error] == NO) {
+                return NO;
+            }
+            zstream->next_out = chunk;
+            zstream->avail_out = (uInt)EXPORT_CHUNK_SIZE;
+        }
+    } while (zstream->avail_in > 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    
+    return YES;
+}
+
+- (BOOL)writePNGToStream:(NSOutputStream *)stream error:(NSError **)error
+{
+    size_t width = CGRectIsNull(_rect) ? 0 : (size_t)ceil(_rect.size.width * _scale);
+    size_t height = CGRectIsNull(_rect) ? 0 : (size_t)ceil(_rect.size.height * _scale);
+    if (width == 0 || height == 0 || width > INT32_MAX / 4 || height > INT32_MAX) {
+        if (error) {
+            *error = TBCanvasExporterError(2, @"The exported rectangle is empty or too large.");
+        }
+        return NO;
+    }
+    
+    // The whole image is rasterized into one strip bitmap of bounded size, top to bottom.
+    size_t bytesPerRow = width * 4;
+    size_t stripHeight = MAX(1, MIN(height, _maximumBufferSize / bytesPerRow));
+    size_t rowLength = 1 + width * 3;
+    
+    uint8_t *pixels = malloc(bytesPerRow * stripHeight);
+    uint8_t *row = malloc(rowLength);
+    uint8_t *chunk = malloc(EXPORT_CHUNK_SIZE);
+    
+    CGContextRef context = NULL;
+    if (pixels) {
+        CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+        context = CGBitmapContextCreate(pixels, width, stripHeight, 8, bytesPerRow, colorSpace, (CGBitmapInfo)kCGImageAlphaNoneSkipLast);
+        CGColorSpaceRelease(colorSpace);
+    }
+    
+    z_stream zstream;
+    memset(&zstream, 0, sizeof(z_stream));
+    
+    BOOL success = NO;
+    if (context == NULL || row == NULL || chunk == NULL || deflateInit(&zstream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        if (error) {
+            *error = TBCanvasExporterError(3, @"The image could not be rasterized.");
+        }
+    } else {
+        zstream.next_out = chunk;
+        zstream.avail_out = (uInt)EXPORT_CHUNK_SIZE;
+        
+        // 8 bit RGB without interlacing.
+        uint8_t header[13] = {0};
+        OSWriteBigInt32(header, 0, (uint32_t)width);
+        OSWriteBigInt32(header, 4, (uint32_t)height);
+        header[8] = 8;
+        header[9] = 2;
+        
+        success = ([self writeBytes:PNG_SIGNATURE length:8 toStream:stream error:error] &&
+                   [self writeChunkOfType:"IHDR" bytes:header length:13 toStream:stream error:error]);
+        
+        NSError *stripError = nil;
+        for (size_t y = 0; success && y < height; y += stripHeight) {
+            @autoreleasepool {
+                CGRect stripRect = CGRectMake(_rect.origin.x, _rect.origin.y + y / _scale, _rect.size.width, stripHeight / _scale);
+                
+                CGContextSaveGState(context);
+                CGContextSetRGBFillColor(context, 1.0, 1.0, 1.0, 1.0);
+                CGContextFillRect(context, CGRectMake(0.0, 0.0, width, stripHeight));
+                
+                // Bitmap contexts have their origin in the bottom left corner. The canvas has it in the top left corner.
+                CGContextTranslateCTM(context, 0.0, stripHeight);
+                CGContextScaleCTM(context, _scale, -_scale);
+                CGContextTranslateCTM(context, -stripRect.origin.x, -stripRect.origin.y);
+                
+                for (TBCanvasRenderModel *renderModel in _renderModels) {
+                    [renderModel drawRect:stripRect inContext:context];
+                }
+                CGContextRestoreGState(context);
+                
+                size_t rowCount = MIN(stripHeight, height - y);
+                for (size_t r = 0; success && r < rowCount; r++) {
+                    const uint8_t *source = pixels + r * bytesPerRow;
+                    row[0] = 0;
+                    for (size_t x = 0; x < width; x++) {
+                        memcpy(row + 1 + x * 3, source + x * 4, 3);
+                    }
+                    
+                    zstream.next_in = row;
+                    zstream.avail_in = (uInt)rowLength;
+                    success = [self deflate:&zstream flush:Z_NO_FLUSH chunk:chunk toStream:stream error:&stripError];
+                }
+            }
+        }
+        
+        if (success) {
+            success = ([self deflate:&zstream flush:Z_FINISH chunk:chunk toStream:stream error:&stripError] &&
+                       [self writeChunkOfType:"IEND" bytes:NULL length:0 toStream:stream error:&stripError]);
+        }
+        if (success == NO && stripError && error) {
+            *error = stripError;
+        }
+        deflateEnd(&zstream);
+    }
+    
+    CGContextRelease(context);
+    free(pixels);
+    free(row);
+    free(chunk);
+    return success;
+}
+
+@end
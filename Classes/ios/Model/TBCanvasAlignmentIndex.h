@@ -0,0 +1,103 @@
+//
+//  TBCanvasAlignmentIndex.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+/**
+ The axis of an alignment.
+ */
+typedef NS_ENUM(NSInteger, TBCanvasAlignmentAxis) {
+    TBCanvasAlignmentAxisX = 0,
+    TBCanvasAlignmentAxisY
+};
+
+/**
+ The result of an alignment query on a single axis.
+ 
+ offset is the distance the queried rectangle has to be moved to be aligned, guide is the position of the guide line on the axis
+ and index is the index of the rectangle aligned to - NSNotFound when nothing is in reach.
+ */
+typedef struct {
+    CGFloat offset;
+    CGFloat guide;
+    NSUInteger index;
+} TBCanvasAlignment;
+
+/**
+ This class finds the nearest edge or center line of stored rectangles on each axis.
+ 
+ The left edges, horizontal centers and right edges of all rectangles are kept in one sorted list, the top edges, vertical centers and bottom edges
+ in another. Moving a rectangle does not reorder the lists - its old entries are skipped and its new ones are inserted into a short sorted pending
+ list per axis which is merged into the sorted lists in a single pass once it grows beyond the square root of the number of rectangles.
+ A query is a binary search into the sorted and the pending lists.
+ 
+ An instance is not thread safe. Separate instances can be used on separate threads.
+ */
+@interface TBCanvasAlignmentIndex : NSObject
+
+/**
+ Stores a rectangle for a given index. Replaces the rectangle previously stored for this index.
+ 
+ @param rect  The given rectangle
+ @param index The given index
+ */
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index;
+
+/**
+ Returns the rectangle stored for a given index.
+ 
+ @param index The given index
+ 
+ @return The rectangle. CGRectNull when no rectangle is stored for the index.
+ */
+- (CGRect)rectForIndex:(NSUInteger)index;
+
+/**
+ Removes the rectangle stored for a given index.
+ 
+ @param index The given index
+ */
+- (void)removeIndex:(NSUInteger)index;
+
+/**
+ Shifts all stored indexes starting at a given index by a given delta without sorting the lists again.
+ When shifting down the indexes in front of the given index that are overwritten must have been removed before.
+ 
+ @param index The first index to shift
+ @param delta The number of positions to shift by. Negative to shift down
+ */
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta;
+
+/**
+ Replaces all rectangles with a list of rectangles. The rectangle at position i is stored for index i.
+ 
+ @param rects The list of rectangles
+ @param count The number of rectangles in the list
+ */
+- (void)loadRects:(const CGRect *)rects count:(NSUInteger)count;
+
+/**
+ Removes all rectangles.
+ */
+- (void)removeAllIndexes;
+
+/**
+ Finds the edge or center line of a stored rectangle nearest to an edge or the center line of a given rectangle on a given axis.
+ 
+ @param rect            The given rectangle
+ @param axis            The given axis
+ @param tolerance       The maximum distance of an alignment
+ @param excludedIndexes The indexes of the rectangles to leave out - usually the ones being moved. Can be `nil`
+ 
+ @return The nearest alignment. Its index is NSNotFound when no line is within the tolerance.
+ */
+- (TBCanvasAlignment)alignmentOfRect:(CGRect)rect onAxis:(TBCanvasAlignmentAxis)axis tolerance:(CGFloat)tolerance excludingIndexes:(NSIndexSet *)excludedIndexes;
+
+@end
@@ -0,0 +1,483 @@
+//
+//  TBCanvasAlignmentIndex.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasAlignmentIndex.h"
+
+/**
+ A single edge or center line of a stored rectangle.
+ */
+typedef struct {
+    CGFloat value;
+    NSUInteger index;
+} TBCanvasAlignmentEntry;
+
+static NSUInteger ALIGNMENT_LINE_COUNT  = 3;
+static NSUInteger ALIGNMENT_MIN_PENDING = 64;
+
+/**
+ Writes the two edges and the center line of a rectangle on a given axis into a list of three values.
+ */
+static void TBCanvasAlignmentLinesOfRect(CGRect rect, TBCanvasAlignmentAxis axis, CGFloat *lines)
+{
+    if (axis == TBCanvasAlignmentAxisX) {
+        lines[0] = CGRectGetMinX(rect);
+        lines[1] = CGRectGetMidX(rect);
+        lines[2] = CGRectGetMaxX(rect);
+    } else {
+        lines[0] = CGRectGetMinY(rect);
+        lines[1] = CGRectGetMidY(rect);
+        lines[2] = CGRectGetMaxY(rect);
+    }
+}
+
+static int TBCanvasAlignmentEntryCompare(const void *first, const void *second)
+{
+    const TBCanvasAlignmentEntry *a = first;
+    const TBCanvasAlignmentEntry *b = second;
+    
+    if (a->value != b->value) {
+        return (a->value < b->value) ? -1 : 1;
+    }
+    if (a->index != b->index) {
+        return (a->index < b->index) ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ Returns the position of the first entry of a sorted list which does not compare below a given entry.
+ */
+static NSUInteger TBCanvasAlignmentLowerBound(const TBCanvasAlignmentEntry *list, NSUInteger count, TBCanvasAlignmentEntry entry)
+{
+    NSUInteger low = 0;
+    NSUInteger high = count;
+    
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (TBCanvasAlignmentEntryCompare(&list[middle], &entry) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+@interface TBCanvasAlignmentIndex()
+{
+    CGRect *rects;
+    BOOL *sorted;
+    BOOL *pending;
+    NSUInteger capacity;
+    
+    TBCanvasAlignmentEntry *entries[2];
+    NSUInteger entryCount[2];
+    NSUInteger staleCount;
+    
+    TBCanvasAlignmentEntry *pendingEntries[2];
+    NSUInteger pendingCount[2];
+    NSUInteger pendingCapacity;
+}
+
+/** @name Storage */
+
+/**
+ Grows the storage to hold a given index.
+ 
+ @param index The given index
+ */
+- (void)ensureCapacityForIndex:(NSUInteger)index;
+
+/**
+ Marks the entries of a given index in the sorted lists as outdated. Outdated entries are skipped by queries.
+ 
+ @param index The given index
+ */
+- (void)invalidateEntriesOfIndex:(NSUInteger)index;
+
+/**
+ Inserts the entries of the current rectangle of a given index into the sorted pending lists.
+ 
+ @param index The given index
+ */
+- (void)insertPendingEntriesOfIndex:(NSUInteger)index;
+
+/**
+ Removes the entries of the current rectangle of a given index from the sorted pending lists. Call before the rectangle is replaced.
+ 
+ @param index The given index
+ */
+- (void)removePendingEntriesOfIndex:(NSUInteger)index;
+
+/**
+ Merges the pending lists into the sorted lists once there are too many pending indexes or outdated entries.
+ */
+- (void)mergePendingIndexesIfNeeded;
+
+/**
+ Drops all outdated entries from the sorted lists and merges the pending lists into them.
+ */
+- (void)mergePendingIndexes;
+
+/** @name Querying */
+
+/**
+ Finds the entry of a sorted list nearest to a given value which is neither outdated nor excluded and closer than the current best alignment.
+ 
+ @param value           The given value
+ @param list            The sorted list
+ @param count           The number of entries in the list
+ @param skipOutdated    `YES` to skip outdated entries. Entries of the pending lists are never outdated
+ @param excludedIndexes The indexes of the rectangles to leave out. Can be `nil`
+ @param alignment       The current best alignment. Replaced when a closer entry is found
+ @param bestDistance    The distance of the current best alignment. Replaced when a closer entry is found
+ */
+- (void)alignValue:(CGFloat)value toList:(const TBCanvasAlignmentEntry *)list count:(NSUInteger)count skippingOutdatedEntries:(BOOL)skipOutdated excludingIndexes:(NSIndexSet *)excludedIndexes alignment:(TBCanvasAlignment *)alignment bestDistance:(CGFloat *)bestDistance;
+
+@end
+
+@implementation TBCanvasAlignmentIndex
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        rects = NULL;
+        sorted = NULL;
+        pending = NULL;
+        capacity = 0;
+        
+        entries[TBCanvasAlignmentAxisX] = NULL;
+        entries[TBCanvasAlignmentAxisY] = NULL;
+        entryCount[TBCanvasAlignmentAxisX] = 0;
+        entryCount[TBCanvasAlignmentAxisY] = 0;
+        staleCount = 0;
+        
+        pendingEntries[TBCanvasAlignmentAxisX] = NULL;
+        pendingEntries[TBCanvasAlignmentAxisY] = NULL;
+        pendingCount[TBCanvasAlignmentAxisX] = 0;
+        pendingCount[TBCanvasAlignmentAxisY] = 0;
+        pendingCapacity = 0;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(rects);
+    free(sorted);
+    free(pending);
+    free(entries[TBCanvasAlignmentAxisX]);
+    free(entries[TBCanvasAlignmentAxisY]);
+    free(pendingEntries[TBCanvasAlignmentAxisX]);
+    free(pendingEntries[TBCanvasAlignmentAxisY]);
+}
+
+#pragma mark - Storage
+
+- (void)ensureCapacityForIndex:(NSUInteger)index
+{
+    if (index < capacity) {
+        return;
+    }
+    
+    NSUInteger newCapacity = MAX(index + 1, capacity * 2);
+    rects = realloc(rects, newCapacity * sizeof(CGRect));
+    sorted = realloc(sorted, newCapacity * sizeof(BOOL));
+    pending = realloc(pending, newCapacity * sizeof(BOOL));
+    
+    for (NSUInteger i = capacity; i < newCapacity; i++) {
+        rects[i] = CGRectNull;
+        sorted[i] = NO;
+        pending[i] = NO;
+    }
+    capacity = newCapacity;
+}
+
+- (void)invalidateEntriesOfIndex:(NSUInteger)index
+{
+    if (sorted[index]) {
+        sorted[index] = NO;
+        staleCount++;
+    }
+}
+
+- (void)insertPendingEntriesOfIndex:(NSUInteger)index
+{
+    if (pendingCount[TBCanvasAlignmentAxisX] + ALIGNMENT_LINE_COUNT > pendingCapacity) {
+        pendingCapacity = MAX(ALIGNMENT_MIN_PENDING * ALIGNMENT_LINE_COUNT, pendingCapacity * 2);
+        pendingEntries[TBCanvasAlignmentAxisX] = realloc(pendingEntries[TBCanvasAlignmentAxisX], pendingCapacity * sizeof(TBCanvasAlignmentEntry));
+        pendingEntries[TBCanvasAlignmentAxisY] = realloc(pendingEntries[TBCanvasAlignmentAxisY], pendingCapacity * sizeof(TBCanvasAlignmentEntry));
+    }
+    
+    for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+        TBCanvasAlignmentEntry *list = pendingEntries[axis];
+        CGFloat lines[3];
+        TBCanvasAlignmentLinesOfRect(rects[index], axis, lines);
+        
+        for (NSUInteger line = 0; line < ALIGNMENT_LINE_COUNT; line++) {
+            TBCanvasAlignmentEntry entry = {lines[line], index};
+            NSUInteger position = TBCanvasAlignmentLowerBound(list, pendingCount[axis], entry);
+            memmove(list + position + 1, list + position, (pendingCount[axis] - position) * sizeof(TBCanvasAlignmentEntry));
+            list[position] = entry;
+            pendingCount[axis]++;
+        }
+    }
+    pending[index] = YES;
+}
+
+- (void)removePendingEntriesOfIndex:(NSUInteger)index
+{
+    if (pending[index] == NO) {
+        return;
+    }
+    
+    for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+        TBCanvasAlignmentEntry *list = pendingEntries[axis];
+        CGFloat lines[3];
+        TBCanvasAlignmentLinesOfRect(rects[index], axis, lines);
+        
+        for (NSUInteger line = 0; line < ALIGNMENT_LINE_COUNT; line++) {
+            TBCanvasAlignmentEntry entry = {lines[line], index};
+            NSUInteger position = TBCanvasAlignmentLowerBound(list, pendingCount[axis], entry);
+            if (position < pendingCount[axis] && TBCanvasAlignmentEntryCompare(&list[position], &entry) == 0) {
+                memmove(list + position, list + position + 1, (pendingCount[axis] - position - 1) * sizeof(TBCanvasAlignmentEntry));
+                pendingCount[axis]--;
+            }
+        }
+    }
+    pending[index] = NO;
+}
+
+- (void)mergePendingIndexesIfNeeded
+{
+    // Inserting into the pending lists costs their length, merging costs the length of the sorted lists. The square root balances both.
+    NSUInteger limit = MAX(ALIGNMENT_MIN_PENDING, (NSUInteger)sqrt(entryCount[TBCanvasAlignmentAxisX] / ALIGNMENT_LINE_COUNT));
+    if (pendingCount[TBCanvasAlignmentAxisX] / ALIGNMENT_LINE_COUNT + staleCount > limit) {
+        [self mergePendingIndexes];
+    }
+}
+
+- (void)mergePendingIndexes
+{
+    for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+        
+        // Drop the outdated entries in place.
+        TBCanvasAlignmentEntry *list = entries[axis];
+        NSUInteger keptCount = 0;
+        for (NSUInteger i = 0; i < entryCount[axis]; i++) {
+            if (sorted[list[i].index]) {
+                list[keptCount++] = list[i];
+            }
+        }
+        
+        // Merge both sorted lists from the back so the kept entries do not have to be copied.
+        const TBCanvasAlignmentEntry *pendingList = pendingEntries[axis];
+        NSUInteger count = pendingCount[axis];
+        list = realloc(list, MAX(1, keptCount + count) * sizeof(TBCanvasAlignmentEntry));
+        NSUInteger k = keptCount;
+        NSUInteger p = count;
+        NSUInteger target = keptCount + count;
+        while (p > 0) {
+            if (k > 0 && TBCanvasAlignmentEntryCompare(&list[k - 1], &pendingList[p - 1]) > 0) {
+                list[--target] = list[--k];
+            } else {
+                list[--target] = pendingList[--p];
+            }
+        }
+        entries[axis] = list;
+        entryCount[axis] = keptCount + count;
+    }
+    
+    for (NSUInteger i = 0; i < pendingCount[TBCanvasAlignmentAxisX]; i++) {
+        NSUInteger index = pendingEntries[TBCanvasAlignmentAxisX][i].index;
+        sorted[index] = YES;
+        pending[index] = NO;
+    }
+    pendingCount[TBCanvasAlignmentAxisX] = 0;
+    pendingCount[TBCanvasAlignmentAxisY] = 0;
+    staleCount = 0;
+}
+
+#pragma mark - Editing
+
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index
+{
+    if (CGRectIsNull(rect)) {
+        [self removeIndex:index];
+        return;
+    }
+    
+    [self ensureCapacityForIndex:index];
+    [self removePendingEntriesOfIndex:index];
+    [self invalidateEntriesOfIndex:index];
+    rects[index] = rect;
+    [self insertPendingEntriesOfIndex:index];
+    [self mergePendingIndexesIfNeeded];
+}
+
+- (CGRect)rectForIndex:(NSUInteger)index
+{
+    return (index < capacity) ? rects[index] : CGRectNull;
+}
+
+- (void)removeIndex:(NSUInteger)index
+{
+    if (index >= capacity) {
+        return;
+    }
+    
+    [self removePendingEntriesOfIndex:index];
+    [self invalidateEntriesOfIndex:index];
+    rects[index] = CGRectNull;
+    [self mergePendingIndexesIfNeeded];
+}
+
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta
+{
+    NSUInteger end = capacity;
+    while (end > index && CGRectIsNull(rects[end - 1])) {
+        end--;
+    }
+    if (delta == 0 || end <= index) {
+        return;
+    }
+    
+    // Renaming keeps the lists sorted - shifted entries stay behind all other entries of equal value. Outdated entries are dropped on the way.
+    for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+        TBCanvasAlignmentEntry *list = entries[axis];
+        NSUInteger keptCount = 0;
+        for (NSUInteger i = 0; i < entryCount[axis]; i++) {
+            if (sorted[list[i].index] == NO) {
+                continue;
+            }
+            if (list[i].index >= index) {
+                list[i].index += delta;
+            }
+            list[keptCount++] = list[i];
+        }
+        entryCount[axis] = keptCount;
+        
+        TBCanvasAlignmentEntry *pendingList = pendingEntries[axis];
+        for (NSUInteger i = 0; i < pendingCount[axis]; i++) {
+            if (pendingList[i].index >= index) {
+                pendingList[i].index += delta;
+            }
+        }
+    }
+    staleCount = 0;
+    
+    if (delta > 0) {
+        [self ensureCapacityForIndex:end - 1 + delta];
+    }
+    memmove(rects + index + delta, rects + index, (end - index) * sizeof(CGRect));
+    memmove(sorted + index + delta, sorted + index, (end - index) * sizeof(BOOL));
+    memmove(pending + index + delta, pending + index, (end - index) * sizeof(BOOL));
+    NSUInteger clearedStart = (delta > 0) ? index : end + delta;
+    for (NSUInteger i = clearedStart; i < clearedStart + labs(delta); i++) {
+        rects[i] = CGRectNull;
+        sorted[i] = NO;
+        pending[i] = NO;
+    }
+}
+
+- (void)loadRects:(const CGRect *)newRects count:(NSUInteger)count
+{
+    for (NSUInteger i = 0; i < capacity; i++) {
+        rects[i] = CGRectNull;
+        sorted[i] = NO;
+        pending[i] = NO;
+    }
+    if (count > 0) {
+        [self ensureCapacityForIndex:count - 1];
+        memcpy(rects, newRects, count * sizeof(CGRect));
+    }
+    pendingCount[TBCanvasAlignmentAxisX] = 0;
+    pendingCount[TBCanvasAlignmentAxisY] = 0;
+    staleCount = 0;
+    
+    for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+        TBCanvasAlignmentEntry *list = realloc(entries[axis], MAX(1, count * ALIGNMENT_LINE_COUNT) * sizeof(TBCanvasAlignmentEntry));
+        NSUInteger listCount = 0;
+        
+        for (NSUInteger index = 0; index < count; index++) {
+            if (CGRectIsNull(rects[index])) {
+                continue;
+            }
+            CGFloat lines[3];
+            TBCanvasAlignmentLinesOfRect(rects[index], axis, lines);
+            for (NSUInteger line = 0; line < ALIGNMENT_LINE_COUNT; line++) {
+                list[listCount].value = lines[line];
+                list[listCount].index = index;
+                listCount++;
+            }
+            sorted[index] = YES;
+        }
+        qsort(list, listCount, sizeof(TBCanvasAlignmentEntry), TBCanvasAlignmentEntryCompare);
+        
+        entries[axis] = list;
+        entryCount[axis] = listCount;
+    }
+}
+
+- (void)removeAllIndexes
+{
+    [self loadRects:NULL count:0];
+}
+
+#pragma mark - Querying
+
+- (void)alignValue:(CGFloat)value toList:(const TBCanvasAlignmentEntry *)list count:(NSUInteger)count skippingOutdatedEntries:(BOOL)skipOutdated excludingIndexes:(NSIndexSet *)excludedIndexes alignment:(TBCanvasAlignment *)alignment bestDistance:(CGFloat *)bestDistance
+{
+    // Walk outwards from the insertion point - nearest entries first - until the first usable entry.
+    TBCanvasAlignmentEntry probe = {value, 0};
+    NSUInteger right = TBCanvasAlignmentLowerBound(list, count, probe);
+    NSUInteger left = right;
+    while (left > 0 || right < count) {
+        CGFloat leftDistance = (left > 0) ? value - list[left - 1].value : CGFLOAT_MAX;
+        CGFloat rightDistance = (right < count) ? list[right].value - value : CGFLOAT_MAX;
+        
+        BOOL takeLeft = (leftDistance <= rightDistance);
+        CGFloat distance = takeLeft ? leftDistance : rightDistance;
+        if (distance > *bestDistance) {
+            break;
+        }
+        
+        TBCanvasAlignmentEntry entry = takeLeft ? list[--left] : list[right++];
+        if ((skipOutdated == NO || sorted[entry.index]) && [excludedIndexes containsIndex:entry.index] == NO) {
+            if (alignment->index == NSNotFound || distance < *bestDistance) {
+                alignment->offset = entry.value - value;
+                alignment->guide = entry.value;
+                alignment->index = entry.index;
+                *bestDistance = distance;
+            }
+            break;
+        }
+    }
+}
+
+- (TBCanvasAlignment)alignmentOfRect:(CGRect)rect onAxis:(TBCanvasAlignmentAxis)axis tolerance:(CGFloat)tolerance excludingIndexes:(NSIndexSet *)excludedIndexes
+{
+    TBCanvasAlignment alignment = {0.0, 0.0, NSNotFound};
+    if (CGRectIsNull(rect)) {
+        return alignment;
+    }
+    
+    CGFloat lines[3];
+    TBCanvasAlignmentLinesOfRect(rect, axis, lines);
+    CGFloat bestDistance = tolerance;
+    
+    for (NSUInteger line = 0; line < ALIGNMENT_LINE_COUNT; line++) {
+        [self alignValue:lines[line] toList:entries[axis] count:entryCount[axis] skippingOutdatedEntries:YES excludingIndexes:excludedIndexes alignment:&alignment bestDistance:&bestDistance];
+        [self alignValue:lines[line] toList:pendingEntries[axis] count:pendingCount[axis] skippingOutdatedEntries:NO excludingIndexes:excludedIndexes alignment:&alignment bestDistance:&bestDistance];
+    }
+    return alignment;
+}
+
+@end
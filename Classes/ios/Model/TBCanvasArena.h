@@ -0,0 +1,105 @@
+//
+//  TBCanvasArena.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ This class hands out transient buffers that live until the next call to `reset` - usually the end of a touch frame.
+ 
+ Raw memory is taken from a single block by bumping an offset. Mutable arrays, index sets and ordered sets are lent from pools
+ and emptied on reset. When a frame needs more memory than the block holds the arena falls back to the heap and grows the block
+ to the size of that frame on the next reset. Once the block and the pools have reached the size of the busiest frame no further
+ heap allocations happen.
+ 
+ Objects stored in raw memory are not retained. An instance is not thread safe.
+ */
+@interface TBCanvasArena : NSObject
+
+/**
+ *  The number of buffers and collections handed out since the counters have been reset.
+ */
+@property (assign, nonatomic, readonly) NSUInteger allocationCount;
+
+/**
+ *  The number of heap allocations made by the arena since the counters have been reset - overflowing buffers, grown blocks and new pooled collections.
+ */
+@property (assign, nonatomic, readonly) NSUInteger heapAllocationCount;
+
+/**
+ *  The number of bytes handed out since the last reset.
+ */
+@property (assign, nonatomic, readonly) size_t bytesInUse;
+
+/**
+ *  The size of the block in bytes.
+ */
+@property (assign, nonatomic, readonly) size_t capacity;
+
+/**
+ Initializes the TBCanvasArena object with a given block size.
+ 
+ @param capacity The size of the block in bytes
+ 
+ @return The initialized TBCanvasArena object
+ */
+- (id)initWithCapacity:(size_t)capacity;
+
+/**
+ Returns a buffer which is valid until the next reset. The buffer is aligned to 16 bytes and not zeroed.
+ 
+ @param size The size of the buffer in bytes
+ 
+ @return The buffer.
+ */
+- (void *)allocateBytes:(size_t)size;
+
+/**
+ Resizes a buffer handed out by this arena. The last buffer handed out is grown in place when the block has room for it,
+ any other buffer is copied into a new one.
+ 
+ @param bytes   The buffer
+ @param oldSize The current size of the buffer in bytes
+ @param newSize The new size of the buffer in bytes
+ 
+ @return The resized buffer.
+ */
+- (void *)reallocateBytes:(void *)bytes fromSize:(size_t)oldSize toSize:(size_t)newSize;
+
+/**
+ Lends an empty mutable array until the next reset.
+ 
+ @return The mutable array.
+ */
+- (NSMutableArray *)borrowArray;
+
+/**
+ Lends an empty mutable index set until the next reset.
+ 
+ @return The mutable index set.
+ */
+- (NSMutableIndexSet *)borrowIndexSet;
+
+/**
+ Lends an empty mutable ordered set until the next reset.
+ 
+ @return The mutable ordered set.
+ */
+- (NSMutableOrderedSet *)borrowOrderedSet;
+
+/**
+ Invalidates all buffers and returns all lent collections to their pools.
+ */
+- (void)reset;
+
+/**
+ Sets allocationCount and heapAllocationCount to `0`.
+ */
+- (void)resetCounters;
+
+@end
@@ -0,0 +1,198 @@
+//
+//  TBCanvasArena.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasArena.h"
+
+static size_t ARENA_ALIGNMENT        = 16;
+static size_t ARENA_DEFAULT_CAPACITY = 64 * 1024;
+
+static size_t TBCanvasArenaAlignedSize(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+@interface TBCanvasArena()
+{
+    uint8_t *block;
+    size_t offset;
+    
+    // The last buffer taken from the block - the only one which can grow in place.
+    uint8_t *lastBuffer;
+}
+
+@property (assign, nonatomic, readwrite) NSUInteger allocationCount;
+@property (assign, nonatomic, readwrite) NSUInteger heapAllocationCount;
+@property (assign, nonatomic, readwrite) size_t bytesInUse;
+@property (assign, nonatomic, readwrite) size_t capacity;
+
+// Buffers which did not fit into the block. Released on reset.
+@property (nonatomic, strong) NSMutableArray *overflowBuffers;
+
+// Pooled collections - lent ones and ones ready to be lent, by class.
+@property (nonatomic, strong) NSMutableDictionary *lentCollections;
+@property (nonatomic, strong) NSMutableDictionary *reusableCollections;
+
+/** @name Pools */
+
+/**
+ Lends an empty collection of a given class. Creates a new one when the pool is empty.
+ 
+ @param collectionClass The given class
+ 
+ @return The collection.
+ */
+- (id)borrowCollectionOfClass:(Class)collectionClass;
+
+@end
+
+@implementation TBCanvasArena
+
+- (id)init
+{
+    return [self initWithCapacity:ARENA_DEFAULT_CAPACITY];
+}
+
+- (id)initWithCapacity:(size_t)capacity
+{
+    self = [super init];
+    if (self) {
+        _capacity = TBCanvasArenaAlignedSize(MAX(capacity, ARENA_ALIGNMENT));
+        block = malloc(_capacity);
+        _overflowBuffers = [[NSMutableArray alloc] init];
+        _lentCollections = [[NSMutableDictionary alloc] init];
+        _reusableCollections = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(block);
+}
+
+#pragma mark - Buffers
+
+- (void *)allocateBytes:(size_t)size
+{
+    size = TBCanvasArenaAlignedSize(MAX(size, 1));
+    _allocationCount++;
+    _bytesInUse += size;
+    
+    if (offset + size <= _capacity) {
+        lastBuffer = block + offset;
+        offset += size;
+        return lastBuffer;
+    }
+    
+    NSMutableData *overflowBuffer = [[NSMutableData alloc] initWithLength:size];
+    [_overflowBuffers addObject:overflowBuffer];
+    _heapAllocationCount++;
+    lastBuffer = NULL;
+    return overflowBuffer.mutableBytes;
+}
+
+- (void *)reallocateBytes:(void *)bytes fromSize:(size_t)oldSize toSize:(size_t)newSize
+{
+    if (bytes == NULL) {
+        return [self allocateBytes:newSize];
+    }
+    
+    size_t alignedOldSize = TBCanvasArenaAlignedSize(MAX(oldSize, 1));
+    size_t alignedNewSize = TBCanvasArenaAlignedSize(MAX(newSize, 1));
+    
+    if (bytes == lastBuffer && (lastBuffer - block) + alignedNewSize <= _capacity) {
+        offset = (lastBuffer - block) + alignedNewSize;
+        _bytesInUse = _bytesInUse - alignedOldSize + alignedNewSize;
+        _allocationCount++;
+        return bytes;
+    }
+    
+    void *resizedBytes = [self allocateBytes:newSize];
+    memcpy(resizedBytes, bytes, MIN(oldSize, newSize));
+    return resizedBytes;
+}
+
+#pragma mark - Pools
+
+- (NSMutableArray *)borrowArray
+{
+    return [self borrowCollectionOfClass:[NSMutableArray class]];
+}
+
+- (NSMutableIndexSet *)borrowIndexSet
+{
+    return [self borrowCollectionOfClass:[NSMutableIndexSet class]];
+}
+
+- (NSMutableOrderedSet *)borrowOrderedSet
+{
+    return [self borrowCollectionOfClass:[NSMutableOrderedSet class]];
+}
+
+- (id)borrowCollectionOfClass:(Class)collectionClass
+{
+    id<NSCopying> key = (id<NSCopying>)collectionClass;
+    NSMutableArray *reusable = _reusableCollections[key];
+    NSMutableArray *lent = _lentCollections[key];
+    if (lent == nil) {
+        reusable = [[NSMutableArray alloc] init];
+        lent = [[NSMutableArray alloc] init];
+        _reusableCollections[key] = reusable;
+        _lentCollections[key] = lent;
+    }
+    
+    id collection = reusable.lastObject;
+    if (collection) {
+        [reusable removeLastObject];
+    } else {
+        collection = [[collectionClass alloc] init];
+        _heapAllocationCount++;
+    }
+    [lent addObject:collection];
+    _allocationCount++;
+    return collection;
+}
+
+#pragma mark - Resetting
+
+- (void)reset
+{
+    // Grow the block to the size of this frame so that the next one fits.
+    if (_overflowBuffers.count > 0) {
+        free(block);
+        _capacity = MAX(_capacity * 2, TBCanvasArenaAlignedSize(_bytesInUse));
+        block = malloc(_capacity);
+        _heapAllocationCount++;
+        [_overflowBuffers removeAllObjects];
+    }
+    offset = 0;
+    lastBuffer = NULL;
+    _bytesInUse = 0;
+    
+    for (id key in _lentCollections) {
+        NSMutableArray *lent = _lentCollections[key];
+        for (id collection in lent) {
+            if ([collection isKindOfClass:[NSMutableIndexSet class]]) {
+                [collection removeAllIndexes];
+            } else {
+                [collection removeAllObjects];
+            }
+        }
+        [_reusableCollections[key] addObjectsFromArray:lent];
+        [lent removeAllObjects];
+    }
+}
+
+- (void)resetCounters
+{
+    _allocationCount = 0;
+    _heapAllocationCount = 0;
+}
+
+@end
@@ -0,0 +1,194 @@
+//
+//  TBCanvasClusterIndex.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+/**
+ This class represents an aggregate of all items whose center lies inside a single cell of a TBCanvasClusterIndex level.
+ */
+@interface TBCanvasCluster : NSObject
+
+/**
+ *  The level of the cluster. Level 0 has the smallest cells.
+ */
+@property (assign, nonatomic, readonly) NSUInteger level;
+
+/**
+ *  The key of the cell of the cluster inside its level.
+ */
+@property (assign, nonatomic, readonly) int64_t cellKey;
+
+/**
+ *  The number of items inside the cluster.
+ */
+@property (assign, nonatomic, readonly) NSUInteger count;
+
+/**
+ *  The smallest rectangle around all items of the cluster.
+ */
+@property (assign, nonatomic, readonly) CGRect bounds;
+
+/**
+ *  The number of edges connecting two items inside the cluster.
+ */
+@property (assign, nonatomic, readonly) NSUInteger internalEdgeCount;
+
+/**
+ *  The bundled edges leaving the cluster. Maps the cell key of the cluster on the other end to the number of edges.
+ */
+@property (strong, nonatomic, readonly) NSDictionary *bundles;
+
+/**
+ Returns the average center of all items inside the cluster.
+ 
+ @return The centroid of the cluster.
+ */
+- (CGPoint)centroid;
+
+@end
+
+/**
+ This class aggregates rectangles and the edges between them in a hierarchy of grids.
+ 
+ Every level doubles the cell size of the level below - four cells of a level form one cell of the next level.
+ Each cell holds the item count, the bounds and the bundled edges of the items centered inside it.
+ Moving a single item or adding or removing a single edge only touches one cell per level.
+ 
+ An instance is not thread safe. Separate instances can be used on separate threads.
+ */
+@interface TBCanvasClusterIndex : NSObject
+
+/**
+ *  The cell size of level 0.
+ */
+@property (assign, nonatomic, readonly) CGFloat baseCellSize;
+
+/**
+ *  The number of levels.
+ */
+@property (assign, nonatomic, readonly) NSUInteger levelCount;
+
+/**
+ Initializes the TBCanvasClusterIndex object.
+ 
+ @param baseCellSize The cell size of level 0
+ @param levelCount   The number of levels
+ 
+ @return The initialized TBCanvasClusterIndex object
+ */
+- (id)initWithBaseCellSize:(CGFloat)baseCellSize levelCount:(NSUInteger)levelCount;
+
+/**
+ Returns the cell size of a given level.
+ 
+ @param level The given level
+ 
+ @return The edge length of a cell.
+ */
+- (CGFloat)cellSizeAtLevel:(NSUInteger)level;
+
+/**
+ Returns the lowest level whose cells are at least as large as a given size.
+ 
+ @param size The given size
+ 
+ @return The level. The highest level when no level is large enough.
+ */
+- (NSUInteger)levelForClusterSize:(CGFloat)size;
+
+/**
+ Stores a rectangle for a given index. Replaces the rectangle previously stored for this index.
+ 
+ @param rect  The given rectangle
+ @param index The given index
+ */
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index;
+
+/**
+ Removes the rectangle stored for a given index. The edges of the index are kept.
+ 
+ @param index The given index
+ */
+- (void)removeIndex:(NSUInteger)index;
+
+/**
+ Replaces all rectangles with a list of rectangles. The rectangle at position i is stored for index i. The edges are kept.
+ 
+ @param rects The list of rectangles
+ @param count The number of rectangles in the list
+ */
+- (void)loadRects:(const CGRect *)rects count:(NSUInteger)count;
+
+/**
+ Shifts all stored indexes and the edges between them starting at a given index by a given delta. The clusters are kept.
+ When shifting down the indexes in front of the given index that are overwritten must have been removed together with their edges before.
+ 
+ @param index The first index to shift
+ @param delta The number of positions to shift by. Negative to shift down
+ */
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta;
+
+/**
+ Removes all rectangles. The edges are kept.
+ */
+- (void)removeAllIndexes;
+
+/**
+ Adds an edge between two indexes.
+ 
+ @param fromIndex The index at one end of the edge
+ @param toIndex   The index at the other end of the edge
+ */
+- (void)addEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+/**
+ Removes an edge between two indexes.
+ 
+ @param fromIndex The index at one end of the edge
+ @param toIndex   The index at the other end of the edge
+ */
+- (void)removeEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+/**
+ Removes all edges.
+ */
+- (void)removeAllEdges;
+
+/**
+ Returns all clusters of a given level whose cell intersects a given rectangle.
+ 
+ @param level The given level
+ @param rect  The given rectangle
+ 
+ @return The TBCanvasCluster objects.
+ */
+- (NSArray *)clustersAtLevel:(NSUInteger)level inRect:(CGRect)rect;
+
+/**
+ Returns the cluster of a given level with a given cell key.
+ 
+ @param cellKey The given cell key
+ @param level   The given level
+ 
+ @return The TBCanvasCluster object. Otherwise `nil`.
+ */
+- (TBCanvasCluster *)clusterWithCellKey:(int64_t)cellKey atLevel:(NSUInteger)level;
+
+/**
+ Returns the cluster of a given level containing a given index.
+ 
+ @param index The given index
+ @param level The given level
+ 
+ @return The TBCanvasCluster object. Otherwise `nil`.
+ */
+- (TBCanvasCluster *)clusterForIndex:(NSUInteger)index atLevel:(NSUInteger)level;
+
+@end
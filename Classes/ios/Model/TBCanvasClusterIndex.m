@@ -0,0 +1,641 @@
+//
+//  TBCanvasClusterIndex.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasClusterIndex.h"
+
+@interface TBCanvasCluster()
+{
+    double sumX;
+    double sumY;
+}
+
+@property (assign, nonatomic, readwrite) CGRect bounds;
+
+// Set to `NO` when an item has left the cluster. The bounds are recomputed before the cluster is handed out.
+@property (assign, nonatomic) BOOL boundsAreValid;
+
+// The indexes of all items inside the cluster. Only maintained on level 0.
+@property (strong, nonatomic) NSMutableIndexSet *members;
+
+// Maps the cell key of a neighbouring cluster to the number of edges between both clusters.
+@property (strong, nonatomic) NSMutableDictionary *edgeBundles;
+
+/**
+ Initializes the TBCanvasCluster object for a given cell.
+ 
+ @param level   The level of the cell
+ @param cellKey The key of the cell
+ 
+ @return The initialized TBCanvasCluster object
+ */
+- (id)initWithLevel:(NSUInteger)level cellKey:(int64_t)cellKey;
+
+/**
+ Adds an item with a given rectangle to the aggregate.
+ 
+ @param rect The rectangle of the item
+ */
+- (void)addItemWithRect:(CGRect)rect;
+
+/**
+ Removes an item with a given rectangle from the aggregate.
+ 
+ @param rect The rectangle of the item
+ */
+- (void)removeItemWithRect:(CGRect)rect;
+
+/**
+ Changes the number of edges leading to the cluster with a given cell key.
+ 
+ @param delta   The number of edges to add. Negative to remove edges
+ @param cellKey The cell key of the cluster on the other end
+ */
+- (void)addEdges:(NSInteger)delta toCellKey:(int64_t)cellKey;
+
+/**
+ Changes the number of edges inside the cluster.
+ 
+ @param delta The number of edges to add. Negative to remove edges
+ */
+- (void)addInternalEdges:(NSInteger)delta;
+
+@end
+
+@implementation TBCanvasCluster
+
+- (id)initWithLevel:(NSUInteger)level cellKey:(int64_t)cellKey
+{
+    self = [super init];
+    if (self) {
+        _level = level;
+        _cellKey = cellKey;
+        _count = 0;
+        _bounds = CGRectNull;
+        _boundsAreValid = YES;
+        _internalEdgeCount = 0;
+        _edgeBundles = [[NSMutableDictionary alloc] init];
+        _members = (level == 0) ? [[NSMutableIndexSet alloc] init] : nil;
+        
+        sumX = 0.0;
+        sumY = 0.0;
+    }
+    return self;
+}
+
+- (NSDictionary *)bundles
+{
+    return _edgeBundles;
+}
+
+- (CGPoint)centroid
+{
+    if (_count == 0) {
+        return CGPointZero;
+    }
+    return CGPointMake(sumX / _count, sumY / _count);
+}
+
+- (void)addItemWithRect:(CGRect)rect
+{
+    _count++;
+    sumX += CGRectGetMidX(rect);
+    sumY += CGRectGetMidY(rect);
+    
+    // Growing keeps the bounds valid.
+    if (_boundsAreValid) {
+        _bounds = CGRectUnion(_bounds, rect);
+    }
+}
+
+- (void)removeItemWithRect:(CGRect)rect
+{
+    _count--;
+    sumX -= CGRectGetMidX(rect);
+    sumY -= CGRectGetMidY(rect);
+    
+    _boundsAreValid = NO;
+}
+
+- (void)addEdges:(NSInteger)delta toCellKey:(int64_t)cellKey
+{
+    NSNumber *key = @(cellKey);
+    NSInteger count = [_edgeBundles[key] integerValue] + delta;
+    
+    if (count > 0) {
+        _edgeBundles[key] = @(count);
+    } else {
+        [_edgeBundles removeObjectForKey:key];
+    }
+}
+
+- (void)addInternalEdges:(NSInteger)delta
+{
+    _internalEdgeCount = (NSUInteger)MAX((NSInteger)_internalEdgeCount + delta, 0);
+}
+
+@end
+
+@interface TBCanvasClusterIndex()
+{
+    CGRect *rects;
+    NSUInteger capacity;
+    
+    // One past the largest index which may have a neighbour list.
+    NSUInteger edgesEnd;
+}
+
+// One dictionary per level. Maps the key of a cell to its TBCanvasCluster.
+@property (nonatomic, strong) NSMutableArray *levels;
+
+// Maps an index to the indexes of its neighbours - one entry per edge.
+@property (nonatomic, strong) NSMutableDictionary *edges;
+
+/**
+ Returns the key of the cell containing a given point.
+ 
+ @param point The given point
+ @param level The level of the cell
+ 
+ @return The cell key.
+ */
+- (int64_t)cellKeyForPoint:(CGPoint)point atLevel:(NSUInteger)level;
+
+/**
+ Returns the key of the cell at a given grid position.
+ 
+ @param column The column of the cell
+ @param row    The row of the cell
+ 
+ @return The cell key.
+ */
+- (int64_t)cellKeyWithColumn:(int32_t)column row:(int32_t)row;
+
+/**
+ Returns the rectangle covered by a given cell.
+ 
+ @param cellKey The key of the cell
+ @param level   The level of the cell
+ 
+ @return The rectangle of the cell.
+ */
+- (CGRect)rectForCellKey:(int64_t)cellKey atLevel:(NSUInteger)level;
+
+/**
+ Returns `YES` if a rectangle is stored for a given index.
+ 
+ @param index The given index
+ 
+ @return `YES` if the index is stored.
+ */
+- (BOOL)containsIndex:(NSUInteger)index;
+
+/**
+ Returns the neighbours of a given index. Creates the list if necessary.
+ 
+ @param index The given index
+ 
+ @return The mutable list of neighbouring indexes.
+ */
+- (NSMutableArray *)neighboursOfIndex:(NSUInteger)index;
+
+/**
+ Adds or removes a single edge to or from the bundles of all levels. Both indexes must be stored.
+ 
+ @param fromIndex The index at one end of the edge
+ @param toIndex   The index at the other end of the edge
+ @param delta     1 to add the edge. -1 to remove it
+ */
+- (void)bundleEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex delta:(NSInteger)delta;
+
+/**
+ Adds or removes all edges between a given index and its stored neighbours to or from the bundles of all levels.
+ 
+ @param index The given index
+ @param delta 1 to add the edges. -1 to remove them
+ */
+- (void)bundleEdgesOfIndex:(NSUInteger)index delta:(NSInteger)delta;
+
+/**
+ Recomputes the bounds of a given cluster if an item has left it.
+ 
+ @param cluster The given TBCanvasCluster
+ */
+- (void)validateBoundsOfCluster:(TBCanvasCluster *)cluster;
+
+@end
+
+@implementation TBCanvasClusterIndex
+
+- (id)init
+{
+    return [self initWithBaseCellSize:128.0 levelCount:8];
+}
+
+- (id)initWithBaseCellSize:(CGFloat)baseCellSize levelCount:(NSUInteger)levelCount
+{
+    self = [super init];
+    if (self) {
+        _baseCellSize = baseCellSize;
+        _levelCount = MAX(levelCount, 1);
+        _levels = [[NSMutableArray alloc] initWithCapacity:_levelCount];
+        _edges = [[NSMutableDictionary alloc] init];
+        
+        for (NSUInteger level = 0; level < _levelCount; level++) {
+            [_levels addObject:[[NSMutableDictionary alloc] init]];
+        }
+        
+        rects = NULL;
+        capacity = 0;
+        edgesEnd = 0;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(rects);
+}
+
+#pragma mark - Cells
+
+- (CGFloat)cellSizeAtLevel:(NSUInteger)level
+{
+    return ldexp(_baseCellSize, (int)level);
+}
+
+- (NSUInteger)levelForClusterSize:(CGFloat)size
+{
+    NSUInteger level = 0;
+    while (level + 1 < _levelCount && [self cellSizeAtLevel:level] < size) {
+        level++;
+    }
+    return level;
+}
+
+- (int64_t)cellKeyForPoint:(CGPoint)point atLevel:(NSUInteger)level
+{
+    CGFloat cellSize = [self cellSizeAtLevel:level];
+    return [self cellKeyWithColumn:(int32_t)floor(point.x / cellSize) row:(int32_t)floor(point.y / cellSize)];
+}
+
+- (int64_t)cellKeyWithColumn:(int32_t)column row:(int32_t)row
+{
+    return ((int64_t)row << 32) | (uint32_t)column;
+}
+
+- (CGRect)rectForCellKey:(int64_t)cellKey atLevel:(NSUInteger)level
+{
+    CGFloat cellSize = [self cellSizeAtLevel:level];
+    int32_t column = (int32_t)(uint32_t)(cellKey & 0xffffffff);
+    int32_t row    = (int32_t)(cellKey >> 32);
+    
+    return CGRectMake(column * cellSize, row * cellSize, cellSize, cellSize);
+}
+
+#pragma mark - Updating
+
+- (BOOL)containsIndex:(NSUInteger)index
+{
+    return (index < capacity && CGRectIsNull(rects[index]) == NO);
+}
+
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index
+{
+    if (CGRectIsNull(rect)) {
+        [self removeIndex:index];
+        return;
+    }
+    
+    if (index >= capacity) {
+        NSUInteger newCapacity = MAX(capacity * 2, MAX(index + 1, 64));
+        rects = realloc(rects, newCapacity * sizeof(CGRect));
+        for (NSUInteger i = capacity; i < newCapacity; i++) {
+            rects[i] = CGRectNull;
+        }
+        capacity = newCapacity;
+    }
+    
+    if (CGRectEqualToRect(rects[index], rect)) {
+        return;
+    }
+    [self removeIndex:index];
+    rects[index] = rect;
+    
+    CGPoint center = CGPointMake(CGRectGetMidX(rect), CGRectGetMidY(rect));
+    
+    for (NSUInteger level = 0; level < _levelCount; level++) {
+        NSMutableDictionary *cells = _levels[level];
+        int64_t cellKey = [self cellKeyForPoint:center atLevel:level];
+        
+        TBCanvasCluster *cluster = cells[@(cellKey)];
+        if (cluster == nil) {
+            cluster = [[TBCanvasCluster alloc] initWithLevel:level cellKey:cellKey];
+            cells[@(cellKey)] = cluster;
+        }
+        [cluster addItemWithRect:rect];
+        [cluster.members addIndex:index];
+    }
+    [self bundleEdgesOfIndex:index delta:1];
+}
+
+- (void)removeIndex:(NSUInteger)index
+{
+    if ([self containsIndex:index] == NO) {
+        return;
+    }
+    [self bundleEdgesOfIndex:index delta:-1];
+    
+    CGRect rect = rects[index];
+    CGPoint center = CGPointMake(CGRectGetMidX(rect), CGRectGetMidY(rect));
+    
+    for (NSUInteger level = 0; level < _levelCount; level++) {
+        NSMutableDictionary *cells = _levels[level];
+        int64_t cellKey = [self cellKeyForPoint:center atLevel:level];
+        
+        TBCanvasCluster *cluster = cells[@(cellKey)];
+        [cluster removeItemWithRect:rect];
+        [cluster.members removeIndex:index];
+        
+        if (cluster.count == 0) {
+            [cells removeObjectForKey:@(cellKey)];
+        }
+    }
+    rects[index] = CGRectNull;
+}
+
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta
+{
+    NSUInteger end = capacity;
+    while (end > index && CGRectIsNull(rects[end - 1])) {
+        end--;
+    }
+    
+    if (delta != 0 && end > index) {
+        if (delta > 0 && end - 1 + delta >= capacity) {
+            NSUInteger newCapacity = MAX(capacity * 2, end + delta);
+            rects = realloc(rects, newCapacity * sizeof(CGRect));
+            for (NSUInteger i = capacity; i < newCapacity; i++) {
+                rects[i] = CGRectNull;
+            }
+            capacity = newCapacity;
+        }
+        
+        // Aggregates do not depend on indexes. Only the members of the level 0 clusters holding shifted items name them.
+        NSMutableSet *shiftedCells = [[NSMutableSet alloc] init];
+        for (NSUInteger i = index; i < end; i++) {
+            if (CGRectIsNull(rects[i]) == NO) {
+                CGPoint center = CGPointMake(CGRectGetMidX(rects[i]), CGRectGetMidY(rects[i]));
+                [shiftedCells addObject:@([self cellKeyForPoint:center atLevel:0])];
+            }
+        }
+        
+        memmove(rects + index + delta, rects + index, (end - index) * sizeof(CGRect));
+        NSUInteger clearedStart = (delta > 0) ? index : end + delta;
+        for (NSUInteger i = clearedStart; i < clearedStart + labs(delta); i++) {
+            rects[i] = CGRectNull;
+        }
+        for (NSNumber *cellKey in shiftedCells) {
+            TBCanvasCluster *cluster = _levels[0][cellKey];
+            [cluster.members shiftIndexesStartingAtIndex:index by:delta];
+        }
+    }
+    
+    // Rename the shifted indexes inside the neighbour lists of themselves and their neighbours.
+    NSMutableIndexSet *owners = [[NSMutableIndexSet alloc] init];
+    NSMutableDictionary *shiftedEdges = [[NSMutableDictionary alloc] init];
+    for (NSUInteger i = index; i < edgesEnd; i++) {
+        NSMutableArray *neighbours = _edges[@(i)];
+        if (neighbours) {
+            [owners addIndex:i];
+            for (NSNumber *neighbour in neighbours) {
+                [owners addIndex:neighbour.unsignedIntegerValue];
+            }
+        }
+    }
+    [owners enumerateIndexesUsingBlock:^(NSUInteger owner, BOOL *stop) {
+        NSMutableArray *neighbours = _edges[@(owner)];
+        for (NSUInteger i = 0; i < neighbours.count; i++) {
+            NSUInteger neighbour = [neighbours[i] unsignedIntegerValue];
+            if (neighbour >= index) {
+                neighbours[i] = @(neighbour + delta);
+            }
+        }
+        if (owner >= index) {
+            [_edges removeObjectForKey:@(owner)];
+            shiftedEdges[@(owner + delta)] = neighbours;
+        }
+    }];
+    [_edges addEntriesFromDictionary:shiftedEdges];
+    if (edgesEnd > index) {
+        edgesEnd += delta;
+    }
+}
+
+- (void)loadRects:(const CGRect *)newRects count:(NSUInteger)count
+{
+    [self removeAllIndexes];
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        [self setRect:newRects[i] forIndex:i];
+    }
+}
+
+- (void)removeAllIndexes
+{
+    for (NSMutableDictionary *cells in _levels) {
+        [cells removeAllObjects];
+    }
+    for (NSUInteger i = 0; i < capacity; i++) {
+        rects[i] = CGRectNull;
+    }
+}
+
+#pragma mark - Edges
+
+- (NSMutableArray *)neighboursOfIndex:(NSUInteger)index
+{
+    NSMutableArray *neighbours = _edges[@(index)];
+    if (neighbours == nil) {
+        neighbours = [[NSMutableArray alloc] init];
+        _edges[@(index)] = neighbours;
+        edgesEnd = MAX(edgesEnd, index + 1);
+    }
+    return neighbours;
+}
+
+- (void)addEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    [[self neighboursOfIndex:fromIndex] addObject:@(toIndex)];
+    if (fromIndex != toIndex) {
+        [[self neighboursOfIndex:toIndex] addObject:@(fromIndex)];
+    }
+    
+    if ([self containsIndex:fromIndex] && [self containsIndex:toIndex]) {
+        [self bundleEdgeFromIndex:fromIndex toIndex:toIndex delta:1];
+    }
+}
+
+- (void)removeEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    NSMutableArray *fromNeighbours = _edges[@(fromIndex)];
+    NSUInteger position = [fromNeighbours indexOfObject:@(toIndex)];
+    if (position == NSNotFound) {
+        return;
+    }
+    [fromNeighbours removeObjectAtIndex:position];
+    
+    if (fromIndex != toIndex) {
+        NSMutableArray *toNeighbours = _edges[@(toIndex)];
+        NSUInteger toPosition = [toNeighbours indexOfObject:@(fromIndex)];
+        if (toPosition != NSNotFound) {
+            [toNeighbours removeObjectAtIndex:toPosition];
+        }
+    }
+    
+    if ([self containsIndex:fromIndex] && [self containsIndex:toIndex]) {
+        [self bundleEdgeFromIndex:fromIndex toIndex:toIndex delta:-1];
+    }
+}
+
+- (void)removeAllEdges
+{
+    for (NSMutableDictionary *cells in _levels) {
+        for (TBCanvasCluster *cluster in cells.objectEnumerator) {
+            [cluster.edgeBundles removeAllObjects];
+            [cluster addInternalEdges:-(NSInteger)cluster.internalEdgeCount];
+        }
+    }
+    [_edges removeAllObjects];
+    edgesEnd = 0;
+}
+
+- (void)bundleEdgesOfIndex:(NSUInteger)index delta:(NSInteger)delta
+{
+    for (NSNumber *neighbour in _edges[@(index)]) {
+        if ([self containsIndex:neighbour.unsignedIntegerValue]) {
+            [self bundleEdgeFromIndex:index toIndex:neighbour.unsignedIntegerValue delta:delta];
+        }
+    }
+}
+
+- (void)bundleEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex delta:(NSInteger)delta
+{
+    CGPoint from = CGPointMake(CGRectGetMidX(rects[fromIndex]), CGRectGetMidY(rects[fromIndex]));
+    CGPoint to   = CGPointMake(CGRectGetMidX(rects[toIndex]), CGRectGetMidY(rects[toIndex]));
+    
+    for (NSUInteger level = 0; level < _levelCount; level++) {
+        NSMutableDictionary *cells = _levels[level];
+        int64_t fromKey = [self cellKeyForPoint:from atLevel:level];
+        int64_t toKey   = [self cellKeyForPoint:to atLevel:level];
+        
+        if (fromKey == toKey) {
+            [cells[@(fromKey)] addInternalEdges:delta];
+        } else {
+            [cells[@(fromKey)] addEdges:delta toCellKey:toKey];
+            [cells[@(toKey)] addEdges:delta toCellKey:fromKey];
+        }
+    }
+}
+
+#pragma mark - Querying
+
+- (void)validateBoundsOfCluster:(TBCanvasCluster *)cluster
+{
+    if (cluster == nil || cluster.boundsAreValid) {
+        return;
+    }
+    
+    __block CGRect bounds = CGRectNull;
+    
+    if (cluster.level == 0) {
+        [cluster.members enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+            bounds = CGRectUnion(bounds, rects[index]);
+        }];
+    } else {
+        
+        // The four cells of the level below make up the cell of the cluster.
+        NSDictionary *cells = _levels[cluster.level - 1];
+        int32_t column = (int32_t)(uint32_t)(cluster.cellKey & 0xffffffff);
+        int32_t row    = (int32_t)(cluster.cellKey >> 32);
+        
+        for (int32_t y = 0; y < 2; y++) {
+            for (int32_t x = 0; x < 2; x++) {
+                TBCanvasCluster *child = cells[@([self cellKeyWithColumn:column * 2 + x row:row * 2 + y])];
+                if (child) {
+                    [self validateBoundsOfCluster:child];
+                    bounds = CGRectUnion(bounds, child.bounds);
+                }
+            }
+        }
+    }
+    cluster.bounds = bounds;
+    cluster.boundsAreValid = YES;
+}
+
+- (NSArray *)clustersAtLevel:(NSUInteger)level inRect:(CGRect)rect
+{
+    NSMutableArray *clusters = [[NSMutableArray alloc] init];
+    
+    if (level >= _levelCount || CGRectIsNull(rect)) {
+        return clusters;
+    }
+    
+    NSDictionary *cells = _levels[level];
+    CGFloat cellSize = [self cellSizeAtLevel:level];
+    
+    int32_t minColumn = (int32_t)floor(CGRectGetMinX(rect) / cellSize);
+    int32_t maxColumn = (int32_t)floor(CGRectGetMaxX(rect) / cellSize);
+    int32_t minRow    = (int32_t)floor(CGRectGetMinY(rect) / cellSize);
+    int32_t maxRow    = (int32_t)floor(CGRectGetMaxY(rect) / cellSize);
+    
+    // Visiting the occupied cells is cheaper when the rectangle covers more cells than there are clusters.
+    if (CGRectIsInfinite(rect) || ((double)maxColumn - minColumn + 1.0) * ((double)maxRow - minRow + 1.0) > cells.count) {
+        for (TBCanvasCluster *cluster in cells.objectEnumerator) {
+            if (CGRectIntersectsRect([self rectForCellKey:cluster.cellKey atLevel:level], rect)) {
+                [self validateBoundsOfCluster:cluster];
+                [clusters addObject:cluster];
+            }
+        }
+        return clusters;
+    }
+    
+    for (int32_t row = minRow; row <= maxRow; row++) {
+        for (int32_t column = minColumn; column <= maxColumn; column++) {
+            TBCanvasCluster *cluster = cells[@([self cellKeyWithColumn:column row:row])];
+            if (cluster) {
+                [self validateBoundsOfCluster:cluster];
+                [clusters addObject:cluster];
+            }
+        }
+    }
+    return clusters;
+}
+
+- (TBCanvasCluster *)clusterWithCellKey:(int64_t)cellKey atLevel:(NSUInteger)level
+{
+    if (level >= _levelCount) {
+        return nil;
+    }
+    
+    TBCanvasCluster *cluster = _levels[level][@(cellKey)];
+    [self validateBoundsOfCluster:cluster];
+    return cluster;
+}
+
+- (TBCanvasCluster *)clusterForIndex:(NSUInteger)index atLevel:(NSUInteger)level
+{
+    if ([self containsIndex:index] == NO) {
+        return nil;
+    }
+    
+    CGPoint center = CGPointMake(CGRectGetMidX(rects[index]), CGRectGetMidY(rects[index]));
+    return [self clusterWithCellKey:[self cellKeyForPoint:center atLevel:level] atLevel:level];
+}
+
+@end
@@ -0,0 +1,118 @@
+//
+//  TBCanvasGraphIndex.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ The direction of a reachability query.
+ */
+typedef NS_ENUM(NSInteger, TBCanvasGraphDirection) {
+    TBCanvasGraphDirectionDownstream = 0,
+    TBCanvasGraphDirectionUpstream
+};
+
+/**
+ This class stores the edges between indexed nodes as adjacency lists in both directions and answers structural queries.
+ 
+ Every node keeps a flat list of its child indexes and one of its parent indexes. Adding or removing a single edge only touches the two lists
+ of its nodes. Reachability queries walk the lists breadth first with a bitmap of visited nodes, degree queries read the list lengths.
+ All results are returned as index sets built from runs of consecutive indexes.
+ 
+ An instance is not thread safe. Separate instances can be used on separate threads.
+ */
+@interface TBCanvasGraphIndex : NSObject
+
+/**
+ *  The number of nodes. Degree queries cover the indexes from `0` to `nodeCount - 1`.
+ */
+@property (assign, nonatomic) NSUInteger nodeCount;
+
+/**
+ *  The number of stored edges.
+ */
+@property (assign, nonatomic, readonly) NSUInteger edgeCount;
+
+/**
+ Adds an edge between two indexes. Parallel edges are counted separately.
+ 
+ @param fromIndex The index of the parent node
+ @param toIndex   The index of the child node
+ */
+- (void)addEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+/**
+ Removes a single edge between two indexes.
+ 
+ @param fromIndex The index of the parent node
+ @param toIndex   The index of the child node
+ */
+- (void)removeEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+/**
+ Removes all edges. The node count is kept.
+ */
+- (void)removeAllEdges;
+
+/**
+ Shifts the adjacency lists of all indexes starting at a given index by a given delta and renames them in the lists of their neighbours.
+ When shifting down the indexes in front of the given index that are overwritten must not have any edges left. The node count is kept.
+ 
+ @param index The first index to shift
+ @param delta The number of positions to shift by. Negative to shift down
+ */
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta;
+
+/**
+ Returns the number of edges leaving a given index.
+ 
+ @param index The given index
+ 
+ @return The number of children.
+ */
+- (NSUInteger)childCountOfIndex:(NSUInteger)index;
+
+/**
+ Returns the number of edges arriving at a given index.
+ 
+ @param index The given index
+ 
+ @return The number of parents.
+ */
+- (NSUInteger)parentCountOfIndex:(NSUInteger)index;
+
+/**
+ Returns all indexes reachable from a set of start indexes along the edges in a given direction.
+ A start index is only part of the result when it can be reached from a start index along at least one edge.
+ 
+ @param indexes   The start indexes
+ @param direction TBCanvasGraphDirectionDownstream follows the edges to the children, TBCanvasGraphDirectionUpstream to the parents
+ 
+ @return The reachable indexes.
+ */
+- (NSIndexSet *)indexesReachableFromIndexes:(NSIndexSet *)indexes direction:(TBCanvasGraphDirection)direction;
+
+/**
+ Returns all indexes whose number of parents lies inside a given range.
+ 
+ @param range The range of parent counts. `NSMakeRange(0, 1)` returns all nodes without parents
+ 
+ @return The matching indexes.
+ */
+- (NSIndexSet *)indexesWithParentCountInRange:(NSRange)range;
+
+/**
+ Returns all indexes whose number of children lies inside a given range.
+ 
+ @param range The range of child counts. `NSMakeRange(0, 1)` returns all nodes without children
+ 
+ @return The matching indexes.
+ */
+- (NSIndexSet *)indexesWithChildCountInRange:(NSRange)range;
+
+@end
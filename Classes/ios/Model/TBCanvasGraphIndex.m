@@ -0,0 +1,296 @@
+//
+//  TBCanvasGraphIndex.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasGraphIndex.h"
+
+/**
+ The adjacency list of a single node in one direction.
+ */
+typedef struct {
+    uint32_t *items;
+    uint32_t count;
+    uint32_t capacity;
+} TBCanvasGraphList;
+
+static const uint32_t GRAPH_LIST_MIN_CAPACITY = 4;
+
+static void TBCanvasGraphListAdd(TBCanvasGraphList *list, uint32_t index)
+{
+    if (list->count == list->capacity) {
+        list->capacity = MAX(list->capacity * 2, GRAPH_LIST_MIN_CAPACITY);
+        list->items = realloc(list->items, list->capacity * sizeof(uint32_t));
+    }
+    list->items[list->count++] = index;
+}
+
+static BOOL TBCanvasGraphListRemove(TBCanvasGraphList *list, uint32_t index)
+{
+    for (uint32_t i = 0; i < list->count; i++) {
+        if (list->items[i] == index) {
+            list->items[i] = list->items[--list->count];
+            return YES;
+        }
+    }
+    return NO;
+}
+
+/**
+ Returns an index set holding every position of a list of flags which is set. Runs of set flags are added as ranges.
+ */
+static NSIndexSet *TBCanvasGraphIndexesOfFlags(const uint8_t *flags, NSUInteger count)
+{
+    NSMutableIndexSet *indexes = [[NSMutableIndexSet alloc] init];
+    
+    NSUInteger i = 0;
+    while (i < count) {
+        if (flags[i] == 0) {
+            i++;
+            continue;
+        }
+        NSUInteger start = i;
+        while (i < count && flags[i]) {
+            i++;
+        }
+        [indexes addIndexesInRange:NSMakeRange(start, i - start)];
+    }
+    return indexes;
+}
+
+@interface TBCanvasGraphIndex()
+{
+    TBCanvasGraphList *children;
+    TBCanvasGraphList *parents;
+    NSUInteger capacity;
+}
+
+@property (assign, nonatomic, readwrite) NSUInteger edgeCount;
+
+/** @name Storage */
+
+/**
+ Grows the storage to hold a given index.
+ 
+ @param index The given index
+ */
+- (void)ensureCapacityForIndex:(NSUInteger)index;
+
+/**
+ Returns the indexes whose adjacency list in a given direction has a length inside a given range.
+ 
+ @param lists The adjacency lists
+ @param range The range of lengths
+ 
+ @return The matching indexes.
+ */
+- (NSIndexSet *)indexesOfLists:(const TBCanvasGraphList *)lists withCountInRange:(NSRange)range;
+
+@end
+
+@implementation TBCanvasGraphIndex
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _nodeCount = 0;
+        _edgeCount = 0;
+        
+        children = NULL;
+        parents = NULL;
+        capacity = 0;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for (NSUInteger i = 0; i < capacity; i++) {
+        free(children[i].items);
+        free(parents[i].items);
+    }
+    free(children);
+    free(parents);
+}
+
+#pragma mark - Storage
+
+- (void)ensureCapacityForIndex:(NSUInteger)index
+{
+    if (index < capacity) {
+        return;
+    }
+    
+    NSUInteger newCapacity = MAX(index + 1, capacity * 2);
+    children = realloc(children, newCapacity * sizeof(TBCanvasGraphList));
+    parents = realloc(parents, newCapacity * sizeof(TBCanvasGraphList));
+    
+    memset(children + capacity, 0, (newCapacity - capacity) * sizeof(TBCanvasGraphList));
+    memset(parents + capacity, 0, (newCapacity - capacity) * sizeof(TBCanvasGraphList));
+    capacity = newCapacity;
+}
+
+- (void)addEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    [self ensureCapacityForIndex:MAX(fromIndex, toIndex)];
+    
+    TBCanvasGraphListAdd(&children[fromIndex], (uint32_t)toIndex);
+    TBCanvasGraphListAdd(&parents[toIndex], (uint32_t)fromIndex);
+    _edgeCount++;
+}
+
+- (void)removeEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    if (fromIndex >= capacity || toIndex >= capacity) {
+        return;
+    }
+    
+    if (TBCanvasGraphListRemove(&children[fromIndex], (uint32_t)toIndex)) {
+        TBCanvasGraphListRemove(&parents[toIndex], (uint32_t)fromIndex);
+        _edgeCount--;
+    }
+}
+
+- (void)removeAllEdges
+{
+    // Keep the lists allocated - edges are usually added again right away.
+    for (NSUInteger i = 0; i < capacity; i++) {
+        children[i].count = 0;
+        parents[i].count = 0;
+    }
+    _edgeCount = 0;
+}
+
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta
+{
+    NSUInteger end = capacity;
+    while (end > index && children[end - 1].count == 0 && parents[end - 1].count == 0) {
+        end--;
+    }
+    if (delta == 0 || end <= index) {
+        return;
+    }
+    
+    // Rename the shifted indexes inside the lists of themselves and their neighbours. Every list is visited once.
+    NSMutableIndexSet *owners = [[NSMutableIndexSet alloc] initWithIndexesInRange:NSMakeRange(index, end - index)];
+    for (NSUInteger i = index; i < end; i++) {
+        for (uint32_t j = 0; j < children[i].count; j++) {
+            [owners addIndex:children[i].items[j]];
+        }
+        for (uint32_t j = 0; j < parents[i].count; j++) {
+            [owners addIndex:parents[i].items[j]];
+        }
+    }
+    for (NSUInteger owner = owners.firstIndex; owner != NSNotFound; owner = [owners indexGreaterThanIndex:owner]) {
+        for (uint32_t j = 0; j < children[owner].count; j++) {
+            if (children[owner].items[j] >= index) {
+                children[owner].items[j] = (uint32_t)(children[owner].items[j] + delta);
+            }
+        }
+        for (uint32_t j = 0; j < parents[owner].count; j++) {
+            if (parents[owner].items[j] >= index) {
+                parents[owner].items[j] = (uint32_t)(parents[owner].items[j] + delta);
+            }
+        }
+    }
+    
+    if (delta > 0) {
+        [self ensureCapacityForIndex:end - 1 + delta];
+    } else {
+        for (NSUInteger i = index + delta; i < index; i++) {
+            free(children[i].items);
+            free(parents[i].items);
+        }
+    }
+    memmove(children + index + delta, children + index, (end - index) * sizeof(TBCanvasGraphList));
+    memmove(parents + index + delta, parents + index, (end - index) * sizeof(TBCanvasGraphList));
+    
+    // The lists in the cleared range have been moved and are owned by their new index.
+    NSUInteger clearedStart = (delta > 0) ? index : end + delta;
+    memset(children + clearedStart, 0, labs(delta) * sizeof(TBCanvasGraphList));
+    memset(parents + clearedStart, 0, labs(delta) * sizeof(TBCanvasGraphList));
+}
+
+#pragma mark - Querying
+
+- (NSUInteger)childCountOfIndex:(NSUInteger)index
+{
+    return (index < capacity) ? children[index].count : 0;
+}
+
+- (NSUInteger)parentCountOfIndex:(NSUInteger)index
+{
+    return (index < capacity) ? parents[index].count : 0;
+}
+
+- (NSIndexSet *)indexesReachableFromIndexes:(NSIndexSet *)indexes direction:(TBCanvasGraphDirection)direction
+{
+    const TBCanvasGraphList *lists = (direction == TBCanvasGraphDirectionDownstream) ? children : parents;
+    
+    NSUInteger startCount = [indexes countOfIndexesInRange:NSMakeRange(0, capacity)];
+    if (startCount == 0) {
+        return [NSIndexSet indexSet];
+    }
+    
+    // Every node enters the queue once when reached. Start nodes may enter a second time.
+    uint8_t *reached = calloc(capacity, sizeof(uint8_t));
+    uint32_t *queue = malloc((startCount + capacity) * sizeof(uint32_t));
+    NSUInteger head = 0;
+    NSUInteger tail = 0;
+    
+    NSUInteger index = [indexes firstIndex];
+    while (index != NSNotFound && index < capacity) {
+        queue[tail++] = (uint32_t)index;
+        index = [indexes indexGreaterThanIndex:index];
+    }
+    
+    while (head < tail) {
+        const TBCanvasGraphList *list = &lists[queue[head++]];
+        for (uint32_t i = 0; i < list->count; i++) {
+            uint32_t next = list->items[i];
+            if (reached[next] == 0) {
+                reached[next] = 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+    
+    NSIndexSet *result = TBCanvasGraphIndexesOfFlags(reached, capacity);
+    free(queue);
+    free(reached);
+    return result;
+}
+
+- (NSIndexSet *)indexesWithParentCountInRange:(NSRange)range
+{
+    return [self indexesOfLists:parents withCountInRange:range];
+}
+
+- (NSIndexSet *)indexesWithChildCountInRange:(NSRange)range
+{
+    return [self indexesOfLists:children withCountInRange:range];
+}
+
+- (NSIndexSet *)indexesOfLists:(const TBCanvasGraphList *)lists withCountInRange:(NSRange)range
+{
+    if (_nodeCount == 0) {
+        return [NSIndexSet indexSet];
+    }
+    
+    uint8_t *matches = malloc(_nodeCount * sizeof(uint8_t));
+    for (NSUInteger i = 0; i < _nodeCount; i++) {
+        NSUInteger count = (i < capacity) ? lists[i].count : 0;
+        matches[i] = NSLocationInRange(count, range);
+    }
+    
+    NSIndexSet *result = TBCanvasGraphIndexesOfFlags(matches, _nodeCount);
+    free(matches);
+    return result;
+}
+
+@end
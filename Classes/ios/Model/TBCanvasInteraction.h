@@ -0,0 +1,80 @@
+//
+//  TBCanvasInteraction.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+@class TBCanvasItemView;
+@class TBCanvasNodeView;
+@class TBCanvasConnectionView;
+
+/**
+ This class holds the state of a single gesture on a TBCollectionCanvasContentView - from the touch on an item view until the touch ends.
+ 
+ Every touched item view gets an interaction of its own. It keeps the segment moved with the item, the connections leading out of that segment,
+ the connection being edited by a handle and the autoscroll distance requested by the gesture. Gestures on different item views therefore
+ never share any state and can be processed concurrently. The autoscroll distances of all gestures are merged once per frame.
+ */
+@interface TBCanvasInteraction : NSObject
+
+/**
+ *  The touched item view. `nil` for programmatic moves.
+ */
+@property (strong, nonatomic, readonly) TBCanvasItemView *itemView;
+
+/**
+ *  Set to `YES` once the touched item view has been moved.
+ */
+@property (assign, nonatomic, getter = isMoving) BOOL moving;
+
+/**
+ *  The collapsed tree segment moved together with a touched TBCanvasNodeView.
+ */
+@property (strong, nonatomic) NSMutableArray *segment;
+
+/**
+ *  The TBCanvasConnectionViews leading from a moved segment to node views outside of it. Redrawn on every frame of the gesture.
+ */
+@property (strong, nonatomic, readonly) NSMutableArray *connectionsForFullRefresh;
+
+/**
+ *  The connection edited by a touched handle - the temporary connection of a create handle or the connection of a move handle.
+ */
+@property (strong, nonatomic) TBCanvasConnectionView *connection;
+
+/**
+ *  The TBCanvasNodeView highlighted as the target of the edited connection.
+ */
+@property (strong, nonatomic) TBCanvasNodeView *connectableNodeView;
+
+/**
+ *  The distance per frame the gesture wants the canvas to scroll. `CGPointZero` while the touched item view is away from the edges.
+ */
+@property (assign, nonatomic) CGPoint autoscrollDistance;
+
+/**
+ Initializes the TBCanvasInteraction object with a touched item view.
+ 
+ @param itemView The touched item view
+ 
+ @return The initialized TBCanvasInteraction object
+ */
+- (id)initWithItemView:(TBCanvasItemView *)itemView;
+
+/**
+ Merges the autoscroll distances of a number of interactions into the distance to scroll in one frame.
+ On each axis the strongest distance wins. Opposing distances of equal strength cancel out.
+ 
+ @param interactions The interactions
+ 
+ @return The merged distance.
+ */
++ (CGPoint)mergedAutoscrollDistanceOfInteractions:(id<NSFastEnumeration>)interactions;
+
+@end
@@ -0,0 +1,65 @@
+//
+//  TBCanvasInteraction.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasInteraction.h"
+
+/**
+ Returns the strongest of a positive and a negative distance. Distances of equal strength cancel out.
+ */
+static CGFloat TBCanvasInteractionStrongestDistance(CGFloat positive, CGFloat negative)
+{
+    if (positive > -negative) {
+        return positive;
+    }
+    if (positive < -negative) {
+        return negative;
+    }
+    return 0.0;
+}
+
+@interface TBCanvasInteraction()
+
+@property (strong, nonatomic, readwrite) TBCanvasItemView *itemView;
+@property (strong, nonatomic, readwrite) NSMutableArray *connectionsForFullRefresh;
+
+@end
+
+@implementation TBCanvasInteraction
+
+- (id)initWithItemView:(TBCanvasItemView *)itemView
+{
+    self = [super init];
+    if (self) {
+        _itemView = itemView;
+        _moving = NO;
+        _segment = nil;
+        _connectionsForFullRefresh = [[NSMutableArray alloc] init];
+        _connection = nil;
+        _connectableNodeView = nil;
+        _autoscrollDistance = CGPointZero;
+    }
+    return self;
+}
+
++ (CGPoint)mergedAutoscrollDistanceOfInteractions:(id<NSFastEnumeration>)interactions
+{
+    CGPoint positive = CGPointZero;
+    CGPoint negative = CGPointZero;
+    
+    for (TBCanvasInteraction *interaction in interactions) {
+        CGPoint distance = interaction.autoscrollDistance;
+        positive.x = MAX(positive.x, distance.x);
+        positive.y = MAX(positive.y, distance.y);
+        negative.x = MIN(negative.x, distance.x);
+        negative.y = MIN(negative.y, distance.y);
+    }
+    return CGPointMake(TBCanvasInteractionStrongestDistance(positive.x, negative.x), TBCanvasInteractionStrongestDistance(positive.y, negative.y));
+}
+
+@end
@@ -0,0 +1,166 @@
+//
+//  TBCanvasRenderModel.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+/**
+ This class holds everything needed to draw the static items of a canvas section without any views: node rectangles,
+ node snapshots and the connections between the nodes.
+ 
+ Drawing is a pure function of the model. The same model state draws the same pixels into the same rectangle.
+ Live nodes are left out together with their connections - they are displayed by live views.
+ 
+ All methods are thread safe. Tiles can be drawn on background threads while the model is edited on the main thread.
+ */
+@interface TBCanvasRenderModel : NSObject
+
+/**
+ *  Called with the part of the canvas whose drawing has changed by an edit. Called on the thread of the edit.
+ */
+@property (copy) void (^invalidationHandler)(CGRect rect);
+
+/**
+ Stores the rectangle of a given node. Replaces the rectangle previously stored for this node.
+ 
+ @param rect  The given rectangle
+ @param index The index of the node
+ */
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index;
+
+/**
+ Replaces all node rectangles with a list of rectangles. The rectangle at position i is stored for node i.
+ Snapshots and live states are dropped. The connections are kept.
+ 
+ @param rects The list of rectangles
+ @param count The number of rectangles in the list
+ */
+- (void)loadRects:(const CGRect *)rects count:(NSUInteger)count;
+
+/**
+ Removes all nodes. The connections are kept.
+ */
+- (void)removeAllIndexes;
+
+/**
+ Shifts all nodes starting at a given index by a given delta together with their snapshots, live states and connections.
+ When shifting down the nodes in front of the given index that are overwritten are dropped. Their connections must have been removed before.
+ 
+ @param index The index of the first node to shift
+ @param delta The number of positions to shift by. Negative to shift down
+ */
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta;
+
+/**
+ Adds a connection between two nodes.
+ 
+ @param fromIndex The index of the parent node
+ @param toIndex   The index of the child node
+ */
+- (void)addEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+/**
+ Removes a connection between two nodes.
+ 
+ @param fromIndex The index of the parent node
+ @param toIndex   The index of the child node
+ */
+- (void)removeEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+/**
+ Removes all connections.
+ */
+- (void)removeAllEdges;
+
+/**
+ Stores the snapshot drawn for a given node. Nodes without snapshot are drawn as plain boxes.
+ 
+ @param image The snapshot. Pass `NULL` to remove the snapshot
+ @param index The index of the node
+ */
+- (void)setImage:(CGImageRef)image forIndex:(NSUInteger)index;
+
+/**
+ Returns the indexes of all nodes intersecting a given rectangle which are neither live nor have a snapshot.
+ 
+ @param rect The given rectangle
+ 
+ @return The indexes in ascending order.
+ */
+- (NSIndexSet *)indexesWithoutImageInRect:(CGRect)rect;
+
+/**
+ Removes the snapshots of all nodes outside a given rectangle. Tiles which have already been drawn stay valid.
+ 
+ @param rect The given rectangle
+ */
+- (void)removeImagesOutsideRect:(CGRect)rect;
+
+/**
+ Marks a node as live. Live nodes and their connections are not drawn.
+ 
+ @param live  `YES` when the node is displayed by a live view
+ @param index The index of the node
+ */
+- (void)setLive:(BOOL)live forIndex:(NSUInteger)index;
+
+/**
+ Returns `YES` when a given node is live.
+ 
+ @param index The index of the node
+ 
+ @return `YES` when the node is live.
+ */
+- (BOOL)isLiveIndex:(NSUInteger)index;
+
+/**
+ Returns the smallest rectangle containing all nodes.
+ 
+ @return The bounding rectangle. CGRectNull when the model is empty.
+ */
+- (CGRect)bounds;
+
+/**
+ Calls a block with the rectangle of every static node intersecting a given rectangle.
+ The block is called while the model is locked and must not edit the model.
+ 
+ @param rect  The given rectangle in canvas coordinates
+ @param block The block to call
+ */
+- (void)enumerateNodesInRect:(CGRect)rect usingBlock:(void (^)(CGRect nodeRect))block;
+
+/**
+ Calls a block with the curve of every static connection intersecting a given rectangle.
+ The curve is a quadratic bezier curve from start to end. The block is called while the model is locked and must not edit the model.
+ 
+ @param rect  The given rectangle in canvas coordinates
+ @param block The block to call. edgeRect is the rectangle covered by the connection including its line width
+ */
+- (void)enumerateEdgesInRect:(CGRect)rect usingBlock:(void (^)(CGRect edgeRect, CGPoint start, CGPoint controlPoint, CGPoint end))block;
+
+/**
+ Draws all static nodes and connections intersecting a given rectangle.
+ The context must be set up in canvas coordinates with the origin in the top left corner.
+ 
+ @param rect    The given rectangle in canvas coordinates
+ @param context The context to draw into
+ */
+- (void)drawRect:(CGRect)rect inContext:(CGContextRef)context;
+
+/**
+ Draws a given rectangle of the canvas into a new bitmap.
+ 
+ @param rect  The given rectangle in canvas coordinates
+ @param scale The number of pixels per canvas point
+ 
+ @return The bitmap. The caller is responsible to release it. `NULL` when the bitmap could not be created.
+ */
+- (CGImageRef)newImageForRect:(CGRect)rect scale:(CGFloat)scale CF_RETURNS_RETAINED;
+
+@end
@@ -0,0 +1,693 @@
+//
+//  TBCanvasRenderModel.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasRenderModel.h"
+#import "TBCanvasSpatialIndex.h"
+
+/**
+ A connection between two nodes. Unused slots have a fromIndex of NSNotFound.
+ */
+typedef struct {
+    NSUInteger fromIndex;
+    NSUInteger toIndex;
+} TBCanvasRenderEdge;
+
+static CGFloat EDGE_LINE_WIDTH   = 10.0;
+static CGFloat NODE_BORDER_WIDTH = 1.0;
+
+/**
+ Returns the offset between the center of a node and the point where a line from start to end leaves the node.
+ Mirrors the geometry of TBCanvasConnectionView.
+ */
+static CGSize TBCanvasRenderIntersectionOffset(CGPoint start, CGPoint end, CGSize size)
+{
+    CGFloat largeX = end.x - start.x;
+    CGFloat largeY = end.y - start.y;
+    
+    CGFloat littleX = size.width * 0.5;
+    
+    CGFloat shrinkFactorY = (largeX != 0.0) ? fabs(littleX / largeX) : 1.0;
+    CGFloat littleY = MAX(MIN(largeY * shrinkFactorY, size.height * 0.5), -size.height * 0.5);
+    
+    CGFloat shrinkFactorX = (largeY != 0.0) ? fabs(littleY / largeY) : 1.0;
+    littleX = MAX(MIN(largeX * shrinkFactorX, size.width * 0.5), -size.width * 0.5);
+    
+    return CGSizeMake(littleX, littleY);
+}
+
+@interface TBCanvasRenderModel()
+{
+    CGRect *rects;
+    CGImageRef *images;
+    BOOL *live;
+    NSUInteger capacity;
+    
+    TBCanvasRenderEdge *edges;
+    NSUInteger edgeCapacity;
+    
+    // One past the largest node index which may have connections attached.
+    NSUInteger incidentEdgesEnd;
+}
+
+// Indexes the rectangles of all nodes.
+@property (nonatomic, strong) TBCanvasSpatialIndex *nodeIndex;
+
+// Indexes the rectangles covered by all connections - keyed by the slot of the connection.
+@property (nonatomic, strong) TBCanvasSpatialIndex *edgeIndex;
+
+// Maps the index of a node to the slots of all connections attached to it.
+@property (nonatomic, strong) NSMutableDictionary *incidentEdges;
+
+// The unused connection slots.
+@property (nonatomic, strong) NSMutableIndexSet *freeEdges;
+
+// The indexes of all nodes with a snapshot.
+@property (nonatomic, strong) NSMutableIndexSet *imageIndexes;
+
+/** @name Storage */
+
+/**
+ Grows the node storage to hold a given index.
+ 
+ @param index The given index
+ */
+- (void)ensureCapacityForIndex:(NSUInteger)index;
+
+/**
+ Returns `YES` when a connection is drawn - both nodes are stored and neither of them is live.
+ 
+ @param edge The slot of the connection
+ 
+ @return `YES` when the connection is drawn.
+ */
+- (BOOL)isDrawnEdge:(NSUInteger)edge;
+
+/**
+ Returns the rectangle covered by a connection including its line width.
+ 
+ @param edge The slot of the connection
+ 
+ @return The rectangle. CGRectNull when one of the nodes is not stored.
+ */
+- (CGRect)rectForEdge:(NSUInteger)edge;
+
+/**
+ Updates the rectangles of all connections attached to a given node.
+ 
+ @param index The index of the node
+ 
+ @return The union of the old and new rectangles of all drawn connections.
+ */
+- (CGRect)updateEdgesOfIndex:(NSUInteger)index;
+
+/**
+ Returns the union of the rectangles of all drawn connections attached to a given node.
+ 
+ @param index The index of the node
+ 
+ @return The rectangle. CGRectNull when no drawn connection is attached.
+ */
+- (CGRect)rectOfDrawnEdgesOfIndex:(NSUInteger)index;
+
+/**
+ Passes a changed rectangle to the invalidation handler.
+ 
+ @param rect The changed rectangle
+ */
+- (void)invalidateRect:(CGRect)rect;
+
+/** @name Drawing */
+
+/**
+ Returns the curve of a connection.
+ 
+ @param edge         The slot of the connection
+ @param start        Returns the visible start point
+ @param controlPoint Returns the control point
+ @param end          Returns the visible end point
+ */
+- (void)getCurveOfEdge:(NSUInteger)edge start:(CGPoint *)start controlPoint:(CGPoint *)controlPoint end:(CGPoint *)end;
+
+/**
+ Adds the path of a connection to the current path of a given context.
+ 
+ @param edge    The slot of the connection
+ @param context The given context
+ */
+- (void)addPathOfEdge:(NSUInteger)edge toContext:(CGContextRef)context;
+
+/**
+ Draws a single node into a given context.
+ 
+ @param index   The index of the node
+ @param context The given context
+ */
+- (void)drawNodeAtIndex:(NSUInteger)index inContext:(CGContextRef)context;
+
+@end
+
+@implementation TBCanvasRenderModel
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _nodeIndex = [[TBCanvasSpatialIndex alloc] init];
+        _edgeIndex = [[TBCanvasSpatialIndex alloc] init];
+        _incidentEdges = [[NSMutableDictionary alloc] init];
+        _freeEdges = [[NSMutableIndexSet alloc] init];
+        _imageIndexes = [[NSMutableIndexSet alloc] init];
+        
+        rects = NULL;
+        images = NULL;
+        live = NULL;
+        capacity = 0;
+        
+        edges = NULL;
+        edgeCapacity = 0;
+        incidentEdgesEnd = 0;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for (NSUInteger i = 0; i < capacity; i++) {
+        CGImageRelease(images[i]);
+    }
+    free(rects);
+    free(images);
+    free(live);
+    free(edges);
+}
+
+#pragma mark - Storage
+
+- (void)ensureCapacityForIndex:(NSUInteger)index
+{
+    if (index < capacity) {
+        return;
+    }
+    
+    NSUInteger newCapacity = MAX(index + 1, capacity * 2);
+    rects = realloc(rects, newCapacity * sizeof(CGRect));
+    images = realloc(images, newCapacity * sizeof(CGImageRef));
+    live = realloc(live, newCapacity * sizeof(BOOL));
+    
+    for (NSUInteger i = capacity; i < newCapacity; i++) {
+        rects[i] = CGRectNull;
+        images[i] = NULL;
+        live[i] = NO;
+    }
+    capacity = newCapacity;
+}
+
+- (BOOL)isDrawnEdge:(NSUInteger)edge
+{
+    TBCanvasRenderEdge e = edges[edge];
+    if (e.fromIndex >= capacity || e.toIndex >= capacity) {
+        return NO;
+    }
+    return (live[e.fromIndex] == NO && live[e.toIndex] == NO && CGRectIsNull(rects[e.fromIndex]) == NO && CGRectIsNull(rects[e.toIndex]) == NO);
+}
+
+- (CGRect)rectForEdge:(NSUInteger)edge
+{
+    TBCanvasRenderEdge e = edges[edge];
+    if (e.fromIndex >= capacity || e.toIndex >= capacity || CGRectIsNull(rects[e.fromIndex]) || CGRectIsNull(rects[e.toIndex])) {
+        return CGRectNull;
+    }
+    return CGRectInset(CGRectUnion(rects[e.fromIndex], rects[e.toIndex]), -EDGE_LINE_WIDTH, -EDGE_LINE_WIDTH);
+}
+
+- (CGRect)updateEdgesOfIndex:(NSUInteger)index
+{
+    __block CGRect dirtyRect = CGRectNull;
+    
+    [_incidentEdges[@(index)] enumerateIndexesUsingBlock:^(NSUInteger edge, BOOL *stop) {
+        CGRect oldRect = [_edgeIndex rectForIndex:edge];
+        CGRect newRect = [self rectForEdge:edge];
+        [_edgeIndex setRect:newRect forIndex:edge];
+        
+        if ([self isDrawnEdge:edge]) {
+            dirtyRect = CGRectUnion(dirtyRect, CGRectUnion(oldRect, newRect));
+        }
+    }];
+    return dirtyRect;
+}
+
+- (CGRect)rectOfDrawnEdgesOfIndex:(NSUInteger)index
+{
+    __block CGRect rect = CGRectNull;
+    
+    [_incidentEdges[@(index)] enumerateIndexesUsingBlock:^(NSUInteger edge, BOOL *stop) {
+        if ([self isDrawnEdge:edge]) {
+            rect = CGRectUnion(rect, [_edgeIndex rectForIndex:edge]);
+        }
+    }];
+    return rect;
+}
+
+- (void)invalidateRect:(CGRect)rect
+{
+    void (^invalidationHandler)(CGRect) = self.invalidationHandler;
+    if (invalidationHandler && CGRectIsNull(rect) == NO) {
+        invalidationHandler(rect);
+    }
+}
+
+#pragma mark - Editing nodes
+
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        [self ensureCapacityForIndex:index];
+        
+        // Moving a live node does not change any tile.
+        if (live[index] == NO) {
+            dirtyRect = CGRectUnion(rects[index], rect);
+        }
+        rects[index] = rect;
+        [_nodeIndex setRect:rect forIndex:index];
+        
+        dirtyRect = CGRectUnion(dirtyRect, [self updateEdgesOfIndex:index]);
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (void)loadRects:(const CGRect *)newRects count:(NSUInteger)count
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        dirtyRect = CGRectUnion([_nodeIndex bounds], [_edgeIndex bounds]);
+        
+        for (NSUInteger i = 0; i < capacity; i++) {
+            CGImageRelease(images[i]);
+            images[i] = NULL;
+            rects[i] = CGRectNull;
+            live[i] = NO;
+        }
+        [_imageIndexes removeAllIndexes];
+        
+        if (count > 0) {
+            [self ensureCapacityForIndex:count - 1];
+            memcpy(rects, newRects, count * sizeof(CGRect));
+        }
+        [_nodeIndex loadRects:newRects count:count];
+        
+        NSMutableData *edgeRects = [[NSMutableData alloc] initWithLength:edgeCapacity * sizeof(CGRect)];
+        CGRect *edgeRectsBytes = edgeRects.mutableBytes;
+        for (NSUInteger edge = 0; edge < edgeCapacity; edge++) {
+            edgeRectsBytes[edge] = (edges[edge].fromIndex == NSNotFound) ? CGRectNull : [self rectForEdge:edge];
+        }
+        [_edgeIndex loadRects:edgeRectsBytes count:edgeCapacity];
+        
+        dirtyRect = CGRectUnion(dirtyRect, CGRectUnion([_nodeIndex bounds], [_edgeIndex bounds]));
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        
+        // The dropped nodes disappear from the tiles.
+        if (delta < 0) {
+            for (NSUInteger i = index + delta; i < MIN(index, capacity); i++) {
+                if (live[i] == NO) {
+                    dirtyRect = CGRectUnion(dirtyRect, rects[i]);
+                }
+                CGImageRelease(images[i]);
+                images[i] = NULL;
+                rects[i] = CGRectNull;
+                live[i] = NO;
+                [_nodeIndex removeIndex:i];
+                [_incidentEdges removeObjectForKey:@(i)];
+            }
+            [_imageIndexes removeIndexesInRange:NSMakeRange(index + delta, -delta)];
+        }
+        
+        NSUInteger end = capacity;
+        while (end > index && CGRectIsNull(rects[end - 1]) && images[end - 1] == NULL && live[end - 1] == NO) {
+            end--;
+        }
+        
+        if (delta != 0 && end > index) {
+            
+            // Rename the shifted nodes inside their connections. Only the shifted nodes are looked up and every connection is visited once.
+            NSMutableIndexSet *shiftedEdges = [[NSMutableIndexSet alloc] init];
+            NSMutableDictionary *shiftedIncidentEdges = [[NSMutableDictionary alloc] init];
+            for (NSUInteger i = index; i < incidentEdgesEnd; i++) {
+                NSMutableIndexSet *incidentEdges = _incidentEdges[@(i)];
+                if (incidentEdges) {
+                    [shiftedEdges addIndexes:incidentEdges];
+                    shiftedIncidentEdges[@(i + delta)] = incidentEdges;
+                    [_incidentEdges removeObjectForKey:@(i)];
+                }
+            }
+            [_incidentEdges addEntriesFromDictionary:shiftedIncidentEdges];
+            if (incidentEdgesEnd > index) {
+                incidentEdgesEnd += delta;
+            }
+            
+            for (NSUInteger edge = shiftedEdges.firstIndex; edge != NSNotFound; edge = [shiftedEdges indexGreaterThanIndex:edge]) {
+                if (edges[edge].fromIndex >= index) {
+                    edges[edge].fromIndex += delta;
+                }
+                if (edges[edge].toIndex >= index) {
+                    edges[edge].toIndex += delta;
+                }
+            }
+            
+            // Nodes keep their rectangles, snapshots and live states. Nothing is drawn differently.
+            if (delta > 0) {
+                [self ensureCapacityForIndex:end - 1 + delta];
+            }
+            memmove(rects + index + delta, rects + index, (end - index) * sizeof(CGRect));
+            memmove(images + index + delta, images + index, (end - index) * sizeof(CGImageRef));
+            memmove(live + index + delta, live + index, (end - index) * sizeof(BOOL));
+            NSUInteger clearedStart = (delta > 0) ? index : end + delta;
+            for (NSUInteger i = clearedStart; i < clearedStart + labs(delta); i++) {
+                rects[i] = CGRectNull;
+                images[i] = NULL;
+                live[i] = NO;
+            }
+            [_nodeIndex shiftIndexesStartingAtIndex:index by:delta];
+            [_imageIndexes shiftIndexesStartingAtIndex:index by:delta];
+        }
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (void)removeAllIndexes
+{
+    [self loadRects:NULL count:0];
+}
+
+- (CGRect)bounds
+{
+    @synchronized(self) {
+        return [_nodeIndex bounds];
+    }
+}
+
+#pragma mark - Editing connections
+
+- (void)addEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        NSUInteger edge = _freeEdges.firstIndex;
+        if (edge == NSNotFound) {
+            edge = edgeCapacity;
+            edgeCapacity = MAX(16, edgeCapacity * 2);
+            edges = realloc(edges, edgeCapacity * sizeof(TBCanvasRenderEdge));
+            [_freeEdges addIndexesInRange:NSMakeRange(edge, edgeCapacity - edge)];
+        }
+        [_freeEdges removeIndex:edge];
+        edges[edge].fromIndex = fromIndex;
+        edges[edge].toIndex = toIndex;
+        incidentEdgesEnd = MAX(incidentEdgesEnd, MAX(fromIndex, toIndex) + 1);
+        
+        for (NSNumber *key in @[@(fromIndex), @(toIndex)]) {
+            NSMutableIndexSet *incidentEdges = _incidentEdges[key];
+            if (incidentEdges == nil) {
+                incidentEdges = [[NSMutableIndexSet alloc] init];
+                _incidentEdges[key] = incidentEdges;
+            }
+            [incidentEdges addIndex:edge];
+        }
+        
+        CGRect rect = [self rectForEdge:edge];
+        [_edgeIndex setRect:rect forIndex:edge];
+        if ([self isDrawnEdge:edge]) {
+            dirtyRect = rect;
+        }
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (void)removeEdgeFromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        NSUInteger edge = [_incidentEdges[@(fromIndex)] indexPassingTest:^BOOL(NSUInteger e, BOOL *stop) {
+            return (edges[e].fromIndex == fromIndex && edges[e].toIndex == toIndex);
+        }];
+        if (edge == NSNotFound) {
+            return;
+        }
+        
+        if ([self isDrawnEdge:edge]) {
+            dirtyRect = [_edgeIndex rectForIndex:edge];
+        }
+        [_edgeIndex removeIndex:edge];
+        [_incidentEdges[@(fromIndex)] removeIndex:edge];
+        [_incidentEdges[@(toIndex)] removeIndex:edge];
+        
+        edges[edge].fromIndex = NSNotFound;
+        edges[edge].toIndex = NSNotFound;
+        [_freeEdges addIndex:edge];
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (void)removeAllEdges
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        dirtyRect = [_edgeIndex bounds];
+        
+        [_edgeIndex removeAllIndexes];
+        [_incidentEdges removeAllObjects];
+        [_freeEdges removeAllIndexes];
+        
+        free(edges);
+        edges = NULL;
+        edgeCapacity = 0;
+        incidentEdgesEnd = 0;
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+#pragma mark - Snapshots and live nodes
+
+- (void)setImage:(CGImageRef)image forIndex:(NSUInteger)index
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        [self ensureCapacityForIndex:index];
+        
+        CGImageRetain(image);
+        CGImageRelease(images[index]);
+        images[index] = image;
+        
+        if (image) {
+            [_imageIndexes addIndex:index];
+        } else {
+            [_imageIndexes removeIndex:index];
+        }
+        
+        if (live[index] == NO) {
+            dirtyRect = rects[index];
+        }
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (NSIndexSet *)indexesWithoutImageInRect:(CGRect)rect
+{
+    @synchronized(self) {
+        NSMutableIndexSet *indexes = [[_nodeIndex indexesOfRectsIntersectingRect:rect] mutableCopy];
+        [indexes removeIndexes:_imageIndexes];
+        [indexes removeIndexesPassingTest:^BOOL(NSUInteger index, BOOL *stop) {
+            return live[index];
+        }];
+        return indexes;
+    }
+}
+
+- (void)removeImagesOutsideRect:(CGRect)rect
+{
+    @synchronized(self) {
+        NSIndexSet *outside = [_imageIndexes indexesPassingTest:^BOOL(NSUInteger index, BOOL *stop) {
+            return (CGRectIntersectsRect(rects[index], rect) == NO);
+        }];
+        [outside enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+            CGImageRelease(images[index]);
+            images[index] = NULL;
+        }];
+        [_imageIndexes removeIndexes:outside];
+    }
+}
+
+- (void)setLive:(BOOL)isLive forIndex:(NSUInteger)index
+{
+    CGRect dirtyRect = CGRectNull;
+    
+    @synchronized(self) {
+        [self ensureCapacityForIndex:index];
+        if (live[index] == isLive) {
+            return;
+        }
+        
+        // The connections of the node are drawn only while it is not live. Collect them while they are drawn.
+        if (isLive) {
+            dirtyRect = CGRectUnion(rects[index], [self rectOfDrawnEdgesOfIndex:index]);
+            live[index] = YES;
+        } else {
+            live[index] = NO;
+            dirtyRect = CGRectUnion(rects[index], [self rectOfDrawnEdgesOfIndex:index]);
+        }
+    }
+    [self invalidateRect:dirtyRect];
+}
+
+- (BOOL)isLiveIndex:(NSUInteger)index
+{
+    @synchronized(self) {
+        return (index < capacity && live[index]);
+    }
+}
+
+#pragma mark - Drawing
+
+- (void)drawRect:(CGRect)rect inContext:(CGContextRef)context
+{
+    @synchronized(self) {
+        CGContextSaveGState(context);
+        
+        // Connections first - nodes are drawn on top of them.
+        CGContextSetRGBStrokeColor(context, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 1.0);
+        CGContextSetLineWidth(context, EDGE_LINE_WIDTH);
+        CGContextSetLineCap(context, kCGLineCapRound);
+        
+        [[_edgeIndex indexesOfRectsIntersectingRect:rect] enumerateIndexesUsingBlock:^(NSUInteger edge, BOOL *stop) {
+            if ([self isDrawnEdge:edge]) {
+                [self addPathOfEdge:edge toContext:context];
+            }
+        }];
+        CGContextStrokePath(context);
+        
+        [[_nodeIndex indexesOfRectsIntersectingRect:rect] enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+            if (live[index] == NO) {
+                [self drawNodeAtIndex:index inContext:context];
+            }
+        }];
+        
+        CGContextRestoreGState(context);
+    }
+}
+
+- (void)enumerateNodesInRect:(CGRect)rect usingBlock:(void (^)(CGRect nodeRect))block
+{
+    @synchronized(self) {
+        [[_nodeIndex indexesOfRectsIntersectingRect:rect] enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+            if (live[index] == NO) {
+                block(rects[index]);
+            }
+        }];
+    }
+}
+
+- (void)enumerateEdgesInRect:(CGRect)rect usingBlock:(void (^)(CGRect edgeRect, CGPoint start, CGPoint controlPoint, CGPoint end))block
+{
+    @synchronized(self) {
+        [[_edgeIndex indexesOfRectsIntersectingRect:rect] enumerateIndexesUsingBlock:^(NSUInteger edge, BOOL *stop) {
+            if ([self isDrawnEdge:edge]) {
+                CGPoint start, controlPoint, end;
+                [self getCurveOfEdge:edge start:&start controlPoint:&controlPoint end:&end];
+                block([_edgeIndex rectForIndex:edge], start, controlPoint, end);
+            }
+        }];
+    }
+}
+
+- (void)getCurveOfEdge:(NSUInteger)edge start:(CGPoint *)start controlPoint:(CGPoint *)controlPoint end:(CGPoint *)end
+{
+    CGRect parentRect = rects[edges[edge].fromIndex];
+    CGRect childRect = rects[edges[edge].toIndex];
+    CGPoint parentCenter = CGPointMake(CGRectGetMidX(parentRect), CGRectGetMidY(parentRect));
+    CGPoint childCenter = CGPointMake(CGRectGetMidX(childRect), CGRectGetMidY(childRect));
+    
+    CGSize startOffset = TBCanvasRenderIntersectionOffset(parentCenter, childCenter, parentRect.size);
+    CGSize endOffset = TBCanvasRenderIntersectionOffset(parentCenter, childCenter, childRect.size);
+    *start = CGPointMake(parentCenter.x + startOffset.width, parentCenter.y + startOffset.height);
+    *end = CGPointMake(childCenter.x - endOffset.width, childCenter.y - endOffset.height);
+    *controlPoint = CGPointMake(start->x + ((end->x - start->x) * 0.5), end->y);
+}
+
+- (void)addPathOfEdge:(NSUInteger)edge toContext:(CGContextRef)context
+{
+    CGPoint start, controlPoint, end;
+    [self getCurveOfEdge:edge start:&start controlPoint:&controlPoint end:&end];
+    
+    CGContextMoveToPoint(context, start.x, start.y);
+    CGContextAddQuadCurveToPoint(context, controlPoint.x, controlPoint.y, end.x, end.y);
+}
+
+- (void)drawNodeAtIndex:(NSUInteger)index inContext:(CGContextRef)context
+{
+    CGRect rect = rects[index];
+    CGImageRef image = images[index];
+    
+    if (image) {
+        // The context is flipped. Flip back so the snapshot is upright.
+        CGContextSaveGState(context);
+        CGContextTranslateCTM(context, rect.origin.x, CGRectGetMaxY(rect));
+        CGContextScaleCTM(context, 1.0, -1.0);
+        CGContextDrawImage(context, CGRectMake(0.0, 0.0, rect.size.width, rect.size.height), image);
+        CGContextRestoreGState(context);
+        return;
+    }
+    
+    CGContextSetRGBFillColor(context, 1.0, 1.0, 1.0, 1.0);
+    CGContextFillRect(context, rect);
+    CGContextSetRGBStrokeColor(context, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 1.0);
+    CGContextSetLineWidth(context, NODE_BORDER_WIDTH);
+    CGContextStrokeRect(context, CGRectInset(rect, NODE_BORDER_WIDTH * 0.5, NODE_BORDER_WIDTH * 0.5));
+}
+
+- (CGImageRef)newImageForRect:(CGRect)rect scale:(CGFloat)scale
+{
+    size_t width = (size_t)ceil(rect.size.width * scale);
+    size_t height = (size_t)ceil(rect.size.height * scale);
+    if (width == 0 || height == 0) {
+        return NULL;
+    }
+    
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpace, (CGBitmapInfo)kCGImageAlphaPremultipliedLast);
+    CGColorSpaceRelease(colorSpace);
+    if (context == NULL) {
+        return NULL;
+    }
+    
+    // Bitmap contexts have their origin in the bottom left corner. The canvas has it in the top left corner.
+    CGContextTranslateCTM(context, 0.0, height);
+    CGContextScaleCTM(context, scale, -scale);
+    CGContextTranslateCTM(context, -rect.origin.x, -rect.origin.y);
+    
+    [self drawRect:rect inContext:context];
+    
+    CGImageRef image = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    return image;
+}
+
+@end
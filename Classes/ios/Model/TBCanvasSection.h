@@ -0,0 +1,175 @@
+//
+//  TBCanvasSection.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+#import "TBCanvasSpatialIndex.h"
+#import "TBCanvasClusterIndex.h"
+#import "TBCanvasRenderModel.h"
+#import "TBCanvasAlignmentIndex.h"
+#import "TBCanvasGraphIndex.h"
+
+@class TBCanvasNodeView;
+@class TBCanvasConnectionView;
+
+/**
+ This class represents a single section of a TBCollectionCanvasContentView.
+ 
+ Every section is a partition of its own. It holds its node table, its edge table, a spatial index, a cluster index, an alignment index and a graph index of its node views.
+ Connections never cross the border of a section.
+ */
+@interface TBCanvasSection : NSObject
+
+/**
+ *  The number of the section.
+ */
+@property (assign, nonatomic, readonly) NSInteger section;
+
+/**
+ *  The node views of the section. The index of a node view equals its tag.
+ */
+@property (strong, nonatomic, readonly) NSMutableArray *nodeViews;
+
+/**
+ *  The connections between the node views of the section. Unordered.
+ */
+@property (strong, nonatomic, readonly) NSMutableSet *connectionViews;
+
+/**
+ *  The spatial index of the node view frames - indexed by tag.
+ */
+@property (strong, nonatomic, readonly) TBCanvasSpatialIndex *spatialIndex;
+
+/**
+ *  The cluster index of the node view frames and connections - indexed by tag. Node views in collapsed segments are not counted.
+ *  Moving node views only records their tags. The recorded node views are applied by updateClusterIndex or when the index is read next. Read it on the main thread.
+ */
+@property (strong, nonatomic, readonly) TBCanvasClusterIndex *clusterIndex;
+
+/**
+ *  The sorted edges and center lines of the node view frames - indexed by tag.
+ */
+@property (strong, nonatomic, readonly) TBCanvasAlignmentIndex *alignmentIndex;
+
+/**
+ *  The parent and child lists of all node views - indexed by tag.
+ */
+@property (strong, nonatomic, readonly) TBCanvasGraphIndex *graphIndex;
+
+/**
+ *  The render model of the node view frames and connections - indexed by tag. `nil` unless the canvas renders tiles.
+ *  Assigning a model loads the current frames and connections into it.
+ */
+@property (strong, nonatomic) TBCanvasRenderModel *renderModel;
+
+/**
+ Initializes the TBCanvasSection object with a given section number.
+ 
+ @param section The number of the section
+ 
+ @return The initialized TBCanvasSection object
+ */
+- (id)initWithSection:(NSInteger)section;
+
+/**
+ Returns the smallest rectangle around all node views of the section.
+ 
+ @return The bounding rectangle. CGRectNull when the section is empty.
+ */
+- (CGRect)bounds;
+
+/**
+ Returns all node views whose frame intersects a given rectangle.
+ 
+ @param rect The given rectangle
+ 
+ @return The TBCanvasNodeView objects in the order of their tags.
+ */
+- (NSArray *)nodeViewsInRect:(CGRect)rect;
+
+/**
+ Adds a connection to the edge table.
+ 
+ @param connection The given TBCanvasConnectionView
+ */
+- (void)addConnectionView:(TBCanvasConnectionView *)connection;
+
+/**
+ Removes a connection from the edge table.
+ 
+ @param connection The given TBCanvasConnectionView
+ */
+- (void)removeConnectionView:(TBCanvasConnectionView *)connection;
+
+/**
+ Updates the edge table after a connection has been attached to a new child node.
+ 
+ @param connection    The given TBCanvasConnectionView
+ @param oldChildNode  The previous child node of the connection
+ */
+- (void)moveConnectionView:(TBCanvasConnectionView *)connection fromChildNode:(TBCanvasNodeView *)oldChildNode;
+
+/**
+ Updates the index entries of a given node view after it has been moved.
+ 
+ @param nodeView The given TBCanvasNodeView
+ */
+- (void)updateNodeView:(TBCanvasNodeView *)nodeView;
+
+/**
+ Applies the frames of all node views updated since the last call to the cluster index. Call on the main thread.
+ */
+- (void)updateClusterIndex;
+
+/**
+ Returns the frames of all node views in the order of their tags. Call on the main thread.
+ 
+ @return An NSData object containing a CGRect for every node view.
+ */
+- (NSData *)nodeViewFrames;
+
+/**
+ Rebuilds the spatial index, the alignment index and the render model from a list of frames returned by nodeViewFrames. Can be called on any thread.
+ The cluster index is rebuilt when it is updated next.
+ 
+ @param frames An NSData object containing a CGRect for every node view
+ */
+- (void)loadNodeViewFrames:(NSData *)frames;
+
+/**
+ Returns a new render model holding the current frames and connections of the section. The render model is independent of the section
+ and can be read on any thread. Call on the main thread.
+ 
+ @return The new TBCanvasRenderModel object.
+ */
+- (TBCanvasRenderModel *)renderModelSnapshot;
+
+/**
+ Inserts a node view into the node table. Shifts the tags of all following node views and their entries in all indexes.
+ 
+ @param nodeView The given TBCanvasNodeView
+ @param index    The position of the node view
+ */
+- (void)insertNodeView:(TBCanvasNodeView *)nodeView atIndex:(NSUInteger)index;
+
+/**
+ Removes a node view from the node table. Shifts the tags of all following node views and their entries in all indexes.
+ The connections of the node view must have been removed before.
+ 
+ @param index The position of the node view
+ */
+- (void)removeNodeViewAtIndex:(NSUInteger)index;
+
+/**
+ Removes all node views and connections from the section.
+ */
+- (void)removeAllItems;
+
+@end
@@ -0,0 +1,263 @@
+//
+//  TBCanvasSection.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasSection.h"
+#import "TBCanvasNodeView.h"
+#import "TBCanvasConnectionView.h"
+
+@interface TBCanvasSection()
+
+// Set when the frames have been loaded since the cluster index has been built.
+@property (assign, nonatomic) BOOL clusterIndexNeedsReload;
+
+// The tags of the node views which have moved, collapsed or expanded since the cluster index has been updated.
+@property (strong, nonatomic) NSMutableIndexSet *clusterIndexUpdates;
+
+/**
+ Rebuilds the cluster index from the current frames of all node views which are not in a collapsed segment.
+ */
+- (void)reloadClusterIndex;
+
+/**
+ Replaces the connections and node rectangles of a given render model with those of the section.
+ 
+ @param renderModel The given TBCanvasRenderModel
+ */
+- (void)loadRenderModel:(TBCanvasRenderModel *)renderModel;
+
+/**
+ Assigns tags and the section number to all node views starting at a given position of the node table.
+ 
+ @param index The given position
+ */
+- (void)retagNodeViewsStartingAtIndex:(NSUInteger)index;
+
+@end
+
+@implementation TBCanvasSection
+
+- (id)initWithSection:(NSInteger)section
+{
+    self = [super init];
+    if (self) {
+        _section = section;
+        _nodeViews = [[NSMutableArray alloc] init];
+        _connectionViews = [[NSMutableSet alloc] init];
+        _spatialIndex = [[TBCanvasSpatialIndex alloc] init];
+        _clusterIndex = [[TBCanvasClusterIndex alloc] init];
+        _clusterIndexUpdates = [[NSMutableIndexSet alloc] init];
+        _alignmentIndex = [[TBCanvasAlignmentIndex alloc] init];
+        _graphIndex = [[TBCanvasGraphIndex alloc] init];
+    }
+    return self;
+}
+
+- (CGRect)bounds
+{
+    return [_spatialIndex bounds];
+}
+
+- (NSArray *)nodeViewsInRect:(CGRect)rect
+{
+    NSIndexSet *indexes = [_spatialIndex indexesOfRectsIntersectingRect:rect];
+    return [_nodeViews objectsAtIndexes:indexes];
+}
+
+- (void)addConnectionView:(TBCanvasConnectionView *)connection
+{
+    [_connectionViews addObject:connection];
+    
+    if (connection.parentNode && connection.childNode) {
+        [_clusterIndex addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        [_graphIndex addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        [_renderModel addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+    }
+}
+
+- (void)removeConnectionView:(TBCanvasConnectionView *)connection
+{
+    [_connectionViews removeObject:connection];
+    
+    if (connection.parentNode && connection.childNode) {
+        [_clusterIndex removeEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        [_graphIndex removeEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        [_renderModel removeEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+    }
+}
+
+- (void)moveConnectionView:(TBCanvasConnectionView *)connection fromChildNode:(TBCanvasNodeView *)oldChildNode
+{
+    if (connection.parentNode && oldChildNode) {
+        [_clusterIndex removeEdgeFromIndex:connection.parentNode.tag toIndex:oldChildNode.tag];
+        [_graphIndex removeEdgeFromIndex:connection.parentNode.tag toIndex:oldChildNode.tag];
+        [_renderModel removeEdgeFromIndex:connection.parentNode.tag toIndex:oldChildNode.tag];
+    }
+    if (connection.parentNode && connection.childNode) {
+        [_clusterIndex addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        [_graphIndex addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        [_renderModel addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+    }
+}
+
+- (void)updateNodeView:(TBCanvasNodeView *)nodeView
+{
+    [_spatialIndex setRect:nodeView.frame forIndex:nodeView.tag];
+    [_clusterIndexUpdates addIndex:nodeView.tag];
+    [_alignmentIndex setRect:nodeView.frame forIndex:nodeView.tag];
+    [_renderModel setRect:nodeView.frame forIndex:nodeView.tag];
+}
+
+- (NSData *)nodeViewFrames
+{
+    NSMutableData *frames = [[NSMutableData alloc] initWithLength:_nodeViews.count * sizeof(CGRect)];
+    CGRect *rects = frames.mutableBytes;
+    
+    for (NSUInteger i = 0; i < _nodeViews.count; i++) {
+        rects[i] = [_nodeViews[i] frame];
+    }
+    return frames;
+}
+
+- (void)loadNodeViewFrames:(NSData *)frames
+{
+    [_spatialIndex loadRects:frames.bytes count:frames.length / sizeof(CGRect)];
+    _clusterIndexNeedsReload = YES;
+    [_alignmentIndex loadRects:frames.bytes count:frames.length / sizeof(CGRect)];
+    [_renderModel loadRects:frames.bytes count:frames.length / sizeof(CGRect)];
+    _graphIndex.nodeCount = frames.length / sizeof(CGRect);
+}
+
+- (TBCanvasClusterIndex *)clusterIndex
+{
+    [self updateClusterIndex];
+    return _clusterIndex;
+}
+
+- (void)updateClusterIndex
+{
+    if (_clusterIndexNeedsReload) {
+        [self reloadClusterIndex];
+        return;
+    }
+    
+    // Collapsed node views are stacked below their head node and would be counted twice.
+    [_clusterIndexUpdates enumerateIndexesUsingBlock:^(NSUInteger tag, BOOL *stop) {
+        if (tag >= _nodeViews.count) {
+            *stop = YES;
+            return;
+        }
+        TBCanvasNodeView *nodeView = _nodeViews[tag];
+        [_clusterIndex setRect:(nodeView.isInCollapsedSegment ? CGRectNull : nodeView.frame) forIndex:tag];
+    }];
+    [_clusterIndexUpdates removeAllIndexes];
+}
+
+- (void)reloadClusterIndex
+{
+    NSMutableData *frames = [[NSMutableData alloc] initWithLength:_nodeViews.count * sizeof(CGRect)];
+    CGRect *rects = frames.mutableBytes;
+    
+    // Collapsed node views are stacked below their head node and would be counted twice.
+    for (NSUInteger i = 0; i < _nodeViews.count; i++) {
+        TBCanvasNodeView *nodeView = _nodeViews[i];
+        rects[i] = nodeView.isInCollapsedSegment ? CGRectNull : nodeView.frame;
+    }
+    [_clusterIndex loadRects:rects count:_nodeViews.count];
+    [_clusterIndexUpdates removeAllIndexes];
+    _clusterIndexNeedsReload = NO;
+}
+
+- (void)insertNodeView:(TBCanvasNodeView *)nodeView atIndex:(NSUInteger)index
+{
+    [_nodeViews insertObject:nodeView atIndex:index];
+    [self retagNodeViewsStartingAtIndex:index];
+    
+    // Make room at the new tag in every index.
+    [_spatialIndex shiftIndexesStartingAtIndex:index by:1];
+    [_clusterIndex shiftIndexesStartingAtIndex:index by:1];
+    [_clusterIndexUpdates shiftIndexesStartingAtIndex:index by:1];
+    [_alignmentIndex shiftIndexesStartingAtIndex:index by:1];
+    [_graphIndex shiftIndexesStartingAtIndex:index by:1];
+    [_renderModel shiftIndexesStartingAtIndex:index by:1];
+    _graphIndex.nodeCount = _nodeViews.count;
+    
+    [self updateNodeView:nodeView];
+}
+
+- (void)removeNodeViewAtIndex:(NSUInteger)index
+{
+    [_spatialIndex removeIndex:index];
+    [_clusterIndex removeIndex:index];
+    [_clusterIndexUpdates removeIndex:index];
+    [_alignmentIndex removeIndex:index];
+    
+    [_nodeViews removeObjectAtIndex:index];
+    [self retagNodeViewsStartingAtIndex:index];
+    
+    // Close the gap in every index. The render model drops the removed node itself.
+    [_spatialIndex shiftIndexesStartingAtIndex:index + 1 by:-1];
+    [_clusterIndex shiftIndexesStartingAtIndex:index + 1 by:-1];
+    [_clusterIndexUpdates shiftIndexesStartingAtIndex:index + 1 by:-1];
+    [_alignmentIndex shiftIndexesStartingAtIndex:index + 1 by:-1];
+    [_graphIndex shiftIndexesStartingAtIndex:index + 1 by:-1];
+    [_renderModel shiftIndexesStartingAtIndex:index + 1 by:-1];
+    _graphIndex.nodeCount = _nodeViews.count;
+}
+
+- (void)retagNodeViewsStartingAtIndex:(NSUInteger)index
+{
+    for (NSUInteger i = index; i < _nodeViews.count; i++) {
+        TBCanvasNodeView *nodeView = _nodeViews[i];
+        nodeView.tag = i;
+        nodeView.section = _section;
+    }
+}
+
+- (void)setRenderModel:(TBCanvasRenderModel *)renderModel
+{
+    _renderModel = renderModel;
+    [self loadRenderModel:_renderModel];
+}
+
+- (TBCanvasRenderModel *)renderModelSnapshot
+{
+    TBCanvasRenderModel *renderModel = [[TBCanvasRenderModel alloc] init];
+    [self loadRenderModel:renderModel];
+    return renderModel;
+}
+
+- (void)loadRenderModel:(TBCanvasRenderModel *)renderModel
+{
+    [renderModel removeAllEdges];
+    for (TBCanvasConnectionView *connection in _connectionViews) {
+        if (connection.parentNode && connection.childNode) {
+            [renderModel addEdgeFromIndex:connection.parentNode.tag toIndex:connection.childNode.tag];
+        }
+    }
+    NSData *frames = [self nodeViewFrames];
+    [renderModel loadRects:frames.bytes count:frames.length / sizeof(CGRect)];
+}
+
+- (void)removeAllItems
+{
+    [_connectionViews removeAllObjects];
+    [_nodeViews removeAllObjects];
+    [_spatialIndex removeAllIndexes];
+    [_clusterIndex removeAllIndexes];
+    [_clusterIndex removeAllEdges];
+    [_clusterIndexUpdates removeAllIndexes];
+    _clusterIndexNeedsReload = NO;
+    [_alignmentIndex removeAllIndexes];
+    [_graphIndex removeAllEdges];
+    _graphIndex.nodeCount = 0;
+    [_renderModel removeAllIndexes];
+    [_renderModel removeAllEdges];
+}
+
+@end
@@ -0,0 +1,102 @@
+//
+//  TBCanvasSpatialIndex.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+/**
+ This class stores rectangles by index in a uniform grid of buckets and answers range queries.
+ 
+ An instance is not thread safe. Separate instances can be used on separate threads.
+ */
+@interface TBCanvasSpatialIndex : NSObject
+
+/**
+ *  The edge length of a single grid cell.
+ */
+@property (assign, nonatomic, readonly) CGFloat cellSize;
+
+/**
+ *  The number of indexed rectangles.
+ */
+@property (assign, nonatomic, readonly) NSUInteger count;
+
+/**
+ Initializes the TBCanvasSpatialIndex object with a given cell size.
+ 
+ @param cellSize The edge length of a grid cell
+ 
+ @return The initialized TBCanvasSpatialIndex object
+ */
+- (id)initWithCellSize:(CGFloat)cellSize;
+
+/**
+ Stores a rectangle for a given index. Replaces the rectangle previously stored for this index.
+ 
+ @param rect  The given rectangle
+ @param index The given index
+ */
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index;
+
+/**
+ Returns the rectangle stored for a given index.
+ 
+ @param index The given index
+ 
+ @return The stored rectangle. Otherwise CGRectNull.
+ */
+- (CGRect)rectForIndex:(NSUInteger)index;
+
+/**
+ Removes the rectangle stored for a given index.
+ 
+ @param index The given index
+ */
+- (void)removeIndex:(NSUInteger)index;
+
+/**
+ Shifts all stored indexes starting at a given index by a given delta.
+ When shifting down the indexes in front of the given index that are overwritten must have been removed before.
+ Only the cells touched by the shifted rectangles are visited.
+ 
+ @param index The first index to shift
+ @param delta The number of positions to shift by. Negative to shift down
+ */
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta;
+
+/**
+ Replaces the content of the index with a list of rectangles. The rectangle at position i is stored for index i.
+ 
+ @param rects The list of rectangles
+ @param count The number of rectangles in the list
+ */
+- (void)loadRects:(const CGRect *)rects count:(NSUInteger)count;
+
+/**
+ Removes all rectangles.
+ */
+- (void)removeAllIndexes;
+
+/**
+ Returns the indexes of all rectangles intersecting a given rectangle.
+ 
+ @param rect The given rectangle
+ 
+ @return The indexes in ascending order.
+ */
+- (NSIndexSet *)indexesOfRectsIntersectingRect:(CGRect)rect;
+
+/**
+ Returns the smallest rectangle containing all stored rectangles.
+ 
+ @return The bounding rectangle. CGRectNull when the index is empty.
+ */
+- (CGRect)bounds;
+
+@end
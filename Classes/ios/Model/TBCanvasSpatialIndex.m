@@ -0,0 +1,335 @@
+//
+//  TBCanvasSpatialIndex.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasSpatialIndex.h"
+
+@interface TBCanvasSpatialIndex()
+{
+    CGRect *rects;
+    NSUInteger capacity;
+    
+    CGRect cachedBounds;
+    BOOL boundsAreValid;
+}
+
+// Maps a cell key to the indexes of all rectangles touching this cell.
+@property (nonatomic, strong) NSMutableDictionary *cells;
+
+// Stores the index sets of cells which have become empty for reuse.
+@property (nonatomic, strong) NSMutableArray *reusableIndexSets;
+
+/**
+ Grows the storage to hold a given index.
+ 
+ @param index The given index
+ */
+- (void)ensureCapacityForIndex:(NSUInteger)index;
+
+/**
+ Calls a block for every cell touched by a given rectangle.
+ 
+ @param rect  The given rectangle
+ @param block The block to call with the key of the cell
+ */
+- (void)enumerateCellsInRect:(CGRect)rect usingBlock:(void (^)(NSNumber *key))block;
+
+/**
+ Returns the number of cells touched by a given rectangle.
+ 
+ @param rect The given rectangle
+ 
+ @return The number of cells.
+ */
+- (double)numberOfCellsInRect:(CGRect)rect;
+
+/**
+ Returns `YES` when two rectangles touch the same cells.
+ 
+ @param rect      The first rectangle
+ @param otherRect The second rectangle
+ 
+ @return `YES` when the rectangles touch the same cells.
+ */
+- (BOOL)rect:(CGRect)rect touchesSameCellsAsRect:(CGRect)otherRect;
+
+/**
+ Adds an index to the cells touched by a given rectangle.
+ 
+ @param index The given index
+ @param rect  The given rectangle
+ */
+- (void)addIndex:(NSUInteger)index toCellsInRect:(CGRect)rect;
+
+/**
+ Removes an index from the cells touched by a given rectangle. Cells which become empty are dropped.
+ 
+ @param index The given index
+ @param rect  The given rectangle
+ */
+- (void)removeIndex:(NSUInteger)index fromCellsInRect:(CGRect)rect;
+
+@end
+
+@implementation TBCanvasSpatialIndex
+
+- (id)init
+{
+    return [self initWithCellSize:256.0];
+}
+
+- (id)initWithCellSize:(CGFloat)cellSize
+{
+    self = [super init];
+    if (self) {
+        _cellSize = cellSize;
+        _count = 0;
+        _cells = [[NSMutableDictionary alloc] init];
+        _reusableIndexSets = [[NSMutableArray alloc] init];
+        
+        rects = NULL;
+        capacity = 0;
+        cachedBounds = CGRectNull;
+        boundsAreValid = YES;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(rects);
+}
+
+#pragma mark - Cells
+
+- (double)numberOfCellsInRect:(CGRect)rect
+{
+    double columns = floor(CGRectGetMaxX(rect) / _cellSize) - floor(CGRectGetMinX(rect) / _cellSize) + 1.0;
+    double rows    = floor(CGRectGetMaxY(rect) / _cellSize) - floor(CGRectGetMinY(rect) / _cellSize) + 1.0;
+    return columns * rows;
+}
+
+- (void)enumerateCellsInRect:(CGRect)rect usingBlock:(void (^)(NSNumber *key))block
+{
+    int32_t minColumn = (int32_t)floor(CGRectGetMinX(rect) / _cellSize);
+    int32_t maxColumn = (int32_t)floor(CGRectGetMaxX(rect) / _cellSize);
+    int32_t minRow    = (int32_t)floor(CGRectGetMinY(rect) / _cellSize);
+    int32_t maxRow    = (int32_t)floor(CGRectGetMaxY(rect) / _cellSize);
+    
+    for (int32_t row = minRow; row <= maxRow; row++) {
+        for (int32_t column = minColumn; column <= maxColumn; column++) {
+            block(@(((int64_t)row << 32) | (uint32_t)column));
+        }
+    }
+}
+
+- (BOOL)rect:(CGRect)rect touchesSameCellsAsRect:(CGRect)otherRect
+{
+    return (floor(CGRectGetMinX(rect) / _cellSize) == floor(CGRectGetMinX(otherRect) / _cellSize) &&
+            floor(CGRectGetMaxX(rect) / _cellSize) == floor(CGRectGetMaxX(otherRect) / _cellSize) &&
+            floor(CGRectGetMinY(rect) / _cellSize) == floor(CGRectGetMinY(otherRect) / _cellSize) &&
+            floor(CGRectGetMaxY(rect) / _cellSize) == floor(CGRectGetMaxY(otherRect) / _cellSize));
+}
+
+- (void)addIndex:(NSUInteger)index toCellsInRect:(CGRect)rect
+{
+    [self enumerateCellsInRect:rect usingBlock:^(NSNumber *key) {
+        NSMutableIndexSet *indexes = _cells[key];
+        if (indexes == nil) {
+            indexes = _reusableIndexSets.lastObject;
+            if (indexes) {
+                [_reusableIndexSets removeLastObject];
+            } else {
+                indexes = [[NSMutableIndexSet alloc] init];
+            }
+            _cells[key] = indexes;
+        }
+        [indexes addIndex:index];
+    }];
+}
+
+- (void)removeIndex:(NSUInteger)index fromCellsInRect:(CGRect)rect
+{
+    [self enumerateCellsInRect:rect usingBlock:^(NSNumber *key) {
+        NSMutableIndexSet *indexes = _cells[key];
+        [indexes removeIndex:index];
+        if (indexes && indexes.count == 0) {
+            [_reusableIndexSets addObject:indexes];
+            [_cells removeObjectForKey:key];
+        }
+    }];
+}
+
+#pragma mark - Updating
+
+- (void)ensureCapacityForIndex:(NSUInteger)index
+{
+    if (index < capacity) {
+        return;
+    }
+    
+    NSUInteger newCapacity = MAX(capacity * 2, MAX(index + 1, 64));
+    rects = realloc(rects, newCapacity * sizeof(CGRect));
+    for (NSUInteger i = capacity; i < newCapacity; i++) {
+        rects[i] = CGRectNull;
+    }
+    capacity = newCapacity;
+}
+
+- (void)setRect:(CGRect)rect forIndex:(NSUInteger)index
+{
+    if (CGRectIsNull(rect)) {
+        [self removeIndex:index];
+        return;
+    }
+    
+    [self ensureCapacityForIndex:index];
+    
+    CGRect oldRect = rects[index];
+    if (CGRectEqualToRect(oldRect, rect)) {
+        return;
+    }
+    
+    // Moving inside the same cells - the common case while dragging - leaves the cells as they are.
+    if (CGRectIsNull(oldRect)) {
+        _count++;
+        [self addIndex:index toCellsInRect:rect];
+    } else if ([self rect:oldRect touchesSameCellsAsRect:rect] == NO) {
+        [self removeIndex:index fromCellsInRect:oldRect];
+        [self addIndex:index toCellsInRect:rect];
+    }
+    rects[index] = rect;
+    
+    // Growing keeps the bounds valid. Shrinking an edge does not.
+    if (boundsAreValid) {
+        if (CGRectIsNull(oldRect) || CGRectContainsRect(CGRectInset(cachedBounds, 1.0, 1.0), oldRect)) {
+            cachedBounds = CGRectUnion(cachedBounds, rect);
+        } else {
+            boundsAreValid = NO;
+        }
+    }
+}
+
+- (CGRect)rectForIndex:(NSUInteger)index
+{
+    if (index >= capacity) {
+        return CGRectNull;
+    }
+    return rects[index];
+}
+
+- (void)removeIndex:(NSUInteger)index
+{
+    if (index >= capacity || CGRectIsNull(rects[index])) {
+        return;
+    }
+    
+    [self removeIndex:index fromCellsInRect:rects[index]];
+    rects[index] = CGRectNull;
+    _count--;
+    boundsAreValid = NO;
+}
+
+- (void)shiftIndexesStartingAtIndex:(NSUInteger)index by:(NSInteger)delta
+{
+    NSUInteger end = capacity;
+    while (end > index && CGRectIsNull(rects[end - 1])) {
+        end--;
+    }
+    if (delta == 0 || end <= index) {
+        return;
+    }
+    if (delta > 0) {
+        [self ensureCapacityForIndex:end - 1 + delta];
+    }
+    
+    // The geometry does not change - only the indexes stored in the cells touched by the shifted range.
+    NSMutableSet *shiftedCells = [[NSMutableSet alloc] init];
+    for (NSUInteger i = index; i < end; i++) {
+        if (CGRectIsNull(rects[i]) == NO) {
+            [self enumerateCellsInRect:rects[i] usingBlock:^(NSNumber *key) {
+                [shiftedCells addObject:key];
+            }];
+        }
+    }
+    
+    memmove(rects + index + delta, rects + index, (end - index) * sizeof(CGRect));
+    NSUInteger clearedStart = (delta > 0) ? index : end + delta;
+    for (NSUInteger i = clearedStart; i < clearedStart + labs(delta); i++) {
+        rects[i] = CGRectNull;
+    }
+    for (NSNumber *key in shiftedCells) {
+        [_cells[key] shiftIndexesStartingAtIndex:index by:delta];
+    }
+}
+
+- (void)loadRects:(const CGRect *)newRects count:(NSUInteger)count
+{
+    [self removeAllIndexes];
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        [self setRect:newRects[i] forIndex:i];
+    }
+}
+
+- (void)removeAllIndexes
+{
+    [_cells removeAllObjects];
+    for (NSUInteger i = 0; i < capacity; i++) {
+        rects[i] = CGRectNull;
+    }
+    _count = 0;
+    cachedBounds = CGRectNull;
+    boundsAreValid = YES;
+}
+
+#pragma mark - Querying
+
+- (NSIndexSet *)indexesOfRectsIntersectingRect:(CGRect)rect
+{
+    NSMutableIndexSet *result = [[NSMutableIndexSet alloc] init];
+    
+    if (_count == 0 || CGRectIsNull(rect)) {
+        return result;
+    }
+    
+    // A linear scan is cheaper when the query touches more cells than there are occupied cells.
+    if (CGRectIsInfinite(rect) || [self numberOfCellsInRect:rect] > _cells.count) {
+        for (NSUInteger i = 0; i < capacity; i++) {
+            if (CGRectIsNull(rects[i]) == NO && CGRectIntersectsRect(rects[i], rect)) {
+                [result addIndex:i];
+            }
+        }
+        return result;
+    }
+    
+    [self enumerateCellsInRect:rect usingBlock:^(NSNumber *key) {
+        [_cells[key] enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+            if (CGRectIntersectsRect(rects[index], rect)) {
+                [result addIndex:index];
+            }
+        }];
+    }];
+    return result;
+}
+
+- (CGRect)bounds
+{
+    if (boundsAreValid == NO) {
+        cachedBounds = CGRectNull;
+        for (NSUInteger i = 0; i < capacity; i++) {
+            if (CGRectIsNull(rects[i]) == NO) {
+                cachedBounds = CGRectUnion(cachedBounds, rects[i]);
+            }
+        }
+        boundsAreValid = YES;
+    }
+    return cachedBounds;
+}
+
+@end
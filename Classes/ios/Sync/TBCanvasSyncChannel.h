@@ -0,0 +1,77 @@
+//
+//  TBCanvasSyncChannel.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreFoundation/CoreFoundation.h>
+
+@class TBCanvasSyncChannel;
+
+/**
+ This is the delegate protocol for the TBCanvasSyncChannel.
+ */
+@protocol TBCanvasSyncChannelDelegate <NSObject>
+
+/**
+ A complete frame has been received.
+ 
+ @param channel The TBCanvasSyncChannel instance calling this method
+ @param frame   The payload of the frame
+ */
+- (void)syncChannel:(TBCanvasSyncChannel *)channel didReceiveFrame:(NSData *)frame;
+
+/**
+ The connection has been closed by the other side or has failed.
+ 
+ @param channel The TBCanvasSyncChannel instance calling this method
+ */
+- (void)syncChannelDidClose:(TBCanvasSyncChannel *)channel;
+
+@end
+
+/**
+ This class sends and receives length prefixed frames over a connected stream socket.
+ 
+ The socket is served on the run loop of the thread the channel has been created on. Frames are delivered on that thread.
+ */
+@interface TBCanvasSyncChannel : NSObject
+
+/**
+ *  The channel's delegate.
+ */
+@property (weak, nonatomic) id<TBCanvasSyncChannelDelegate> delegate;
+
+/**
+ *  `YES` until the channel has been closed.
+ */
+@property (assign, nonatomic, readonly, getter = isOpen) BOOL open;
+
+/**
+ Initializes the TBCanvasSyncChannel object with a connected socket. The channel owns the socket and closes it.
+ 
+ @param nativeSocket The connected socket
+ 
+ @return The initialized TBCanvasSyncChannel object
+ */
+- (id)initWithNativeSocket:(CFSocketNativeHandle)nativeSocket;
+
+/**
+ Sends a frame. Blocks until the frame has been handed to the system.
+ 
+ @param frame The payload of the frame
+ 
+ @return `YES` when the frame has been sent.
+ */
+- (BOOL)sendFrame:(NSData *)frame;
+
+/**
+ Closes the connection. The delegate is not called.
+ */
+- (void)close;
+
+@end
@@ -0,0 +1,178 @@
+//
+//  TBCanvasSyncChannel.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <netinet/tcp.h>
+#import <poll.h>
+#import <errno.h>
+#import <libkern/OSByteOrder.h>
+
+#import "TBCanvasSyncChannel.h"
+
+static const NSUInteger FRAME_HEADER_SIZE     = 4;
+static const uint32_t   FRAME_MAXIMUM_SIZE    = 64 * 1024 * 1024;
+static const int        CHANNEL_SEND_TIMEOUT  = 5000;
+
+static void TBCanvasSyncChannelCallBack(CFSocketRef socket, CFSocketCallBackType type, CFDataRef address, const void *data, void *info);
+
+@interface TBCanvasSyncChannel()
+{
+    CFSocketRef socketRef;
+    CFRunLoopSourceRef runLoopSource;
+}
+
+@property (assign, nonatomic, readwrite, getter = isOpen) BOOL open;
+
+// Received bytes not yet forming a complete frame.
+@property (nonatomic, strong) NSMutableData *inputBuffer;
+
+/** @name Receiving */
+
+/**
+ Appends received bytes to the input buffer and delivers all complete frames.
+ 
+ @param data The received bytes. Empty when the connection has been closed
+ */
+- (void)receiveData:(NSData *)data;
+
+/** @name Sending */
+
+/**
+ Writes bytes to the socket. Waits while the socket buffer is full.
+ 
+ @param bytes  The bytes
+ @param length The number of bytes
+ 
+ @return `YES` when all bytes have been written.
+ */
+- (BOOL)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+
+@end
+
+@implementation TBCanvasSyncChannel
+
+- (id)initWithNativeSocket:(CFSocketNativeHandle)nativeSocket
+{
+    self = [super init];
+    if (self) {
+        int option = 1;
+        setsockopt(nativeSocket, SOL_SOCKET, SO_NOSIGPIPE, &option, sizeof(option));
+        setsockopt(nativeSocket, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+        
+        CFSocketContext context = {0, (__bridge void *)self, NULL, NULL, NULL};
+        socketRef = CFSocketCreateWithNative(kCFAllocatorDefault, nativeSocket, kCFSocketDataCallBack, TBCanvasSyncChannelCallBack, &context);
+        runLoopSource = CFSocketCreateRunLoopSource(kCFAllocatorDefault, socketRef, 0);
+        CFRunLoopAddSource(CFRunLoopGetCurrent(), runLoopSource, kCFRunLoopCommonModes);
+        
+        _inputBuffer = [[NSMutableData alloc] init];
+        _open = YES;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self close];
+}
+
+- (void)close
+{
+    if (_open == NO) {
+        return;
+    }
+    _open = NO;
+    
+    CFRunLoopSourceInvalidate(runLoopSource);
+    CFRelease(runLoopSource);
+    runLoopSource = NULL;
+    
+    CFSocketInvalidate(socketRef);
+    CFRelease(socketRef);
+    socketRef = NULL;
+}
+
+#pragma mark - Receiving
+
+- (void)receiveData:(NSData *)data
+{
+    if (data.length == 0) {
+        [self close];
+        [_delegate syncChannelDidClose:self];
+        return;
+    }
+    [_inputBuffer appendData:data];
+    
+    NSUInteger offset = 0;
+    while (_open && _inputBuffer.length - offset >= FRAME_HEADER_SIZE) {
+        uint32_t frameLength = OSReadLittleInt32(_inputBuffer.bytes, offset);
+        if (frameLength > FRAME_MAXIMUM_SIZE) {
+            [self close];
+            [_delegate syncChannelDidClose:self];
+            return;
+        }
+        if (_inputBuffer.length - offset - FRAME_HEADER_SIZE < frameLength) {
+            break;
+        }
+        
+        NSData *frame = [_inputBuffer subdataWithRange:NSMakeRange(offset + FRAME_HEADER_SIZE, frameLength)];
+        offset += FRAME_HEADER_SIZE + frameLength;
+        [_delegate syncChannel:self didReceiveFrame:frame];
+    }
+    if (offset > 0) {
+        [_inputBuffer replaceBytesInRange:NSMakeRange(0, MIN(offset, _inputBuffer.length)) withBytes:NULL length:0];
+    }
+}
+
+#pragma mark - Sending
+
+- (BOOL)sendFrame:(NSData *)frame
+{
+    if (_open == NO || frame.length > FRAME_MAXIMUM_SIZE) {
+        return NO;
+    }
+    
+    uint8_t header[FRAME_HEADER_SIZE];
+    OSWriteLittleInt32(header, 0, (uint32_t)frame.length);
+    return ([self writeBytes:header length:FRAME_HEADER_SIZE] && [self writeBytes:frame.bytes length:frame.length]);
+}
+
+- (BOOL)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    CFSocketNativeHandle nativeSocket = CFSocketGetNative(socketRef);
+    
+    while (length > 0) {
+        ssize_t written = send(nativeSocket, bytes, length, 0);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                struct pollfd descriptor = {nativeSocket, POLLOUT, 0};
+                if (poll(&descriptor, 1, CHANNEL_SEND_TIMEOUT) > 0) {
+                    continue;
+                }
+            }
+            return NO;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return YES;
+}
+
+@end
+
+static void TBCanvasSyncChannelCallBack(CFSocketRef socket, CFSocketCallBackType type, CFDataRef address, const void *data, void *info)
+{
+    if (type == kCFSocketDataCallBack) {
+        TBCanvasSyncChannel *channel = (__bridge TBCanvasSyncChannel *)info;
+        [channel receiveData:(__bridge NSData *)data];
+    }
+}
@@ -0,0 +1,61 @@
+//
+//  TBCanvasSyncClient.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+#import "TBCanvasSyncEngine.h"
+
+/**
+ This class connects a TBCanvasSyncEngine to a TBCanvasSyncServer on the loopback interface.
+ 
+ Local deltas recorded during one run loop cycle are sent as a single batch. Received batches are merged by the engine.
+ The client is served on the run loop of the thread it has been connected on - usually the main thread.
+ */
+@interface TBCanvasSyncClient : NSObject <TBCanvasSyncEngineDelegate>
+
+/**
+ *  The synchronized engine. The client becomes its delegate.
+ */
+@property (strong, nonatomic, readonly) TBCanvasSyncEngine *syncEngine;
+
+/**
+ *  `YES` while the client is connected.
+ */
+@property (assign, nonatomic, readonly, getter = isConnected) BOOL connected;
+
+/**
+ Initializes the TBCanvasSyncClient object with a TBCanvasSyncEngine.
+ 
+ @param syncEngine The synchronized engine
+ 
+ @return The initialized TBCanvasSyncClient object
+ */
+- (id)initWithSyncEngine:(TBCanvasSyncEngine *)syncEngine;
+
+/**
+ Connects to a server on the loopback interface.
+ 
+ @param port  The TCP port of the server
+ @param error Returns the error when the connection can not be established
+ 
+ @return `YES` when the client has been connected.
+ */
+- (BOOL)connectToPort:(uint16_t)port error:(NSError **)error;
+
+/**
+ Sends all pending local deltas as one batch. Called automatically once per run loop cycle.
+ */
+- (void)sendPendingDeltas;
+
+/**
+ Closes the connection.
+ */
+- (void)disconnect;
+
+@end
@@ -0,0 +1,123 @@
+//
+//  TBCanvasSyncClient.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
+#import <unistd.h>
+
+#import "TBCanvasSyncClient.h"
+#import "TBCanvasSyncChannel.h"
+
+@interface TBCanvasSyncClient() <TBCanvasSyncChannelDelegate>
+
+@property (nonatomic, strong, readwrite) TBCanvasSyncEngine *syncEngine;
+
+// The connection to the server.
+@property (nonatomic, strong) TBCanvasSyncChannel *channel;
+
+@end
+
+@implementation TBCanvasSyncClient
+
+- (id)initWithSyncEngine:(TBCanvasSyncEngine *)syncEngine
+{
+    self = [super init];
+    if (self) {
+        _syncEngine = syncEngine;
+        _syncEngine.delegate = self;
+        _channel = nil;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:self];
+    [_channel close];
+}
+
+- (BOOL)isConnected
+{
+    return _channel.isOpen;
+}
+
+#pragma mark - Connecting
+
+- (BOOL)connectToPort:(uint16_t)port error:(NSError **)error
+{
+    [self disconnect];
+    
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    int nativeSocket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (nativeSocket < 0 || connect(nativeSocket, (const struct sockaddr *)&address, sizeof(address)) != 0) {
+        if (nativeSocket >= 0) {
+            close(nativeSocket);
+        }
+        if (error) {
+            *error = [NSError errorWithDomain:TBCanvasSyncErrorDomain code:3 userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Can not connect to port %u.", port]}];
+        }
+        return NO;
+    }
+    
+    _channel = [[TBCanvasSyncChannel alloc] initWithNativeSocket:nativeSocket];
+    _channel.delegate = self;
+    
+    // Edits made before connecting are sent right away.
+    [self sendPendingDeltas];
+    return YES;
+}
+
+- (void)disconnect
+{
+    [_channel close];
+    _channel = nil;
+}
+
+#pragma mark - Sending
+
+- (void)sendPendingDeltas
+{
+    if (_channel.isOpen == NO) {
+        return;
+    }
+    
+    NSData *batch = [_syncEngine takePendingBatch];
+    if (batch && [_channel sendFrame:batch] == NO) {
+        [self disconnect];
+    }
+}
+
+#pragma mark - TBCanvasSyncEngineDelegate
+
+- (void)syncEngineDidRecordDeltas:(TBCanvasSyncEngine *)syncEngine
+{
+    // Collect all edits of the current run loop cycle in one batch.
+    [self performSelector:@selector(sendPendingDeltas) withObject:nil afterDelay:0.0];
+}
+
+#pragma mark - TBCanvasSyncChannelDelegate
+
+- (void)syncChannel:(TBCanvasSyncChannel *)channel didReceiveFrame:(NSData *)frame
+{
+    [_syncEngine applyBatch:frame error:NULL];
+}
+
+- (void)syncChannelDidClose:(TBCanvasSyncChannel *)channel
+{
+    _channel = nil;
+}
+
+@end
@@ -0,0 +1,226 @@
+//
+//  TBCanvasSyncEngine.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+@class TBCollectionCanvasContentView;
+@class TBCanvasSyncEngine;
+
+extern NSString * const TBCanvasSyncErrorDomain;
+
+/**
+ The kind of edit a delta describes.
+ */
+typedef NS_ENUM(uint8_t, TBCanvasDeltaKind) {
+    TBCanvasDeltaKindMoveNode = 0,
+    TBCanvasDeltaKindAddConnection,
+    TBCanvasDeltaKindRemoveConnection,
+    TBCanvasDeltaKindCollapseNode,
+    TBCanvasDeltaKindExpandNode
+};
+
+/**
+ A single edit of a canvas.
+ 
+ Node views are referenced by section and tag - edits in sections beyond UINT16_MAX are not recorded. Connections are referenced
+ by the section and tag of their parent node and the tag of their child node in childTag - moving a connection is a removal followed
+ by an addition. location is the new center of a moved node view. clock and site are the version of the delta - a Lamport clock
+ and the id of the editing device.
+ */
+typedef struct {
+    TBCanvasDeltaKind kind;
+    uint16_t section;
+    int32_t nodeTag;
+    int32_t childTag;
+    CGPoint location;
+    uint64_t clock;
+    uint32_t site;
+} TBCanvasDelta;
+
+/**
+ This is the delegate protocol for the TBCanvasSyncEngine.
+ */
+@protocol TBCanvasSyncEngineDelegate <NSObject>
+
+@optional
+
+/**
+ The first local delta since the last batch has been recorded. Called once per batch.
+ 
+ @param syncEngine The TBCanvasSyncEngine instance calling this method
+ */
+- (void)syncEngineDidRecordDeltas:(TBCanvasSyncEngine *)syncEngine;
+
+@end
+
+/**
+ This class mirrors the edits of a TBCollectionCanvasContentView across devices.
+ 
+ Local edits are recorded as compact deltas of fixed size. Every field - the position of a node view, its collapse state or the
+ presence of a connection - keeps the version of its last edit. Repeated edits of a field before the next batch is taken replace
+ each other, so the size of a batch depends on the number of edited fields - not on the size of the canvas.
+ 
+ Remote batches are merged field by field. The edit with the higher version wins - the higher clock or, on equal clocks,
+ the higher site. Accepted deltas are applied to the canvas in a single pass per batch.
+ 
+ Inserting and deleting node views is not synchronized and changes the tags deltas refer to. Every insertion or deletion starts a
+ new epoch. Batches carry the epoch they have been recorded in and are only merged by engines in the same epoch - devices reach
+ it by applying the same insertions and deletions.
+ 
+ Batches are stored in a compact binary format of fixed size records.
+ */
+@interface TBCanvasSyncEngine : NSObject
+
+/**
+ *  The id of the editing device. Must be unique among all synchronized devices.
+ */
+@property (assign, nonatomic, readonly) uint32_t site;
+
+/**
+ *  The Lamport clock. The highest clock seen so far.
+ */
+@property (assign, nonatomic, readonly) uint64_t clock;
+
+/**
+ *  The number of insertions and deletions of node views since the engine has been created. Stored in every batch.
+ */
+@property (assign, nonatomic, readonly) uint16_t epoch;
+
+/**
+ *  The canvas edited on this device. Set by the canvas when the engine is attached to it.
+ */
+@property (weak, nonatomic) TBCollectionCanvasContentView *contentView;
+
+/**
+ *  The engine's delegate.
+ */
+@property (weak, nonatomic) id<TBCanvasSyncEngineDelegate> delegate;
+
+/**
+ *  The number of local deltas waiting for the next batch.
+ */
+@property (assign, nonatomic, readonly) NSUInteger pendingDeltaCount;
+
+/**
+ *  `YES` while remote deltas are applied to the canvas. Local deltas are not recorded meanwhile.
+ */
+@property (assign, nonatomic, readonly, getter = isApplyingRemoteDeltas) BOOL applyingRemoteDeltas;
+
+/**
+ *  The number of remote deltas applied to the canvas.
+ */
+@property (assign, nonatomic, readonly) NSUInteger appliedDeltaCount;
+
+/**
+ *  The number of remote deltas discarded because a newer edit of their field had been seen before.
+ */
+@property (assign, nonatomic, readonly) NSUInteger discardedDeltaCount;
+
+/**
+ Initializes the TBCanvasSyncEngine object with the id of the editing device.
+ 
+ @param site The id of the editing device
+ 
+ @return The initialized TBCanvasSyncEngine object
+ */
+- (id)initWithSite:(uint32_t)site;
+
+/**
+ Records a local edit. The version is assigned by the engine.
+ 
+ @param delta The given delta
+ */
+- (void)recordDelta:(TBCanvasDelta)delta;
+
+/**
+ Starts a new epoch after node views have been inserted into or deleted from a given section.
+ Drops the versions and the pending deltas of the section - their tags name other node views now.
+ 
+ @param section The given section
+ */
+- (void)invalidateSection:(NSInteger)section;
+
+/**
+ Returns the recorded local deltas as a batch and starts a new one.
+ 
+ @return The batch. `nil` when no delta has been recorded.
+ */
+- (NSData *)takePendingBatch;
+
+/**
+ Merges a remote batch into the canvas.
+ 
+ @param batch The batch
+ @param error Returns the error when the batch is not valid or belongs to another epoch
+ 
+ @return `YES` when the batch has been merged.
+ */
+- (BOOL)applyBatch:(NSData *)batch error:(NSError **)error;
+
+/**
+ Encodes a list of deltas as a batch of the first epoch.
+ 
+ @param deltas The list of deltas
+ @param count  The number of deltas in the list
+ 
+ @return The batch.
+ */
++ (NSData *)batchWithDeltas:(const TBCanvasDelta *)deltas count:(NSUInteger)count;
+
+/**
+ Encodes a list of deltas as a batch of a given epoch.
+ 
+ @param deltas The list of deltas
+ @param count  The number of deltas in the list
+ @param epoch  The epoch the deltas have been recorded in
+ 
+ @return The batch.
+ */
++ (NSData *)batchWithDeltas:(const TBCanvasDelta *)deltas count:(NSUInteger)count epoch:(uint16_t)epoch;
+
+/**
+ Merges a list of batches into a single batch holding only the newest delta of every field, ordered by version.
+ Merging the compacted batch has the same effect as merging all batches. Batches which are not valid and batches of earlier epochs are skipped.
+ 
+ @param batches The list of batches
+ 
+ @return The compacted batch.
+ */
++ (NSData *)compactedBatchWithBatches:(NSArray *)batches;
+
+/**
+ Returns the number of deltas in a batch.
+ 
+ @param batch The batch
+ 
+ @return The number of deltas. NSNotFound when the batch is not valid.
+ */
++ (NSUInteger)countOfDeltasInBatch:(NSData *)batch;
+
+/**
+ Returns the epoch a batch has been recorded in.
+ 
+ @param batch The batch
+ 
+ @return The epoch. 0 when the batch is not valid.
+ */
++ (uint16_t)epochOfBatch:(NSData *)batch;
+
+/**
+ Decodes a single delta of a batch.
+ 
+ @param index The index of the delta
+ @param batch The batch
+ 
+ @return The delta.
+ */
++ (TBCanvasDelta)deltaAtIndex:(NSUInteger)index inBatch:(NSData *)batch;
+
+@end
@@ -0,0 +1,401 @@
+//
+//  TBCanvasSyncEngine.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <libkern/OSByteOrder.h>
+
+#import "TBCanvasSyncEngine.h"
+#import "TBCollectionCanvasContentView.h"
+
+NSString * const TBCanvasSyncErrorDomain = @"TBCanvasSyncErrorDomain";
+
+static const char       BATCH_MAGIC[4]    = {'T', 'B', 'S', 'Y'};
+static const uint16_t   BATCH_VERSION     = 2;
+static const NSUInteger BATCH_HEADER_SIZE = 8;
+static const NSUInteger BATCH_RECORD_SIZE = 32;
+
+/**
+ The version of the last edit of a field.
+ */
+typedef struct {
+    uint64_t clock;
+    uint32_t site;
+} TBCanvasSyncVersion;
+
+/**
+ Returns the field edited by a delta - the kind of field, the section, the node tag and the child tag of connections.
+ Collapsing and expanding edit the same field, adding and removing a connection too.
+ */
+static NSIndexPath *TBCanvasSyncFieldOfDelta(TBCanvasDelta delta)
+{
+    NSUInteger field = 0;
+    NSUInteger childTag = 0;
+    
+    if (delta.kind == TBCanvasDeltaKindAddConnection || delta.kind == TBCanvasDeltaKindRemoveConnection) {
+        field = 1;
+        childTag = (uint32_t)delta.childTag;
+    } else if (delta.kind == TBCanvasDeltaKindCollapseNode || delta.kind == TBCanvasDeltaKindExpandNode) {
+        field = 2;
+    }
+    
+    NSUInteger indexes[4] = {field, delta.section, (uint32_t)delta.nodeTag, childTag};
+    return [NSIndexPath indexPathWithIndexes:indexes length:4];
+}
+
+/**
+ Orders two deltas by version - by clock first and by site on equal clocks.
+ */
+static int TBCanvasSyncDeltaCompareVersions(const void *first, const void *second)
+{
+    const TBCanvasDelta *a = first;
+    const TBCanvasDelta *b = second;
+    
+    if (a->clock != b->clock) {
+        return (a->clock < b->clock) ? -1 : 1;
+    }
+    if (a->site != b->site) {
+        return (a->site < b->site) ? -1 : 1;
+    }
+    return 0;
+}
+
+@interface TBCanvasSyncEngine()
+{
+    TBCanvasDelta *pendingDeltas;
+    NSUInteger pendingCapacity;
+}
+
+@property (assign, nonatomic, readwrite) uint64_t clock;
+@property (assign, nonatomic, readwrite) uint16_t epoch;
+@property (assign, nonatomic, readwrite) NSUInteger pendingDeltaCount;
+@property (assign, nonatomic, readwrite, getter = isApplyingRemoteDeltas) BOOL applyingRemoteDeltas;
+@property (assign, nonatomic, readwrite) NSUInteger appliedDeltaCount;
+@property (assign, nonatomic, readwrite) NSUInteger discardedDeltaCount;
+
+// The version of the last edit of every field seen so far - local or remote.
+@property (nonatomic, strong) NSMutableDictionary *versions;
+
+// The position of the pending local delta of every field edited since the last batch.
+@property (nonatomic, strong) NSMutableDictionary *pendingIndexes;
+
+/** @name Versions */
+
+/**
+ Returns whether a delta is newer than the last edit of its field and stores its version if so.
+ 
+ @param delta The given delta
+ @param field The field edited by the delta
+ 
+ @return `YES` when the delta is newer.
+ */
+- (BOOL)storeVersionOfDelta:(TBCanvasDelta)delta field:(NSIndexPath *)field;
+
+@end
+
+@implementation TBCanvasSyncEngine
+
+- (id)init
+{
+    return [self initWithSite:arc4random()];
+}
+
+- (id)initWithSite:(uint32_t)site
+{
+    self = [super init];
+    if (self) {
+        _site = site;
+        _clock = 0;
+        _epoch = 0;
+        _versions = [[NSMutableDictionary alloc] init];
+        _pendingIndexes = [[NSMutableDictionary alloc] init];
+        pendingDeltas = NULL;
+        pendingCapacity = 0;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(pendingDeltas);
+}
+
+#pragma mark - Versions
+
+- (BOOL)storeVersionOfDelta:(TBCanvasDelta)delta field:(NSIndexPath *)field
+{
+    NSValue *knownVersion = _versions[field];
+    if (knownVersion) {
+        TBCanvasSyncVersion version;
+        [knownVersion getValue:&version];
+        if (delta.clock < version.clock || (delta.clock == version.clock && delta.site <= version.site)) {
+            return NO;
+        }
+    }
+    
+    TBCanvasSyncVersion version = {delta.clock, delta.site};
+    _versions[field] = [NSValue valueWithBytes:&version objCType:@encode(TBCanvasSyncVersion)];
+    return YES;
+}
+
+#pragma mark - Epochs
+
+- (void)invalidateSection:(NSInteger)section
+{
+    _epoch++;
+    
+    // Tags recorded before the edit name other node views now.
+    for (NSIndexPath *field in _versions.allKeys) {
+        if ([field indexAtPosition:1] == (NSUInteger)section) {
+            [_versions removeObjectForKey:field];
+        }
+    }
+    
+    NSUInteger keptCount = 0;
+    [_pendingIndexes removeAllObjects];
+    for (NSUInteger i = 0; i < _pendingDeltaCount; i++) {
+        if (pendingDeltas[i].section != section) {
+            _pendingIndexes[TBCanvasSyncFieldOfDelta(pendingDeltas[i])] = @(keptCount);
+            pendingDeltas[keptCount++] = pendingDeltas[i];
+        }
+    }
+    _pendingDeltaCount = keptCount;
+}
+
+#pragma mark - Local deltas
+
+- (void)recordDelta:(TBCanvasDelta)delta
+{
+    if (_applyingRemoteDeltas) {
+        return;
+    }
+    
+    delta.clock = ++_clock;
+    delta.site = _site;
+    
+    NSIndexPath *field = TBCanvasSyncFieldOfDelta(delta);
+    [self storeVersionOfDelta:delta field:field];
+    
+    // A field edited again before the next batch only sends its last edit.
+    NSNumber *pendingIndex = _pendingIndexes[field];
+    if (pendingIndex) {
+        pendingDeltas[pendingIndex.unsignedIntegerValue] = delta;
+        return;
+    }
+    
+    if (_pendingDeltaCount == pendingCapacity) {
+        pendingCapacity = MAX(pendingCapacity * 2, 64);
+        pendingDeltas = realloc(pendingDeltas, pendingCapacity * sizeof(TBCanvasDelta));
+    }
+    _pendingIndexes[field] = @(_pendingDeltaCount);
+    pendingDeltas[_pendingDeltaCount++] = delta;
+    
+    if (_pendingDeltaCount == 1 && [_delegate respondsToSelector:@selector(syncEngineDidRecordDeltas:)]) {
+        [_delegate syncEngineDidRecordDeltas:self];
+    }
+}
+
+- (NSData *)takePendingBatch
+{
+    if (_pendingDeltaCount == 0) {
+        return nil;
+    }
+    
+    NSData *batch = [TBCanvasSyncEngine batchWithDeltas:pendingDeltas count:_pendingDeltaCount epoch:_epoch];
+    _pendingDeltaCount = 0;
+    [_pendingIndexes removeAllObjects];
+    return batch;
+}
+
+#pragma mark - Remote deltas
+
+- (BOOL)applyBatch:(NSData *)batch error:(NSError **)error
+{
+    NSUInteger count = [TBCanvasSyncEngine countOfDeltasInBatch:batch];
+    if (count == NSNotFound) {
+        if (error) {
+            *error = [NSError errorWithDomain:TBCanvasSyncErrorDomain code:1 userInfo:@{NSLocalizedDescriptionKey: @"Not a valid delta batch."}];
+        }
+        return NO;
+    }
+    if ([TBCanvasSyncEngine epochOfBatch:batch] != _epoch) {
+        if (error) {
+            *error = [NSError errorWithDomain:TBCanvasSyncErrorDomain code:2 userInfo:@{NSLocalizedDescriptionKey: @"The delta batch belongs to another epoch."}];
+        }
+        return NO;
+    }
+    
+    // Only the newest edit of every field is applied.
+    TBCanvasDelta *acceptedDeltas = malloc(MAX(count, 1) * sizeof(TBCanvasDelta));
+    NSUInteger acceptedCount = 0;
+    NSMutableDictionary *acceptedIndexes = [[NSMutableDictionary alloc] initWithCapacity:count];
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        TBCanvasDelta delta = [TBCanvasSyncEngine deltaAtIndex:i inBatch:batch];
+        _clock = MAX(_clock, delta.clock);
+        
+        if (delta.kind > TBCanvasDeltaKindExpandNode) {
+            _discardedDeltaCount++;
+            continue;
+        }
+        
+        NSIndexPath *field = TBCanvasSyncFieldOfDelta(delta);
+        if ([self storeVersionOfDelta:delta field:field] == NO) {
+            _discardedDeltaCount++;
+            continue;
+        }
+        
+        NSNumber *acceptedIndex = acceptedIndexes[field];
+        if (acceptedIndex) {
+            acceptedDeltas[acceptedIndex.unsignedIntegerValue] = delta;
+            _discardedDeltaCount++;
+        } else {
+            acceptedIndexes[field] = @(acceptedCount);
+            acceptedDeltas[acceptedCount++] = delta;
+        }
+    }
+    
+    if (acceptedCount > 0) {
+        _applyingRemoteDeltas = YES;
+        [_contentView applySyncDeltas:acceptedDeltas count:acceptedCount];
+        _applyingRemoteDeltas = NO;
+        _appliedDeltaCount += acceptedCount;
+    }
+    free(acceptedDeltas);
+    return YES;
+}
+
+#pragma mark - Encoding
+
++ (NSData *)batchWithDeltas:(const TBCanvasDelta *)deltas count:(NSUInteger)count
+{
+    return [self batchWithDeltas:deltas count:count epoch:0];
+}
+
++ (NSData *)batchWithDeltas:(const TBCanvasDelta *)deltas count:(NSUInteger)count epoch:(uint16_t)epoch
+{
+    NSMutableData *data = [[NSMutableData alloc] initWithLength:BATCH_HEADER_SIZE + count * BATCH_RECORD_SIZE];
+    uint8_t *bytes = data.mutableBytes;
+    
+    memcpy(bytes, BATCH_MAGIC, 4);
+    OSWriteLittleInt16(bytes, 4, BATCH_VERSION);
+    OSWriteLittleInt16(bytes, 6, epoch);
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        TBCanvasDelta delta = deltas[i];
+        uint8_t *record = bytes + BATCH_HEADER_SIZE + i * BATCH_RECORD_SIZE;
+        
+        float fx = delta.location.x;
+        float fy = delta.location.y;
+        uint32_t x, y;
+        memcpy(&x, &fx, sizeof(float));
+        memcpy(&y, &fy, sizeof(float));
+        
+        record[0] = delta.kind;
+        OSWriteLittleInt16(record, 2, delta.section);
+        OSWriteLittleInt32(record, 4, (uint32_t)delta.nodeTag);
+        OSWriteLittleInt32(record, 8, (uint32_t)delta.childTag);
+        OSWriteLittleInt32(record, 12, x);
+        OSWriteLittleInt32(record, 16, y);
+        OSWriteLittleInt64(record, 20, delta.clock);
+        OSWriteLittleInt32(record, 28, delta.site);
+    }
+    return data;
+}
+
++ (NSData *)compactedBatchWithBatches:(NSArray *)batches
+{
+    NSMutableData *newestDeltas = [[NSMutableData alloc] init];
+    NSMutableDictionary *newestIndexes = [[NSMutableDictionary alloc] init];
+    
+    // Batches of earlier epochs name node views by outdated tags.
+    uint16_t epoch = 0;
+    for (NSData *batch in batches) {
+        if ([self countOfDeltasInBatch:batch] != NSNotFound) {
+            epoch = MAX(epoch, [self epochOfBatch:batch]);
+        }
+    }
+    
+    for (NSData *batch in batches) {
+        NSUInteger count = [self countOfDeltasInBatch:batch];
+        if (count == NSNotFound || [self epochOfBatch:batch] != epoch) {
+            continue;
+        }
+        
+        for (NSUInteger i = 0; i < count; i++) {
+            TBCanvasDelta delta = [self deltaAtIndex:i inBatch:batch];
+            if (delta.kind > TBCanvasDeltaKindExpandNode) {
+                continue;
+            }
+            
+            NSIndexPath *field = TBCanvasSyncFieldOfDelta(delta);
+            NSNumber *newestIndex = newestIndexes[field];
+            if (newestIndex == nil) {
+                newestIndexes[field] = @(newestDeltas.length / sizeof(TBCanvasDelta));
+                [newestDeltas appendBytes:&delta length:sizeof(TBCanvasDelta)];
+                continue;
+            }
+            
+            TBCanvasDelta *newestDelta = (TBCanvasDelta *)newestDeltas.mutableBytes + newestIndex.unsignedIntegerValue;
+            if (TBCanvasSyncDeltaCompareVersions(&delta, newestDelta) > 0) {
+                *newestDelta = delta;
+            }
+        }
+    }
+    
+    // Edits of different fields are merged in the order they have been made.
+    NSUInteger count = newestDeltas.length / sizeof(TBCanvasDelta);
+    qsort(newestDeltas.mutableBytes, count, sizeof(TBCanvasDelta), TBCanvasSyncDeltaCompareVersions);
+    return [self batchWithDeltas:newestDeltas.bytes count:count epoch:epoch];
+}
+
++ (NSUInteger)countOfDeltasInBatch:(NSData *)batch
+{
+    const uint8_t *bytes = batch.bytes;
+    if (batch.length < BATCH_HEADER_SIZE || memcmp(bytes, BATCH_MAGIC, 4) != 0 || OSReadLittleInt16(bytes, 4) != BATCH_VERSION
+        || (batch.length - BATCH_HEADER_SIZE) % BATCH_RECORD_SIZE != 0) {
+        return NSNotFound;
+    }
+    return (batch.length - BATCH_HEADER_SIZE) / BATCH_RECORD_SIZE;
+}
+
++ (uint16_t)epochOfBatch:(NSData *)batch
+{
+    if ([self countOfDeltasInBatch:batch] == NSNotFound) {
+        return 0;
+    }
+    return OSReadLittleInt16(batch.bytes, 6);
+}
+
++ (TBCanvasDelta)deltaAtIndex:(NSUInteger)index inBatch:(NSData *)batch
+{
+    NSUInteger count = [self countOfDeltasInBatch:batch];
+    if (count == NSNotFound || index >= count) {
+        [NSException raise:NSRangeException format:@"### Error: TBCanvasSyncEngine: index %lu beyond bounds of batch", (unsigned long)index];
+    }
+    
+    const uint8_t *record = (const uint8_t *)batch.bytes + BATCH_HEADER_SIZE + index * BATCH_RECORD_SIZE;
+    
+    TBCanvasDelta delta;
+    delta.kind = record[0];
+    delta.section = OSReadLittleInt16(record, 2);
+    delta.nodeTag = (int32_t)OSReadLittleInt32(record, 4);
+    delta.childTag = (int32_t)OSReadLittleInt32(record, 8);
+    
+    uint32_t x = OSReadLittleInt32(record, 12);
+    uint32_t y = OSReadLittleInt32(record, 16);
+    float fx, fy;
+    memcpy(&fx, &x, sizeof(float));
+    memcpy(&fy, &y, sizeof(float));
+    delta.location = CGPointMake(fx, fy);
+    delta.clock = OSReadLittleInt64(record, 20);
+    delta.site = OSReadLittleInt32(record, 28);
+    
+    return delta;
+}
+
+@end
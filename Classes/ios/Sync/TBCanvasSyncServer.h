@@ -0,0 +1,59 @@
+//
+//  TBCanvasSyncServer.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ This class is a reference relay for synchronized canvases on the loopback interface.
+ 
+ Every delta batch received from a TBCanvasSyncClient is forwarded unchanged to all other connected clients and kept in a history.
+ A client connecting later receives the history first, so every client ends up with the same state. Once the history holds too many batches
+ it is compacted into a single snapshot batch with the newest delta of every field - the history grows with the number of edited fields,
+ not with the number of edits. Merging is done by the TBCanvasSyncEngine of each client.
+ 
+ The server is served on the run loop of the thread it has been started on.
+ */
+@interface TBCanvasSyncServer : NSObject
+
+/**
+ *  The TCP port the server listens on. `0` until the server has been started.
+ */
+@property (assign, nonatomic, readonly) uint16_t port;
+
+/**
+ *  The number of connected clients.
+ */
+@property (assign, nonatomic, readonly) NSUInteger clientCount;
+
+/**
+ *  The number of batches received so far.
+ */
+@property (assign, nonatomic, readonly) NSUInteger batchCount;
+
+/**
+ *  The number of batches kept in the history - the snapshot and the batches received after it.
+ */
+@property (assign, nonatomic, readonly) NSUInteger historyBatchCount;
+
+/**
+ Starts listening on the loopback interface.
+ 
+ @param port  The TCP port. Pass `0` to let the system choose a free port
+ @param error Returns the error when the socket can not be opened
+ 
+ @return `YES` when the server has been started.
+ */
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error;
+
+/**
+ Disconnects all clients and stops listening. The history is kept.
+ */
+- (void)stop;
+
+@end
@@ -0,0 +1,189 @@
+//
+//  TBCanvasSyncServer.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
+
+#import "TBCanvasSyncServer.h"
+#import "TBCanvasSyncChannel.h"
+#import "TBCanvasSyncEngine.h"
+
+static NSUInteger HISTORY_COMPACTION_BATCHES = 32;
+
+static void TBCanvasSyncServerAcceptCallBack(CFSocketRef socket, CFSocketCallBackType type, CFDataRef address, const void *data, void *info);
+
+@interface TBCanvasSyncServer() <TBCanvasSyncChannelDelegate>
+{
+    CFSocketRef listeningSocket;
+    CFRunLoopSourceRef runLoopSource;
+}
+
+@property (assign, nonatomic, readwrite) uint16_t port;
+@property (assign, nonatomic, readwrite) NSUInteger batchCount;
+
+// The channels of all connected clients.
+@property (nonatomic, strong) NSMutableArray *channels;
+
+// The snapshot of all compacted batches followed by the batches received since in the order of arrival.
+@property (nonatomic, strong) NSMutableArray *history;
+
+/** @name Handling clients */
+
+/**
+ Opens a channel for a newly accepted client and sends it the history.
+ 
+ @param nativeSocket The socket of the client
+ */
+- (void)acceptClientWithNativeSocket:(CFSocketNativeHandle)nativeSocket;
+
+@end
+
+@implementation TBCanvasSyncServer
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _port = 0;
+        _batchCount = 0;
+        _channels = [[NSMutableArray alloc] init];
+        _history = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stop];
+}
+
+- (NSUInteger)clientCount
+{
+    return _channels.count;
+}
+
+- (NSUInteger)historyBatchCount
+{
+    return _history.count;
+}
+
+#pragma mark - Listening
+
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error
+{
+    if (listeningSocket) {
+        return YES;
+    }
+    
+    CFSocketContext context = {0, (__bridge void *)self, NULL, NULL, NULL};
+    listeningSocket = CFSocketCreate(kCFAllocatorDefault, PF_INET, SOCK_STREAM, IPPROTO_TCP, kCFSocketAcceptCallBack, TBCanvasSyncServerAcceptCallBack, &context);
+    
+    if (listeningSocket) {
+        int option = 1;
+        setsockopt(CFSocketGetNative(listeningSocket), SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+    }
+    
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    NSData *addressData = [NSData dataWithBytes:&address length:sizeof(address)];
+    if (listeningSocket == NULL || CFSocketSetAddress(listeningSocket, (__bridge CFDataRef)addressData) != kCFSocketSuccess) {
+        if (error) {
+            *error = [NSError errorWithDomain:TBCanvasSyncErrorDomain code:2 userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Can not listen on port %u.", port]}];
+        }
+        [self stop];
+        return NO;
+    }
+    
+    // Look up the port chosen by the system.
+    NSData *boundAddress = CFBridgingRelease(CFSocketCopyAddress(listeningSocket));
+    _port = ntohs(((const struct sockaddr_in *)boundAddress.bytes)->sin_port);
+    
+    runLoopSource = CFSocketCreateRunLoopSource(kCFAllocatorDefault, listeningSocket, 0);
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), runLoopSource, kCFRunLoopCommonModes);
+    return YES;
+}
+
+- (void)stop
+{
+    for (TBCanvasSyncChannel *channel in _channels) {
+        [channel close];
+    }
+    [_channels removeAllObjects];
+    
+    if (runLoopSource) {
+        CFRunLoopSourceInvalidate(runLoopSource);
+        CFRelease(runLoopSource);
+        runLoopSource = NULL;
+    }
+    if (listeningSocket) {
+        CFSocketInvalidate(listeningSocket);
+        CFRelease(listeningSocket);
+        listeningSocket = NULL;
+    }
+    _port = 0;
+}
+
+#pragma mark - Handling clients
+
+- (void)acceptClientWithNativeSocket:(CFSocketNativeHandle)nativeSocket
+{
+    TBCanvasSyncChannel *channel = [[TBCanvasSyncChannel alloc] initWithNativeSocket:nativeSocket];
+    channel.delegate = self;
+    
+    for (NSData *batch in _history) {
+        if ([channel sendFrame:batch] == NO) {
+            [channel close];
+            return;
+        }
+    }
+    [_channels addObject:channel];
+}
+
+#pragma mark - TBCanvasSyncChannelDelegate
+
+- (void)syncChannel:(TBCanvasSyncChannel *)channel didReceiveFrame:(NSData *)frame
+{
+    [_history addObject:frame];
+    _batchCount++;
+    
+    for (TBCanvasSyncChannel *otherChannel in [_channels copy]) {
+        if (otherChannel != channel && [otherChannel sendFrame:frame] == NO) {
+            [otherChannel close];
+            [_channels removeObject:otherChannel];
+        }
+    }
+    
+    // Batches which are not valid are dropped - clients would reject them anyway.
+    if (_history.count > HISTORY_COMPACTION_BATCHES) {
+        NSData *snapshot = [TBCanvasSyncEngine compactedBatchWithBatches:_history];
+        [_history removeAllObjects];
+        [_history addObject:snapshot];
+    }
+}
+
+- (void)syncChannelDidClose:(TBCanvasSyncChannel *)channel
+{
+    [_channels removeObject:channel];
+}
+
+@end
+
+static void TBCanvasSyncServerAcceptCallBack(CFSocketRef socket, CFSocketCallBackType type, CFDataRef address, const void *data, void *info)
+{
+    if (type == kCFSocketAcceptCallBack) {
+        TBCanvasSyncServer *server = (__bridge TBCanvasSyncServer *)info;
+        [server acceptClientWithNativeSocket:*(const CFSocketNativeHandle *)data];
+    }
+}
@@ -17,8 +17,9 @@
 
 /**
  Returns the number of sections on the canvas.
+ Every section is loaded, indexed and reloaded on its own. Connections are only established between node views of the same section.
  
- @return The number of sections.
+ @return The number of sections. A value of `0` loads a single section `0`.
  */
 - (NSInteger)numberOfSectionsOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView;
 
@@ -85,4 +86,17 @@
  */
 - (TBCanvasMoveHandleView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView moveHandleForConnectionAtPoint:(CGPoint)point;
 
+@optional
+
+/**
+ Returns the values of an attribute of all Node objects in a given section. Called once per attribute query on the canvas.
+ 
+ @param collectionCanvasContentView The TBCollectionCanvasContentView instance requesting the data
+ @param attribute The name of the attribute
+ @param section The given section number
+ 
+ @return The NSArray object with the value of every Node object in the order of their rows. NSNull for Node objects without a value.
+ */
+- (NSArray *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView valuesOfAttribute:(NSString *)attribute inSection:(NSInteger)section;
+
 @end
@@ -25,6 +25,14 @@
  */
 - (void)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView didSelectNodeAtIndexPath:(NSIndexPath *)indexPath;
 
+/**
+ A group of nodes has been selected on the canvas view.
+ 
+ @param collectionCanvasContentView The TBCollectionCanvasContentView instance calling this method
+ @param indexPaths The index paths of the selected TBCanvasNodeView objects.
+ */
+- (void)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView didSelectNodesAtIndexPaths:(NSArray *)indexPaths;
+
 /**
  A node has been moved on the canvas view.
  
@@ -118,7 +126,7 @@
  A connection has been removed between two nodes on the canvas view.
  
  @param collectionCanvasContentView The TBCollectionCanvasContentView instance calling this method
- @param indexPath The index path of the parent TBCanvasConnectionView object.
+ @param indexPath The index path of the TBCanvasConnectionView object - section and row of the parent node followed by the connection's tag.
  */
 - (void)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView didRemoveConnectionAtIndexPath:(NSIndexPath *)indexPath;
 
@@ -126,7 +134,7 @@
  A connection has been moved between two child nodes on the canvas view.
  
  @param collectionCanvasContentView The TBCollectionCanvasContentView instance calling this method
- @param indexPath The index path of the parent TBCanvasConnectionView object.
+ @param indexPath The index path of the TBCanvasConnectionView object - section and row of the parent node followed by the connection's tag.
  @param newChildIndexPath The index path of the new child TBCanvasNodeView object.
  */
 - (void)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView didMoveConnectionAtNode:(NSIndexPath *)indexPath toNewChildIndexPath:(NSIndexPath *)newChildIndexPath;
@@ -0,0 +1,22 @@
+//
+//  TBCanvasClusterView.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasItemView.h"
+
+/**
+ This class represents a group of TBCanvasNodeViews drawn as a single item when the canvas is zoomed out.
+ */
+@interface TBCanvasClusterView : TBCanvasItemView
+
+/**
+ *  The number of node views represented by the cluster view.
+ */
+@property (assign, nonatomic) NSUInteger count;
+
+@end
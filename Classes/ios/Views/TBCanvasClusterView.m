@@ -0,0 +1,63 @@
+//
+//  TBCanvasClusterView.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <QuartzCore/QuartzCore.h>
+
+#import "TBCanvasClusterView.h"
+
+@interface TBCanvasClusterView()
+
+@property (strong, nonatomic) UILabel *countLabel;
+
+@end
+
+@implementation TBCanvasClusterView
+
+- (id)initWithFrame:(CGRect)frame
+{
+    self = [super initWithFrame:frame];
+    if (self) {
+        
+        self.backgroundColor = [UIColor colorWithRed:150.0f/255.0f green:214.0f/255.0f blue:217.0f/255.0f alpha:0.8f];
+        self.userInteractionEnabled = NO;
+        
+        CALayer *layer = [self layer];
+        layer.borderColor = [[UIColor darkGrayColor] CGColor];
+        
+        self.countLabel = [[UILabel alloc] initWithFrame:self.bounds];
+        self.countLabel.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
+        self.countLabel.backgroundColor = [UIColor clearColor];
+        self.countLabel.textColor = [UIColor darkGrayColor];
+        self.countLabel.textAlignment = NSTextAlignmentCenter;
+        self.countLabel.adjustsFontSizeToFitWidth = YES;
+        self.countLabel.minimumScaleFactor = 0.1;
+        [self addSubview:self.countLabel];
+        
+        [self setZoomScale:self.zoomScale];
+    }
+    return self;
+}
+
+- (void)setCount:(NSUInteger)count
+{
+    _count = count;
+    self.countLabel.text = [NSString stringWithFormat:@"%lu", (unsigned long)count];
+}
+
+- (void)setZoomScale:(CGFloat)scale
+{
+    [super setZoomScale:scale];
+    
+    // The canvas is scaled down as a whole. Keep border and label readable on screen.
+    self.layer.borderWidth = 2.0 / scale;
+    self.layer.cornerRadius = 8.0 / scale;
+    self.countLabel.font = [UIFont boldSystemFontOfSize:14.0 / scale];
+}
+
+@end
@@ -116,6 +116,7 @@
 
 /**
  Returns the indexPath of the TBCanvasConnectionView object.
+ The first two indexes are the section and row of the parent node. The last index is the tag of the connection.
  
  @return The NSIndexPath object
  */
@@ -9,6 +9,8 @@
 
 #import "TBCanvasConnectionView.h"
 #import "TBCanvasNodeView.h"
+#import "TBCanvasMoveHandleView.h"
+#import "TBCanvasInstrumentation.h"
 
 @interface TBCanvasConnectionView()
 {
@@ -119,6 +121,8 @@
 
 - (void)drawConnectionFromPoint:(CGPoint)start toPoint:(CGPoint)end
 {
+    TB_CANVAS_COUNT("connectionRedraw");
+    
     visibleStartPoint = [self calculateStartPointForLineFrom:start toPoint:end];
     visibleEndPoint =  [self calculateEndPointForLineFrom:start toPoint:end];
     
@@ -236,7 +240,12 @@
         
         void(^redrawConnection)(BOOL) = ^(BOOL complete) {
         
-            [self drawConnection];   
+            [self drawConnection];
+            
+            // Keep the move handle at the end of the animated connection.
+            if (self.moveConnectionHandle) {
+                self.moveConnectionHandle.center = [self.superview convertPoint:self.visibleEndPoint fromView:self];
+            }
         };
         
         [UIView animateWithDuration:0.2 delay:0.0 options:UIViewAnimationOptionBeginFromCurrentState | UIViewAnimationOptionCurveEaseOut
@@ -250,11 +259,13 @@
 
 - (NSIndexPath *)indexPath
 {
-    return [NSIndexPath indexPathForRow:self.tag inSection:self.parentNode.tag]; 
+    return [self.parentNode.indexPath indexPathByAddingIndex:self.tag];
 }
 
 - (BOOL)checkTouchIsValid:(CGPoint)touch
 {
+    TB_CANVAS_COUNT("connectionHitTest");
+    
     CGPoint localTouch = [self convertPoint:touch fromView:self.superview];
     CGPathRef tappableArea = CGPathCreateCopyByStrokingPath(shapeLayer.path, NULL, fmaxf(35.0f, shapeLayer.lineWidth), kCGLineCapRound, kCGLineJoinMiter, shapeLayer.miterLimit);
     BOOL isValid = CGPathContainsPoint(tappableArea, NULL, localTouch, true);
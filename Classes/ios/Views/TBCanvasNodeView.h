@@ -33,6 +33,11 @@
  */
 @property (assign, nonatomic) NSInteger headNodeTag;
 
+/**
+ *  The section of the canvas this node view belongs to. The node view's tag is its row inside the section.
+ */
+@property (assign, nonatomic) NSInteger section;
+
 /**
  *  The node view delegate. Receives messages about touch events of the view.
  */
@@ -93,6 +98,20 @@
  */
 - (void)setEditing:(BOOL)isEditing;
 
+/**
+ Returns `YES` when the TBCanvasNodeView is in edit mode.
+ 
+ @return `YES` when the TBCanvasNodeView is in edit mode.
+ */
+- (BOOL)isEditing;
+
+/**
+ Returns the index path of the TBCanvasNodeView object built from its section and tag.
+ 
+ @return The NSIndexPath object
+ */
+- (NSIndexPath *)indexPath;
+
 /**
  Returns the segment rectangle transformed by zoomScale.
  
@@ -24,6 +24,7 @@
 
 @synthesize hasCollapsedSubStructure;
 @synthesize headNodeTag;
+@synthesize section;
 
 @synthesize delegate;
 @synthesize connectionHandle;
@@ -54,6 +55,7 @@
         _isEditing = NO;
         hasCollapsedSubStructure = NO;
         headNodeTag = -1;
+        section = 0;
         
         self.backgroundColor = [UIColor whiteColor];
         self.frame = frame;
@@ -102,6 +104,11 @@
     }
 }
 
+- (BOOL)isEditing
+{
+    return _isEditing;
+}
+
 - (NSMutableArray *)connectedNodes
 {
     if (!connectedNodes) {
@@ -129,6 +136,11 @@
     return childConnections;
 }
 
+- (NSIndexPath *)indexPath
+{
+    return [NSIndexPath indexPathForRow:self.tag inSection:self.section];
+}
+
 - (CGRect)scaledSegmentRect
 {
     return CGRectMake(self.segmentRect.origin.x * self.zoomScale, self.segmentRect.origin.y * self.zoomScale,
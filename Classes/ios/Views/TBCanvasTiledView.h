@@ -0,0 +1,25 @@
+//
+//  TBCanvasTiledView.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <UIKit/UIKit.h>
+
+/**
+ This class displays the static items of a canvas in cached bitmap tiles.
+ 
+ The view is backed by a CATiledLayer. Tiles are drawn on background threads for every level of detail and stay cached
+ until the part of the canvas they cover is invalidated with setNeedsDisplayInRect:.
+ */
+@interface TBCanvasTiledView : UIView
+
+/**
+ *  The TBCanvasRenderModel objects drawn into the tiles - one per section.
+ */
+@property (copy) NSArray *renderModels;
+
+@end
@@ -0,0 +1,53 @@
+//
+//  TBCanvasTiledView.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <QuartzCore/QuartzCore.h>
+
+#import "TBCanvasTiledView.h"
+#import "TBCanvasRenderModel.h"
+
+static CGFloat TILE_SIZE            = 512.0;
+static size_t  TILE_LEVELS_OF_DETAIL = 4;
+
+@implementation TBCanvasTiledView
+
++ (Class)layerClass
+{
+    return [CATiledLayer class];
+}
+
+- (id)initWithFrame:(CGRect)frame
+{
+    self = [super initWithFrame:frame];
+    if (self) {
+        
+        self.backgroundColor = [UIColor clearColor];
+        self.opaque = NO;
+        self.userInteractionEnabled = NO;
+        
+        // Levels of detail cover zooming out. The bias adds sharper levels for zooming in.
+        CATiledLayer *tiledLayer = (CATiledLayer *)self.layer;
+        tiledLayer.tileSize = CGSizeMake(TILE_SIZE, TILE_SIZE);
+        tiledLayer.levelsOfDetail = TILE_LEVELS_OF_DETAIL;
+        tiledLayer.levelsOfDetailBias = 1;
+    }
+    return self;
+}
+
+- (void)drawRect:(CGRect)rect
+{
+    // Called on a background thread for every tile.
+    CGContextRef context = UIGraphicsGetCurrentContext();
+    
+    for (TBCanvasRenderModel *renderModel in self.renderModels) {
+        [renderModel drawRect:rect inContext:context];
+    }
+}
+
+@end
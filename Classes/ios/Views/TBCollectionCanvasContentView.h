@@ -13,9 +13,31 @@
 #import "TBCanvasNodeView.h"
 #import "TBCollectionCanvasContentViewDataSource.h"
 #import "TBCollectionCanvasContentViewDelegate.h"
+#import "TBCanvasTouchTrace.h"
+#import "TBCanvasExporter.h"
+#import "TBCanvasArena.h"
+#import "TBCanvasSyncEngine.h"
+#import "TBCanvasGraphIndex.h"
 
 @class TBCollectionCanvasView;
 
+/**
+ The gesture drawn by touches on the empty canvas.
+ */
+typedef NS_ENUM(NSInteger, TBCanvasSelectionMode) {
+    TBCanvasSelectionModeNone = 0,
+    TBCanvasSelectionModeRectangle,
+    TBCanvasSelectionModeLasso
+};
+
+/**
+ The way highlighted node views are set apart from the rest of the canvas.
+ */
+typedef NS_ENUM(NSInteger, TBCanvasHighlightStyle) {
+    TBCanvasHighlightStyleOutline = 0,
+    TBCanvasHighlightStyleDimOthers
+};
+
 /**
  This class represents a canvas for node items in a collection.
  Items can be dragged, inserted, deleted etc.
@@ -47,10 +69,62 @@
 @property (assign, nonatomic, getter = isMenuEnabled) BOOL menuEnabled;
 
 /**
- *  Set to `YES` if the view is currently handling single touches.
+ *  Set to `YES` if the view is currently handling single touches. Always `NO` - every gesture is tracked on its own and never locks out other touches.
  */
 @property (assign, nonatomic, readonly, getter=isLockedToSingleTouch) BOOL lockedToSingleTouch;
 
+/**
+ *  Records the touch stream handled by the view when set. Set to `nil` to stop recording.
+ */
+@property (strong, nonatomic) TBCanvasTouchTrace *touchTrace;
+
+/**
+ *  The selection gesture for touches on the empty canvas. Scrolling is disabled while set to anything else than `TBCanvasSelectionModeNone`.
+ */
+@property (assign, nonatomic) TBCanvasSelectionMode selectionMode;
+
+/**
+ *  Below this zoom scale dense regions of the canvas are drawn as clusters and the connections between them are bundled. Set to `0.0` to disable clustering. Defaults to `0.25`.
+ */
+@property (assign, nonatomic) CGFloat clusteringZoomScale;
+
+/**
+ *  Set to `YES` if the canvas currently displays clusters instead of single items.
+ */
+@property (assign, nonatomic, readonly, getter=isShowingClusters) BOOL showingClusters;
+
+/**
+ *  Set to `YES` to render all node views and connections nobody interacts with into cached tiles.
+ *  Only touched or edited node views, collapsed segments with their head nodes and their connections are displayed as live views. Defaults to `NO`.
+ */
+@property (assign, nonatomic, getter = isTiledRenderingEnabled) BOOL tiledRenderingEnabled;
+
+/**
+ *  Set to `YES` to snap dragged node views to the edges and center lines of the node views around them and to display alignment guides. Defaults to `NO`.
+ */
+@property (assign, nonatomic, getter = isSnappingEnabled) BOOL snappingEnabled;
+
+/**
+ *  The distance in screen points within which a dragged node view snaps to an alignment guide. Defaults to `8.0`.
+ */
+@property (assign, nonatomic) CGFloat snappingTolerance;
+
+/**
+ *  Holds the transient buffers of touch handling, collapsing and expanding. They are released at the end of every frame.
+ *  Its counters show how often the canvas had to allocate memory from the heap for them.
+ */
+@property (strong, nonatomic, readonly) TBCanvasArena *frameArena;
+
+/**
+ *  Records the edits of the canvas and merges remote edits into it. Set to `nil` to stop synchronizing. Defaults to `nil`.
+ */
+@property (strong, nonatomic) TBCanvasSyncEngine *syncEngine;
+
+/**
+ *  The way highlighted node views are displayed. Defaults to `TBCanvasHighlightStyleOutline`.
+ */
+@property (assign, nonatomic) TBCanvasHighlightStyle highlightStyle;
+
 /** @name Managing the TBCollectionCanvasContentView's content */
 
 /**
@@ -69,6 +143,14 @@
  */
 - (void)reloadCanvas;
 
+/**
+ Reloads all items of a single section. The items of all other sections stay untouched.
+ The number of sections must not change. Use reloadCanvas when sections are added or removed.
+ 
+ @param section The given section
+ */
+- (void)reloadSection:(NSInteger)section;
+
 /**
  Resizes the canvas view to an optimal size (optimal >= minimum size).
  */
@@ -111,6 +193,14 @@
  */
 - (TBCanvasNodeView *)nodeAtIndexPath:(NSIndexPath *)indexPath;
 
+/**
+ Switches the edit mode of a node with a given index. A node in edit mode is displayed by a live view while tiled rendering is enabled.
+ 
+ @param editing   `YES` to start editing
+ @param indexPath The index path of the given TBCanvasNodeView object.
+ */
+- (void)setEditing:(BOOL)editing forNodeAtIndexPath:(NSIndexPath *)indexPath;
+
 
 /** @name Controlling the TBCollectionCanvasContentView */
 
@@ -119,6 +209,25 @@
  */
 - (void)toggleConnectMode;
 
+/**
+ Adds connection handles to all items in or near the visible part of the canvas while in connection mode.
+ Handles of items outside the visible part are recycled.
+ */
+- (void)layoutConnectionHandles;
+
+/**
+ Replaces node views and connections with cluster views and bundled connections while the zoom scale is below clusteringZoomScale.
+ Only clusters in or near the visible part of the canvas are displayed.
+ */
+- (void)layoutClusters;
+
+/**
+ Takes snapshots of the node views in or near the visible part of the canvas for the tiles while tiled rendering is enabled.
+ Visible node views are taken first. A single call takes a limited number of snapshots and schedules the remaining ones for the next pass of the run loop.
+ Snapshots of node views far away are released.
+ */
+- (void)layoutTiles;
+
 /**
  Returns `YES` when the TBCollectionCanvasContentView is currently processing subviews (tapping, dragging etc.).
  
@@ -128,8 +237,9 @@
 
 /**
  Returns `YES`when the view is locked to processing of only one view.
+ Gestures on different item views are processed concurrently, each in an interaction context of its own. The view is therefore never locked.
  
- @return `YES`when the view is locked to processing of only one view.
+ @return Always `NO`.
  */
 - (BOOL)isInSingleTouchMode;
 
@@ -138,4 +248,164 @@
  */
 - (void)hideMenu;
 
+
+/** @name Selecting multiple nodes */
+
+/**
+ Selects all visible TBCanvasNodeViews intersecting a given rectangle. Replaces the current selection.
+ 
+ @param rect The given rectangle in canvas coordinates
+ 
+ @return The index paths of the selected TBCanvasNodeView objects.
+ */
+- (NSArray *)selectNodesInRect:(CGRect)rect;
+
+/**
+ Selects all visible TBCanvasNodeViews whose center lies inside a given closed path. Replaces the current selection.
+ 
+ @param lasso The given path in canvas coordinates
+ 
+ @return The index paths of the selected TBCanvasNodeView objects.
+ */
+- (NSArray *)selectNodesInLasso:(UIBezierPath *)lasso;
+
+/**
+ Returns the index paths of all selected TBCanvasNodeViews.
+ 
+ @return The index paths of the selected TBCanvasNodeView objects.
+ */
+- (NSArray *)indexPathsForSelectedNodes;
+
+/**
+ Clears the selection.
+ */
+- (void)deselectAllNodes;
+
+/**
+ Moves all selected TBCanvasNodeViews and the collapsed segments below them by a given distance.
+ Connections attached to the selection are redrawn once. The delegate is informed with a single call.
+ 
+ @param distance The given distance in canvas coordinates
+ */
+- (void)moveSelectedNodesBy:(CGSize)distance;
+
+
+/** @name Exporting the canvas */
+
+/**
+ Returns a snapshot of the node frames and connections of every section. The snapshots can be exported on any thread while the canvas is edited.
+ 
+ @return A TBCanvasRenderModel object for every section.
+ */
+- (NSArray *)renderModelsForExport;
+
+/**
+ Writes the nodes and connections of the whole canvas to a file on a background queue. The view hierarchy is not drawn.
+ 
+ @param url        The URL of the file
+ @param format     The file format
+ @param completion Called on the main queue when done. error is `nil` when the canvas has been written
+ */
+- (void)exportToURL:(NSURL *)url format:(TBCanvasExportFormat)format completion:(void (^)(NSError *error))completion;
+
+
+/** @name Replaying touches */
+
+/**
+ Processes a recorded event as if it had been delivered by the corresponding TBCanvasItemView.
+ 
+ @param event The recorded TBCanvasTouchTraceEvent.
+ */
+- (void)processTouchTraceEvent:(TBCanvasTouchTraceEvent)event;
+
+
+/** @name Synchronizing the canvas */
+
+/**
+ Applies a batch of remote edits to the canvas as if they had been made on this canvas. The delegate is notified of every edit.
+ Usually called by the syncEngine after merging a remote batch.
+ 
+ @param deltas The list of TBCanvasDelta edits
+ @param count  The number of edits in the list
+ */
+- (void)applySyncDeltas:(const TBCanvasDelta *)deltas count:(NSUInteger)count;
+
+
+/** @name Querying the canvas */
+
+/**
+ Returns the rows of all TBCanvasNodeViews reachable from a given TBCanvasNodeView along its connections.
+ 
+ @param indexPath The index path of the given TBCanvasNodeView
+ @param direction TBCanvasGraphDirectionDownstream follows the connections to the children, TBCanvasGraphDirectionUpstream to the parents
+ 
+ @return The rows inside the section of the given TBCanvasNodeView.
+ */
+- (NSIndexSet *)indexesOfNodesReachableFromNodeAtIndexPath:(NSIndexPath *)indexPath direction:(TBCanvasGraphDirection)direction;
+
+/**
+ Returns the rows of all TBCanvasNodeViews of a section whose number of parent connections lies inside a given range.
+ 
+ @param section The given section number
+ @param range   The range of parent counts. `NSMakeRange(0, 1)` returns all node views without parents
+ 
+ @return The rows of the matching TBCanvasNodeView objects.
+ */
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section withParentCountInRange:(NSRange)range;
+
+/**
+ Returns the rows of all TBCanvasNodeViews of a section whose number of child connections lies inside a given range.
+ 
+ @param section The given section number
+ @param range   The range of child counts. `NSMakeRange(0, 1)` returns all node views without children
+ 
+ @return The rows of the matching TBCanvasNodeView objects.
+ */
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section withChildCountInRange:(NSRange)range;
+
+/**
+ Returns the rows of all TBCanvasNodeViews of a section whose frame intersects a given rectangle. Node views inside collapsed segments are included.
+ 
+ @param section The given section number
+ @param rect    The given rectangle in canvas coordinates
+ 
+ @return The rows of the matching TBCanvasNodeView objects.
+ */
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section inRect:(CGRect)rect;
+
+/**
+ Returns the rows of all TBCanvasNodeViews of a section whose value of an attribute matches a predicate.
+ The values are requested from the data source with a single call. NSNull values never match.
+ 
+ @param section   The given section number
+ @param attribute The name of the attribute
+ @param predicate The predicate evaluated with each value
+ 
+ @return The rows of the matching TBCanvasNodeView objects. Empty when the data source does not provide attribute values.
+ */
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section whereAttribute:(NSString *)attribute matchesPredicate:(NSPredicate *)predicate;
+
+/**
+ Highlights the TBCanvasNodeViews with the given rows of a section in a single layer above the canvas. Replaces the highlights of the section.
+ The node views themselves are not changed. Highlights follow moved, inserted and deleted node views.
+ 
+ @param indexes The rows of the TBCanvasNodeViews. Pass an empty set to remove the highlights of the section
+ @param section The given section number
+ */
+- (void)highlightNodesWithIndexes:(NSIndexSet *)indexes inSection:(NSInteger)section;
+
+/**
+ Returns the rows of all highlighted TBCanvasNodeViews of a section.
+ 
+ @param section The given section number
+ 
+ @return The rows of the highlighted TBCanvasNodeView objects.
+ */
+- (NSIndexSet *)indexesOfHighlightedNodesInSection:(NSInteger)section;
+
+/**
+ Removes all highlights.
+ */
+- (void)removeAllHighlights;
+
 @end
\ No newline at end of file
@@ -12,51 +12,96 @@
 #import "TBCollectionCanvasView.h"
 #import "TBCanvasCreateHandleView.h"
 #import "TBCanvasMoveHandleView.h"
+#import "TBCanvasInstrumentation.h"
+#import "TBCanvasSection.h"
+#import "TBCanvasClusterView.h"
+#import "TBCanvasTiledView.h"
+#import "TBCanvasInteraction.h"
 
 NSString * const kInternalInconsistencyException = @"InternalInconsistencyException";
 
+/**
+ A node view on the explicit stack of a depth first traversal.
+ 
+ nodeView is not retained - the node views outlive the traversal. connectionIndex is the index of the next child connection to visit.
+ */
+typedef struct {
+    __unsafe_unretained TBCanvasNodeView *nodeView;
+    NSUInteger connectionIndex;
+} TBCanvasTraversalFrame;
+
+static NSUInteger TRAVERSAL_STACK_CAPACITY = 64;
+
+static NSUInteger     SNAPSHOTS_PER_PASS         = 32;
+static CGFloat        SNAPSHOT_MARGIN            = 0.5;
+static NSTimeInterval SEGMENT_ANIMATION_DURATION = 0.2;
+
+/**
+ Returns the key of the cached segment below a node view. Combines section and tag into a single 64 bit number.
+ */
+static NSNumber *TBCanvasSegmentKey(NSInteger section, NSInteger tag)
+{
+    return @(((unsigned long long)section << 32) | (unsigned long long)(uint32_t)tag);
+}
+
+/**
+ Returns the key of the interaction of a touched item view. Item views are compared by identity - the interaction retains its item view.
+ */
+static NSValue *TBCanvasInteractionKey(TBCanvasItemView *itemView)
+{
+    return [NSValue valueWithNonretainedObject:itemView];
+}
+
+static int TBCanvasCompareFloats(const void *first, const void *second)
+{
+    CGFloat a = *(const CGFloat *)first;
+    CGFloat b = *(const CGFloat *)second;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+static int TBCanvasCompareRectsByMinX(const void *first, const void *second)
+{
+    CGFloat a = ((const CGRect *)first)->origin.x;
+    CGFloat b = ((const CGRect *)second)->origin.x;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+static int TBCanvasCompareRectsByMinY(const void *first, const void *second)
+{
+    CGFloat a = ((const CGRect *)first)->origin.y;
+    CGFloat b = ((const CGRect *)second)->origin.y;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
 @interface TBCollectionCanvasContentView()
 {
     BOOL isInConnectMode;
-    BOOL isMovingCanvasNodeViews;
     
-    float autoscrollDistanceHorizontal;
-    float autoscrollDistanceVertical;
+    CGPoint selectionOrigin;
 }
 
-// The currently touched views.
-@property (nonatomic, strong) NSMutableArray *viewsTouched;
-
-// Stores all node views displayed on the canvas.
-@property (nonatomic, strong) NSMutableArray *nodeViews;
+// The interaction contexts of all gestures in progress by the key of their touched TBCanvasItemView.
+@property (nonatomic, strong) NSMutableDictionary *interactions;
 
-// Stores all node connections displayed on the canvas.
-@property (nonatomic, strong) NSMutableArray *connectionViews;
+// Stores all sections of the canvas. Every TBCanvasSection holds the node views and connections displayed in this section.
+@property (nonatomic, strong) NSMutableArray *sections;
 
-// Stores all handles to establish a new connection.
+// Stores all handles to establish a new connection currently displayed on the canvas.
 @property (nonatomic, strong) NSMutableArray *createHandles;
 
-// Stores all handles to move an established connection.
+// Stores all handles to move an established connection currently displayed on the canvas.
 @property (nonatomic, strong) NSMutableArray *moveHandles;
 
-// Stores all TBCanvasItemViews that are part of the selected tree segment and will be processed with the head node.
-@property (nonatomic, strong) NSMutableDictionary *segmentsBelowNode;
-
-// Stores all TBCanvasConnectionView of a node view inside a selected tree segment wich point to a node view outside the segment.
-@property (nonatomic, strong) NSMutableArray *connectionViewsForFullRefresh;
-
-// A connection that is used when the user wants to establish a new connection between two TBCanvasNodeViews.
-@property (nonatomic, strong) TBCanvasConnectionView *temporaryConnectionView;
+// Stores recycled handles to establish a new connection.
+@property (nonatomic, strong) NSMutableArray *reusableCreateHandles;
 
-// When the temporary connection is above a TBCanvasNodeView, this view will be highlighted and stored at this pointer.
-@property (nonatomic, strong) TBCanvasNodeView *connectableNodeView;
+// Stores recycled handles to move an established connection.
+@property (nonatomic, strong) NSMutableArray *reusableMoveHandles;
 
-// A connection that has been tapped by the user. The attributes of this connection can be edited.
-@property (nonatomic, strong) TBCanvasConnectionView *selectedConnectionView;
-
-@property (nonatomic, strong) NSMutableArray *autoscrollingItems;
+// Stores all TBCanvasItemViews that are part of the selected tree segment and will be processed with the head node.
+@property (nonatomic, strong) NSMutableDictionary *segmentsBelowNode;
 
-// Moves the dragged view and the parent scrollview by a given fraction when the view has been dragged outside the content view.
+// Moves the dragged views and the parent scrollview by the merged autoscroll distance of all interactions once per frame.
 @property (nonatomic, strong) NSTimer *autoscrollTimer;
 
 // Triggered when a touch on an TBCanvasNodeView has began. Invalidated when the touch has moved has ended.
@@ -68,6 +113,48 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 // The view currently decorated with a menu.
 @property (nonatomic, strong) TBCanvasNodeView *viewWithMenu;
 
+// The TBCanvasNodeViews selected by a rubber band or a lasso. Dragging one of them moves all of them.
+@property (nonatomic, strong) NSMutableOrderedSet *selectedNodeViews;
+
+// The path drawn by the selection gesture in progress.
+@property (nonatomic, strong) UIBezierPath *selectionPath;
+
+// Displays the selection path while the selection gesture is in progress.
+@property (nonatomic, strong) CAShapeLayer *selectionLayer;
+
+// Stores all cluster views currently displayed on the canvas.
+@property (nonatomic, strong) NSMutableArray *clusterViews;
+
+// Stores recycled cluster views.
+@property (nonatomic, strong) NSMutableArray *reusableClusterViews;
+
+// Draws the bundled connections between clusters. One layer per line width.
+@property (nonatomic, strong) NSArray *bundleLayers;
+
+// Displays all items rendered into tiles while tiled rendering is enabled.
+@property (nonatomic, strong) TBCanvasTiledView *tiledView;
+
+// The TBCanvasNodeViews displayed as live views while tiled rendering is enabled.
+@property (nonatomic, strong) NSMutableSet *promotedNodeViews;
+
+// Set while a pass of layoutTiles is scheduled for the remaining snapshots.
+@property (nonatomic, assign) BOOL tileLayoutScheduled;
+
+// Displays the alignment guides of the node view being dragged. One layer per axis.
+@property (nonatomic, strong) NSArray *guideLayers;
+
+// The rows of the highlighted TBCanvasNodeViews by section number.
+@property (nonatomic, strong) NSMutableDictionary *highlightedIndexes;
+
+// Displays the highlighted TBCanvasNodeViews.
+@property (nonatomic, strong) CAShapeLayer *highlightLayer;
+
+// Set when a highlighted TBCanvasNodeView has moved during the current frame.
+@property (nonatomic, assign) BOOL highlightsNeedLayout;
+
+// The TBCanvasNodeViews marked as targets of connection handles - counted once per handle gesture.
+@property (nonatomic, strong) NSCountedSet *connectableNodeViews;
+
 /** @name Layout */
 
 /**
@@ -79,25 +166,229 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
  */
 - (CGPoint)autoLayoutNodeView:(TBCanvasNodeView *)nodeView;
 
+/** @name Handling sections */
+
+/**
+ Loads all node views and connections of a given section from the data source.
+ 
+ @param canvasSection The given TBCanvasSection
+ */
+- (void)fillSection:(TBCanvasSection *)canvasSection;
+
+/**
+ Removes all node views, connections and handles of a given section from the canvas.
+ 
+ @param canvasSection The given TBCanvasSection
+ */
+- (void)clearSection:(TBCanvasSection *)canvasSection;
+
+/**
+ Rebuilds the spatial indexes of the given sections concurrently.
+ 
+ @param sections The TBCanvasSection objects to index
+ */
+- (void)reindexSections:(NSArray *)sections;
+
+/**
+ Returns the section a given node view belongs to.
+ 
+ @param nodeView The given TBCanvasNodeView
+ 
+ @return The TBCanvasSection object
+ */
+- (TBCanvasSection *)sectionForNodeView:(TBCanvasNodeView *)nodeView;
+
+/**
+ Updates the spatial index of all node views inside a given tree segment.
+ 
+ @param treeSegment The array containing the given TBCanvasItemViews.
+ */
+- (void)updateSpatialIndexForSegment:(NSArray *)treeSegment;
+
+/** @name Clustering */
+
+/**
+ Shows or hides all node views and connections of the given sections.
+ 
+ @param hidden   `YES` to hide the items
+ @param sections The TBCanvasSection objects
+ */
+- (void)setItemViewsHidden:(BOOL)hidden inSections:(NSArray *)sections;
+
+/**
+ Returns the cluster view at a given position of the displayed cluster views. Reuses a recycled cluster view if possible.
+ 
+ @param index The given position
+ 
+ @return The TBCanvasClusterView object
+ */
+- (TBCanvasClusterView *)clusterViewAtIndex:(NSUInteger)index;
+
+/** @name Tiled rendering */
+
+/**
+ Creates the render model of a given section and forwards its invalidations to the tiles.
+ 
+ @param canvasSection The given TBCanvasSection
+ */
+- (void)attachRenderModelToSection:(TBCanvasSection *)canvasSection;
+
+/**
+ Hands the render models of all sections to the tiled view.
+ */
+- (void)updateRenderModelsOfTiledView;
+
+/**
+ Redraws all tiles intersecting a given rectangle. Can be called on any thread.
+ 
+ @param rect The given rectangle in canvas coordinates
+ */
+- (void)invalidateTilesInRect:(CGRect)rect;
+
+/**
+ Displays the given node views and their connections as live views and removes them from the tiles.
+ 
+ @param itemViews The TBCanvasItemViews to promote. Items other than TBCanvasNodeViews are ignored
+ */
+- (void)promoteNodeViews:(NSArray *)itemViews;
+
+/**
+ Renders all promoted node views back into the tiles unless they are touched, edited or part of a collapsed segment.
+ */
+- (void)demoteNodeViews;
+
+/**
+ Displays the node views of all collapsed segments and their head nodes as live views. The tiles can't draw the rotated stack of a collapsed segment.
+ 
+ @param sections The TBCanvasSection objects
+ */
+- (void)promoteCollapsedNodeViewsInSections:(NSArray *)sections;
+
+/**
+ Returns the topmost node view rendered into the tiles at a given point.
+ 
+ @param point The given point in canvas coordinates
+ 
+ @return The TBCanvasNodeView object. Otherwise `nil`.
+ */
+- (TBCanvasNodeView *)tiledNodeViewAtPoint:(CGPoint)point;
+
+/**
+ Takes a snapshot of a given node view and stores it in the render model of its section.
+ 
+ @param nodeView The given TBCanvasNodeView
+ */
+- (void)updateSnapshotOfNodeView:(TBCanvasNodeView *)nodeView;
+
+/** @name Alignment guides */
+
+/**
+ Moves a location a given node view is dragged to so the node view is aligned with the nearest edges or center lines of the node views standing still.
+ Displays a guide for every alignment.
+ 
+ @param location The location the node view is dragged to
+ @param nodeView The given TBCanvasNodeView
+ 
+ @return The snapped location. The given location when nothing is in reach or snapping is disabled.
+ */
+- (CGPoint)snappedLocation:(CGPoint)location ofNodeView:(TBCanvasNodeView *)nodeView;
+
+/**
+ Removes all alignment guides.
+ */
+- (void)hideAlignmentGuides;
+
 /** @name Handling TBCanvasConnectionView objects */
 
 /**
- Adds a TBCanvasConnectionView between TBCanvasNodeViews.
+ Adds a TBCanvasConnectionView between the TBCanvasNodeViews of a given section.
+ 
+ @param canvasSection The given TBCanvasSection
+ */
+- (void)connectNodesInSection:(TBCanvasSection *)canvasSection;
+
+/**
+ Adds a new TBCanvasConnectionView from the data source between two TBCanvasNodeViews and notifies the delegate.
+ 
+ @param parentView The parent TBCanvasNodeView
+ @param childView  The child TBCanvasNodeView
+ 
+ @return The added TBCanvasConnectionView.
+ */
+- (TBCanvasConnectionView *)connectNodeView:(TBCanvasNodeView *)parentView toNodeView:(TBCanvasNodeView *)childView;
+
+/**
+ Returns the valid TBCanvasConnectionView between two TBCanvasNodeViews.
+ 
+ @param parentView The parent TBCanvasNodeView
+ @param childView  The child TBCanvasNodeView
+ 
+ @return The TBCanvasConnectionView. nil when the node views are not connected.
+ */
+- (TBCanvasConnectionView *)connectionFromNodeView:(TBCanvasNodeView *)parentView toNodeView:(TBCanvasNodeView *)childView;
+
+/** @name Synchronizing the canvas */
+
+/**
+ Passes a local edit to the syncEngine.
+ 
+ @param kind          The kind of edit
+ @param nodeView      The edited TBCanvasNodeView or the parent of the edited connection
+ @param childNodeView The child of the edited connection. nil for edits of node views
+ */
+- (void)recordSyncDeltaOfKind:(TBCanvasDeltaKind)kind nodeView:(TBCanvasNodeView *)nodeView childNodeView:(TBCanvasNodeView *)childNodeView;
+
+/** @name Querying the canvas */
+
+/**
+ Redraws the highlight layer from the current frames of all highlighted TBCanvasNodeViews. Called whenever the canvas is sized to fit
+ and at the end of every frame which has moved a highlighted node view.
+ */
+- (void)layoutHighlights;
+
+/**
+ Marks the highlights to be laid out at the end of the current frame if a given TBCanvasNodeView is highlighted.
+ 
+ @param nodeView The moved TBCanvasNodeView
+ */
+- (void)invalidateHighlightOfNodeView:(TBCanvasNodeView *)nodeView;
+
+/**
+ Adds the union of a list of rectangles to a path. The union is split into rectangles which do not overlap - one row of merged rectangles
+ per run of adjacent horizontal bands with equal spans - so the path can be filled with the even-odd rule. Uses its own scratch buffers.
+ 
+ @param rects The rectangles. Sorted in place
+ @param count The number of rectangles
+ @param path  The path to add the rectangles to
+ */
+- (void)addUnionOfRects:(CGRect *)rects count:(NSUInteger)count toPath:(CGMutablePathRef)path;
+
+/**
+ Moves the highlighted rows of a section after a TBCanvasNodeView has been inserted or deleted.
+ 
+ @param section The given section number
+ @param index   The first row to move
+ @param delta   The distance to move the rows by. Negative values drop the rows in front of index
  */
-- (void)connectNodes;
+- (void)shiftHighlightedIndexesInSection:(NSInteger)section startingAtIndex:(NSUInteger)index by:(NSInteger)delta;
 
 /** @name Autoscrolling */
 
 /**
- Cuts autoscroll distance to maxAutoscrollDistance when the value exceeds the maximum defined with const maxAutoscrollDistance.
+ Drops the part of the autoscroll distance of every interaction which would move its item view past the left or upper border of the canvas.
  */
-- (void)validateAutoscrollDistance;
+- (void)validateAutoscrollDistances;
 
 /**
- Grows / shrinks the canvas by a given fraction.
+ Scrolls the canvas by the merged autoscroll distance of all interactions and moves the item views of all interactions along. Called once per frame.
  */
 - (void)autoScrollOnEdges;
 
+/**
+ Stops the autoscroll timer, resizes the canvas and scrolls the touched view to be visible.
+ */
+- (void)stopAutoscrolling;
+
 /**
  Calculates the autoscroll distance depending on the proximity to the view's edge.
  The closer the object to the view's edge the faster it will scroll.
@@ -108,35 +399,30 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 - (float)autoscrollDistanceForProximityToEdge:(float)proximity;
 
 /**
- Checks wether the given view touches the right and or bottom egde of the content view
- and triggers an automatic dragging.
+ Checks wether the item view of a given interaction touches an egde of the content view, stores the resulting autoscroll distance
+ in the interaction and starts or stops the autoscroll timer.
  
- @param itemView The given TBCanvasItemView to check.
+ @param interaction The given interaction to check.
  */
-- (void)checkAutoScrollingForCanvasItemView:(TBCanvasItemView *)itemView;
+- (void)checkAutoScrollingForInteraction:(TBCanvasInteraction *)interaction;
 
 /**
- Scrolls the touched view to be visible.
+ Scrolls the touched view to be visible. Does nothing while more than one gesture is in progress.
  */
 - (void)scrollTouchedViewToVisible;
 
 /** @name Connection Handles */
 
 /**
- Adds handles to all connections.
+ Returns the part of the canvas that is visible in the hosting scroll view - extended by the outer canvas margin.
  
- - Adds a TBCanvasCreateHandleView above every TBCanvasNodeView on the canvas.
- - Adds a TBCanvasMoveHandleView above every TBCanvasConnectionView.
- 
- Handles will be subviews of the TBCollectionCanvasContentView.
- Handle objects will be stored in the NSMutableArrays
- - newHandles
- - moveHandles
+ @return The visible rectangle in the coordinate system of the TBCollectionCanvasContentView.
  */
-- (void)addConnectionHandles;
+- (CGRect)visibleCanvasRect;
 
 /**
- Returns a TBCanvasCreateHandleView for a given TBCanvasNodeView.
+ Adds a TBCanvasCreateHandleView to a given TBCanvasNodeView.
+ Reuses a recycled handle if possible. Otherwise a new handle is requested from the data source.
  
  @param  nodeView The given TBCanvasNodeView
  @return The resulting TBCanvasCreateHandleView
@@ -144,7 +430,8 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 - (TBCanvasCreateHandleView *)makeCreateHandleForNodeView:(TBCanvasNodeView *)nodeView;
 
 /**
- Returns a TBCanvasMoveHandleView for a given TBCanvasConnectionView.
+ Adds a TBCanvasMoveHandleView to a given TBCanvasConnectionView.
+ Reuses a recycled handle if possible. Otherwise a new handle is requested from the data source.
  
  @param  connection The given TBCanvasConnectionView
  @return The resulting TBCanvasMoveHandleView
@@ -152,17 +439,37 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 - (TBCanvasMoveHandleView *)makeMoveConnectionHandleForConnection:(TBCanvasConnectionView *)connection;
 
 /**
- Removes all TBCanvasCreateHandles and TBCanvasMoveHandles from the TBCollectionCanvasContentView
- and from the 'newHandles' and 'moveHandles' arrays.
+ Detaches a TBCanvasCreateHandleView from its node view and stores it for reuse.
+ 
+ @param handle The given TBCanvasCreateHandleView
+ */
+- (void)recycleCreateHandle:(TBCanvasCreateHandleView *)handle;
+
+/**
+ Detaches a TBCanvasMoveHandleView from its connection and stores it for reuse.
+ 
+ @param handle The given TBCanvasMoveHandleView
+ */
+- (void)recycleMoveHandle:(TBCanvasMoveHandleView *)handle;
+
+/**
+ Recycles all TBCanvasCreateHandles and TBCanvasMoveHandles on the TBCollectionCanvasContentView.
  */
 - (void)removeConnectionHandles;
 
 /**
- Redraws all given TBCanvasConnectionView objects passed in an array.
+ Moves the handles of all items inside a given tree segment to their anchor points.
+ 
+ @param treeSegment The array containing the given TBCanvasItemViews.
+ */
+- (void)moveConnectionHandlesForSegment:(NSArray *)treeSegment;
+
+/**
+ Redraws all given TBCanvasConnectionView objects passed in an array or set.
  
  @param connections The TBCanvasConnectionView objects to redraw.
  */
-- (void)refreshConnections:(NSMutableArray *)connections;
+- (void)refreshConnections:(id<NSFastEnumeration>)connections;
 
 /**
  Redraws all parent and child connections of a given TBCanvasNodeView object.
@@ -171,11 +478,6 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
  */
 - (void)refreshConnectionsForView:(TBCanvasNodeView *)canvasNodeView;
 
-/**
- Redraws all TBCanvasConnectionViews inside the connectionsForFullRefresh array.
- */
-- (void)refreshConnectionsOutsideSelection;
-
 /**
  Move a TBCanvasItemView's connections.
  
@@ -203,10 +505,21 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 - (CGRect)segmentRectangleFromSegment:(NSArray *)treeSegment;
 
 /**
- Collects all TBCanvasConnectionView objects wich point to node views outside the selected tree segment.
- Stores the collected objects inside the connectionsForFullRefresh array.
+ Returns the tags of all TBCanvasNodeViews inside a given tree segment.
+ 
+ @param treeSegment The array containing the given TBCanvasItemViews.
+ 
+ @return The index set of node view tags. Taken from the frameArena - valid until the frame ends.
+ */
+- (NSMutableIndexSet *)nodeTagsInSegment:(NSArray *)treeSegment;
+
+/**
+ Collects all TBCanvasConnectionView objects wich point from node views outside the tree segments below a number of head node views into these segments.
+ 
+ @param nodeViews   The head node views
+ @param connections The array to store the collected objects in
  */
-- (void)collectConnectionsForFullRefresh;
+- (void)collectConnectionsForFullRefreshOfNodeViews:(NSArray *)nodeViews intoArray:(NSMutableArray *)connections;
 
 /**
  Collapses all items below a given node view.
@@ -250,7 +563,7 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 /**
  Expands all items below a given node view.
  
- Though this method works recursive the head node is given as a separate parameter.
+ Traverses the segment iteratively. Nested collapsed subnodes are expanded in relation to their own head node.
  
  @param nodeView The given node view
  @param headNode The head of the collapsed node
@@ -265,6 +578,143 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
  */
 - (void)saveExpandedSegment:(NSMutableArray *)treeSegment;
 
+/** @name Handling touches */
+
+/**
+ Returns the location of the given touches inside the TBCollectionCanvasContentView corrected by the touch offset of the given item view.
+ 
+ @param touches  The touches
+ @param itemView The touched TBCanvasItemView
+ 
+ @return The location as CGPoint
+ */
+- (CGPoint)locationOfTouches:(NSSet *)touches inItemView:(TBCanvasItemView *)itemView;
+
+/**
+ Appends an event to the touchTrace if the view is recording.
+ 
+ @param target   The kind of the touched item view
+ @param phase    The touch phase or menu action
+ @param itemView The touched TBCanvasItemView
+ @param location The location of the touch
+ */
+- (void)recordTouchTraceEventWithTarget:(TBCanvasTouchTraceTarget)target phase:(TBCanvasTouchTracePhase)phase itemView:(TBCanvasItemView *)itemView location:(CGPoint)location;
+
+/**
+ Marks the end of a frame of touch handling and releases all buffers taken from the frameArena during the frame.
+ */
+- (void)endFrame;
+
+/** @name Tracking interactions */
+
+/**
+ Creates the interaction context of a gesture on a given item view.
+ 
+ @param itemView The touched TBCanvasItemView
+ 
+ @return The new interaction.
+ */
+- (TBCanvasInteraction *)beginInteractionWithItemView:(TBCanvasItemView *)itemView;
+
+/**
+ Returns the interaction context of the gesture in progress on a given item view.
+ 
+ @param itemView The touched TBCanvasItemView
+ 
+ @return The interaction or `nil` if the item view is not being touched.
+ */
+- (TBCanvasInteraction *)interactionForItemView:(TBCanvasItemView *)itemView;
+
+/**
+ Discards the interaction context of a finished gesture. Stops the autoscroll timer when no other gesture wants to scroll.
+ 
+ @param interaction The finished interaction
+ */
+- (void)endInteraction:(TBCanvasInteraction *)interaction;
+
+/**
+ Returns `YES` when a given TBCanvasNodeView is moved by a gesture on another item view - as part of a dragged selection or a dragged segment -
+ or is an end of a connection dragged by a connection handle.
+ 
+ @param nodeView The given TBCanvasNodeView
+ 
+ @return `YES` when the node view is being moved.
+ */
+- (BOOL)isNodeViewMovedByInteraction:(TBCanvasNodeView *)nodeView;
+
+/**
+ Replaces the target node view of a connection handle gesture. A node view stays selected as long as any handle gesture targets it,
+ is touched itself or is part of the selection.
+ 
+ @param nodeView    The new target or `nil`
+ @param interaction The interaction of the handle gesture
+ */
+- (void)setConnectableNodeView:(TBCanvasNodeView *)nodeView forInteraction:(TBCanvasInteraction *)interaction;
+
+/** @name Selecting multiple nodes */
+
+/**
+ Returns all TBCanvasNodeViews of all sections intersecting a given rectangle. Node views inside collapsed segments are skipped.
+ 
+ @param rect The given rectangle
+ 
+ @return The TBCanvasNodeView objects.
+ */
+- (NSMutableArray *)visibleNodeViewsInRect:(CGRect)rect;
+
+/**
+ Replaces the selection with the given TBCanvasNodeViews and informs the delegate.
+ 
+ @param nodeViews The given TBCanvasNodeView objects
+ 
+ @return The index paths of the selected TBCanvasNodeView objects.
+ */
+- (NSArray *)selectNodeViews:(NSArray *)nodeViews;
+
+/**
+ Returns `YES` when dragging a given TBCanvasNodeView moves the whole selection.
+ 
+ @param nodeView The given TBCanvasNodeView
+ 
+ @return `YES` when the node view is part of the selection.
+ */
+- (BOOL)isMovingSelectionWithNodeView:(TBCanvasNodeView *)nodeView;
+
+/**
+ Prepares the collapsed segments below a group of TBCanvasNodeViews for being moved.
+ Collects the connections leading into these segments in the given interaction.
+ Borrows from the frame arena. Callers outside a frame reset the arena when they are done.
+ 
+ @param nodeViews   The TBCanvasNodeView objects to move
+ @param interaction The interaction moving the group
+ */
+- (void)beginMovingNodeViews:(NSArray *)nodeViews interaction:(TBCanvasInteraction *)interaction;
+
+/**
+ Moves a group of TBCanvasNodeViews and the collapsed segments below them by a given distance in one pass.
+ Every connection attached to the group is redrawn once.
+ 
+ @param nodeViews   The TBCanvasNodeView objects to move. An array or an ordered set
+ @param delta       The distance to move
+ @param interaction The interaction moving the group
+ */
+- (void)moveNodeViews:(id<NSFastEnumeration>)nodeViews byDelta:(CGPoint)delta interaction:(TBCanvasInteraction *)interaction;
+
+/**
+ Keeps a moved group of TBCanvasNodeViews inside the canvas and resizes the canvas once.
+ 
+ @param nodeViews   The moved TBCanvasNodeView objects
+ @param interaction The interaction moving the group
+ */
+- (void)endMovingNodeViews:(NSArray *)nodeViews interaction:(TBCanvasInteraction *)interaction;
+
+/**
+ Informs the delegate about a moved group of TBCanvasNodeViews including the node views inside their collapsed segments.
+ 
+ @param nodeViews The moved TBCanvasNodeView objects
+ */
+- (void)notifyDelegateOfMovedNodeViews:(NSArray *)nodeViews;
+
 /** @name Handling the menu */
 
 /**
@@ -292,6 +742,8 @@ NSString * const kInternalInconsistencyException = @"InternalInconsistencyExcept
 
 static CGFloat OUTER_CANVAS_MARGIN      = 100.0;
 static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
+static CGFloat CLUSTER_SCREEN_SIZE      = 64.0;
+static NSUInteger CLUSTER_BUNDLE_WIDTHS = 4;
 
 
 - (id)initWithFrame:(CGRect)frame {
@@ -304,32 +756,76 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
         
         zoomScale = 0.5;
         
-        _temporaryConnectionView = nil;
-        _connectableNodeView = nil;
-        _selectedConnectionView = nil;
-        
         _scrollView = nil;
         _autoscrollTimer = nil;
         _menuTimer = nil;
         _menuEnabled = NO;
         
-        _viewsTouched = [[NSMutableArray alloc] init];
-        _nodeViews = [[NSMutableArray alloc] init];
-        _connectionViews = [[NSMutableArray alloc] init];
+        _interactions = [[NSMutableDictionary alloc] init];
+        _sections = [[NSMutableArray alloc] init];
         _createHandles = [[NSMutableArray alloc] init];
         _moveHandles = [[NSMutableArray alloc] init];
+        _reusableCreateHandles = [[NSMutableArray alloc] init];
+        _reusableMoveHandles = [[NSMutableArray alloc] init];
         _segmentsBelowNode = [[NSMutableDictionary alloc] init];
-        _connectionViewsForFullRefresh = [[NSMutableArray alloc] init];
-        _autoscrollingItems = [[NSMutableArray alloc] init];
+        _frameArena = [[TBCanvasArena alloc] init];
+        _selectedNodeViews = [[NSMutableOrderedSet alloc] init];
         
-        isMovingCanvasNodeViews = NO;
-        isInConnectMode = NO;
+        _selectionMode = TBCanvasSelectionModeNone;
+        _selectionPath = nil;
+        _selectionLayer = [CAShapeLayer layer];
+        _selectionLayer.fillColor = [UIColor colorWithWhite:0.5 alpha:0.2].CGColor;
+        _selectionLayer.strokeColor = [UIColor darkGrayColor].CGColor;
+        _selectionLayer.lineWidth = 2.0;
+        _selectionLayer.lineDashPattern = @[@6, @4];
         
-        self.viewWithMenu = nil;
-        self.menuController = [UIMenuController sharedMenuController];
-    }
-    return self;
-}
+        _clusteringZoomScale = 0.25;
+        _showingClusters = NO;
+        _clusterViews = [[NSMutableArray alloc] init];
+        _reusableClusterViews = [[NSMutableArray alloc] init];
+        
+        NSMutableArray *bundleLayers = [[NSMutableArray alloc] init];
+        for (NSUInteger i = 0; i < CLUSTER_BUNDLE_WIDTHS; i++) {
+            CAShapeLayer *bundleLayer = [CAShapeLayer layer];
+            bundleLayer.fillColor = nil;
+            bundleLayer.strokeColor = [UIColor colorWithWhite:0.4 alpha:0.6].CGColor;
+            bundleLayer.lineCap = kCALineCapRound;
+            [layer insertSublayer:bundleLayer atIndex:0];
+            [bundleLayers addObject:bundleLayer];
+        }
+        _bundleLayers = bundleLayers;
+        
+        _tiledRenderingEnabled = NO;
+        _tiledView = nil;
+        _promotedNodeViews = [[NSMutableSet alloc] init];
+        
+        _snappingEnabled = NO;
+        _snappingTolerance = 8.0;
+        NSMutableArray *guideLayers = [[NSMutableArray alloc] init];
+        for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+            CALayer *guideLayer = [CALayer layer];
+            guideLayer.backgroundColor = [UIColor colorWithRed:0.0 green:0.5 blue:1.0 alpha:1.0].CGColor;
+            
+            // Guides follow the dragged node view without implicit animations.
+            guideLayer.actions = @{@"position" : [NSNull null], @"bounds" : [NSNull null]};
+            [guideLayers addObject:guideLayer];
+        }
+        _guideLayers = guideLayers;
+        
+        _highlightStyle = TBCanvasHighlightStyleOutline;
+        _highlightedIndexes = [[NSMutableDictionary alloc] init];
+        _highlightLayer = [CAShapeLayer layer];
+        _highlightLayer.fillRule = kCAFillRuleEvenOdd;
+        
+        _connectableNodeViews = [[NSCountedSet alloc] init];
+        
+        isInConnectMode = NO;
+        
+        self.viewWithMenu = nil;
+        self.menuController = [UIMenuController sharedMenuController];
+    }
+    return self;
+}
 
 - (void)configureMenu
 {
@@ -342,25 +838,60 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
 #pragma mark -  TBCanvas view setup
 
 - (void)fillCanvas
+{
+    TB_CANVAS_SCOPED_TIMER("fillCanvas");
+    
+    NSInteger sectionCount = 0;
+    
+    if ([_canvasViewDataSource respondsToSelector:@selector(numberOfSectionsOnCanvasContentView:)]) {
+        sectionCount = [_canvasViewDataSource numberOfSectionsOnCanvasContentView:self];
+    }
+    
+    // Data sources without sections are loaded as a single section 0.
+    sectionCount = MAX(sectionCount, 1);
+    
+    for (NSInteger section = 0; section < sectionCount; section++) {
+        TBCanvasSection *canvasSection = [[TBCanvasSection alloc] initWithSection:section];
+        [_sections addObject:canvasSection];
+        
+        if (_tiledRenderingEnabled) {
+            [self attachRenderModelToSection:canvasSection];
+        }
+        [self fillSection:canvasSection];
+    }
+    [self reindexSections:_sections];
+    [self sizeCanvasToFit];
+    
+    if (_showingClusters || _tiledRenderingEnabled) {
+        [self setItemViewsHidden:YES inSections:_sections];
+    }
+    [self promoteCollapsedNodeViewsInSections:_sections];
+    [self updateRenderModelsOfTiledView];
+    [self layoutClusters];
+    [self layoutTiles];
+}
+
+- (void)fillSection:(TBCanvasSection *)canvasSection
 {
     NSInteger nodeCount = 0;
     NSMutableArray *headNodes = [[NSMutableArray alloc] init];
     NSMutableArray *segmentNodes = [[NSMutableArray alloc] init];
     
     if ([_canvasViewDataSource respondsToSelector:@selector(collectionCanvasContentView:numberOfNodesInSection:)]) {
-        nodeCount = [_canvasViewDataSource collectionCanvasContentView:self numberOfNodesInSection:0];
+        nodeCount = [_canvasViewDataSource collectionCanvasContentView:self numberOfNodesInSection:canvasSection.section];
     }
     
     for (NSInteger i = 0; i < nodeCount; i++) {
         TBCanvasNodeView *nodeView = nil;
         
         if ([_canvasViewDataSource respondsToSelector:@selector(collectionCanvasContentView:nodeViewAtIndexPath:)]) {
-            nodeView = [_canvasViewDataSource collectionCanvasContentView:self nodeViewAtIndexPath:[NSIndexPath indexPathForRow:i inSection:0]];
+            nodeView = [_canvasViewDataSource collectionCanvasContentView:self nodeViewAtIndexPath:[NSIndexPath indexPathForRow:i inSection:canvasSection.section]];
         }
         if (nodeView) {
             
             if (nodeView.tag == i) {
                 
+                nodeView.section = canvasSection.section;
                 nodeView.delegate = self;
                 nodeView.zoomScale = zoomScale;
                 
@@ -368,7 +899,7 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
                     nodeView.center = [self autoLayoutNodeView:nodeView];
                 }
                 
-                [_nodeViews addObject:nodeView];
+                [canvasSection.nodeViews addObject:nodeView];
                 
                 [self addSubview:nodeView];
                 
@@ -382,12 +913,11 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
                     [segmentNodes addObject:nodeView];
                 }
             } else {
-                [NSException raise:kInternalInconsistencyException format:@"### Error: TBCollectionCanvasContentView: Internal Inconsistency: nodeView.tag %li not equal to %li", (long)nodeView.tag, (long)i];
+                [NSException raise:kInternalInconsistencyException format:@"### Error: TBCollectionCanvasContentView: Internal Inconsistency: nodeView.tag %li not equal to %li in section %li", (long)nodeView.tag, (long)i, (long)canvasSection.section];
             }
         }
     }
-    [self connectNodes];
-    [self sizeCanvasToFit];
+    [self connectNodesInSection:canvasSection];
     
     [self ticktockSegment:segmentNodes];
     
@@ -401,22 +931,44 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
     [segmentNodes removeAllObjects];
 }
 
+- (void)reindexSections:(NSArray *)sections
+{
+    TB_CANVAS_SCOPED_TIMER("reindexSections");
+    
+    // Frames are read on the main thread. The indexes of independent sections are built concurrently.
+    NSMutableArray *frames = [[NSMutableArray alloc] initWithCapacity:sections.count];
+    for (TBCanvasSection *canvasSection in sections) {
+        [frames addObject:[canvasSection nodeViewFrames]];
+    }
+    
+    dispatch_apply(sections.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        [(TBCanvasSection *)sections[i] loadNodeViewFrames:frames[i]];
+    });
+}
+
+- (TBCanvasSection *)sectionForNodeView:(TBCanvasNodeView *)nodeView
+{
+    return _sections[nodeView.section];
+}
+
 - (CGPoint)autoLayoutNodeView:(TBCanvasNodeView *)nodeView
 {
     CGRect frame = nodeView.frame;
     frame.origin.x = (CGRectGetMinX(self.scrollView.bounds) / zoomScale) + OUTER_FILEVIEW_MARGIN;
     frame.origin.y = (CGRectGetMinY(self.scrollView.bounds) / zoomScale) + OUTER_FILEVIEW_MARGIN;
     
-    for (TBCanvasNodeView *view in _nodeViews) {
-        if (CGRectIntersectsRect(frame, view.frame)) {
-            
-            // step to the right and keep a distance
-            frame.origin.x = CGRectGetMaxX(view.frame) + OUTER_FILEVIEW_MARGIN;
-            
-            // if we are too right do a linebreak
-            if (CGRectGetMaxX(frame) > CGRectGetMaxX(self.scrollView.bounds) / zoomScale) {
-                frame.origin.x =  (CGRectGetMinX(self.scrollView.bounds) / zoomScale) + OUTER_FILEVIEW_MARGIN;
-                frame.origin.y += frame.size.height + OUTER_FILEVIEW_MARGIN;
+    for (TBCanvasSection *canvasSection in _sections) {
+        for (TBCanvasNodeView *view in canvasSection.nodeViews) {
+            if (CGRectIntersectsRect(frame, view.frame)) {
+                
+                // step to the right and keep a distance
+                frame.origin.x = CGRectGetMaxX(view.frame) + OUTER_FILEVIEW_MARGIN;
+                
+                // if we are too right do a linebreak
+                if (CGRectGetMaxX(frame) > CGRectGetMaxX(self.scrollView.bounds) / zoomScale) {
+                    frame.origin.x =  (CGRectGetMinX(self.scrollView.bounds) / zoomScale) + OUTER_FILEVIEW_MARGIN;
+                    frame.origin.y += frame.size.height + OUTER_FILEVIEW_MARGIN;
+                }
             }
         }
     }
@@ -425,15 +977,18 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
     return nodeView.center;
 }
 
-- (void)connectNodes
+- (void)connectNodesInSection:(TBCanvasSection *)canvasSection
 {
+    TB_CANVAS_SCOPED_TIMER("connectNodes");
+    
     NSSet *nodeConnections = nil;
+    NSArray *nodeViews = canvasSection.nodeViews;
     
     // Iterate through all nodes.
-    for (TBCanvasNodeView *nodeView in _nodeViews) {
+    for (TBCanvasNodeView *nodeView in nodeViews) {
         
         if ([_canvasViewDataSource respondsToSelector:@selector(collectionCanvasContentView:connectionsForNodeAtIndexPath:)]) {
-            nodeConnections = [_canvasViewDataSource collectionCanvasContentView:self connectionsForNodeAtIndexPath:[NSIndexPath indexPathForRow:nodeView.tag inSection:0]];
+            nodeConnections = [_canvasViewDataSource collectionCanvasContentView:self connectionsForNodeAtIndexPath:nodeView.indexPath];
         }
         
         // Iterate through all connections.
@@ -442,8 +997,13 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
             NSUInteger parentTag = nodeConnection.parentIndex;
             NSUInteger childTag  = nodeConnection.childIndex;
             
-            TBCanvasNodeView *parentView = _nodeViews[parentTag];
-            TBCanvasNodeView *childView = _nodeViews[childTag];
+            // Connections never leave their section.
+            if (parentTag >= nodeViews.count || childTag >= nodeViews.count) {
+                [NSException raise:kInternalInconsistencyException format:@"### Error: TBCollectionCanvasContentView: Internal Inconsistency: connection %li -> %li outside of section %li", (long)parentTag, (long)childTag, (long)canvasSection.section];
+            }
+            
+            TBCanvasNodeView *parentView = nodeViews[parentTag];
+            TBCanvasNodeView *childView = nodeViews[childTag];
             
             // add a new connection and connect both
             nodeConnection.canvasNodeConnectionDelegate = self;
@@ -453,7 +1013,7 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
             // register connection in all three arrays.
             [parentView.childConnections addObject:nodeConnection];
             [childView.parentConnections addObject:nodeConnection];
-            [_connectionViews addObject:nodeConnection];
+            [canvasSection addConnectionView:nodeConnection];
             
             // set connection attributes.
             [self addSubview:nodeConnection];
@@ -463,32 +1023,123 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
     }
 }
 
+- (TBCanvasConnectionView *)connectNodeView:(TBCanvasNodeView *)parentView toNodeView:(TBCanvasNodeView *)childView
+{
+    TBCanvasConnectionView *connection = [self.canvasViewDataSource collectionCanvasContentView:self newConectionForNodeAtIndexPath:parentView.indexPath];
+    connection.canvasNodeConnectionDelegate = self;
+    connection.zoomScale = zoomScale;
+    
+    connection.parentNode = parentView;
+    connection.childNode = childView;
+    connection.tag = parentView.childConnections.count;
+    
+    [parentView.childConnections addObject:connection];
+    [childView.parentConnections addObject:connection];
+    [[self sectionForNodeView:parentView] addConnectionView:connection];
+    
+    [self addSubview:connection];
+    [self sendSubviewToBack:connection];
+    
+    [connection drawConnection];
+    
+    // Add new invisible handle.
+    [self makeMoveConnectionHandleForConnection:connection];
+    
+    [self recordSyncDeltaOfKind:TBCanvasDeltaKindAddConnection nodeView:parentView childNodeView:childView];
+    
+    if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didAddConnectionBetweenParentAtIndexPath:childAtIndexPath:)]) {
+        [_canvasViewDelegate collectionCanvasContentView:self didAddConnectionBetweenParentAtIndexPath:parentView.indexPath childAtIndexPath:childView.indexPath];
+    }
+    return connection;
+}
+
+- (TBCanvasConnectionView *)connectionFromNodeView:(TBCanvasNodeView *)parentView toNodeView:(TBCanvasNodeView *)childView
+{
+    for (TBCanvasConnectionView *connection in parentView.childConnections) {
+        if (connection.childNode == childView && connection.isValid) {
+            return connection;
+        }
+    }
+    return nil;
+}
+
 - (void)clearCanvas
 {
     [_segmentsBelowNode removeAllObjects];
-    [_connectionViewsForFullRefresh removeAllObjects];
+    [self deselectAllNodes];
     
-    [_connectionViews makeObjectsPerformSelector:@selector(removeFromSuperview)];
-    [_connectionViews makeObjectsPerformSelector:@selector(reset)];
-    [_connectionViews removeAllObjects];
-    
-    [_nodeViews makeObjectsPerformSelector:@selector(removeFromSuperview)];
-    [_nodeViews makeObjectsPerformSelector:@selector(reset)];
-    [_nodeViews removeAllObjects];
+    for (TBCanvasSection *canvasSection in _sections) {
+        [self clearSection:canvasSection];
+    }
+    [_sections removeAllObjects];
+    [self updateRenderModelsOfTiledView];
+    [self layoutHighlights];
     
     [self removeConnectionHandles];
+    [_reusableCreateHandles removeAllObjects];
+    [_reusableMoveHandles removeAllObjects];
     isInConnectMode = NO;
     
-    if (_temporaryConnectionView) {
-        [_temporaryConnectionView removeFromSuperview];
-        [_temporaryConnectionView reset];
-        _temporaryConnectionView = nil;
+    // Without sections all cluster views are recycled.
+    [self layoutClusters];
+    
+    // Gestures in progress end with the canvas. Their remaining touches are ignored.
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        if ([interaction.itemView isKindOfClass:[TBCanvasCreateHandleView class]]) {
+            [interaction.connection removeFromSuperview];
+        }
+        [interaction.connection reset];
+    }
+    [_interactions removeAllObjects];
+    [_autoscrollTimer invalidate];
+    _autoscrollTimer = nil;
+}
+
+- (void)clearSection:(TBCanvasSection *)canvasSection
+{
+    // Drop cached segments of this section.
+    for (NSNumber *key in _segmentsBelowNode.allKeys) {
+        if ((NSInteger)(key.unsignedLongLongValue >> 32) == canvasSection.section) {
+            [_segmentsBelowNode removeObjectForKey:key];
+        }
+    }
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        [interaction.connectionsForFullRefresh removeObjectsInArray:canvasSection.connectionViews.allObjects];
+    }
+    [_highlightedIndexes removeObjectForKey:@(canvasSection.section)];
+    
+    if (_viewWithMenu && _viewWithMenu.section == canvasSection.section) {
+        [self hideMenu];
+        _viewWithMenu = nil;
+    }
+    
+    for (TBCanvasNodeView *nodeView in canvasSection.nodeViews) {
+        if ([_selectedNodeViews containsObject:nodeView]) {
+            [nodeView setSelected:NO];
+            [_selectedNodeViews removeObject:nodeView];
+        }
+        [_promotedNodeViews removeObject:nodeView];
     }
     
-    if (_selectedConnectionView) {
-        [_selectedConnectionView reset];
-        _selectedConnectionView = nil;
+    // Recycle handles.
+    for (TBCanvasConnectionView *connection in canvasSection.connectionViews) {
+        if (connection.moveConnectionHandle) {
+            [self recycleMoveHandle:connection.moveConnectionHandle];
+        }
+    }
+    for (TBCanvasNodeView *nodeView in canvasSection.nodeViews) {
+        if (nodeView.connectionHandle) {
+            [self recycleCreateHandle:nodeView.connectionHandle];
+        }
     }
+    
+    [canvasSection.connectionViews makeObjectsPerformSelector:@selector(removeFromSuperview)];
+    [canvasSection.connectionViews makeObjectsPerformSelector:@selector(reset)];
+    
+    [canvasSection.nodeViews makeObjectsPerformSelector:@selector(removeFromSuperview)];
+    [canvasSection.nodeViews makeObjectsPerformSelector:@selector(reset)];
+    
+    [canvasSection removeAllItems];
 }
 
 - (void)reloadCanvas
@@ -497,102 +1148,132 @@ static CGFloat OUTER_FILEVIEW_MARGIN    = 40.0;
     [self fillCanvas];
 }
 
+- (void)reloadSection:(NSInteger)section
+{
+    TBCanvasSection *canvasSection = _sections[section];
+    
+    [self clearSection:canvasSection];
+    [self fillSection:canvasSection];
+    [self reindexSections:@[canvasSection]];
+    [_syncEngine invalidateSection:section];
+    
+    [self sizeCanvasToFit];
+    
+    if (_showingClusters || _tiledRenderingEnabled) {
+        [self setItemViewsHidden:YES inSections:@[canvasSection]];
+    }
+    [self promoteCollapsedNodeViewsInSections:@[canvasSection]];
+    [self layoutClusters];
+    [self layoutTiles];
+    [self layoutConnectionHandles];
+}
+
 #pragma mark - Autoscrolling, resizing and zooming
 
 static int     AUTOSCROLL_THRESHOLD     = 10;
 static CGFloat MAX_AUTOSCROLL_DISTANCE  =  2.0;
 static CGFloat AUTOSCROLL_MARGIN        =  1.0;
 
-- (void)validateAutoscrollDistance {
-    
-    for (TBCanvasItemView *itemView in _autoscrollingItems) {
+- (void)validateAutoscrollDistances
+{
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
         
-        // When the view reaches left or upper border of the view kill the timer.
-        if (itemView.scaledFrame.origin.x <= 0.0) {
-            autoscrollDistanceHorizontal = 0.0;
-        }
-        if (itemView.scaledFrame.origin.y <= 0.0) {
-            autoscrollDistanceVertical  = 0.0;
+        // When the view reaches left or upper border of the view stop scrolling towards it.
+        CGPoint distance = interaction.autoscrollDistance;
+        CGRect scaledFrame = interaction.itemView.scaledFrame;
+        if (scaledFrame.origin.x <= 0.0 && distance.x < 0.0) {
+            distance.x = 0.0;
         }
-        
-        // Keep values from exceeding minimum / maximum value.
-        autoscrollDistanceHorizontal = MIN(autoscrollDistanceHorizontal,  MAX_AUTOSCROLL_DISTANCE);
-        autoscrollDistanceHorizontal = MAX(autoscrollDistanceHorizontal, (MAX_AUTOSCROLL_DISTANCE * -1));
-        
-        autoscrollDistanceVertical   = MIN(autoscrollDistanceVertical,    MAX_AUTOSCROLL_DISTANCE);
-        autoscrollDistanceVertical   = MAX(autoscrollDistanceVertical,   (MAX_AUTOSCROLL_DISTANCE * -1));
-        
-    }
-    
-    if ((autoscrollDistanceHorizontal == 0.0 && autoscrollDistanceVertical == 0.0) || _autoscrollingItems.count == 0) {
-        if (_autoscrollTimer) {
-            [_autoscrollTimer invalidate];
-            _autoscrollTimer = nil;
-            
-            [_autoscrollingItems removeAllObjects];
-            
-            [self sizeCanvasToFit];
-            [self scrollTouchedViewToVisible];
+        if (scaledFrame.origin.y <= 0.0 && distance.y < 0.0) {
+            distance.y = 0.0;
         }
+        interaction.autoscrollDistance = distance;
     }
 }
 
 - (void)autoScrollOnEdges
 {
-    [self validateAutoscrollDistance];
+    TB_CANVAS_SCOPED_TIMER("autoscrollTick");
+    
+    [self validateAutoscrollDistances];
+    
+    // All gestures scroll the canvas together - once per frame.
+    CGPoint distance = [TBCanvasInteraction mergedAutoscrollDistanceOfInteractions:_interactions.objectEnumerator];
+    if (distance.x == 0.0 && distance.y == 0.0) {
+        [self stopAutoscrolling];
+        return;
+    }
     
     // Move the scrollview's content offset...
     CGPoint offset = self.scrollView.contentOffset;
-    offset.x += autoscrollDistanceHorizontal;
-    offset.y += autoscrollDistanceVertical;
+    offset.x += distance.x;
+    offset.y += distance.y;
     self.scrollView.contentOffset = offset;
     
-    // And the touched view by the given fraction.
+    // And the touched views by the given fraction.
+    CGPoint delta = CGPointMake(distance.x / zoomScale, distance.y / zoomScale);
     
-    for (TBCanvasItemView *itemView in _autoscrollingItems) {
+    // Every gesture keeps its items under its finger - not only the gestures near the edges.
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        TBCanvasItemView *itemView = interaction.itemView;
+        
+        // A dragged selection scrolls as a whole.
+        if ([itemView isKindOfClass:[TBCanvasNodeView class]] && [self isMovingSelectionWithNodeView:(TBCanvasNodeView *)itemView]) {
+            [self moveNodeViews:_selectedNodeViews byDelta:delta interaction:interaction];
+            continue;
+        }
         
-        CGPoint center = itemView.center;
-        center.x += autoscrollDistanceHorizontal / zoomScale;
-        center.y += autoscrollDistanceVertical / zoomScale;
-        itemView.center = center;
+        itemView.center = CGPointMake(itemView.center.x + delta.x, itemView.center.y + delta.y);
         
         if ([itemView isKindOfClass:[TBCanvasNodeView class]]) {
             
             TBCanvasNodeView *nodeView = (TBCanvasNodeView *)itemView;
             
-            if (isInConnectMode) {
-                TBCanvasCreateHandleView *newHandle = _createHandles[nodeView.tag];
-                newHandle.center = CGPointMake(nodeView.center.x, nodeView.center.y + (nodeView.frame.size.height * 0.5));
-            }
-            
-            NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:nodeView];
+            nodeView.connectionHandle.center = nodeView.connectionHandleAncorPoint;
             
-            for (TBCanvasItemView *item in segmentBelowNode) {
-                item.center = CGPointMake(item.center.x + autoscrollDistanceHorizontal / zoomScale, item.center.y + autoscrollDistanceVertical / zoomScale);
+            if (interaction.segment) {
+                for (TBCanvasItemView *item in interaction.segment) {
+                    item.center = CGPointMake(item.center.x + delta.x, item.center.y + delta.y);
+                }
+                [self moveConnectionHandlesForSegment:interaction.segment];
+                [self updateSpatialIndexForSegment:interaction.segment];
+                nodeView.segmentRect = CGRectOffset(nodeView.segmentRect, delta.x, delta.y);
+                
+                [self refreshConnections:interaction.connectionsForFullRefresh];
             }
-            nodeView.segmentRect = CGRectOffset(nodeView.segmentRect, autoscrollDistanceHorizontal / zoomScale, autoscrollDistanceVertical / zoomScale);
+            
+            [[self sectionForNodeView:nodeView] updateNodeView:nodeView];
+            [self invalidateHighlightOfNodeView:nodeView];
         }
         [self moveConnectionsForItemView:itemView];
     }
+    [self endFrame];
+}
+
+- (void)stopAutoscrolling
+{
+    if (_autoscrollTimer == nil) {
+        return;
+    }
+    [_autoscrollTimer invalidate];
+    _autoscrollTimer = nil;
+    
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        interaction.autoscrollDistance = CGPointZero;
+    }
+    
+    [self sizeCanvasToFit];
+    [self scrollTouchedViewToVisible];
 }
 
 - (float)autoscrollDistanceForProximityToEdge:(float)proximity {
     return ceilf((AUTOSCROLL_THRESHOLD - proximity) / 5.0);
 }
 
-- (void)checkAutoScrollingForCanvasItemView:(TBCanvasItemView *)itemView
+- (void)checkAutoScrollingForInteraction:(TBCanvasInteraction *)interaction
 {
-    // Reset if nothing to scroll.
-    if (_autoscrollingItems.count == 0) {
-        autoscrollDistanceHorizontal = 0.0;
-        autoscrollDistanceVertical   = 0.0;
-    }
-    
     CGRect scrollViewRect = CGRectInset(self.scrollView.bounds, AUTOSCROLL_MARGIN, AUTOSCROLL_MARGIN);
-    CGRect viewTouchedRect = itemView.scaledFrame;
-    
-    //if ([itemView isKindOfClass:[TBCanvasNodeView class]])
-    //    viewTouchedRect = ((TBCanvasNodeView *)itemView).scaledSegmentRect;
+    CGRect viewTouchedRect = interaction.itemView.scaledFrame;
     
     float autoscrollDistanceH = 0.0;
     float autoscrollDistanceV = 0.0;
@@ -617,56 +1298,42 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
         }
     }
     
-    autoscrollDistanceHorizontal = MAX(autoscrollDistanceHorizontal, autoscrollDistanceH);
-    
-    autoscrollDistanceVertical = MAX(autoscrollDistanceVertical, autoscrollDistanceV);
+    // Keep values from exceeding minimum / maximum value.
+    autoscrollDistanceH = MAX(MIN(autoscrollDistanceH, MAX_AUTOSCROLL_DISTANCE), (MAX_AUTOSCROLL_DISTANCE * -1));
+    autoscrollDistanceV = MAX(MIN(autoscrollDistanceV, MAX_AUTOSCROLL_DISTANCE), (MAX_AUTOSCROLL_DISTANCE * -1));
+    interaction.autoscrollDistance = CGPointMake(autoscrollDistanceH, autoscrollDistanceV);
     
-    
-    if ((autoscrollDistanceH == 0.0) && (autoscrollDistanceV == 0.0)) {
-        [_autoscrollingItems removeObjectIdenticalTo:itemView];
-    } else {
-        if ([_autoscrollingItems containsObject:itemView] == NO) {
-            [_autoscrollingItems addObject:itemView];
-        }
-    }
-    // Reset timer when view is inside visible bounds again OR start timer if not.
-    if ((autoscrollDistanceHorizontal == 0.0 && autoscrollDistanceVertical == 0.0) || _autoscrollingItems.count == 0) {
+    // Reset timer when all views are inside visible bounds again OR start timer if not.
+    CGPoint distance = [TBCanvasInteraction mergedAutoscrollDistanceOfInteractions:_interactions.objectEnumerator];
+    if (distance.x == 0.0 && distance.y == 0.0) {
+        [self stopAutoscrolling];
         
-        if (_autoscrollTimer) {
-            [_autoscrollTimer invalidate];
-            _autoscrollTimer = nil;
-            [_autoscrollingItems removeAllObjects];
-            
-            [self sizeCanvasToFit];
-            [self scrollTouchedViewToVisible];
-        }
-        
-    } else {
-        
-        if (_autoscrollingItems.count > 0) {
-            if (_autoscrollTimer == nil) {
-                _autoscrollTimer = [NSTimer scheduledTimerWithTimeInterval:(1.0 / 60.0) target:self selector:@selector(autoScrollOnEdges) userInfo:nil repeats:YES];
-            }
-        }
+    } else if (_autoscrollTimer == nil) {
+        _autoscrollTimer = [NSTimer scheduledTimerWithTimeInterval:(1.0 / 60.0) target:self selector:@selector(autoScrollOnEdges) userInfo:nil repeats:YES];
     }
 }
 
 - (void)scrollTouchedViewToVisible
 {
-    if (_viewsTouched.count == 1) {
-        TBCanvasItemView *viewTouched = _viewsTouched.lastObject;
+    // Scrolling to one of several touched views would pull the canvas away from the others.
+    if (_interactions.count == 1) {
+        TBCanvasItemView *viewTouched = [[_interactions.objectEnumerator nextObject] itemView];
         [self.scrollView scrollRectToVisible:CGRectInset(viewTouched.scaledFrame, -OUTER_FILEVIEW_MARGIN * zoomScale, -OUTER_FILEVIEW_MARGIN * zoomScale) animated:YES];
     }
 }
 
 - (void)sizeCanvasToFit {
+    TB_CANVAS_SCOPED_TIMER("sizeCanvasToFit");
     
     CGSize size = {0.0, 0.0};
     
-    // Get smallest possible rect around all views + outer margin.
-    for (TBCanvasNodeView *nodeView in _nodeViews) {
-        size.width  = MAX(CGRectGetMaxX(nodeView.scaledFrame), size.width);
-        size.height = MAX(CGRectGetMaxY(nodeView.scaledFrame), size.height);
+    // Get smallest possible rect around all sections + outer margin.
+    for (TBCanvasSection *canvasSection in _sections) {
+        CGRect bounds = canvasSection.bounds;
+        if (CGRectIsNull(bounds) == NO) {
+            size.width  = MAX(CGRectGetMaxX(bounds) * zoomScale, size.width);
+            size.height = MAX(CGRectGetMaxY(bounds) * zoomScale, size.height);
+        }
     }
     
     // Reset to default size if necessary.
@@ -680,20 +1347,25 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     self.frame = CGRectMake(0.0, 0.0, size.width, size.height);
     
     self.scrollView.contentSize = self.frame.size;
+    
+    [self layoutHighlights];
 }
 
 - (void)zoomToScale:(CGFloat)scale
 {
     zoomScale = scale;
     
-    // Iterate through all  TBCanvasNodeViews.
-    for (TBCanvasNodeView *nodeView in _nodeViews) {
-        nodeView.zoomScale = zoomScale;
-    }
-    
-    // Iterate through all TBCanvasConnectionViews.
-    for (TBCanvasConnectionView *connection in _connectionViews) {
-        connection.zoomScale = zoomScale;
+    for (TBCanvasSection *canvasSection in _sections) {
+        
+        // Iterate through all  TBCanvasNodeViews.
+        for (TBCanvasNodeView *nodeView in canvasSection.nodeViews) {
+            nodeView.zoomScale = zoomScale;
+        }
+        
+        // Iterate through all TBCanvasConnectionViews.
+        for (TBCanvasConnectionView *connection in canvasSection.connectionViews) {
+            connection.zoomScale = zoomScale;
+        }
     }
     
     // Iterate through all  TBCanvasCreateHandles.
@@ -706,19 +1378,28 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
         handle.zoomScale = zoomScale;
     }
     
-    // Don't forget the temporary connection if it has been set.
-    if (_temporaryConnectionView) {
-        _temporaryConnectionView.zoomScale = zoomScale;
+    // Recycled handles get their zoom scale when they are reused.
+    
+    // Don't forget the temporary connections of create handles being dragged.
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        if ([interaction.itemView isKindOfClass:[TBCanvasCreateHandleView class]]) {
+            interaction.connection.zoomScale = zoomScale;
+        }
     }
     
     [self sizeCanvasToFit];
+    [self layoutClusters];
+    [self layoutTiles];
+    [self layoutConnectionHandles];
 }
 
 #pragma mark - TBCanvasNodeView handling
 
 - (void)updateNodeViewAtIndexPath:(NSIndexPath *)indexPath
 {
-    [[self nodeAtIndexPath:indexPath] removeFromSuperview];
+    TBCanvasSection *canvasSection = _sections[indexPath.section];
+    TBCanvasNodeView *oldNodeView = canvasSection.nodeViews[indexPath.row];
+    [oldNodeView removeFromSuperview];
     
     TBCanvasNodeView *nodeView = nil;
     
@@ -728,12 +1409,23 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     
     if (nodeView) {
         nodeView.tag = indexPath.row;
+        nodeView.section = indexPath.section;
         nodeView.delegate = self;
-        nodeView.frame = [_nodeViews[indexPath.row] frame];
+        nodeView.frame = oldNodeView.frame;
         nodeView.zoomScale = zoomScale;
+        nodeView.hidden = (_showingClusters || _tiledRenderingEnabled);
         
-        _nodeViews[indexPath.row] = nodeView;
+        canvasSection.nodeViews[indexPath.row] = nodeView;
         [self addSubview:nodeView];
+        
+        [canvasSection updateNodeView:nodeView];
+        
+        // The tiles show the new node view from now on.
+        [_promotedNodeViews removeObject:oldNodeView];
+        [canvasSection.renderModel setLive:NO forIndex:indexPath.row];
+        if (_tiledRenderingEnabled) {
+            [self updateSnapshotOfNodeView:nodeView];
+        }
     }
 }
 
@@ -746,35 +1438,31 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     }
     
     if (nodeView) {
-        nodeView.tag = indexPath.row;
+        TBCanvasSection *canvasSection = _sections[indexPath.section];
+        
         nodeView.delegate = self;
         nodeView.zoomScale = zoomScale;
+        nodeView.hidden = (_showingClusters || _tiledRenderingEnabled);
         
-        [_nodeViews insertObject:nodeView atIndex:indexPath.row];
+        // Shift the tags of the remaining node views
+        [canvasSection insertNodeView:nodeView atIndex:indexPath.row];
+        [_syncEngine invalidateSection:indexPath.section];
         [self addSubview:nodeView];
+        [self shiftHighlightedIndexesInSection:indexPath.section startingAtIndex:indexPath.row by:1];
         
-        // Reindex remaining node views
-        for (NSInteger i = indexPath.row; i < _nodeViews.count; i++) {
-            ((TBCanvasNodeView *)_nodeViews[i]).tag = i;
-        }
+        // The new node view still needs a snapshot.
+        [self layoutTiles];
         
         // Add new connection handle if necessary.
-        if (isInConnectMode) {
-            TBCanvasCreateHandleView *handle = [self makeCreateHandleForNodeView:nodeView];
-            nodeView.connectionHandle = handle;
-            
-            [_createHandles insertObject:handle atIndex:handle.tag];
-            
-            // Reindex remaining handles
-            for (NSInteger i = handle.tag; i < _createHandles.count; i++) {
-                ((TBCanvasCreateHandleView *)_createHandles[i]).tag = i;
-            }
-            
-            // Add new connection handle to node view.
-            [self addSubview:handle];
+        if (isInConnectMode && CGRectIntersectsRect(nodeView.frame, [self visibleCanvasRect])) {
+            [self makeCreateHandleForNodeView:nodeView];
         }
         
         [self sizeCanvasToFit];
+        
+        if (_showingClusters) {
+            [self layoutClusters];
+        }
     }
 }
 
@@ -785,6 +1473,7 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     nodeView = [self nodeAtIndexPath:indexPath];
     
     if (nodeView) {
+        TBCanvasSection *canvasSection = _sections[indexPath.section];
         
         // Expand node when collapsed.
         if (nodeView.hasCollapsedSubStructure) {
@@ -802,12 +1491,12 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
             [parentConnection.parentNode.childConnections removeObject:parentConnection];
             
             // Remove move handle
-            TBCanvasMoveHandleView *handle = parentConnection.moveConnectionHandle;
-            [handle removeFromSuperview];
-            [_moveHandles removeObject:handle];
+            if (parentConnection.moveConnectionHandle) {
+                [self recycleMoveHandle:parentConnection.moveConnectionHandle];
+            }
             
             // Remove connection
-            [_connectionViews removeObject:parentConnection];
+            [canvasSection removeConnectionView:parentConnection];
         }
         for (TBCanvasConnectionView *childConnection in nodeView.childConnections) {
             [childConnection removeFromSuperview];
@@ -819,40 +1508,53 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
             [childConnection.childNode.parentConnections removeObject:childConnection];
             
             // Remove move handle
-            TBCanvasMoveHandleView *handle = childConnection.moveConnectionHandle;
-            [handle removeFromSuperview];
-            [_moveHandles removeObject:handle];
+            if (childConnection.moveConnectionHandle) {
+                [self recycleMoveHandle:childConnection.moveConnectionHandle];
+            }
             
             // Remove connection
-            [_connectionViews removeObject:childConnection];
+            [canvasSection removeConnectionView:childConnection];
         }
         
-        [_nodeViews removeObjectAtIndex:indexPath.row];
-        
-        // Reindex remaining node views
-        for (NSInteger i = indexPath.row; i < _nodeViews.count; i++) {
-            ((TBCanvasNodeView *)_nodeViews[i]).tag = i;
-        }
+        // Shift the tags of the remaining node views
+        [canvasSection removeNodeViewAtIndex:indexPath.row];
+        [_syncEngine invalidateSection:indexPath.section];
+        [_selectedNodeViews removeObject:nodeView];
+        [_promotedNodeViews removeObject:nodeView];
+        [self shiftHighlightedIndexesInSection:indexPath.section startingAtIndex:indexPath.row + 1 by:-1];
         
         // Remove new connection handle if necessary.
-        if (isInConnectMode) {
-            TBCanvasCreateHandleView *handle = _createHandles[nodeView.tag];
-            [handle removeFromSuperview];
-            [_createHandles removeObjectAtIndex:nodeView.tag];
-            
-            // Reindex remaining handles
-            for (NSInteger i = handle.tag; i < _createHandles.count; i++) {
-                ((TBCanvasCreateHandleView *)_createHandles[i]).tag = i;
-            }
+        if (nodeView.connectionHandle) {
+            [self recycleCreateHandle:nodeView.connectionHandle];
         }
         
         [nodeView removeFromSuperview];
+        [self layoutHighlights];
+        
+        if (_showingClusters) {
+            [self layoutClusters];
+        }
+    }
+}
+
+- (void)setEditing:(BOOL)editing forNodeAtIndexPath:(NSIndexPath *)indexPath
+{
+    TBCanvasNodeView *nodeView = [self nodeAtIndexPath:indexPath];
+    
+    if (editing) {
+        [self promoteNodeViews:@[nodeView]];
+    }
+    [nodeView setEditing:editing];
+    
+    if (editing == NO) {
+        [self demoteNodeViews];
     }
 }
 
 - (TBCanvasNodeView *)nodeAtIndexPath:(NSIndexPath *)indexPath
 {
-    return _nodeViews[indexPath.row];
+    TBCanvasSection *canvasSection = _sections[indexPath.section];
+    return canvasSection.nodeViews[indexPath.row];
 }
 
 
@@ -862,50 +1564,108 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
 {
     if (isInConnectMode) {
         [self removeConnectionHandles];
+        isInConnectMode = NO;
     } else {
-        [self addConnectionHandles];
+        isInConnectMode = YES;
+        [self layoutConnectionHandles];
+    }
+}
+
+- (CGRect)visibleCanvasRect
+{
+    if (self.scrollView == nil) {
+        return CGRectInfinite;
     }
-    isInConnectMode = !isInConnectMode;
+    
+    CGRect bounds = self.scrollView.bounds;
+    CGRect visibleRect = CGRectMake(bounds.origin.x / zoomScale, bounds.origin.y / zoomScale, bounds.size.width / zoomScale, bounds.size.height / zoomScale);
+    
+    return CGRectInset(visibleRect, -OUTER_CANVAS_MARGIN, -OUTER_CANVAS_MARGIN);
 }
 
-- (void)addConnectionHandles
+- (void)layoutConnectionHandles
 {
-    // Add  TBCanvasCreateHandles
-    for (TBCanvasNodeView *nodeView in _nodeViews) {
+    if (isInConnectMode == NO) {
+        return;
+    }
+    
+    // Node views are replaced by clusters. There is nothing to connect.
+    if (_showingClusters) {
+        [self removeConnectionHandles];
+        return;
+    }
+    
+    TB_CANVAS_SCOPED_TIMER("layoutConnectionHandles");
+    
+    CGRect visibleRect = [self visibleCanvasRect];
+    
+    // Recycle handles of items which left the visible rect or have been collapsed. Keep handles of touched items.
+    for (TBCanvasCreateHandleView *handle in [_createHandles copy]) {
+        TBCanvasNodeView *nodeView = handle.nodeView;
         
-        if (nodeView.isInCollapsedSegment == NO) {
-            
-            TBCanvasCreateHandleView *handle = [self makeCreateHandleForNodeView:nodeView];
-            nodeView.connectionHandle = handle;
-            [_createHandles addObject:handle];
-            
-            [self addSubview:handle];
+        if ([self interactionForItemView:handle] || [self interactionForItemView:nodeView]) {
+            continue;
+        }
+        if (nodeView.superview != self || nodeView.isInCollapsedSegment || CGRectIntersectsRect(nodeView.frame, visibleRect) == NO) {
+            [self recycleCreateHandle:handle];
         }
     }
     
-    // Add  TBCanvasMoveHandles
-    for (TBCanvasConnectionView *connection in _connectionViews) {
+    for (TBCanvasMoveHandleView *handle in [_moveHandles copy]) {
+        TBCanvasConnectionView *connection = handle.connection;
         
-        if (connection.isInCollapsedSegment == NO) {
-            
-            TBCanvasMoveHandleView *handle = [self makeMoveConnectionHandleForConnection:connection];
-            connection.moveConnectionHandle = handle;
-            [_moveHandles addObject:handle];
+        if ([self interactionForItemView:handle] || [self interactionForItemView:connection.parentNode] || [self interactionForItemView:connection.childNode]) {
+            continue;
+        }
+        if (connection.superview != self || connection.isValid == NO || connection.isInCollapsedSegment || CGRectIntersectsRect(connection.childNode.frame, visibleRect) == NO) {
+            [self recycleMoveHandle:handle];
+        }
+    }
+    
+    // Add handles to visible items. Sections outside the visible rect are skipped entirely.
+    for (TBCanvasSection *canvasSection in _sections) {
+        if (CGRectIntersectsRect(canvasSection.bounds, visibleRect) == NO) {
+            continue;
+        }
+        
+        for (TBCanvasNodeView *nodeView in [canvasSection nodeViewsInRect:visibleRect]) {
+            if (nodeView.isInCollapsedSegment) {
+                continue;
+            }
+            if (nodeView.connectionHandle == nil) {
+                [self makeCreateHandleForNodeView:nodeView];
+            }
             
-            [self addSubview:handle];
+            // The move handle of a connection sits at its child node.
+            for (TBCanvasConnectionView *connection in nodeView.parentConnections) {
+                if (connection.moveConnectionHandle == nil && connection.isValid && connection.isInCollapsedSegment == NO) {
+                    [self makeMoveConnectionHandleForConnection:connection];
+                }
+            }
         }
     }
 }
 
 - (TBCanvasCreateHandleView *)makeCreateHandleForNodeView:(TBCanvasNodeView *)nodeView
 {
-    CGPoint handleCenter = [self convertPoint:nodeView.connectionHandleAncorPoint toView:self];
+    CGPoint handleCenter = nodeView.connectionHandleAncorPoint;
     
-    TBCanvasCreateHandleView *handle = [self.canvasViewDataSource collectionCanvasContentView:self newHandleForConnectionAtPoint:handleCenter];
+    TBCanvasCreateHandleView *handle = _reusableCreateHandles.lastObject;
+    if (handle) {
+        [_reusableCreateHandles removeLastObject];
+        handle.center = handleCenter;
+    } else {
+        TB_CANVAS_COUNT("handleAllocation");
+        handle = [self.canvasViewDataSource collectionCanvasContentView:self newHandleForConnectionAtPoint:handleCenter];
+    }
     handle.zoomScale = zoomScale;
     handle.nodeView = nodeView;
     handle.delegate = self;
     
+    nodeView.connectionHandle = handle;
+    [_createHandles addObject:handle];
+    [self addSubview:handle];
+    
     return handle;
 }
 
@@ -913,65 +1673,956 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
 {
     CGPoint handleCenter = [self convertPoint:connection.visibleEndPoint fromView:connection];
     
-    TBCanvasMoveHandleView *handle = [self.canvasViewDataSource collectionCanvasContentView:self moveHandleForConnectionAtPoint:handleCenter];
+    TBCanvasMoveHandleView *handle = _reusableMoveHandles.lastObject;
+    if (handle) {
+        [_reusableMoveHandles removeLastObject];
+        handle.center = handleCenter;
+    } else {
+        TB_CANVAS_COUNT("handleAllocation");
+        handle = [self.canvasViewDataSource collectionCanvasContentView:self moveHandleForConnectionAtPoint:handleCenter];
+    }
     handle.zoomScale = zoomScale;
     handle.connection = connection;
     handle.delegate = self;
     
+    connection.moveConnectionHandle = handle;
+    [_moveHandles addObject:handle];
+    [self addSubview:handle];
+    
     return handle;
 }
 
-
-- (void)removeConnectionHandles
+- (void)recycleCreateHandle:(TBCanvasCreateHandleView *)handle
 {
-    [_createHandles makeObjectsPerformSelector:@selector(removeFromSuperview)];
-    [_createHandles removeAllObjects];
+    [handle removeFromSuperview];
     
-    [_moveHandles makeObjectsPerformSelector:@selector(removeFromSuperview)];
-    [_moveHandles removeAllObjects];
+    if (handle.nodeView.connectionHandle == handle) {
+        handle.nodeView.connectionHandle = nil;
+    }
+    handle.nodeView = nil;
+    
+    [_createHandles removeObjectIdenticalTo:handle];
+    [_reusableCreateHandles addObject:handle];
 }
 
-#pragma mark - Drawing connections
+- (void)recycleMoveHandle:(TBCanvasMoveHandleView *)handle
+{
+    [handle removeFromSuperview];
+    
+    if (handle.connection.moveConnectionHandle == handle) {
+        handle.connection.moveConnectionHandle = nil;
+    }
+    handle.connection = nil;
+    
+    [_moveHandles removeObjectIdenticalTo:handle];
+    [_reusableMoveHandles addObject:handle];
+}
 
-- (void)refreshConnectionsForView:(TBCanvasNodeView *)canvasNodeView
+- (void)removeConnectionHandles
 {
-    [self refreshConnections:canvasNodeView.parentConnections];
-    [self refreshConnections:canvasNodeView.childConnections];
+    for (TBCanvasCreateHandleView *handle in [_createHandles copy]) {
+        [self recycleCreateHandle:handle];
+    }
+    
+    for (TBCanvasMoveHandleView *handle in [_moveHandles copy]) {
+        [self recycleMoveHandle:handle];
+    }
 }
 
-- (void)refreshConnections:(NSMutableArray *)connections
+- (void)moveConnectionHandlesForSegment:(NSArray *)treeSegment
 {
-    for (TBCanvasConnectionView *canvasNodeConnection in connections) {
-        [canvasNodeConnection drawConnection];
-        
-        if (isInConnectMode) {
-            if (canvasNodeConnection.isValid) {
-                TBCanvasMoveHandleView *handle = canvasNodeConnection.moveConnectionHandle;
-                handle.center = [self convertPoint:canvasNodeConnection.visibleEndPoint fromView:canvasNodeConnection];
+    if (isInConnectMode == NO) {
+        return;
+    }
+    
+    for (TBCanvasItemView *item in treeSegment) {
+        if ([item isKindOfClass:[TBCanvasNodeView class]]) {
+            TBCanvasNodeView *nodeView = (TBCanvasNodeView *)item;
+            nodeView.connectionHandle.center = nodeView.connectionHandleAncorPoint;
+            
+        } else if ([item isKindOfClass:[TBCanvasConnectionView class]]) {
+            TBCanvasConnectionView *connection = (TBCanvasConnectionView *)item;
+            if (connection.moveConnectionHandle) {
+                connection.moveConnectionHandle.center = [self convertPoint:connection.visibleEndPoint fromView:connection];
             }
         }
     }
 }
 
-- (void)refreshConnectionsOutsideSelection
-{
-    [self refreshConnections:_connectionViewsForFullRefresh];
-}
+#pragma mark - Clustering
 
-- (void)moveConnectionsForItemView:(TBCanvasItemView *)itemView
+- (void)layoutClusters
 {
-    if ([itemView isKindOfClass:[TBCanvasNodeView class]]) {
-        [self refreshConnectionsForView:(TBCanvasNodeView *)itemView];
-        
-    } else {
+    TB_CANVAS_SCOPED_TIMER("layoutClusters");
+    
+    BOOL showClusters = (_clusteringZoomScale > 0.0 && zoomScale < _clusteringZoomScale && _sections.count > 0);
+    
+    // Only the transition touches every item. While zoomed out or in, the items stay as they are.
+    if (showClusters != _showingClusters) {
+        _showingClusters = showClusters;
+        [self setItemViewsHidden:(showClusters || _tiledRenderingEnabled) inSections:_sections];
+        _tiledView.hidden = showClusters;
         
-        TBCanvasConnectionView *connection = nil;
+        if (showClusters) {
+            [self removeConnectionHandles];
+            [self deselectAllNodes];
+            [self hideMenu];
+        } else {
+            [self promoteNodeViews:_promotedNodeViews.allObjects];
+        }
+    }
+    
+    NSUInteger clusterCount = 0;
+    CGMutablePathRef paths[CLUSTER_BUNDLE_WIDTHS];
+    for (NSUInteger i = 0; i < CLUSTER_BUNDLE_WIDTHS; i++) {
+        paths[i] = CGPathCreateMutable();
+    }
+    
+    if (_showingClusters) {
+        CGRect visibleRect = [self visibleCanvasRect];
+        
+        for (TBCanvasSection *canvasSection in _sections) {
+            if (CGRectIntersectsRect(canvasSection.bounds, visibleRect) == NO) {
+                continue;
+            }
+            
+            TBCanvasClusterIndex *clusterIndex = canvasSection.clusterIndex;
+            NSUInteger level = [clusterIndex levelForClusterSize:CLUSTER_SCREEN_SIZE / zoomScale];
+            NSMutableSet *drawnCellKeys = [[NSMutableSet alloc] init];
+            
+            for (TBCanvasCluster *cluster in [clusterIndex clustersAtLevel:level inRect:visibleRect]) {
+                TBCanvasClusterView *clusterView = [self clusterViewAtIndex:clusterCount++];
+                clusterView.frame = cluster.bounds;
+                clusterView.count = cluster.count;
+                if (clusterView.zoomScale != zoomScale) {
+                    clusterView.zoomScale = zoomScale;
+                }
+                
+                // Connections inside a cluster are hidden. Connections between clusters are drawn once per pair of clusters.
+                CGPoint centroid = cluster.centroid;
+                NSDictionary *bundles = cluster.bundles;
+                for (NSNumber *cellKey in bundles) {
+                    if ([drawnCellKeys containsObject:cellKey]) {
+                        continue;
+                    }
+                    TBCanvasCluster *otherCluster = [clusterIndex clusterWithCellKey:cellKey.longLongValue atLevel:level];
+                    if (otherCluster == nil) {
+                        continue;
+                    }
+                    
+                    NSUInteger width = MIN((NSUInteger)log2([bundles[cellKey] doubleValue]), CLUSTER_BUNDLE_WIDTHS - 1);
+                    CGPoint otherCentroid = otherCluster.centroid;
+                    CGPathMoveToPoint(paths[width], NULL, centroid.x, centroid.y);
+                    CGPathAddLineToPoint(paths[width], NULL, otherCentroid.x, otherCentroid.y);
+                }
+                [drawnCellKeys addObject:@(cluster.cellKey)];
+            }
+        }
+    }
+    
+    // Recycle cluster views which are not needed anymore.
+    while (_clusterViews.count > clusterCount) {
+        TBCanvasClusterView *clusterView = _clusterViews.lastObject;
+        [clusterView removeFromSuperview];
+        [_clusterViews removeLastObject];
+        [_reusableClusterViews addObject:clusterView];
+    }
+    
+    for (NSUInteger i = 0; i < CLUSTER_BUNDLE_WIDTHS; i++) {
+        CAShapeLayer *bundleLayer = _bundleLayers[i];
+        bundleLayer.lineWidth = (1.0 + 2.0 * i) / zoomScale;
+        bundleLayer.path = CGPathIsEmpty(paths[i]) ? NULL : paths[i];
+        CGPathRelease(paths[i]);
+    }
+}
+
+- (void)setItemViewsHidden:(BOOL)hidden inSections:(NSArray *)sections
+{
+    for (TBCanvasSection *canvasSection in sections) {
+        for (TBCanvasNodeView *nodeView in canvasSection.nodeViews) {
+            nodeView.hidden = hidden;
+        }
+        for (TBCanvasConnectionView *connection in canvasSection.connectionViews) {
+            connection.hidden = hidden;
+        }
+    }
+}
+
+- (TBCanvasClusterView *)clusterViewAtIndex:(NSUInteger)index
+{
+    if (index < _clusterViews.count) {
+        return _clusterViews[index];
+    }
+    
+    TBCanvasClusterView *clusterView = _reusableClusterViews.lastObject;
+    if (clusterView) {
+        [_reusableClusterViews removeLastObject];
+    } else {
+        TB_CANVAS_COUNT("clusterViewAllocation");
+        clusterView = [[TBCanvasClusterView alloc] initWithFrame:CGRectZero];
+    }
+    [_clusterViews addObject:clusterView];
+    [self addSubview:clusterView];
+    return clusterView;
+}
+
+#pragma mark - Tiled rendering
+
+- (void)setTiledRenderingEnabled:(BOOL)tiledRenderingEnabled
+{
+    if (tiledRenderingEnabled == _tiledRenderingEnabled) {
+        return;
+    }
+    _tiledRenderingEnabled = tiledRenderingEnabled;
+    
+    if (_tiledRenderingEnabled) {
+        _tiledView = [[TBCanvasTiledView alloc] initWithFrame:self.bounds];
+        _tiledView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
+        _tiledView.hidden = _showingClusters;
+        [self insertSubview:_tiledView atIndex:0];
+        
+        for (TBCanvasSection *canvasSection in _sections) {
+            [self attachRenderModelToSection:canvasSection];
+        }
+        [self updateRenderModelsOfTiledView];
+        
+        [self setItemViewsHidden:YES inSections:_sections];
+        [self promoteCollapsedNodeViewsInSections:_sections];
+        [self layoutTiles];
+        
+    } else {
+        for (TBCanvasSection *canvasSection in _sections) {
+            canvasSection.renderModel = nil;
+        }
+        [_promotedNodeViews removeAllObjects];
+        [_tiledView removeFromSuperview];
+        _tiledView = nil;
         
-        if ([itemView isKindOfClass:[TBCanvasCreateHandleView class]]) {
-            connection = _temporaryConnectionView;
-        } else if ([itemView isKindOfClass:[TBCanvasMoveHandleView class]]) {
-            connection = _selectedConnectionView;
+        [self setItemViewsHidden:_showingClusters inSections:_sections];
+    }
+}
+
+- (void)attachRenderModelToSection:(TBCanvasSection *)canvasSection
+{
+    __weak TBCollectionCanvasContentView *weakSelf = self;
+    
+    TBCanvasRenderModel *renderModel = [[TBCanvasRenderModel alloc] init];
+    renderModel.invalidationHandler = ^(CGRect rect) {
+        [weakSelf invalidateTilesInRect:rect];
+    };
+    canvasSection.renderModel = renderModel;
+}
+
+- (void)updateRenderModelsOfTiledView
+{
+    if (_tiledView == nil) {
+        return;
+    }
+    
+    NSMutableArray *renderModels = [[NSMutableArray alloc] init];
+    for (TBCanvasSection *canvasSection in _sections) {
+        if (canvasSection.renderModel) {
+            [renderModels addObject:canvasSection.renderModel];
+        }
+    }
+    _tiledView.renderModels = renderModels;
+    [_tiledView setNeedsDisplay];
+}
+
+- (void)invalidateTilesInRect:(CGRect)rect
+{
+    // Sections are reindexed on background threads.
+    if ([NSThread isMainThread] == NO) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self invalidateTilesInRect:rect];
+        });
+        return;
+    }
+    
+    if (_tiledView) {
+        TB_CANVAS_COUNT("tileInvalidation");
+        [_tiledView setNeedsDisplayInRect:rect];
+    }
+}
+
+- (void)layoutTiles
+{
+    if (_tiledRenderingEnabled == NO || _showingClusters) {
+        return;
+    }
+    
+    TB_CANVAS_SCOPED_TIMER("layoutTiles");
+    
+    // Snapshots are taken ahead of scrolling within a margin around the visible rect and kept within twice the margin.
+    CGRect visibleRect = [self visibleCanvasRect];
+    CGRect nearRect = CGRectInset(visibleRect, -visibleRect.size.width * SNAPSHOT_MARGIN, -visibleRect.size.height * SNAPSHOT_MARGIN);
+    CGRect keptRect = CGRectInset(visibleRect, -visibleRect.size.width * SNAPSHOT_MARGIN * 2.0, -visibleRect.size.height * SNAPSHOT_MARGIN * 2.0);
+    
+    for (TBCanvasSection *canvasSection in _sections) {
+        [canvasSection.renderModel removeImagesOutsideRect:keptRect];
+    }
+    
+    // Node views without snapshot are drawn as plain boxes meanwhile.
+    __block NSUInteger snapshotCount = 0;
+    for (NSValue *rect in @[[NSValue valueWithCGRect:visibleRect], [NSValue valueWithCGRect:nearRect]]) {
+        for (TBCanvasSection *canvasSection in _sections) {
+            if (CGRectIntersectsRect(canvasSection.bounds, rect.CGRectValue) == NO) {
+                continue;
+            }
+            
+            [[canvasSection.renderModel indexesWithoutImageInRect:rect.CGRectValue] enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+                if (snapshotCount == SNAPSHOTS_PER_PASS) {
+                    *stop = YES;
+                    return;
+                }
+                [self updateSnapshotOfNodeView:canvasSection.nodeViews[index]];
+                snapshotCount++;
+            }];
         }
+    }
+    
+    if (snapshotCount == SNAPSHOTS_PER_PASS && _tileLayoutScheduled == NO) {
+        _tileLayoutScheduled = YES;
+        
+        __weak TBCollectionCanvasContentView *weakSelf = self;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            weakSelf.tileLayoutScheduled = NO;
+            [weakSelf layoutTiles];
+        });
+    }
+}
+
+- (void)updateSnapshotOfNodeView:(TBCanvasNodeView *)nodeView
+{
+    TBCanvasRenderModel *renderModel = [self sectionForNodeView:nodeView].renderModel;
+    if (renderModel == nil || CGRectIsEmpty(nodeView.bounds)) {
+        return;
+    }
+    
+    TB_CANVAS_COUNT("nodeSnapshot");
+    
+    // Make sure the node view is rendered even while it is hidden.
+    BOOL hidden = nodeView.hidden;
+    nodeView.hidden = NO;
+    
+    UIGraphicsBeginImageContextWithOptions(nodeView.bounds.size, NO, [[UIScreen mainScreen] scale]);
+    [nodeView.layer renderInContext:UIGraphicsGetCurrentContext()];
+    UIImage *snapshot = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    nodeView.hidden = hidden;
+    
+    [renderModel setImage:snapshot.CGImage forIndex:nodeView.tag];
+}
+
+- (void)promoteNodeViews:(NSArray *)itemViews
+{
+    if (_tiledRenderingEnabled == NO || _showingClusters) {
+        return;
+    }
+    
+    for (TBCanvasItemView *item in itemViews) {
+        if ([item isKindOfClass:[TBCanvasNodeView class]] == NO) {
+            continue;
+        }
+        TBCanvasNodeView *nodeView = (TBCanvasNodeView *)item;
+        
+        [_promotedNodeViews addObject:nodeView];
+        nodeView.hidden = NO;
+        for (TBCanvasConnectionView *connection in nodeView.parentConnections) {
+            connection.hidden = NO;
+        }
+        for (TBCanvasConnectionView *connection in nodeView.childConnections) {
+            connection.hidden = NO;
+        }
+        [[self sectionForNodeView:nodeView].renderModel setLive:YES forIndex:nodeView.tag];
+    }
+}
+
+- (void)demoteNodeViews
+{
+    if (_tiledRenderingEnabled == NO || _showingClusters || _interactions.count > 0) {
+        return;
+    }
+    
+    for (TBCanvasNodeView *nodeView in [_promotedNodeViews allObjects]) {
+        if (nodeView.isEditing || nodeView.isInCollapsedSegment || nodeView.hasCollapsedSubStructure) {
+            continue;
+        }
+        [_promotedNodeViews removeObject:nodeView];
+        
+        // The node view may look different now. Take the snapshot before hiding it.
+        [self updateSnapshotOfNodeView:nodeView];
+        nodeView.hidden = YES;
+        
+        // Connections being removed stay visible until their animation has finished.
+        for (TBCanvasConnectionView *connection in nodeView.parentConnections) {
+            connection.hidden = (connection.isValid && [_promotedNodeViews containsObject:connection.parentNode] == NO);
+        }
+        for (TBCanvasConnectionView *connection in nodeView.childConnections) {
+            connection.hidden = (connection.isValid && [_promotedNodeViews containsObject:connection.childNode] == NO);
+        }
+        [[self sectionForNodeView:nodeView].renderModel setLive:NO forIndex:nodeView.tag];
+    }
+}
+
+- (void)promoteCollapsedNodeViewsInSections:(NSArray *)sections
+{
+    if (_tiledRenderingEnabled == NO || _showingClusters) {
+        return;
+    }
+    
+    for (TBCanvasSection *canvasSection in sections) {
+        for (TBCanvasNodeView *nodeView in canvasSection.nodeViews) {
+            if (nodeView.isInCollapsedSegment || nodeView.hasCollapsedSubStructure) {
+                [self promoteNodeViews:@[nodeView]];
+            }
+        }
+    }
+}
+
+- (TBCanvasNodeView *)tiledNodeViewAtPoint:(CGPoint)point
+{
+    CGRect rect = CGRectMake(point.x, point.y, 1.0, 1.0);
+    
+    for (TBCanvasSection *canvasSection in [_sections reverseObjectEnumerator]) {
+        for (TBCanvasNodeView *nodeView in [[canvasSection nodeViewsInRect:rect] reverseObjectEnumerator]) {
+            if (nodeView.isInCollapsedSegment == NO) {
+                return nodeView;
+            }
+        }
+    }
+    return nil;
+}
+
+- (UIView *)hitTest:(CGPoint)point withEvent:(UIEvent *)event
+{
+    UIView *hitView = [super hitTest:point withEvent:event];
+    
+    // Hidden node views are not hit. Hand the touch to the node view under it. It is promoted once the touch has begun.
+    if (_tiledRenderingEnabled && _showingClusters == NO && hitView == self) {
+        TBCanvasNodeView *nodeView = [self tiledNodeViewAtPoint:point];
+        if (nodeView) {
+            return nodeView;
+        }
+    }
+    return hitView;
+}
+
+#pragma mark - Alignment guides
+
+- (CGPoint)snappedLocation:(CGPoint)location ofNodeView:(TBCanvasNodeView *)nodeView
+{
+    if (_snappingEnabled == NO || _showingClusters) {
+        return location;
+    }
+    
+    // The node views moving along with the dragged one must not be snapped to.
+    NSMutableArray *movingNodeViews = [_frameArena borrowArray];
+    if ([self isMovingSelectionWithNodeView:nodeView]) {
+        for (TBCanvasNodeView *selectedNodeView in _selectedNodeViews) {
+            [movingNodeViews addObject:selectedNodeView];
+        }
+    } else {
+        [movingNodeViews addObject:nodeView];
+    }
+    NSUInteger draggedCount = movingNodeViews.count;
+    for (NSUInteger i = 0; i < draggedCount; i++) {
+        TBCanvasNodeView *draggedNodeView = movingNodeViews[i];
+        if (draggedNodeView.hasCollapsedSubStructure) {
+            [movingNodeViews addObjectsFromArray:[self segmentForCanvasNodeView:draggedNodeView]];
+        }
+    }
+    
+    CGRect rect = CGRectOffset(nodeView.frame, location.x - nodeView.center.x, location.y - nodeView.center.y);
+    CGFloat tolerance = _snappingTolerance / zoomScale;
+    
+    TBCanvasAlignment alignments[2] = {{0.0, 0.0, NSNotFound}, {0.0, 0.0, NSNotFound}};
+    CGRect alignedRects[2] = {CGRectNull, CGRectNull};
+    
+    NSMutableIndexSet *excludedIndexes = [_frameArena borrowIndexSet];
+    for (TBCanvasSection *canvasSection in _sections) {
+        [excludedIndexes removeAllIndexes];
+        for (TBCanvasItemView *item in movingNodeViews) {
+            if ([item isKindOfClass:[TBCanvasNodeView class]] && [(TBCanvasNodeView *)item section] == canvasSection.section) {
+                [excludedIndexes addIndex:item.tag];
+            }
+        }
+        
+        for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+            TBCanvasAlignment alignment = [canvasSection.alignmentIndex alignmentOfRect:rect onAxis:axis tolerance:tolerance excludingIndexes:excludedIndexes];
+            if (alignment.index != NSNotFound && (alignments[axis].index == NSNotFound || fabs(alignment.offset) < fabs(alignments[axis].offset))) {
+                alignments[axis] = alignment;
+                alignedRects[axis] = [canvasSection.alignmentIndex rectForIndex:alignment.index];
+            }
+        }
+    }
+    
+    TBCanvasAlignment alignmentX = alignments[TBCanvasAlignmentAxisX];
+    TBCanvasAlignment alignmentY = alignments[TBCanvasAlignmentAxisY];
+    if (alignmentX.index != NSNotFound) {
+        location.x += alignmentX.offset;
+        rect = CGRectOffset(rect, alignmentX.offset, 0.0);
+    }
+    if (alignmentY.index != NSNotFound) {
+        location.y += alignmentY.offset;
+        rect = CGRectOffset(rect, 0.0, alignmentY.offset);
+    }
+    
+    // Every guide runs from the aligned node view to the dragged one. The guide layers are moved - no path is built per frame.
+    CGFloat lineWidth = 1.0 / zoomScale;
+    for (TBCanvasAlignmentAxis axis = TBCanvasAlignmentAxisX; axis <= TBCanvasAlignmentAxisY; axis++) {
+        CALayer *guideLayer = _guideLayers[axis];
+        if (alignments[axis].index == NSNotFound) {
+            [guideLayer removeFromSuperlayer];
+            continue;
+        }
+        
+        CGRect span = CGRectUnion(rect, alignedRects[axis]);
+        if (axis == TBCanvasAlignmentAxisX) {
+            guideLayer.frame = CGRectMake(alignmentX.guide - lineWidth * 0.5, CGRectGetMinY(span), lineWidth, CGRectGetHeight(span));
+        } else {
+            guideLayer.frame = CGRectMake(CGRectGetMinX(span), alignmentY.guide - lineWidth * 0.5, CGRectGetWidth(span), lineWidth);
+        }
+        if (guideLayer.superlayer == nil) {
+            [self.layer addSublayer:guideLayer];
+        }
+    }
+    return location;
+}
+
+- (void)hideAlignmentGuides
+{
+    [_guideLayers makeObjectsPerformSelector:@selector(removeFromSuperlayer)];
+}
+
+#pragma mark - Exporting the canvas
+
+- (NSArray *)renderModelsForExport
+{
+    NSMutableArray *renderModels = [[NSMutableArray alloc] initWithCapacity:_sections.count];
+    for (TBCanvasSection *section in _sections) {
+        [renderModels addObject:[section renderModelSnapshot]];
+    }
+    return renderModels;
+}
+
+- (void)exportToURL:(NSURL *)url format:(TBCanvasExportFormat)format completion:(void (^)(NSError *error))completion
+{
+    TBCanvasExporter *exporter = [[TBCanvasExporter alloc] initWithRenderModels:[self renderModelsForExport]];
+    [exporter exportToURL:url format:format completion:completion];
+}
+
+#pragma mark - Synchronizing the canvas
+
+- (void)setSyncEngine:(TBCanvasSyncEngine *)syncEngine
+{
+    _syncEngine.contentView = nil;
+    _syncEngine = syncEngine;
+    _syncEngine.contentView = self;
+}
+
+- (void)recordSyncDeltaOfKind:(TBCanvasDeltaKind)kind nodeView:(TBCanvasNodeView *)nodeView childNodeView:(TBCanvasNodeView *)childNodeView
+{
+    if (_syncEngine == nil) {
+        return;
+    }
+    
+    // Deltas store the section in 16 bits. Later sections are not synchronized.
+    if (nodeView.section > UINT16_MAX) {
+        return;
+    }
+    
+    TBCanvasDelta delta;
+    delta.kind = kind;
+    delta.section = (uint16_t)nodeView.section;
+    delta.nodeTag = (int32_t)nodeView.tag;
+    delta.childTag = childNodeView ? (int32_t)childNodeView.tag : -1;
+    delta.location = nodeView.center;
+    delta.clock = 0;
+    delta.site = 0;
+    
+    [_syncEngine recordDelta:delta];
+}
+
+- (void)applySyncDeltas:(const TBCanvasDelta *)deltas count:(NSUInteger)count
+{
+    TB_CANVAS_SCOPED_TIMER("applySyncDeltas");
+    
+    // Moves are applied together after all other edits - the canvas is resized once per batch.
+    NSMutableArray *movedNodeViews = [[NSMutableArray alloc] init];
+    NSMutableArray *locations = [[NSMutableArray alloc] init];
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        TBCanvasDelta delta = deltas[i];
+        
+        // Edits of node views which do not exist on this canvas are dropped.
+        if (delta.section >= _sections.count) {
+            continue;
+        }
+        NSArray *nodeViews = [_sections[delta.section] nodeViews];
+        if (delta.nodeTag < 0 || delta.nodeTag >= (int32_t)nodeViews.count) {
+            continue;
+        }
+        TBCanvasNodeView *nodeView = nodeViews[delta.nodeTag];
+        TBCanvasNodeView *childView = (delta.childTag >= 0 && delta.childTag < (int32_t)nodeViews.count) ? nodeViews[delta.childTag] : nil;
+        
+        switch (delta.kind) {
+            case TBCanvasDeltaKindMoveNode:
+                [movedNodeViews addObject:nodeView];
+                [locations addObject:[NSValue valueWithCGPoint:delta.location]];
+                break;
+                
+            case TBCanvasDeltaKindAddConnection:
+                if (childView && [self connectionFromNodeView:nodeView toNodeView:childView] == nil) {
+                    [self connectNodeView:nodeView toNodeView:childView];
+                }
+                break;
+                
+            case TBCanvasDeltaKindRemoveConnection: {
+                TBCanvasConnectionView *connection = childView ? [self connectionFromNodeView:nodeView toNodeView:childView] : nil;
+                if (connection) {
+                    if (connection.moveConnectionHandle) {
+                        [self recycleMoveHandle:connection.moveConnectionHandle];
+                    }
+                    [self removedConnectionView:connection atIndexPath:connection.indexPath];
+                }
+                break;
+            }
+                
+            case TBCanvasDeltaKindCollapseNode:
+                if (nodeView.hasCollapsedSubStructure == NO) {
+                    [self collapseSegment:nodeView];
+                }
+                break;
+                
+            case TBCanvasDeltaKindExpandNode:
+                if (nodeView.hasCollapsedSubStructure) {
+                    [self expandSegment:nodeView];
+                }
+                break;
+        }
+    }
+    
+    if (movedNodeViews.count > 0) {
+        TBCanvasInteraction *interaction = [[TBCanvasInteraction alloc] initWithItemView:nil];
+        [self beginMovingNodeViews:movedNodeViews interaction:interaction];
+        for (NSUInteger i = 0; i < movedNodeViews.count; i++) {
+            TBCanvasNodeView *nodeView = movedNodeViews[i];
+            CGPoint location = [locations[i] CGPointValue];
+            [self moveNodeViews:@[nodeView] byDelta:CGPointMake(location.x - nodeView.center.x, location.y - nodeView.center.y) interaction:interaction];
+        }
+        [self endMovingNodeViews:movedNodeViews interaction:interaction];
+        
+        if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didMoveNodeAtIndexPath:nodeView:)]) {
+            for (TBCanvasNodeView *nodeView in movedNodeViews) {
+                [_canvasViewDelegate collectionCanvasContentView:self didMoveNodeAtIndexPath:nodeView.indexPath nodeView:nodeView];
+            }
+        }
+    }
+    
+    if (_showingClusters) {
+        [self layoutClusters];
+    }
+    [_frameArena reset];
+}
+
+#pragma mark - Querying the canvas
+
+- (NSIndexSet *)indexesOfNodesReachableFromNodeAtIndexPath:(NSIndexPath *)indexPath direction:(TBCanvasGraphDirection)direction
+{
+    TB_CANVAS_SCOPED_TIMER("queryNodes");
+    
+    TBCanvasSection *canvasSection = _sections[indexPath.section];
+    return [canvasSection.graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:indexPath.row] direction:direction];
+}
+
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section withParentCountInRange:(NSRange)range
+{
+    TB_CANVAS_SCOPED_TIMER("queryNodes");
+    
+    TBCanvasSection *canvasSection = _sections[section];
+    return [canvasSection.graphIndex indexesWithParentCountInRange:range];
+}
+
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section withChildCountInRange:(NSRange)range
+{
+    TB_CANVAS_SCOPED_TIMER("queryNodes");
+    
+    TBCanvasSection *canvasSection = _sections[section];
+    return [canvasSection.graphIndex indexesWithChildCountInRange:range];
+}
+
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section inRect:(CGRect)rect
+{
+    TB_CANVAS_SCOPED_TIMER("queryNodes");
+    
+    TBCanvasSection *canvasSection = _sections[section];
+    return [canvasSection.spatialIndex indexesOfRectsIntersectingRect:CGRectStandardize(rect)];
+}
+
+- (NSIndexSet *)indexesOfNodesInSection:(NSInteger)section whereAttribute:(NSString *)attribute matchesPredicate:(NSPredicate *)predicate
+{
+    TB_CANVAS_SCOPED_TIMER("queryNodes");
+    
+    if ([_canvasViewDataSource respondsToSelector:@selector(collectionCanvasContentView:valuesOfAttribute:inSection:)] == NO) {
+        return [NSIndexSet indexSet];
+    }
+    
+    TBCanvasSection *canvasSection = _sections[section];
+    NSArray *values = [_canvasViewDataSource collectionCanvasContentView:self valuesOfAttribute:attribute inSection:section];
+    NSIndexSet *rows = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, MIN(values.count, canvasSection.nodeViews.count))];
+    
+    // Predicates are immutable - the values are tested concurrently.
+    NSNull *null = [NSNull null];
+    return [values indexesOfObjectsAtIndexes:rows options:NSEnumerationConcurrent passingTest:^BOOL(id value, NSUInteger idx, BOOL *stop) {
+        return (value != null && [predicate evaluateWithObject:value]);
+    }];
+}
+
+- (void)highlightNodesWithIndexes:(NSIndexSet *)indexes inSection:(NSInteger)section
+{
+    if (indexes.count > 0) {
+        _highlightedIndexes[@(section)] = [indexes copy];
+    } else {
+        [_highlightedIndexes removeObjectForKey:@(section)];
+    }
+    [self layoutHighlights];
+}
+
+- (NSIndexSet *)indexesOfHighlightedNodesInSection:(NSInteger)section
+{
+    NSIndexSet *indexes = _highlightedIndexes[@(section)];
+    return indexes ? indexes : [NSIndexSet indexSet];
+}
+
+- (void)removeAllHighlights
+{
+    [_highlightedIndexes removeAllObjects];
+    [self layoutHighlights];
+}
+
+- (void)setHighlightStyle:(TBCanvasHighlightStyle)highlightStyle
+{
+    _highlightStyle = highlightStyle;
+    [self layoutHighlights];
+}
+
+- (void)shiftHighlightedIndexesInSection:(NSInteger)section startingAtIndex:(NSUInteger)index by:(NSInteger)delta
+{
+    NSMutableIndexSet *indexes = [_highlightedIndexes[@(section)] mutableCopy];
+    if (indexes == nil) {
+        return;
+    }
+    [indexes shiftIndexesStartingAtIndex:index by:delta];
+    _highlightedIndexes[@(section)] = indexes;
+}
+
+- (void)invalidateHighlightOfNodeView:(TBCanvasNodeView *)nodeView
+{
+    if (_highlightsNeedLayout || _highlightedIndexes.count == 0) {
+        return;
+    }
+    _highlightsNeedLayout = [_highlightedIndexes[@(nodeView.section)] containsIndex:nodeView.tag];
+}
+
+- (void)layoutHighlights
+{
+    TB_CANVAS_SCOPED_TIMER("layoutHighlights");
+    
+    _highlightsNeedLayout = NO;
+    
+    if (_highlightedIndexes.count == 0) {
+        _highlightLayer.path = nil;
+        [_highlightLayer removeFromSuperlayer];
+        return;
+    }
+    
+    // One path for all highlights. Dimming cuts the union of the highlighted frames out of a rectangle covering the canvas -
+    // overlapping frames would cancel each other out under the even-odd rule.
+    CGMutablePathRef path = CGPathCreateMutable();
+    BOOL dimsOthers = (_highlightStyle == TBCanvasHighlightStyleDimOthers);
+    if (dimsOthers) {
+        CGPathAddRect(path, NULL, self.bounds);
+    }
+    CGFloat outset = dimsOthers ? 0.0 : 4.0 / zoomScale;
+    
+    NSUInteger rectCount = 0;
+    for (NSNumber *section in _highlightedIndexes) {
+        rectCount += [_highlightedIndexes[section] count];
+    }
+    // Highlights are laid out outside of frames too - the frame arena would not be reset afterwards.
+    CGRect *rects = dimsOthers ? malloc(MAX(rectCount, 1) * sizeof(CGRect)) : NULL;
+    rectCount = 0;
+    
+    for (NSNumber *section in _highlightedIndexes) {
+        if (section.unsignedIntegerValue >= _sections.count) {
+            continue;
+        }
+        NSArray *nodeViews = [_sections[section.unsignedIntegerValue] nodeViews];
+        NSIndexSet *indexes = _highlightedIndexes[section];
+        
+        for (NSUInteger index = indexes.firstIndex; index != NSNotFound && index < nodeViews.count; index = [indexes indexGreaterThanIndex:index]) {
+            TBCanvasNodeView *nodeView = nodeViews[index];
+            if (nodeView.isInCollapsedSegment) {
+                continue;
+            }
+            if (dimsOthers) {
+                rects[rectCount++] = nodeView.frame;
+            } else {
+                CGPathAddRect(path, NULL, CGRectInset(nodeView.frame, -outset, -outset));
+            }
+        }
+    }
+    if (dimsOthers) {
+        [self addUnionOfRects:rects count:rectCount toPath:path];
+        free(rects);
+    }
+    
+    [CATransaction begin];
+    [CATransaction setDisableActions:YES];
+    
+    if (_highlightStyle == TBCanvasHighlightStyleDimOthers) {
+        _highlightLayer.fillColor = [UIColor colorWithWhite:0.0 alpha:0.45].CGColor;
+        _highlightLayer.strokeColor = nil;
+    } else {
+        _highlightLayer.fillColor = nil;
+        _highlightLayer.strokeColor = [UIColor colorWithRed:1.0 green:0.6 blue:0.0 alpha:1.0].CGColor;
+        _highlightLayer.lineWidth = 3.0 / zoomScale;
+    }
+    _highlightLayer.path = path;
+    if (_highlightLayer.superlayer == nil) {
+        [self.layer addSublayer:_highlightLayer];
+    }
+    
+    [CATransaction commit];
+    CGPathRelease(path);
+}
+
+- (void)addUnionOfRects:(CGRect *)rects count:(NSUInteger)count toPath:(CGMutablePathRef)path
+{
+    if (count == 0) {
+        return;
+    }
+    
+    // The horizontal bands are bounded by the distinct upper and lower edges of all rectangles.
+    CGFloat *edges = malloc(2 * count * sizeof(CGFloat));
+    NSUInteger edgeCount = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        rects[i] = CGRectStandardize(rects[i]);
+        edges[edgeCount++] = CGRectGetMinY(rects[i]);
+        edges[edgeCount++] = CGRectGetMaxY(rects[i]);
+    }
+    qsort(edges, edgeCount, sizeof(CGFloat), TBCanvasCompareFloats);
+    qsort(rects, count, sizeof(CGRect), TBCanvasCompareRectsByMinY);
+    
+    CGRect *row = malloc(count * sizeof(CGRect));
+    NSUInteger *active = malloc(count * sizeof(NSUInteger));
+    NSUInteger activeCount = 0;
+    NSUInteger next = 0;
+    
+    // The merged spans of the current band and of the pending bands above it - pairs of minimum and maximum x.
+    CGFloat *spans = malloc(2 * count * sizeof(CGFloat));
+    CGFloat *pendingSpans = malloc(2 * count * sizeof(CGFloat));
+    NSUInteger pendingSpanCount = 0;
+    CGFloat pendingTop = 0.0;
+    CGFloat pendingBottom = 0.0;
+    
+    for (NSUInteger e = 0; e + 1 < edgeCount; e++) {
+        CGFloat top = edges[e];
+        CGFloat bottom = edges[e + 1];
+        if (bottom <= top) {
+            continue;
+        }
+        
+        // Keep the rectangles covering the band. Every rectangle ending below top ends at bottom or further down.
+        while (next < count && CGRectGetMinY(rects[next]) <= top) {
+            active[activeCount++] = next++;
+        }
+        NSUInteger rowCount = 0;
+        NSUInteger kept = 0;
+        for (NSUInteger i = 0; i < activeCount; i++) {
+            CGRect rect = rects[active[i]];
+            if (CGRectGetMaxY(rect) > top) {
+                active[kept++] = active[i];
+                row[rowCount++] = rect;
+            }
+        }
+        activeCount = kept;
+        qsort(row, rowCount, sizeof(CGRect), TBCanvasCompareRectsByMinX);
+        
+        // Merge the overlapping spans of the band.
+        NSUInteger spanCount = 0;
+        for (NSUInteger i = 0; i < rowCount;) {
+            CGFloat minX = CGRectGetMinX(row[i]);
+            CGFloat maxX = CGRectGetMaxX(row[i]);
+            for (i++; i < rowCount && CGRectGetMinX(row[i]) <= maxX; i++) {
+                maxX = MAX(maxX, CGRectGetMaxX(row[i]));
+            }
+            if (maxX > minX) {
+                spans[2 * spanCount] = minX;
+                spans[2 * spanCount + 1] = maxX;
+                spanCount++;
+            }
+        }
+        
+        // A band continuing the pending bands with the same spans extends them - the path holds one rectangle per span and run of bands.
+        if (spanCount == pendingSpanCount && pendingBottom == top && memcmp(spans, pendingSpans, 2 * spanCount * sizeof(CGFloat)) == 0) {
+            pendingBottom = bottom;
+            continue;
+        }
+        for (NSUInteger i = 0; i < pendingSpanCount; i++) {
+            CGPathAddRect(path, NULL, CGRectMake(pendingSpans[2 * i], pendingTop, pendingSpans[2 * i + 1] - pendingSpans[2 * i], pendingBottom - pendingTop));
+        }
+        CGFloat *swap = pendingSpans;
+        pendingSpans = spans;
+        spans = swap;
+        pendingSpanCount = spanCount;
+        pendingTop = top;
+        pendingBottom = bottom;
+    }
+    for (NSUInteger i = 0; i < pendingSpanCount; i++) {
+        CGPathAddRect(path, NULL, CGRectMake(pendingSpans[2 * i], pendingTop, pendingSpans[2 * i + 1] - pendingSpans[2 * i], pendingBottom - pendingTop));
+    }
+    
+    free(edges);
+    free(row);
+    free(active);
+    free(spans);
+    free(pendingSpans);
+}
+
+#pragma mark - Drawing connections
+
+- (void)refreshConnectionsForView:(TBCanvasNodeView *)canvasNodeView
+{
+    [self refreshConnections:canvasNodeView.parentConnections];
+    [self refreshConnections:canvasNodeView.childConnections];
+}
+
+- (void)refreshConnections:(id<NSFastEnumeration>)connections
+{
+    for (TBCanvasConnectionView *canvasNodeConnection in connections) {
+        [canvasNodeConnection drawConnection];
+        
+        if (isInConnectMode) {
+            if (canvasNodeConnection.isValid) {
+                TBCanvasMoveHandleView *handle = canvasNodeConnection.moveConnectionHandle;
+                handle.center = [self convertPoint:canvasNodeConnection.visibleEndPoint fromView:canvasNodeConnection];
+            }
+        }
+    }
+}
+
+- (void)moveConnectionsForItemView:(TBCanvasItemView *)itemView
+{
+    if ([itemView isKindOfClass:[TBCanvasNodeView class]]) {
+        [self refreshConnectionsForView:(TBCanvasNodeView *)itemView];
+        
+    } else {
+        
+        // The temporary connection of a create handle or the connection of a move handle.
+        TBCanvasConnectionView *connection = [self interactionForItemView:itemView].connection;
         
         connection.frame =  CGRectMake(connection.parentNode.center.x, connection.parentNode.center.y+20.0,
                                        itemView.center.x - connection.parentNode.center.x,
@@ -992,43 +2643,91 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     [connection.parentNode.childConnections removeObject:connection];
     [connection.childNode.connectedNodes removeObject:connection.parentNode];
     [connection.childNode.parentConnections removeObject:connection];
-    [_connectionViews removeObject:connection];
+    [[self sectionForNodeView:connection.parentNode] removeConnectionView:connection];
+    
+    [self recordSyncDeltaOfKind:TBCanvasDeltaKindRemoveConnection nodeView:connection.parentNode childNodeView:connection.childNode];
     
     if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didRemoveConnectionAtIndexPath:)]) {
         [_canvasViewDelegate collectionCanvasContentView:self didRemoveConnectionAtIndexPath:indexPath];
     }
 }
 
-#pragma mark - Processing multiple items
-
-- (NSMutableArray *)collectSegmentBelowNode:(TBCanvasNodeView *)nodeView
+#pragma mark - Processing multiple items
+
+- (NSMutableArray *)collectSegmentBelowNode:(TBCanvasNodeView *)nodeView
+{
+    TB_CANVAS_SCOPED_TIMER("collectSegment");
+    
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    
+    // Avoid circular references to another parent view, to viewTouched or back to the given node view.
+    NSMutableIndexSet *visitedNodes = [_frameArena borrowIndexSet];
+    [visitedNodes addIndex:nodeView.tag];
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        TBCanvasItemView *viewTouched = interaction.itemView;
+        if ([viewTouched isKindOfClass:[TBCanvasNodeView class]] && ((TBCanvasNodeView *)viewTouched).section == nodeView.section) {
+            [visitedNodes addIndex:viewTouched.tag];
+        }
+    }
+    
+    // Depth first traversal with an explicit stack in the frame arena - keeps the item order of a recursive walk.
+    // Connection handles are not part of a segment. They are derived from their items on demand.
+    NSUInteger stackCapacity = TRAVERSAL_STACK_CAPACITY;
+    NSUInteger stackCount = 1;
+    TBCanvasTraversalFrame *stack = [_frameArena allocateBytes:stackCapacity * sizeof(TBCanvasTraversalFrame)];
+    stack[0].nodeView = nodeView;
+    stack[0].connectionIndex = 0;
+    
+    while (stackCount > 0) {
+        
+        TBCanvasTraversalFrame *frame = &stack[stackCount - 1];
+        TBCanvasNodeView *currentNode = frame->nodeView;
+        
+        if (frame->connectionIndex >= currentNode.childConnections.count) {
+            stackCount--;
+            continue;
+        }
+        TBCanvasConnectionView *connection = currentNode.childConnections[frame->connectionIndex++];
+        if (connection.isValid == NO) {
+            continue;
+        }
+        [array addObject:connection];
+        
+        if ([visitedNodes containsIndex:connection.childNode.tag] == NO) {
+            [visitedNodes addIndex:connection.childNode.tag];
+            [array addObject:connection.childNode];
+            
+            if (stackCount == stackCapacity) {
+                stack = [_frameArena reallocateBytes:stack fromSize:stackCapacity * sizeof(TBCanvasTraversalFrame) toSize:2 * stackCapacity * sizeof(TBCanvasTraversalFrame)];
+                stackCapacity *= 2;
+            }
+            stack[stackCount].nodeView = connection.childNode;
+            stack[stackCount].connectionIndex = 0;
+            stackCount++;
+        }
+    }
+    return array;
+}
+
+- (NSMutableIndexSet *)nodeTagsInSegment:(NSArray *)treeSegment
+{
+    NSMutableIndexSet *nodeTags = [_frameArena borrowIndexSet];
+    for (TBCanvasItemView *item in treeSegment) {
+        if ([item isKindOfClass:[TBCanvasNodeView class]]) {
+            [nodeTags addIndex:item.tag];
+        }
+    }
+    return nodeTags;
+}
+
+- (void)updateSpatialIndexForSegment:(NSArray *)treeSegment
 {
-    NSMutableArray *array = [[NSMutableArray alloc] init];
-    
-    for (TBCanvasConnectionView *connection in nodeView.childConnections) {
-        if (connection.isValid) {
-            [array addObject:connection];
-            
-            // Avoid circular references to another parent view or to viewTouched.
-            if ([array containsObject:connection.childNode] == NO && [_viewsTouched containsObject:connection.childNode] == NO) {
-                [array addObject:connection.childNode];
-                
-                if (isInConnectMode) {
-                    if (connection.childNode.connectionHandle) {
-                        [array addObject:connection.childNode.connectionHandle];
-                    }
-                }
-                
-                [array addObjectsFromArray:[self collectSegmentBelowNode:connection.childNode]];
-            }
-            if (isInConnectMode) {
-                if (connection.moveConnectionHandle) {
-                    [array addObject:connection.moveConnectionHandle];
-                }
-            }
+    for (TBCanvasItemView *item in treeSegment) {
+        if ([item isKindOfClass:[TBCanvasNodeView class]]) {
+            TBCanvasNodeView *nodeView = (TBCanvasNodeView *)item;
+            [[self sectionForNodeView:nodeView] updateNodeView:nodeView];
         }
     }
-    return array;
 }
 
 - (CGRect)segmentRectangleFromSegment:(NSArray *)treeSegment
@@ -1040,16 +2739,33 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     return segmentRect;
 }
 
-- (void)collectConnectionsForFullRefresh
+- (void)collectConnectionsForFullRefreshOfNodeViews:(NSArray *)nodeViews intoArray:(NSMutableArray *)connections
 {
-    for (NSMutableArray *segmentBelowNode in _segmentsBelowNode.allValues) {
+    // A segment holds every valid child connection of its head node and of its node views.
+    // Membership of a connection is therefore a lookup of its parent node tag - no set of the segment items is built.
+    NSMutableIndexSet *segmentMembers = [_frameArena borrowIndexSet];
+    
+    for (TBCanvasNodeView *headNodeView in nodeViews) {
+        NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:headNodeView];
+        BOOL hasMembers = NO;
+        
         for (TBCanvasItemView *nodeItem in segmentBelowNode) {
             if ([nodeItem isKindOfClass:[TBCanvasNodeView class]]) {
                 TBCanvasNodeView *nodeView = (TBCanvasNodeView *)nodeItem;
                 if (nodeView.parentConnections.count > 1) {
+                    if (hasMembers == NO) {
+                        [segmentMembers removeAllIndexes];
+                        [segmentMembers addIndex:headNodeView.tag];
+                        for (TBCanvasItemView *item in segmentBelowNode) {
+                            if ([item isKindOfClass:[TBCanvasNodeView class]]) {
+                                [segmentMembers addIndex:item.tag];
+                            }
+                        }
+                        hasMembers = YES;
+                    }
                     for (TBCanvasConnectionView *parentConnection in nodeView.parentConnections) {
-                        if ([segmentBelowNode containsObject:parentConnection] == NO) {
-                            [_connectionViewsForFullRefresh addObject:parentConnection];
+                        if (parentConnection.isValid == NO || [segmentMembers containsIndex:parentConnection.parentNode.tag] == NO) {
+                            [connections addObject:parentConnection];
                         }
                     }
                 }
@@ -1062,12 +2778,16 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
 
 - (void)collapseSegment:(TBCanvasNodeView *)nodeView
 {
+    TB_CANVAS_SCOPED_TIMER("collapseSegment");
+    
     // Collect collapseable treeSegment
     NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:nodeView];
     nodeView.segmentRect = CGRectUnion(nodeView.frame, [self segmentRectangleFromSegment:segmentBelowNode]);
     nodeView.hasCollapsedSubStructure = YES;
     
-    NSIndexPath *indexPath = [NSIndexPath indexPathForRow:nodeView.tag inSection:0];
+    [self recordSyncDeltaOfKind:TBCanvasDeltaKindCollapseNode nodeView:nodeView childNodeView:nil];
+    
+    NSIndexPath *indexPath = nodeView.indexPath;
     if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didCollapseNodeAtIndexPath:nodeView:)]) {
         [_canvasViewDelegate collectionCanvasContentView:self didCollapseNodeAtIndexPath:indexPath nodeView:nodeView];
     }
@@ -1076,6 +2796,10 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
         [_canvasViewDelegate collectionCanvasContentView:self didCollapseConnectionsBelowNodeView:nodeView atIndexPath:indexPath];
     }
     
+    // Tiles are not animated. The segment slides below the node view as live views.
+    [self promoteNodeViews:@[nodeView]];
+    [self promoteNodeViews:segmentBelowNode];
+    
     // Collapse segment
     for (TBCanvasItemView *nodeItem in segmentBelowNode) {
         
@@ -1100,13 +2824,20 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
         }
     }
     // Redraw connections to external node views.
-    [self collectConnectionsForFullRefresh];
-    [self refreshConnectionsOutsideSelection];
+    NSMutableArray *connections = [_frameArena borrowArray];
+    [self collectConnectionsForFullRefreshOfNodeViews:@[nodeView] intoArray:connections];
+    [self refreshConnections:connections];
     
     [self saveCollapsedSegment:segmentBelowNode];
+    [self updateSpatialIndexForSegment:segmentBelowNode];
     
     [self bringSubviewToFront:nodeView];
     [self sizeCanvasToFit];
+    [self layoutConnectionHandles];
+    if (_showingClusters) {
+        [self layoutClusters];
+    }
+    [_frameArena reset];
 }
 
 - (void)ticktockSegment:(NSArray *)treeSegment
@@ -1139,7 +2870,7 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
             TBCanvasNodeView *nodeView = (TBCanvasNodeView *)item;
             [collapsedNodeViews addObject:nodeView];
             
-            NSIndexPath *indexPath = [NSIndexPath indexPathForRow:item.tag inSection:0];
+            NSIndexPath *indexPath = nodeView.indexPath;
             [collapsedNodeIndexPaths addObject:indexPath];
             
             if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didCollapseConnectionsBelowNodeView:atIndexPath:)]) {
@@ -1157,6 +2888,8 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
 
 - (void)expandSegment:(TBCanvasNodeView *)nodeView
 {
+    TB_CANVAS_SCOPED_TIMER("expandSegment");
+    
     // Collect collapseable treeSegment
     NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:nodeView];
     nodeView.segmentRect = CGRectUnion(nodeView.frame, [self segmentRectangleFromSegment:segmentBelowNode]);
@@ -1165,7 +2898,9 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     [self expandSegment:nodeView headNode:nodeView expandSubNode:YES];
     nodeView.hasCollapsedSubStructure = NO;
     
-    NSIndexPath *indexPath = [NSIndexPath indexPathForRow:nodeView.tag inSection:0];
+    [self recordSyncDeltaOfKind:TBCanvasDeltaKindExpandNode nodeView:nodeView childNodeView:nil];
+    
+    NSIndexPath *indexPath = nodeView.indexPath;
     if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didExpandNodeAtIndexPath:nodeView:)]) {
         [_canvasViewDelegate collectionCanvasContentView:self didExpandNodeAtIndexPath:indexPath nodeView:nodeView];
     }
@@ -1175,13 +2910,25 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     }
     
     // Redraw connections to external node views.
-    [self collectConnectionsForFullRefresh];
-    [self refreshConnectionsOutsideSelection];
+    NSMutableArray *connections = [_frameArena borrowArray];
+    [self collectConnectionsForFullRefreshOfNodeViews:@[nodeView] intoArray:connections];
+    [self refreshConnections:connections];
     
     [self saveExpandedSegment:segmentBelowNode];
+    [self updateSpatialIndexForSegment:segmentBelowNode];
+    
+    // The expanded node views return into the tiles once they have slid into place.
+    if (_tiledRenderingEnabled) {
+        [self performSelector:@selector(demoteNodeViews) withObject:nil afterDelay:SEGMENT_ANIMATION_DURATION];
+    }
     
     [self bringSubviewToFront:nodeView];
     [self sizeCanvasToFit];
+    [self layoutConnectionHandles];
+    if (_showingClusters) {
+        [self layoutClusters];
+    }
+    [_frameArena reset];
 }
 
 - (void)expandItem:(TBCanvasItemView *)item headNode:(TBCanvasNodeView *)headNode expandAsSubnode:(BOOL)expandAsSubnode
@@ -1219,44 +2966,56 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
 
 - (void)expandSegment:(TBCanvasNodeView *)nodeView headNode:(TBCanvasNodeView *)headNode expandSubNode:(BOOL)expandSubnode
 {
-    for (TBCanvasConnectionView *connection in nodeView.childConnections) {
+    // Membership is computed once for the whole segment - not once per level.
+    NSMutableIndexSet *segmentMembers = [self nodeTagsInSegment:[self segmentForCanvasNodeView:nodeView]];
+    NSMutableIndexSet *expandedNodes = [_frameArena borrowIndexSet];
+    [expandedNodes addIndex:nodeView.tag];
+    
+    // Node views to process in pairs with the head node their items are expanded in relation to.
+    NSUInteger stackCapacity = TRAVERSAL_STACK_CAPACITY;
+    NSUInteger stackCount = 2;
+    __unsafe_unretained TBCanvasNodeView **stack = (__unsafe_unretained TBCanvasNodeView **)[_frameArena allocateBytes:stackCapacity * sizeof(TBCanvasNodeView *)];
+    stack[0] = nodeView;
+    stack[1] = headNode;
+    
+    while (stackCount > 0) {
         
-        // Ignore connections outside collapsed segment.
-        if (connection.isInCollapsedSegment) {
+        TBCanvasNodeView *currentNode = stack[stackCount - 2];
+        TBCanvasNodeView *currentHeadNode = stack[stackCount - 1];
+        stackCount -= 2;
+        
+        // Items below a collapsed subnode stay collapsed and follow the subnode.
+        BOOL expandAsSubnode = (expandSubnode && currentHeadNode == headNode);
+        
+        for (TBCanvasConnectionView *connection in currentNode.childConnections) {
             
-            [self expandItem:connection headNode:headNode expandAsSubnode:expandSubnode];
+            // Ignore connections outside collapsed segment.
+            if (connection.isInCollapsedSegment == NO) {
+                continue;
+            }
             
-            // Avoid circular references to another parent view or to viewTouched.
-            NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:nodeView];
-            if ([segmentBelowNode containsObject:connection.childNode]) {
+            [self expandItem:connection headNode:currentHeadNode expandAsSubnode:expandAsSubnode];
+            
+            TBCanvasNodeView *childNode = connection.childNode;
+            
+            // Ignore child nodes outside collapsed segment or already reached through another parent.
+            if ([segmentMembers containsIndex:childNode.tag] && [expandedNodes containsIndex:childNode.tag] == NO && childNode.isInCollapsedSegment) {
+                [expandedNodes addIndex:childNode.tag];
                 
-                // Ignore child nodes outside collapsed segment.
-                //if ((connection.childNode.isInCollapsedSegment) && (connection.childNode.headNodeTag == headNode.tag)) {
-                if (connection.childNode.isInCollapsedSegment) {
-                    [self expandItem:connection.childNode headNode:headNode expandAsSubnode:expandSubnode];
-                    
-                    if (isInConnectMode) {
-                        [self expandItem:connection.childNode.connectionHandle headNode:headNode expandAsSubnode:expandSubnode];
-                    }
-                    
-                    if (expandSubnode == YES) {
-                        
-                        // Expand items in relation to subnode.
-                        if (connection.childNode.hasCollapsedSubStructure == NO) {
-                            [self expandSegment:connection.childNode headNode:headNode expandSubNode:YES];
-                        } else {
-                            [self expandSegment:connection.childNode headNode:connection.childNode expandSubNode:NO];
-                        }
-                        
-                    } else {
-                        
-                        // Expand items in relation to head node.
-                        [self expandSegment:connection.childNode headNode:headNode expandSubNode:NO];
-                    }
+                [self expandItem:childNode headNode:currentHeadNode expandAsSubnode:expandAsSubnode];
+                
+                if (stackCount == stackCapacity) {
+                    stack = (__unsafe_unretained TBCanvasNodeView **)[_frameArena reallocateBytes:stack fromSize:stackCapacity * sizeof(TBCanvasNodeView *) toSize:2 * stackCapacity * sizeof(TBCanvasNodeView *)];
+                    stackCapacity *= 2;
+                }
+                stack[stackCount++] = childNode;
+                
+                // Expand items in relation to the subnode when it is collapsed too.
+                if (expandAsSubnode && childNode.hasCollapsedSubStructure) {
+                    stack[stackCount++] = childNode;
+                } else {
+                    stack[stackCount++] = currentHeadNode;
                 }
-            }
-            if (isInConnectMode) {
-                [self expandItem:connection.moveConnectionHandle headNode:headNode expandAsSubnode:expandSubnode];
             }
         }
     }
@@ -1276,7 +3035,7 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
             
             [expandedNodeViews addObject:nodeView];
             
-            NSIndexPath *indexPath = [NSIndexPath indexPathForRow:nodeView.tag inSection:0];
+            NSIndexPath *indexPath = nodeView.indexPath;
             [expandedNodeIndexPaths addObject:indexPath];
             
             if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didExpandConnectionsBelowNodeView:atIndexPath:)]) {
@@ -1290,6 +3049,290 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     }
 }
 
+#pragma mark - Selecting multiple nodes
+
+- (void)setSelectionMode:(TBCanvasSelectionMode)selectionMode
+{
+    _selectionMode = selectionMode;
+    self.scrollView.scrollEnabled = (selectionMode == TBCanvasSelectionModeNone);
+}
+
+- (NSMutableArray *)visibleNodeViewsInRect:(CGRect)rect
+{
+    NSMutableArray *nodeViews = [[NSMutableArray alloc] init];
+    
+    for (TBCanvasSection *canvasSection in _sections) {
+        if (CGRectIntersectsRect(canvasSection.bounds, rect) == NO) {
+            continue;
+        }
+        
+        for (TBCanvasNodeView *nodeView in [canvasSection nodeViewsInRect:rect]) {
+            if (nodeView.isInCollapsedSegment == NO) {
+                [nodeViews addObject:nodeView];
+            }
+        }
+    }
+    return nodeViews;
+}
+
+- (NSArray *)selectNodesInRect:(CGRect)rect
+{
+    TB_CANVAS_SCOPED_TIMER("selectNodes");
+    
+    return [self selectNodeViews:[self visibleNodeViewsInRect:CGRectStandardize(rect)]];
+}
+
+- (NSArray *)selectNodesInLasso:(UIBezierPath *)lasso
+{
+    TB_CANVAS_SCOPED_TIMER("selectNodes");
+    
+    // The bounding box of the lasso narrows down the candidates. Only their centers are tested against the path.
+    NSMutableArray *nodeViews = [self visibleNodeViewsInRect:lasso.bounds];
+    NSIndexSet *outsideLasso = [nodeViews indexesOfObjectsPassingTest:^BOOL(TBCanvasNodeView *nodeView, NSUInteger idx, BOOL *stop) {
+        return ([lasso containsPoint:nodeView.center] == NO);
+    }];
+    [nodeViews removeObjectsAtIndexes:outsideLasso];
+    
+    return [self selectNodeViews:nodeViews];
+}
+
+- (NSArray *)selectNodeViews:(NSArray *)nodeViews
+{
+    [self deselectAllNodes];
+    
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        [nodeView setSelected:YES];
+        [_selectedNodeViews addObject:nodeView];
+    }
+    
+    NSArray *indexPaths = [self indexPathsForSelectedNodes];
+    if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didSelectNodesAtIndexPaths:)]) {
+        [_canvasViewDelegate collectionCanvasContentView:self didSelectNodesAtIndexPaths:indexPaths];
+    }
+    return indexPaths;
+}
+
+- (NSArray *)indexPathsForSelectedNodes
+{
+    NSMutableArray *indexPaths = [[NSMutableArray alloc] initWithCapacity:_selectedNodeViews.count];
+    for (TBCanvasNodeView *nodeView in _selectedNodeViews) {
+        [indexPaths addObject:nodeView.indexPath];
+    }
+    return indexPaths;
+}
+
+- (void)deselectAllNodes
+{
+    for (TBCanvasNodeView *nodeView in _selectedNodeViews) {
+        [nodeView setSelected:NO];
+    }
+    [_selectedNodeViews removeAllObjects];
+}
+
+- (BOOL)isMovingSelectionWithNodeView:(TBCanvasNodeView *)nodeView
+{
+    return (_selectedNodeViews.count > 0 && [_selectedNodeViews containsObject:nodeView]);
+}
+
+- (void)moveSelectedNodesBy:(CGSize)distance
+{
+    if (_selectedNodeViews.count == 0) {
+        return;
+    }
+    NSArray *nodeViews = _selectedNodeViews.array;
+    TBCanvasInteraction *interaction = [[TBCanvasInteraction alloc] initWithItemView:nil];
+    
+    [self beginMovingNodeViews:nodeViews interaction:interaction];
+    [self moveNodeViews:nodeViews byDelta:CGPointMake(distance.width, distance.height) interaction:interaction];
+    [self endMovingNodeViews:nodeViews interaction:interaction];
+    [self notifyDelegateOfMovedNodeViews:nodeViews];
+    
+    if (_showingClusters) {
+        [self layoutClusters];
+    }
+    [_frameArena reset];
+}
+
+- (void)beginMovingNodeViews:(NSArray *)nodeViews interaction:(TBCanvasInteraction *)interaction
+{
+    NSMutableArray *headNodeViews = [_frameArena borrowArray];
+    
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        if (nodeView.hasCollapsedSubStructure) {
+            NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:nodeView];
+            nodeView.segmentRect = CGRectUnion(nodeView.frame, [self segmentRectangleFromSegment:segmentBelowNode]);
+            
+            if (segmentBelowNode.count > 0) {
+                [segmentBelowNode makeObjectsPerformSelector:@selector(setSelected:) withObject:@"YES"];
+            }
+            [headNodeViews addObject:nodeView];
+        }
+    }
+    [self collectConnectionsForFullRefreshOfNodeViews:headNodeViews intoArray:interaction.connectionsForFullRefresh];
+}
+
+- (void)moveNodeViews:(id<NSFastEnumeration>)nodeViews byDelta:(CGPoint)delta interaction:(TBCanvasInteraction *)interaction
+{
+    TB_CANVAS_SCOPED_TIMER("moveSelection");
+    
+    // Connections shared by two moved node views are drawn only once.
+    NSMutableOrderedSet *connections = [_frameArena borrowOrderedSet];
+    
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        nodeView.center = CGPointMake(nodeView.center.x + delta.x, nodeView.center.y + delta.y);
+        nodeView.connectionHandle.center = nodeView.connectionHandleAncorPoint;
+        [[self sectionForNodeView:nodeView] updateNodeView:nodeView];
+        [self invalidateHighlightOfNodeView:nodeView];
+        
+        [connections addObjectsFromArray:nodeView.parentConnections];
+        [connections addObjectsFromArray:nodeView.childConnections];
+        
+        if (nodeView.hasCollapsedSubStructure) {
+            NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:nodeView];
+            
+            for (TBCanvasItemView *item in segmentBelowNode) {
+                if ([_selectedNodeViews containsObject:item] == NO) {
+                    item.center = CGPointMake(item.center.x + delta.x, item.center.y + delta.y);
+                }
+            }
+            [self moveConnectionHandlesForSegment:segmentBelowNode];
+            [self updateSpatialIndexForSegment:segmentBelowNode];
+            
+            nodeView.segmentRect = CGRectOffset(nodeView.segmentRect, delta.x, delta.y);
+        }
+    }
+    [self refreshConnections:connections];
+    [self refreshConnections:interaction.connectionsForFullRefresh];
+}
+
+- (void)endMovingNodeViews:(NSArray *)nodeViews interaction:(TBCanvasInteraction *)interaction
+{
+    // Check if the group is outside left or top border of canvas and correct if necessary.
+    CGPoint correction = CGPointZero;
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        correction.x = MAX(correction.x, OUTER_CANVAS_MARGIN - nodeView.center.x);
+        correction.y = MAX(correction.y, OUTER_CANVAS_MARGIN - nodeView.center.y);
+    }
+    if (correction.x > 0.0 || correction.y > 0.0) {
+        [self moveNodeViews:nodeViews byDelta:correction interaction:interaction];
+    }
+    
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        if (nodeView.hasCollapsedSubStructure) {
+            [[self segmentForCanvasNodeView:nodeView] makeObjectsPerformSelector:@selector(setSelected:) withObject:nil];
+        }
+        
+        if (isInConnectMode) {
+            if (nodeView.connectionHandle) {
+                [self bringSubviewToFront:nodeView.connectionHandle];
+            }
+            for (TBCanvasConnectionView *connectionView in nodeView.parentConnections) {
+                if (connectionView.moveConnectionHandle) {
+                    [self bringSubviewToFront:connectionView.moveConnectionHandle];
+                }
+            }
+        }
+    }
+    [interaction.connectionsForFullRefresh removeAllObjects];
+    
+    [self sizeCanvasToFit];
+    [self layoutConnectionHandles];
+}
+
+- (void)notifyDelegateOfMovedNodeViews:(NSArray *)nodeViews
+{
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        [self recordSyncDeltaOfKind:TBCanvasDeltaKindMoveNode nodeView:nodeView childNodeView:nil];
+    }
+    
+    if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didMoveSegmentOfNodesAtIndexPaths:nodeViews:)] == NO) {
+        return;
+    }
+    
+    NSMutableOrderedSet *movedNodeViews = [[NSMutableOrderedSet alloc] initWithArray:nodeViews];
+    for (TBCanvasNodeView *nodeView in nodeViews) {
+        if (nodeView.hasCollapsedSubStructure) {
+            for (TBCanvasItemView *item in [self segmentForCanvasNodeView:nodeView]) {
+                if ([item isKindOfClass:[TBCanvasNodeView class]]) {
+                    [movedNodeViews addObject:item];
+                }
+            }
+        }
+    }
+    
+    NSMutableArray *indexPaths = [[NSMutableArray alloc] initWithCapacity:movedNodeViews.count];
+    for (TBCanvasNodeView *nodeView in movedNodeViews) {
+        [indexPaths addObject:nodeView.indexPath];
+    }
+    [_canvasViewDelegate collectionCanvasContentView:self didMoveSegmentOfNodesAtIndexPaths:indexPaths nodeViews:movedNodeViews.array];
+}
+
+#pragma mark - Touch handling - selection gesture
+
+- (void)touchesBegan:(NSSet *)touches withEvent:(UIEvent *)event
+{
+    if (_selectionMode == TBCanvasSelectionModeNone || [self isProcessingViews]) {
+        [super touchesBegan:touches withEvent:event];
+        return;
+    }
+    
+    [self hideMenu];
+    
+    selectionOrigin = [[touches anyObject] locationInView:self];
+    self.selectionPath = [UIBezierPath bezierPath];
+    [_selectionPath moveToPoint:selectionOrigin];
+    
+    _selectionLayer.path = nil;
+    [self.layer addSublayer:_selectionLayer];
+}
+
+- (void)touchesMoved:(NSSet *)touches withEvent:(UIEvent *)event
+{
+    if (_selectionPath == nil) {
+        [super touchesMoved:touches withEvent:event];
+        return;
+    }
+    
+    CGPoint location = [[touches anyObject] locationInView:self];
+    
+    if (_selectionMode == TBCanvasSelectionModeRectangle) {
+        CGRect rect = CGRectMake(selectionOrigin.x, selectionOrigin.y, location.x - selectionOrigin.x, location.y - selectionOrigin.y);
+        self.selectionPath = [UIBezierPath bezierPathWithRect:CGRectStandardize(rect)];
+    } else {
+        [_selectionPath addLineToPoint:location];
+    }
+    _selectionLayer.path = _selectionPath.CGPath;
+}
+
+- (void)touchesEnded:(NSSet *)touches withEvent:(UIEvent *)event
+{
+    if (_selectionPath == nil) {
+        [super touchesEnded:touches withEvent:event];
+        return;
+    }
+    
+    if (_selectionMode == TBCanvasSelectionModeRectangle) {
+        [self selectNodesInRect:_selectionPath.bounds];
+    } else {
+        [_selectionPath closePath];
+        [self selectNodesInLasso:_selectionPath];
+    }
+    
+    [_selectionLayer removeFromSuperlayer];
+    self.selectionPath = nil;
+}
+
+- (void)touchesCancelled:(NSSet *)touches withEvent:(UIEvent *)event
+{
+    if (_selectionPath == nil) {
+        [super touchesCancelled:touches withEvent:event];
+        return;
+    }
+    
+    [_selectionLayer removeFromSuperlayer];
+    self.selectionPath = nil;
+}
+
 #pragma mark - Menu handling
 
 - (void)scheduleMenuForItemView:(TBCanvasItemView *)canvasItemView
@@ -1346,206 +3389,531 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
         return (_viewWithMenu.hasCollapsedSubStructure == NO && _viewWithMenu.childConnections.count > 0);
     }
     
-    // expand
-    if (action == @selector(expand:)) {
-        return (_viewWithMenu.hasCollapsedSubStructure && _viewWithMenu.childConnections.count > 0);
+    // expand
+    if (action == @selector(expand:)) {
+        return (_viewWithMenu.hasCollapsedSubStructure && _viewWithMenu.childConnections.count > 0);
+    }
+    
+	if (action == @selector(delete:)) {
+		return YES;
+    }
+    
+    return NO;
+}
+
+- (void)collapse:(id)sender
+{
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseCollapse itemView:_viewWithMenu location:_viewWithMenu.center];
+    
+    [self collapseSegment:_viewWithMenu];
+    
+    // Reset after the animation has finished.
+    [self performSelector:@selector(setViewWithMenu:) withObject:nil afterDelay:0.3];
+}
+
+- (void)expand:(id)sender
+{
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseExpand itemView:_viewWithMenu location:_viewWithMenu.center];
+    
+    [self expandSegment:_viewWithMenu];
+    
+    // Reset after the animation has finished.
+    [self performSelector:@selector(setViewWithMenu:) withObject:nil afterDelay:0.3];
+}
+
+- (void)delete:(id)sender
+{
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseDelete itemView:_viewWithMenu location:_viewWithMenu.center];
+    
+    NSIndexPath *indexPath = _viewWithMenu.indexPath;
+    
+    if (_viewWithMenu.hasCollapsedSubStructure) {
+        [self expandSegment:_viewWithMenu];
+    }
+    
+    [self deleteNodeAtIndexPath:indexPath];
+    
+    if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didDeleteNodeAtIndexPath:)]) {
+        [_canvasViewDelegate collectionCanvasContentView:self didDeleteNodeAtIndexPath:indexPath];
+    }
+}
+
+#pragma mark - Touch handling - external
+
+- (BOOL)isProcessingViews
+{
+    return (_interactions.count > 0);
+}
+
+- (BOOL)isInSingleTouchMode
+{
+    // Every gesture is tracked in an interaction of its own. Other touches are never locked out.
+    return NO;
+}
+
+- (NSMutableArray *)segmentForCanvasNodeView:(TBCanvasNodeView *)canvasNodeView
+{
+    NSNumber *key = TBCanvasSegmentKey(canvasNodeView.section, canvasNodeView.tag);
+    NSMutableArray *segmentBelowNode = _segmentsBelowNode[key];
+    
+    if (segmentBelowNode == nil) {
+        segmentBelowNode = [self collectSegmentBelowNode:canvasNodeView];
+        _segmentsBelowNode[key] = segmentBelowNode;
+    }
+    
+    return segmentBelowNode;
+}
+
+#pragma mark - Touch tracing
+
+- (CGPoint)locationOfTouches:(NSSet *)touches inItemView:(TBCanvasItemView *)itemView
+{
+    CGPoint location = [[touches anyObject] locationInView:self];
+    
+    location.x += itemView.touchOffset.width;
+    location.y += itemView.touchOffset.height;
+    
+    return location;
+}
+
+- (void)endFrame
+{
+    if (_highlightsNeedLayout) {
+        [self layoutHighlights];
     }
     
-	if (action == @selector(delete:)) {
-		return YES;
+    // Node views moved during the frame reach the cluster index once.
+    for (TBCanvasSection *canvasSection in _sections) {
+        [canvasSection updateClusterIndex];
     }
-    
-    return NO;
+    TB_CANVAS_MARK_FRAME();
+    [_frameArena reset];
 }
 
-- (void)collapse:(id)sender
+#pragma mark - Tracking interactions
+
+- (TBCanvasInteraction *)beginInteractionWithItemView:(TBCanvasItemView *)itemView
 {
-    [self collapseSegment:_viewWithMenu];
-    
-    // Reset after the animation has finished.
-    [self performSelector:@selector(setViewWithMenu:) withObject:nil afterDelay:0.3];
+    TBCanvasInteraction *interaction = [[TBCanvasInteraction alloc] initWithItemView:itemView];
+    _interactions[TBCanvasInteractionKey(itemView)] = interaction;
+    return interaction;
 }
 
-- (void)expand:(id)sender
+- (TBCanvasInteraction *)interactionForItemView:(TBCanvasItemView *)itemView
 {
-    [self expandSegment:_viewWithMenu];
-    
-    // Reset after the animation has finished.
-    [self performSelector:@selector(setViewWithMenu:) withObject:nil afterDelay:0.3];
+    return (itemView) ? _interactions[TBCanvasInteractionKey(itemView)] : nil;
 }
 
-- (void)delete:(id)sender
+- (void)endInteraction:(TBCanvasInteraction *)interaction
 {
-    NSIndexPath *indexPath = [NSIndexPath indexPathForRow:_viewWithMenu.tag inSection:0];
+    [_interactions removeObjectForKey:TBCanvasInteractionKey(interaction.itemView)];
     
-    if (_viewWithMenu.hasCollapsedSubStructure) {
-        [self expandSegment:_viewWithMenu];
+    // The remaining gestures keep scrolling.
+    CGPoint distance = [TBCanvasInteraction mergedAutoscrollDistanceOfInteractions:_interactions.objectEnumerator];
+    if (distance.x == 0.0 && distance.y == 0.0) {
+        [_autoscrollTimer invalidate];
+        _autoscrollTimer = nil;
+    }
+}
+
+- (BOOL)isNodeViewMovedByInteraction:(TBCanvasNodeView *)nodeView
+{
+    if (nodeView == nil) {
+        return NO;
     }
     
-    [self deleteNodeAtIndexPath:indexPath];
-    
-    if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didDeleteNodeAtIndexPath:)]) {
-        [_canvasViewDelegate collectionCanvasContentView:self didDeleteNodeAtIndexPath:indexPath];
+    for (TBCanvasInteraction *interaction in _interactions.objectEnumerator) {
+        TBCanvasItemView *itemView = interaction.itemView;
+        
+        // Handles in turn can not be grabbed while a node view of their connection is moved.
+        TBCanvasConnectionView *connection = interaction.connection;
+        if (connection && (connection.parentNode == nodeView || connection.childNode == nodeView)) {
+            return YES;
+        }
+        
+        if ([itemView isKindOfClass:[TBCanvasNodeView class]] == NO) {
+            continue;
+        }
+        if ([self isMovingSelectionWithNodeView:(TBCanvasNodeView *)itemView] && [self isMovingSelectionWithNodeView:nodeView]) {
+            return YES;
+        }
+        if (nodeView.isInCollapsedSegment && [interaction.segment containsObject:nodeView]) {
+            return YES;
+        }
     }
+    return NO;
 }
 
-#pragma mark - Touch handling - external
-
-- (BOOL)isProcessingViews
+- (void)setConnectableNodeView:(TBCanvasNodeView *)nodeView forInteraction:(TBCanvasInteraction *)interaction
 {
-    return (_viewsTouched.count > 0);
+    TBCanvasNodeView *oldNodeView = interaction.connectableNodeView;
+    if (oldNodeView == nodeView) {
+        return;
+    }
+    interaction.connectableNodeView = nodeView;
+    
+    if (nodeView) {
+        [_connectableNodeViews addObject:nodeView];
+        [nodeView setSelected:YES];
+    }
+    if (oldNodeView) {
+        [_connectableNodeViews removeObject:oldNodeView];
+        
+        // Other handle gestures may still target the old node view.
+        if ([_connectableNodeViews countForObject:oldNodeView] == 0 && [self interactionForItemView:oldNodeView] == nil && [_selectedNodeViews containsObject:oldNodeView] == NO) {
+            [oldNodeView setSelected:NO];
+        }
+    }
 }
 
-- (BOOL)isInSingleTouchMode
+- (void)recordTouchTraceEventWithTarget:(TBCanvasTouchTraceTarget)target phase:(TBCanvasTouchTracePhase)phase itemView:(TBCanvasItemView *)itemView location:(CGPoint)location
 {
-    return ((_temporaryConnectionView) || (_selectedConnectionView));
+    if (_touchTrace == nil) {
+        return;
+    }
+    
+    TBCanvasTouchTraceEvent event;
+    event.target = target;
+    event.phase = phase;
+    event.nodeTag = (int32_t)itemView.tag;
+    event.connectionIndex = -1;
+    event.location = location;
+    event.timestamp = 0.0;
+    event.section = 0;
+    
+    if ([itemView isKindOfClass:[TBCanvasNodeView class]]) {
+        event.section = (uint16_t)((TBCanvasNodeView *)itemView).section;
+        
+    } else if ([itemView isKindOfClass:[TBCanvasCreateHandleView class]]) {
+        event.nodeTag = (int32_t)((TBCanvasCreateHandleView *)itemView).nodeView.tag;
+        event.section = (uint16_t)((TBCanvasCreateHandleView *)itemView).nodeView.section;
+        
+    } else if ([itemView isKindOfClass:[TBCanvasMoveHandleView class]]) {
+        TBCanvasConnectionView *connection = ((TBCanvasMoveHandleView *)itemView).connection;
+        event.nodeTag = (int32_t)connection.parentNode.tag;
+        event.section = (uint16_t)connection.parentNode.section;
+        event.connectionIndex = (int32_t)[connection.parentNode.childConnections indexOfObjectIdenticalTo:connection];
+    }
+    
+    [_touchTrace recordEvent:event];
 }
 
-- (NSMutableArray *)segmentForCanvasNodeView:(TBCanvasNodeView *)canvasNodeView
+- (void)processTouchTraceEvent:(TBCanvasTouchTraceEvent)event
 {
-    NSString *key = [NSString stringWithFormat:@"%li", (long)canvasNodeView.tag];
-    NSMutableArray *segmentBelowNode = _segmentsBelowNode[key];
+    if (event.section >= _sections.count) {
+        return;
+    }
+    TBCanvasSection *canvasSection = _sections[event.section];
     
-    if (segmentBelowNode == nil) {
-        segmentBelowNode = [self collectSegmentBelowNode:canvasNodeView];
-        _segmentsBelowNode[key] = segmentBelowNode;
+    if (event.nodeTag < 0 || event.nodeTag >= (int32_t)canvasSection.nodeViews.count) {
+        return;
     }
+    TBCanvasNodeView *nodeView = canvasSection.nodeViews[event.nodeTag];
     
-    return segmentBelowNode;
+    switch (event.target) {
+            
+        case TBCanvasTouchTraceTargetNode:
+            if ([self canProcessCanvasNodeView:nodeView]) {
+                switch (event.phase) {
+                    case TBCanvasTouchTracePhaseBegan:
+                        [self canvasNodeView:nodeView touchBeganAtLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseMoved:
+                        [self canvasNodeView:nodeView touchMovedToLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseEnded:
+                        [self canvasNodeView:nodeView touchEndedAtLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseCancelled:
+                        [self canvasNodeView:nodeView touchCancelledAtLocation:event.location];
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+            
+        case TBCanvasTouchTraceTargetCreateHandle: {
+            TBCanvasCreateHandleView *handle = nodeView.connectionHandle;
+            if (handle && [self canProcessCanvasCreateHandle:handle]) {
+                switch (event.phase) {
+                    case TBCanvasTouchTracePhaseBegan:
+                        [self canvasCreateHandle:handle touchBeganAtLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseMoved:
+                        [self canvasCreateHandle:handle touchMovedToLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseEnded:
+                        [self canvasCreateHandle:handle touchEndedAtLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseCancelled:
+                        [self canvasCreateHandle:handle touchCancelledAtLocation:event.location];
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+        }
+            
+        case TBCanvasTouchTraceTargetMoveHandle: {
+            if (event.connectionIndex < 0 || event.connectionIndex >= (int32_t)nodeView.childConnections.count) {
+                break;
+            }
+            TBCanvasConnectionView *connection = nodeView.childConnections[event.connectionIndex];
+            TBCanvasMoveHandleView *handle = connection.moveConnectionHandle;
+            if (handle && [self canProcessCanvasMoveHandle:handle]) {
+                switch (event.phase) {
+                    case TBCanvasTouchTracePhaseBegan:
+                        [self canvasMoveHandle:handle touchBeganAtLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseMoved:
+                        [self canvasMoveHandle:handle touchMovedToLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseEnded:
+                        [self canvasMoveHandle:handle touchEndedAtLocation:event.location];
+                        break;
+                    case TBCanvasTouchTracePhaseCancelled:
+                        [self canvasMoveHandle:handle touchCancelledAtLocation:event.location];
+                        break;
+                    default:
+                        break;
+                }
+            }
+            break;
+        }
+            
+        case TBCanvasTouchTraceTargetMenu:
+            _viewWithMenu = nodeView;
+            if (event.phase == TBCanvasTouchTracePhaseCollapse && [self canPerformAction:@selector(collapse:) withSender:nil]) {
+                [self collapse:nil];
+            } else if (event.phase == TBCanvasTouchTracePhaseExpand && [self canPerformAction:@selector(expand:) withSender:nil]) {
+                [self expand:nil];
+            } else if (event.phase == TBCanvasTouchTracePhaseDelete) {
+                [self delete:nil];
+            }
+            break;
+    }
 }
 
 #pragma mark - TBCanvasNodeViewDelegate
 
 - (BOOL)canProcessCanvasNodeView:(TBCanvasNodeView *)canvasNodeView
 {
-    return ([self isInSingleTouchMode] == NO);
+    // A node view already being touched keeps its gesture. A new touch must not grab a node view moved by another gesture.
+    if ([self interactionForItemView:canvasNodeView]) {
+        return YES;
+    }
+    return ([self isNodeViewMovedByInteraction:canvasNodeView] == NO);
 }
 
 - (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchesBegan:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    [self hideMenu];
+    [self canvasNodeView:canvasNodeView touchBeganAtLocation:[self locationOfTouches:touches inItemView:canvasNodeView]];
+}
+
+- (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchBeganAtLocation:(CGPoint)location
+{
+    // A further touch on an item view already being dragged joins its gesture.
+    if ([self interactionForItemView:canvasNodeView]) {
+        return;
+    }
     
-    CGPoint location = [[touches anyObject] locationInView:self];
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan itemView:canvasNodeView location:location];
+    
+    [self hideMenu];
     
-    location.x += canvasNodeView.touchOffset.width;
-    location.y += canvasNodeView.touchOffset.height;
+    // Touching a node outside the selection clears the selection - unless another gesture is dragging it.
+    if (_selectedNodeViews.count > 0 && [_selectedNodeViews containsObject:canvasNodeView] == NO && [self isNodeViewMovedByInteraction:_selectedNodeViews.firstObject] == NO) {
+        [self deselectAllNodes];
+    }
     
     // Set view.
-    [_viewsTouched addObject:canvasNodeView];
+    TBCanvasInteraction *interaction = [self beginInteractionWithItemView:canvasNodeView];
+    [self promoteNodeViews:@[canvasNodeView]];
     
     [self bringSubviewToFront:canvasNodeView];
     [canvasNodeView setSelected:YES];
     
-    if (canvasNodeView.hasCollapsedSubStructure) {
+    if ([self isMovingSelectionWithNodeView:canvasNodeView]) {
+        [self promoteNodeViews:_selectedNodeViews.array];
+        [self beginMovingNodeViews:_selectedNodeViews.array interaction:interaction];
         
-        NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:canvasNodeView];
-        canvasNodeView.segmentRect = CGRectUnion(canvasNodeView.frame, [self segmentRectangleFromSegment:segmentBelowNode]);
+    } else {
         
-        if (segmentBelowNode.count > 0) {
-            [segmentBelowNode makeObjectsPerformSelector:@selector(setSelected:) withObject:@"YES"];
+        if (canvasNodeView.hasCollapsedSubStructure) {
+            interaction.segment = [self segmentForCanvasNodeView:canvasNodeView];
+            [self promoteNodeViews:interaction.segment];
         }
+        [self beginMovingNodeViews:@[canvasNodeView] interaction:interaction];
     }
-    [self collectConnectionsForFullRefresh];
     
     if (_menuEnabled) {
         [self scheduleMenuForItemView:canvasNodeView];
     }
+    [_frameArena reset];
 }
 
 - (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchesMoved:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    [self hideMenu];
+    [self canvasNodeView:canvasNodeView touchMovedToLocation:[self locationOfTouches:touches inItemView:canvasNodeView]];
+}
+
+- (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchMovedToLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasNodeView];
+    if (interaction == nil) {
+        return;
+    }
     
-    CGPoint location = [[touches anyObject] locationInView:self];
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved itemView:canvasNodeView location:location];
     
-    location.x += canvasNodeView.touchOffset.width;
-    location.y += canvasNodeView.touchOffset.height;
+    [self hideMenu];
     
+    location = [self snappedLocation:location ofNodeView:canvasNodeView];
     CGPoint delta = CGPointMake(location.x - canvasNodeView.center.x, location.y - canvasNodeView.center.y);
+    
+    if ([self isMovingSelectionWithNodeView:canvasNodeView]) {
+        [self moveNodeViews:_selectedNodeViews byDelta:delta interaction:interaction];
+        interaction.moving = YES;
+        
+        [self killMenuTimer];
+        [self checkAutoScrollingForInteraction:interaction];
+        [self endFrame];
+        return;
+    }
+    
     canvasNodeView.center = location;
-    isMovingCanvasNodeViews = YES;
+    [[self sectionForNodeView:canvasNodeView] updateNodeView:canvasNodeView];
+    [self invalidateHighlightOfNodeView:canvasNodeView];
+    interaction.moving = YES;
     
     [self killMenuTimer];
     
-    if (isInConnectMode) {
-        TBCanvasCreateHandleView *handle = _createHandles[canvasNodeView.tag];
-        handle.center = CGPointMake(canvasNodeView.center.x, canvasNodeView.center.y + (canvasNodeView.frame.size.height / 2.0));
-    }
+    canvasNodeView.connectionHandle.center = canvasNodeView.connectionHandleAncorPoint;
     
-    if (canvasNodeView.hasCollapsedSubStructure) {
+    if (interaction.segment) {
         
-        NSMutableArray *segmentBelowNode = [self segmentForCanvasNodeView:canvasNodeView];
+        NSMutableArray *segmentBelowNode = interaction.segment;
         canvasNodeView.segmentRect = CGRectUnion(canvasNodeView.frame, [self segmentRectangleFromSegment:segmentBelowNode]);
         
         for (TBCanvasItemView *item in segmentBelowNode) {
             item.center = CGPointMake(item.center.x + delta.x, item.center.y + delta.y);
         }
+        [self moveConnectionHandlesForSegment:segmentBelowNode];
+        [self updateSpatialIndexForSegment:segmentBelowNode];
         
         canvasNodeView.segmentRect = CGRectOffset(canvasNodeView.segmentRect, delta.x, delta.y);
         
-        [self refreshConnectionsOutsideSelection];
+        [self refreshConnections:interaction.connectionsForFullRefresh];
     }
     
     [self moveConnectionsForItemView:canvasNodeView];
-    [self checkAutoScrollingForCanvasItemView:canvasNodeView];
+    [self checkAutoScrollingForInteraction:interaction];
+    [self endFrame];
 }
 
 - (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchesEnded:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    CGPoint location = [[touches anyObject] locationInView:self];
-    location.x += canvasNodeView.touchOffset.width;
-    location.y += canvasNodeView.touchOffset.height;
+    [self canvasNodeView:canvasNodeView touchEndedAtLocation:[self locationOfTouches:touches inItemView:canvasNodeView]];
+}
+
+- (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchEndedAtLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasNodeView];
+    if (interaction == nil) {
+        return;
+    }
+    
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded itemView:canvasNodeView location:location];
+    
+    // A tap does not move the node view.
+    if (interaction.isMoving) {
+        location = [self snappedLocation:location ofNodeView:canvasNodeView];
+    }
+    [self hideAlignmentGuides];
+    
+    if ([self isMovingSelectionWithNodeView:canvasNodeView]) {
+        
+        NSArray *nodeViews = _selectedNodeViews.array;
+        [self moveNodeViews:nodeViews byDelta:CGPointMake(location.x - canvasNodeView.center.x, location.y - canvasNodeView.center.y) interaction:interaction];
+        [self endMovingNodeViews:nodeViews interaction:interaction];
+        
+        if (interaction.isMoving) {
+            [self notifyDelegateOfMovedNodeViews:nodeViews];
+            [self scrollTouchedViewToVisible];
+            
+        } else if (_viewWithMenu == nil) {
+            [self killMenuTimer];
+            
+            if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didSelectNodeAtIndexPath:)]) {
+                [_canvasViewDelegate collectionCanvasContentView:self didSelectNodeAtIndexPath:canvasNodeView.indexPath];
+            }
+        }
+        
+        [self endInteraction:interaction];
+        [self demoteNodeViews];
+        [_frameArena reset];
+        return;
+    }
     
     // Check if view is outside left or top border of canvas and correct if necessary.
     location.x = MAX(location.x, OUTER_CANVAS_MARGIN);
     location.y = MAX(location.y, OUTER_CANVAS_MARGIN);
     canvasNodeView.center = location;
+    [[self sectionForNodeView:canvasNodeView] updateNodeView:canvasNodeView];
     
-    NSMutableArray *segmentBelowNode = nil;
-    if (canvasNodeView.hasCollapsedSubStructure) {
-        
-        segmentBelowNode = [self segmentForCanvasNodeView:canvasNodeView];
+    NSMutableArray *segmentBelowNode = interaction.segment;
+    if (segmentBelowNode) {
         canvasNodeView.segmentRect = CGRectUnion(canvasNodeView.frame, [self segmentRectangleFromSegment:segmentBelowNode]);
     }
     
-    if (isMovingCanvasNodeViews == NO) {
+    if (interaction.isMoving == NO) {
         
         if (_viewWithMenu == nil) {
             [self killMenuTimer];
             
             if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didSelectNodeAtIndexPath:)]) {
-                [_canvasViewDelegate collectionCanvasContentView:self didSelectNodeAtIndexPath:[NSIndexPath indexPathForRow:canvasNodeView.tag inSection:0]];
+                [_canvasViewDelegate collectionCanvasContentView:self didSelectNodeAtIndexPath:canvasNodeView.indexPath];
             }
         }
     } else {
         
+        [self recordSyncDeltaOfKind:TBCanvasDeltaKindMoveNode nodeView:canvasNodeView childNodeView:nil];
+        
         if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didMoveNodeAtIndexPath:nodeView:)]) {
-            [_canvasViewDelegate collectionCanvasContentView:self didMoveNodeAtIndexPath:[NSIndexPath indexPathForRow:canvasNodeView.tag inSection:0] nodeView:canvasNodeView];
+            [_canvasViewDelegate collectionCanvasContentView:self didMoveNodeAtIndexPath:canvasNodeView.indexPath nodeView:canvasNodeView];
         }
         
         if (isInConnectMode) {
-            TBCanvasCreateHandleView *handle = _createHandles[canvasNodeView.tag];
-            handle.center = CGPointMake(canvasNodeView.center.x, canvasNodeView.center.y + (canvasNodeView.frame.size.height / 2.0));
-            [self bringSubviewToFront:_createHandles[canvasNodeView.tag]];
+            TBCanvasCreateHandleView *handle = canvasNodeView.connectionHandle;
+            handle.center = canvasNodeView.connectionHandleAncorPoint;
+            if (handle) {
+                [self bringSubviewToFront:handle];
+            }
             
             for (TBCanvasConnectionView *connectionView in canvasNodeView.parentConnections) {
-                [self bringSubviewToFront:connectionView.moveConnectionHandle];
+                if (connectionView.moveConnectionHandle) {
+                    [self bringSubviewToFront:connectionView.moveConnectionHandle];
+                }
             }
         }
         
         [self sizeCanvasToFit];
         [self scrollTouchedViewToVisible];
         
-        if (canvasNodeView.hasCollapsedSubStructure) {
+        if (segmentBelowNode) {
             
             NSMutableArray *segmentOfNodeViews = [[NSMutableArray alloc] init];
+            NSMutableArray *indexPaths = [[NSMutableArray alloc] init];
             for (TBCanvasNodeView *nodeView in segmentBelowNode) {
                 if ([nodeView isKindOfClass:[TBCanvasNodeView class]]) {
                     [segmentOfNodeViews addObject:nodeView];
+                    [indexPaths addObject:nodeView.indexPath];
                 }
             }
             if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didMoveSegmentOfNodesAtIndexPaths:nodeViews:)]) {
-                [_canvasViewDelegate collectionCanvasContentView:self didMoveSegmentOfNodesAtIndexPaths:nil nodeViews:segmentOfNodeViews];
+                [_canvasViewDelegate collectionCanvasContentView:self didMoveSegmentOfNodesAtIndexPaths:indexPaths nodeViews:segmentOfNodeViews];
             }
         }
     }
@@ -1553,379 +3921,405 @@ static CGFloat AUTOSCROLL_MARGIN        =  1.0;
     [segmentBelowNode makeObjectsPerformSelector:@selector(setSelected:) withObject:nil];
     
     [self moveConnectionsForItemView:canvasNodeView];
-    [_connectionViewsForFullRefresh removeAllObjects];
     
     [canvasNodeView setSelected:NO];
     
-    isMovingCanvasNodeViews = NO;
-    [_autoscrollTimer invalidate];
-    
-    [_viewsTouched removeObject:canvasNodeView];
-    [_autoscrollingItems removeObject:canvasNodeView];
+    [self endInteraction:interaction];
+    [self demoteNodeViews];
+    [_frameArena reset];
 }
 
 - (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchesCancelled:(NSSet *)touches withEvent:(UIEvent *)event
 {
+    [self canvasNodeView:canvasNodeView touchCancelledAtLocation:[self locationOfTouches:touches inItemView:canvasNodeView]];
+}
+
+- (void)canvasNodeView:(TBCanvasNodeView *)canvasNodeView touchCancelledAtLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasNodeView];
+    if (interaction == nil) {
+        return;
+    }
+    
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseCancelled itemView:canvasNodeView location:location];
+    
+    [self hideAlignmentGuides];
+    
+    if ([self isMovingSelectionWithNodeView:canvasNodeView]) {
+        [self endMovingNodeViews:_selectedNodeViews.array interaction:interaction];
+        [self scrollTouchedViewToVisible];
+        
+        [self endInteraction:interaction];
+        [self demoteNodeViews];
+        [_frameArena reset];
+        return;
+    }
+    
     [self moveConnectionsForItemView:canvasNodeView];
     
-    TBCanvasCreateHandleView *handle = _createHandles[canvasNodeView.tag];
-    handle.center = CGPointMake(canvasNodeView.center.x, canvasNodeView.center.y + (canvasNodeView.frame.size.height / 2.0));
-    [self bringSubviewToFront:_createHandles[canvasNodeView.tag]];
+    TBCanvasCreateHandleView *handle = canvasNodeView.connectionHandle;
+    handle.center = canvasNodeView.connectionHandleAncorPoint;
+    if (handle) {
+        [self bringSubviewToFront:handle];
+    }
     
     for (TBCanvasConnectionView *connectionView in canvasNodeView.parentConnections) {
-        [self bringSubviewToFront:connectionView.moveConnectionHandle];
+        if (connectionView.moveConnectionHandle) {
+            [self bringSubviewToFront:connectionView.moveConnectionHandle];
+        }
     }
     
     [self sizeCanvasToFit];
     [self scrollTouchedViewToVisible];
     
-    [_viewsTouched removeObject:canvasNodeView];
-    [_autoscrollingItems removeObject:canvasNodeView];
+    [self endInteraction:interaction];
+    [self demoteNodeViews];
+    [_frameArena reset];
 }
 
 #pragma mark - TBCanvasCreateHandleViewDelegate
 
 - (BOOL)canProcessCanvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle
 {
-    if ([self isInSingleTouchMode]) {
-        return (_viewsTouched[0] == canvasCreateHandle);
+    // Other gestures go on. Only the node view of the handle must not be moved at the same time - dragged itself, with a selection or in a segment.
+    if ([self interactionForItemView:canvasCreateHandle]) {
+        return YES;
     }
-    
-    if ([self isProcessingViews]) {
-        return NO;
-    }
-    
-    return YES;
+    TBCanvasNodeView *nodeView = canvasCreateHandle.nodeView;
+    return ([self interactionForItemView:nodeView] == nil && [self isNodeViewMovedByInteraction:nodeView] == NO);
 }
 
 - (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchesBegan:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    [self hideMenu];
-    
-    _lockedToSingleTouch = YES;
+    [self canvasCreateHandle:canvasCreateHandle touchBeganAtLocation:[self locationOfTouches:touches inItemView:canvasCreateHandle]];
+}
+
+- (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchBeganAtLocation:(CGPoint)location
+{
+    if ([self interactionForItemView:canvasCreateHandle]) {
+        return;
+    }
     
-    CGPoint location = [[touches anyObject] locationInView:self];
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseBegan itemView:canvasCreateHandle location:location];
     
-    location.x += canvasCreateHandle.touchOffset.width;
-    location.y += canvasCreateHandle.touchOffset.height;
+    [self hideMenu];
     
-    [_viewsTouched addObject:canvasCreateHandle];
+    TBCanvasInteraction *interaction = [self beginInteractionWithItemView:canvasCreateHandle];
     [canvasCreateHandle setHighlighted:YES];
     
     // Add the temporary connection object.
-    TBCanvasNodeView *parentView = _nodeViews[canvasCreateHandle.tag];
-    _temporaryConnectionView = [self.canvasViewDataSource collectionCanvasContentView:self newConectionForNodeAtIndexPath:[NSIndexPath indexPathForRow:parentView.tag inSection:0]];
-    _temporaryConnectionView.canvasNodeConnectionDelegate = self;
-    _temporaryConnectionView.parentNode = parentView;
-    _temporaryConnectionView.zoomScale = zoomScale;
-    [self addSubview:_temporaryConnectionView];
-    
-    _temporaryConnectionView.frame =  CGRectMake(_temporaryConnectionView.parentNode.center.x, _temporaryConnectionView.parentNode.center.y,
-                                             location.x - _temporaryConnectionView.parentNode.center.x,
-                                             location.y - _temporaryConnectionView.parentNode.center.y);
-    
-    CGPoint start = [self convertPoint:_temporaryConnectionView.parentNode.center toView:_temporaryConnectionView];
-    CGPoint end   = [self convertPoint:location toView:_temporaryConnectionView];
-    [_temporaryConnectionView drawConnectionFromPoint:start toPoint:end];
+    TBCanvasNodeView *parentView = canvasCreateHandle.nodeView;
+    [self promoteNodeViews:@[parentView]];
+    TBCanvasConnectionView *temporaryConnectionView = [self.canvasViewDataSource collectionCanvasContentView:self newConectionForNodeAtIndexPath:parentView.indexPath];
+    temporaryConnectionView.canvasNodeConnectionDelegate = self;
+    temporaryConnectionView.parentNode = parentView;
+    temporaryConnectionView.zoomScale = zoomScale;
+    [self addSubview:temporaryConnectionView];
+    interaction.connection = temporaryConnectionView;
+    
+    temporaryConnectionView.frame =  CGRectMake(temporaryConnectionView.parentNode.center.x, temporaryConnectionView.parentNode.center.y,
+                                            location.x - temporaryConnectionView.parentNode.center.x,
+                                            location.y - temporaryConnectionView.parentNode.center.y);
+    
+    CGPoint start = [self convertPoint:temporaryConnectionView.parentNode.center toView:temporaryConnectionView];
+    CGPoint end   = [self convertPoint:location toView:temporaryConnectionView];
+    [temporaryConnectionView drawConnectionFromPoint:start toPoint:end];
 }
 
 - (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchesMoved:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    [self hideMenu];
+    [self canvasCreateHandle:canvasCreateHandle touchMovedToLocation:[self locationOfTouches:touches inItemView:canvasCreateHandle]];
+}
+
+- (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchMovedToLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasCreateHandle];
+    if (interaction == nil) {
+        return;
+    }
     
-    CGPoint location = [[touches anyObject] locationInView:self];
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseMoved itemView:canvasCreateHandle location:location];
     
-    location.x += [canvasCreateHandle touchOffset].width;
-    location.y += [canvasCreateHandle touchOffset].height;
+    [self hideMenu];
     
     canvasCreateHandle.center = location;
-    isMovingCanvasNodeViews = YES;
-    
-    _temporaryConnectionView.frame =  CGRectMake(_temporaryConnectionView.parentNode.center.x, _temporaryConnectionView.parentNode.center.y,
-                                             location.x - _temporaryConnectionView.parentNode.center.x,
-                                             location.y - _temporaryConnectionView.parentNode.center.y);
-    
-    CGPoint start = [self convertPoint:_temporaryConnectionView.parentNode.center toView:_temporaryConnectionView];
-    CGPoint end   = [self convertPoint:location toView:_temporaryConnectionView];
-    [_temporaryConnectionView drawConnectionFromPoint:start toPoint:end];
-    
-    for (TBCanvasNodeView *nodeView in _nodeViews) {
-        
-        if ((CGRectIntersectsRect(nodeView.frame, canvasCreateHandle.frame))  && (nodeView != _temporaryConnectionView.parentNode) && (nodeView.isInCollapsedSegment == NO)) {
-            if (_connectableNodeView) {
-                if (_connectableNodeView != (TBCanvasNodeView *)nodeView) {
-                    [_connectableNodeView setSelected:NO];
-                    _connectableNodeView = nil;
-                    _connectableNodeView = (TBCanvasNodeView *)nodeView;
-                    [_connectableNodeView setSelected:YES];
-                    goto bail;
-                    
-                } else {
-                    goto bail;
-                }
-                
-            } else {
-                _connectableNodeView = (TBCanvasNodeView *)nodeView;
-                [_connectableNodeView setSelected:YES];
-                goto bail;
-            }
-            
+    interaction.moving = YES;
+    
+    TBCanvasConnectionView *temporaryConnectionView = interaction.connection;
+    temporaryConnectionView.frame =  CGRectMake(temporaryConnectionView.parentNode.center.x, temporaryConnectionView.parentNode.center.y,
+                                            location.x - temporaryConnectionView.parentNode.center.x,
+                                            location.y - temporaryConnectionView.parentNode.center.y);
+    
+    CGPoint start = [self convertPoint:temporaryConnectionView.parentNode.center toView:temporaryConnectionView];
+    CGPoint end   = [self convertPoint:location toView:temporaryConnectionView];
+    [temporaryConnectionView drawConnectionFromPoint:start toPoint:end];
+    
+    // Connections stay inside a section. Only node views of the parent's section near the handle are tested.
+    TBCanvasNodeView *connectableNodeView = nil;
+    for (TBCanvasNodeView *nodeView in [[self sectionForNodeView:temporaryConnectionView.parentNode] nodeViewsInRect:canvasCreateHandle.frame]) {
+        
+        // Counts every node view tested against the handle.
+        TB_CANVAS_COUNT("hitTest");
+        
+        if ((nodeView != temporaryConnectionView.parentNode) && (nodeView.isInCollapsedSegment == NO)) {
+            connectableNodeView = nodeView;
+            break;
         }
     }
+    [self setConnectableNodeView:connectableNodeView forInteraction:interaction];
     
-    if (_connectableNodeView) {
-        [_connectableNodeView setSelected:NO];
-        _connectableNodeView = nil;
+    // The highlighted node view has to be a live view.
+    if (interaction.connectableNodeView) {
+        [self promoteNodeViews:@[interaction.connectableNodeView]];
     }
-    
-bail:
-    [self checkAutoScrollingForCanvasItemView:canvasCreateHandle];
+    [self checkAutoScrollingForInteraction:interaction];
+    [self endFrame];
 }
 
 - (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchesEnded:(NSSet *)touches withEvent:(UIEvent *)event
 {
+    [self canvasCreateHandle:canvasCreateHandle touchEndedAtLocation:[self locationOfTouches:touches inItemView:canvasCreateHandle]];
+}
+
+- (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchEndedAtLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasCreateHandle];
+    if (interaction == nil) {
+        return;
+    }
+    
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseEnded itemView:canvasCreateHandle location:location];
+    
     [self hideMenu];
     
-    if (_connectableNodeView) {
-        TBCanvasNodeView *parentView = _temporaryConnectionView.parentNode;
+    TBCanvasConnectionView *temporaryConnectionView = interaction.connection;
+    if (interaction.connectableNodeView) {
+        TBCanvasNodeView *childView = interaction.connectableNodeView;
+        [self setConnectableNodeView:nil forInteraction:interaction];
         
         // Add a new valid connection.
-        TBCanvasConnectionView *connection = [self.canvasViewDataSource collectionCanvasContentView:self newConectionForNodeAtIndexPath:[NSIndexPath indexPathForRow:parentView.tag inSection:0]];
-        connection.canvasNodeConnectionDelegate = self;
-        connection.zoomScale = zoomScale;
-        
-        connection.parentNode = parentView;
-        connection.childNode = _connectableNodeView;
-        connection.tag = connection.parentNode.childConnections.count;
-        
-        [parentView.childConnections addObject:connection];
-        [_connectableNodeView.parentConnections addObject:connection];
-        [_connectionViews addObject:connection];
-        
-        [self addSubview:connection];
-        [self sendSubviewToBack:connection];
-        
-        [connection drawConnection];
-        
-        // Add new invisible handle.
-        TBCanvasMoveHandleView *moveHandle = [self makeMoveConnectionHandleForConnection:connection];
-        [_moveHandles addObject:moveHandle];
-        
-        connection.moveConnectionHandle = moveHandle;
-        
-        [self bringSubviewToFront:moveHandle];
-        [self addSubview:moveHandle];
-        
-        [_connectableNodeView setSelected:NO];
-        _connectableNodeView = nil;
-        
-        NSIndexPath *parentIndex = [NSIndexPath indexPathForRow:connection.parentNode.tag inSection:0];
-        NSIndexPath *childIndex = [NSIndexPath indexPathForRow:connection.childNode.tag inSection:0];
-        
-        if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didAddConnectionBetweenParentAtIndexPath:childAtIndexPath:)]) {
-            [_canvasViewDelegate collectionCanvasContentView:self didAddConnectionBetweenParentAtIndexPath:parentIndex childAtIndexPath:childIndex];
-        }
+        [self connectNodeView:temporaryConnectionView.parentNode toNodeView:childView];
     }
     
-    canvasCreateHandle.center = [self convertPoint:_temporaryConnectionView.parentNode.connectionHandleAncorPoint toView:self];
+    canvasCreateHandle.center = [self convertPoint:temporaryConnectionView.parentNode.connectionHandleAncorPoint toView:self];
     
     [canvasCreateHandle setHighlighted:NO];
-    [_temporaryConnectionView removeFromSuperview];
-    _temporaryConnectionView = nil;
-    _connectableNodeView = nil;
+    [temporaryConnectionView removeFromSuperview];
     
     [self sizeCanvasToFit];
     [self scrollTouchedViewToVisible];
     
-    [_viewsTouched removeObject:canvasCreateHandle];
-    [_autoscrollingItems removeObject:canvasCreateHandle];
-    
-    _lockedToSingleTouch = NO;
+    [self endInteraction:interaction];
+    [self demoteNodeViews];
 }
 
 - (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchesCancelled:(NSSet *)touches withEvent:(UIEvent *)event
 {
+    [self canvasCreateHandle:canvasCreateHandle touchCancelledAtLocation:[self locationOfTouches:touches inItemView:canvasCreateHandle]];
+}
+
+- (void)canvasCreateHandle:(TBCanvasCreateHandleView *)canvasCreateHandle touchCancelledAtLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasCreateHandle];
+    if (interaction == nil) {
+        return;
+    }
+    
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseCancelled itemView:canvasCreateHandle location:location];
+    
     [self hideMenu];
-    isMovingCanvasNodeViews = NO;
-    [_autoscrollTimer invalidate];
     [self sizeCanvasToFit];
     
-    canvasCreateHandle.center = [self convertPoint:_temporaryConnectionView.parentNode.connectionHandleAncorPoint toView:self];
-    [_temporaryConnectionView removeFromSuperview];
-    _temporaryConnectionView = nil;
-    _connectableNodeView = nil;
+    TBCanvasConnectionView *temporaryConnectionView = interaction.connection;
+    canvasCreateHandle.center = [self convertPoint:temporaryConnectionView.parentNode.connectionHandleAncorPoint toView:self];
+    [temporaryConnectionView removeFromSuperview];
+    [self setConnectableNodeView:nil forInteraction:interaction];
     
     [self scrollTouchedViewToVisible];
     
     [canvasCreateHandle setSelected:NO];
     
-    [_connectionViewsForFullRefresh removeAllObjects];
-    
-    [_viewsTouched removeObject:canvasCreateHandle];
-    [_autoscrollingItems removeObject:canvasCreateHandle];
-    
-    _lockedToSingleTouch = NO;
+    [self endInteraction:interaction];
+    [self demoteNodeViews];
 }
 
 #pragma mark - TBCanvasMoveHandleViewDelegate
 
 - (BOOL)canProcessCanvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle
 {
-    if ([self isInSingleTouchMode]) {
-        return (_viewsTouched[0] == canvasMoveHandle);
-    }
-    
-    if ([self isProcessingViews]) {
-        return NO;
+    // Other gestures go on. Only the node views of the connection must not be moved at the same time - dragged themselves, with a selection or in a segment.
+    if ([self interactionForItemView:canvasMoveHandle]) {
+        return YES;
     }
-    
-    return YES;
+    TBCanvasConnectionView *connection = canvasMoveHandle.connection;
+    TBCanvasNodeView *parentNode = connection.parentNode;
+    TBCanvasNodeView *childNode = connection.childNode;
+    return ([self interactionForItemView:parentNode] == nil && [self isNodeViewMovedByInteraction:parentNode] == NO &&
+            [self interactionForItemView:childNode] == nil && [self isNodeViewMovedByInteraction:childNode] == NO);
 }
 
 - (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchesBegan:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    [self hideMenu];
-    
-    _lockedToSingleTouch = YES;
+    [self canvasMoveHandle:canvasMoveHandle touchBeganAtLocation:[self locationOfTouches:touches inItemView:canvasMoveHandle]];
+}
+
+- (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchBeganAtLocation:(CGPoint)location
+{
+    if ([self interactionForItemView:canvasMoveHandle]) {
+        return;
+    }
     
-    CGPoint location = [[touches anyObject] locationInView:self];
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMoveHandle phase:TBCanvasTouchTracePhaseBegan itemView:canvasMoveHandle location:location];
     
-    location.x += canvasMoveHandle.touchOffset.width;
-    location.y += canvasMoveHandle.touchOffset.height;
+    [self hideMenu];
     
-    [_viewsTouched addObject:canvasMoveHandle];
+    TBCanvasInteraction *interaction = [self beginInteractionWithItemView:canvasMoveHandle];
     [canvasMoveHandle setHighlighted:YES];
     
     // Set the selected connection object.
-    _selectedConnectionView = canvasMoveHandle.connection;
+    TBCanvasConnectionView *selectedConnectionView = canvasMoveHandle.connection;
+    interaction.connection = selectedConnectionView;
+    [self promoteNodeViews:@[selectedConnectionView.parentNode, selectedConnectionView.childNode]];
     
-    CGPoint start = [self convertPoint:_selectedConnectionView.parentNode.center toView:_selectedConnectionView];
-    CGPoint end   = [self convertPoint:location toView:_selectedConnectionView];
+    CGPoint start = [self convertPoint:selectedConnectionView.parentNode.center toView:selectedConnectionView];
+    CGPoint end   = [self convertPoint:location toView:selectedConnectionView];
     
-    [_selectedConnectionView drawConnectionFromPoint:start toPoint:end];
+    [selectedConnectionView drawConnectionFromPoint:start toPoint:end];
 }
 
 - (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchesMoved:(NSSet *)touches withEvent:(UIEvent *)event
 {
-    [self hideMenu];
+    [self canvasMoveHandle:canvasMoveHandle touchMovedToLocation:[self locationOfTouches:touches inItemView:canvasMoveHandle]];
+}
+
+- (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchMovedToLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasMoveHandle];
+    if (interaction == nil) {
+        return;
+    }
     
-    CGPoint location = [[touches anyObject] locationInView:self];
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMoveHandle phase:TBCanvasTouchTracePhaseMoved itemView:canvasMoveHandle location:location];
     
-    location.x += canvasMoveHandle.touchOffset.width;
-    location.y += canvasMoveHandle.touchOffset.height;
+    [self hideMenu];
     
     canvasMoveHandle.center = location;
-    isMovingCanvasNodeViews = YES;
+    interaction.moving = YES;
     
+    TBCanvasConnectionView *selectedConnectionView = interaction.connection;
+    selectedConnectionView.frame =  CGRectMake(selectedConnectionView.parentNode.center.x, selectedConnectionView.parentNode.center.y+20.0,
+                                           location.x - selectedConnectionView.parentNode.center.x,
+                                           location.y - selectedConnectionView.parentNode.center.y);
     
-    _selectedConnectionView.frame =  CGRectMake(_selectedConnectionView.parentNode.center.x, _selectedConnectionView.parentNode.center.y+20.0,
-                                            location.x - _selectedConnectionView.parentNode.center.x,
-                                            location.y - _selectedConnectionView.parentNode.center.y);
+    CGPoint start = [self convertPoint:selectedConnectionView.parentNode.center toView:selectedConnectionView];
+    CGPoint end   = [self convertPoint:location toView:selectedConnectionView];
+    [selectedConnectionView drawConnectionFromPoint:start toPoint:end];
     
-    CGPoint start = [self convertPoint:_selectedConnectionView.parentNode.center toView:_selectedConnectionView];
-    CGPoint end   = [self convertPoint:location toView:_selectedConnectionView];
-    [_selectedConnectionView drawConnectionFromPoint:start toPoint:end];
-    
-    for (TBCanvasNodeView *nodeView in _nodeViews) {
+    TBCanvasNodeView *connectableNodeView = nil;
+    for (TBCanvasNodeView *nodeView in [[self sectionForNodeView:selectedConnectionView.parentNode] nodeViewsInRect:canvasMoveHandle.frame]) {
         
-        if ((CGRectIntersectsRect(nodeView.frame, canvasMoveHandle.frame)) && (nodeView != _selectedConnectionView.parentNode) && (nodeView.isInCollapsedSegment == NO)) {
-            if (_connectableNodeView) {
-                if (_connectableNodeView != (TBCanvasNodeView *)nodeView) {
-                    [_connectableNodeView setSelected:NO];
-                    _connectableNodeView = nil;
-                    _connectableNodeView = (TBCanvasNodeView *)nodeView;
-                    [_connectableNodeView setSelected:YES];
-                    goto bail2;
-                    
-                } else {
-                    goto bail2;
-                }
-                
-            } else {
-                _connectableNodeView = (TBCanvasNodeView *)nodeView;
-                [_connectableNodeView setSelected:YES];
-                goto bail2;
-            }
-            
+        // Counts every node view tested against the handle.
+        TB_CANVAS_COUNT("hitTest");
+        
+        if ((nodeView != selectedConnectionView.parentNode) && (nodeView.isInCollapsedSegment == NO)) {
+            connectableNodeView = nodeView;
+            break;
         }
     }
+    [self setConnectableNodeView:connectableNodeView forInteraction:interaction];
     
-    if (_connectableNodeView) {
-        [_connectableNodeView setSelected:NO];
-        _connectableNodeView = nil;
+    // The highlighted node view has to be a live view.
+    if (interaction.connectableNodeView) {
+        [self promoteNodeViews:@[interaction.connectableNodeView]];
     }
-    
-bail2:
-    [self checkAutoScrollingForCanvasItemView:canvasMoveHandle];
+    [self checkAutoScrollingForInteraction:interaction];
+    [self endFrame];
 }
 
 - (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchesEnded:(NSSet *)touches withEvent:(UIEvent *)event
 {
+    [self canvasMoveHandle:canvasMoveHandle touchEndedAtLocation:[self locationOfTouches:touches inItemView:canvasMoveHandle]];
+}
+
+- (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchEndedAtLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasMoveHandle];
+    if (interaction == nil) {
+        return;
+    }
+    
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMoveHandle phase:TBCanvasTouchTracePhaseEnded itemView:canvasMoveHandle location:location];
+    
     [self hideMenu];
     
-    if (_connectableNodeView) {
+    TBCanvasConnectionView *selectedConnectionView = interaction.connection;
+    TBCanvasNodeView *connectableNodeView = interaction.connectableNodeView;
+    if (connectableNodeView) {
         // Move connection to another childview
-        NSIndexPath *connectionIndexPath = [_selectedConnectionView indexPath];
-        NSIndexPath *newChildIndexPath = [NSIndexPath indexPathForRow:_connectableNodeView.tag inSection:0];
+        NSIndexPath *connectionIndexPath = [selectedConnectionView indexPath];
+        NSIndexPath *newChildIndexPath = connectableNodeView.indexPath;
         
-        [_selectedConnectionView.childNode.connectedNodes removeObject:_selectedConnectionView.parentNode];
-        [_selectedConnectionView.childNode.parentConnections removeObject:_selectedConnectionView];
-        _selectedConnectionView.childNode = _connectableNodeView;
+        TBCanvasNodeView *oldChildNode = selectedConnectionView.childNode;
+        [selectedConnectionView.childNode.connectedNodes removeObject:selectedConnectionView.parentNode];
+        [selectedConnectionView.childNode.parentConnections removeObject:selectedConnectionView];
+        selectedConnectionView.childNode = connectableNodeView;
         
-        [_selectedConnectionView.childNode.connectedNodes addObject:_selectedConnectionView.parentNode];
-        [_selectedConnectionView.childNode.parentConnections addObject:_selectedConnectionView];
-        [_selectedConnectionView drawConnection];
-        [_connectableNodeView setSelected:NO];
-        _connectableNodeView = nil;
+        [selectedConnectionView.childNode.connectedNodes addObject:selectedConnectionView.parentNode];
+        [selectedConnectionView.childNode.parentConnections addObject:selectedConnectionView];
+        [[self sectionForNodeView:selectedConnectionView.parentNode] moveConnectionView:selectedConnectionView fromChildNode:oldChildNode];
+        [selectedConnectionView drawConnection];
+        [self setConnectableNodeView:nil forInteraction:interaction];
+        
+        // Remote canvases see a moved connection as a removal followed by an addition.
+        [self recordSyncDeltaOfKind:TBCanvasDeltaKindRemoveConnection nodeView:selectedConnectionView.parentNode childNodeView:oldChildNode];
+        [self recordSyncDeltaOfKind:TBCanvasDeltaKindAddConnection nodeView:selectedConnectionView.parentNode childNodeView:selectedConnectionView.childNode];
         
         if ([_canvasViewDelegate respondsToSelector:@selector(collectionCanvasContentView:didMoveConnectionAtNode:toNewChildIndexPath:)]) {
             [_canvasViewDelegate collectionCanvasContentView:self didMoveConnectionAtNode:connectionIndexPath toNewChildIndexPath:newChildIndexPath];
         }
         
-        canvasMoveHandle.center = [self convertPoint:_selectedConnectionView.visibleEndPoint fromView:_selectedConnectionView];
+        canvasMoveHandle.center = [self convertPoint:selectedConnectionView.visibleEndPoint fromView:selectedConnectionView];
         [canvasMoveHandle setHighlighted:NO];
-        _selectedConnectionView = nil;
-        _connectableNodeView = nil;
         
     } else {
         // Remove connection completely
-        [_selectedConnectionView suspenderSnapAnimation];
-        _selectedConnectionView = nil;
-        _connectableNodeView = nil;
-        [canvasMoveHandle removeFromSuperview];
-        [_moveHandles removeObject:canvasMoveHandle];
+        [selectedConnectionView suspenderSnapAnimation];
+        [self recycleMoveHandle:canvasMoveHandle];
     }
     
     [self sizeCanvasToFit];
     [self scrollTouchedViewToVisible];
     
-    isMovingCanvasNodeViews = NO;
-    [_autoscrollTimer invalidate];
-    
-    [_viewsTouched removeObject:canvasMoveHandle];
-    [_autoscrollingItems removeObject:canvasMoveHandle];
-    
-    _lockedToSingleTouch = NO;
+    [self endInteraction:interaction];
+    [self demoteNodeViews];
 }
 
 - (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchesCancelled:(NSSet *)touches withEvent:(UIEvent *)event
 {
+    [self canvasMoveHandle:canvasMoveHandle touchCancelledAtLocation:[self locationOfTouches:touches inItemView:canvasMoveHandle]];
+}
+
+- (void)canvasMoveHandle:(TBCanvasMoveHandleView *)canvasMoveHandle touchCancelledAtLocation:(CGPoint)location
+{
+    TBCanvasInteraction *interaction = [self interactionForItemView:canvasMoveHandle];
+    if (interaction == nil) {
+        return;
+    }
+    
+    [self recordTouchTraceEventWithTarget:TBCanvasTouchTraceTargetMoveHandle phase:TBCanvasTouchTracePhaseCancelled itemView:canvasMoveHandle location:location];
+    
     [self hideMenu];
-    isMovingCanvasNodeViews = NO;
-    [_autoscrollTimer invalidate];
     
     [self sizeCanvasToFit];
     [self scrollTouchedViewToVisible];
     
-    canvasMoveHandle.center = [self convertPoint:_selectedConnectionView.visibleEndPoint fromView:_selectedConnectionView];
+    TBCanvasConnectionView *selectedConnectionView = interaction.connection;
+    canvasMoveHandle.center = [self convertPoint:selectedConnectionView.visibleEndPoint fromView:selectedConnectionView];
     [canvasMoveHandle setHighlighted:NO];
-    _selectedConnectionView = nil;
-    _connectableNodeView = nil;
-    
-    [_viewsTouched removeObject:canvasMoveHandle];
-    [_autoscrollingItems removeObject:canvasMoveHandle];
+    [self setConnectableNodeView:nil forInteraction:interaction];
     
-    _lockedToSingleTouch = NO;
+    [self endInteraction:interaction];
+    [self demoteNodeViews];
 }
 
 @end
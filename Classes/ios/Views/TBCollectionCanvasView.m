@@ -66,7 +66,7 @@ CGFloat const TBCollectionCanvasContentViewHeight = 1000.0;
  */
 - (BOOL)touchesShouldBegin:(NSSet *)touches withEvent:(UIEvent *)event inContentView:(UIView *)view
 {
-    if ([self.collectionCanvasView isProcessingViews]) {
+    if ([self.collectionCanvasView isProcessingViews] || self.collectionCanvasView.selectionMode != TBCanvasSelectionModeNone) {
         return YES;
     }
     
@@ -93,4 +93,11 @@ CGFloat const TBCollectionCanvasContentViewHeight = 1000.0;
     [self.collectionCanvasView zoomToScale:scale];
 }
 
+- (void)scrollViewDidScroll:(UIScrollView *)scrollView
+{
+    [self.collectionCanvasView layoutClusters];
+    [self.collectionCanvasView layoutTiles];
+    [self.collectionCanvasView layoutConnectionHandles];
+}
+
 @end
@@ -79,7 +79,7 @@
 
 - (NSInteger)numberOfSectionsOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView
 {
-    return 0;
+    return 1;
 }
 
 -(NSInteger)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView numberOfNodesInSection:(NSInteger)section
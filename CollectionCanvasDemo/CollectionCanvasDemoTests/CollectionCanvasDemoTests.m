@@ -8,7 +8,179 @@
 
 #import <XCTest/XCTest.h>
 
-@interface CollectionCanvasDemoTests : XCTestCase
+#import <QuartzCore/QuartzCore.h>
+#import <malloc/malloc.h>
+
+#import "TBCollectionCanvasView.h"
+#import "TBCanvasInstrumentation.h"
+#import "TBCanvasSpatialIndex.h"
+#import "TBCanvasSection.h"
+#import "TBCanvasClusterIndex.h"
+#import "TBCanvasClusterView.h"
+#import "TBCanvasRenderModel.h"
+#import "TBCanvasAlignmentIndex.h"
+#import "TBCanvasArena.h"
+#import "TBCanvasGraphIndex.h"
+#import "TBCanvasSyncServer.h"
+#import "TBCanvasSyncClient.h"
+#import "TBCanvasInteraction.h"
+#import "TBCanvasGraphGenerator.h"
+#import "TBCanvasBenchmark.h"
+
+@interface TBCollectionCanvasContentView (Benchmark)
+
+- (void)collapseSegment:(TBCanvasNodeView *)nodeView;
+- (void)expandSegment:(TBCanvasNodeView *)nodeView;
+- (void)autoScrollOnEdges;
+- (void)addUnionOfRects:(CGRect *)rects count:(NSUInteger)count toPath:(CGMutablePathRef)path;
+
+@end
+
+/**
+ Data source serving a generated graph of node views.
+ */
+@interface CanvasBenchmarkDataSource : NSObject <TBCollectionCanvasContentViewDataSource>
+
+@property (strong, nonatomic) NSMutableArray *nodeViews;
+@property (strong, nonatomic) NSMutableArray *edges;
+@property (strong, nonatomic) NSMutableDictionary *attributeValues;
+@property (assign, nonatomic) NSInteger sectionCount;
+
+- (id)initWithNodeCount:(NSInteger)nodeCount;
+- (void)connectParent:(NSInteger)parent child:(NSInteger)child;
+
+@end
+
+@implementation CanvasBenchmarkDataSource
+
+- (id)initWithNodeCount:(NSInteger)nodeCount
+{
+    self = [super init];
+    if (self) {
+        _nodeViews = [[NSMutableArray alloc] init];
+        _edges = [[NSMutableArray alloc] init];
+        _attributeValues = [[NSMutableDictionary alloc] init];
+        _sectionCount = 1;
+        
+        for (NSInteger i = 0; i < nodeCount; i++) {
+            TBCanvasNodeView *nodeView = [[TBCanvasNodeView alloc] initWithFrame:CGRectMake(0.0, 0.0, 40.0, 40.0)];
+            nodeView.tag = i;
+            nodeView.center = CGPointMake(200.0 + (i % 100) * 60.0, 200.0 + (i / 100) * 60.0);
+            [_nodeViews addObject:nodeView];
+            [_edges addObject:[[NSMutableArray alloc] init]];
+        }
+    }
+    return self;
+}
+
+- (void)connectParent:(NSInteger)parent child:(NSInteger)child
+{
+    [_edges[parent] addObject:@(child)];
+}
+
+- (NSInteger)numberOfSectionsOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView
+{
+    return _sectionCount;
+}
+
+- (NSInteger)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView numberOfNodesInSection:(NSInteger)section
+{
+    return _nodeViews.count;
+}
+
+- (TBCanvasNodeView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView nodeViewAtIndexPath:(NSIndexPath *)indexPath
+{
+    return _nodeViews[indexPath.row];
+}
+
+- (TBCanvasConnectionView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView newConectionForNodeAtIndexPath:(NSIndexPath *)indexPath
+{
+    return [[TBCanvasConnectionView alloc] initWithFrame:CGRectZero];
+}
+
+- (NSSet *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView connectionsForNodeAtIndexPath:(NSIndexPath *)indexPath
+{
+    NSMutableSet *connections = [[NSMutableSet alloc] init];
+    NSInteger connectionIndex = 0;
+    for (NSNumber *child in _edges[indexPath.row]) {
+        TBCanvasConnectionView *connection = [[TBCanvasConnectionView alloc] initWithFrame:CGRectZero];
+        connection.tag = connectionIndex++;
+        connection.parentNode = _nodeViews[indexPath.row];
+        connection.childNode = _nodeViews[child.integerValue];
+        [connections addObject:connection];
+    }
+    return connections;
+}
+
+- (TBCanvasCreateHandleView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView newHandleForConnectionAtPoint:(CGPoint)point
+{
+    return [[TBCanvasCreateHandleView alloc] initWithFrame:CGRectMake(point.x - 10.0, point.y - 10.0, 20.0, 20.0)];
+}
+
+- (NSArray *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView valuesOfAttribute:(NSString *)attribute inSection:(NSInteger)section
+{
+    return _attributeValues[attribute];
+}
+
+- (TBCanvasMoveHandleView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView moveHandleForConnectionAtPoint:(CGPoint)point
+{
+    return [[TBCanvasMoveHandleView alloc] initWithFrame:CGRectMake(point.x - 10.0, point.y - 10.0, 20.0, 20.0)];
+}
+
+@end
+
+/**
+ Data source serving one CanvasBenchmarkDataSource per section.
+ */
+@interface CanvasSectionedDataSource : CanvasBenchmarkDataSource
+
+@property (strong, nonatomic) NSArray *sectionDataSources;
+
+- (id)initWithSectionDataSources:(NSArray *)sectionDataSources;
+
+@end
+
+@implementation CanvasSectionedDataSource
+
+- (id)initWithSectionDataSources:(NSArray *)sectionDataSources
+{
+    self = [super initWithNodeCount:0];
+    if (self) {
+        _sectionDataSources = sectionDataSources;
+        for (CanvasBenchmarkDataSource *dataSource in sectionDataSources) {
+            [self.nodeViews addObjectsFromArray:dataSource.nodeViews];
+        }
+    }
+    return self;
+}
+
+- (NSInteger)numberOfSectionsOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView
+{
+    return _sectionDataSources.count;
+}
+
+- (NSInteger)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView numberOfNodesInSection:(NSInteger)section
+{
+    return [_sectionDataSources[section] collectionCanvasContentView:collectionCanvasContentView numberOfNodesInSection:section];
+}
+
+- (TBCanvasNodeView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView nodeViewAtIndexPath:(NSIndexPath *)indexPath
+{
+    return [_sectionDataSources[indexPath.section] collectionCanvasContentView:collectionCanvasContentView nodeViewAtIndexPath:indexPath];
+}
+
+- (NSSet *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView connectionsForNodeAtIndexPath:(NSIndexPath *)indexPath
+{
+    return [_sectionDataSources[indexPath.section] collectionCanvasContentView:collectionCanvasContentView connectionsForNodeAtIndexPath:indexPath];
+}
+
+@end
+
+@interface CollectionCanvasDemoTests : XCTestCase <TBCollectionCanvasContentViewDelegate>
+
+@property (strong, nonatomic) TBCollectionCanvasContentView *canvas;
+@property (strong, nonatomic) CanvasBenchmarkDataSource *dataSource;
+@property (strong, nonatomic) NSMutableArray *movedIndexPaths;
 
 @end
 
@@ -18,17 +190,1807 @@
 {
     [super setUp];
     // Put setup code here. This method is called before the invocation of each test method in the class.
+    _canvas = [[TBCollectionCanvasContentView alloc] initWithFrame:CGRectMake(0.0, 0.0, TBCollectionCanvasContentViewWidth, TBCollectionCanvasContentViewHeight)];
 }
 
 - (void)tearDown
 {
     // Put teardown code here. This method is called after the invocation of each test method in the class.
+    [_canvas clearCanvas];
+    _canvas = nil;
+    _dataSource = nil;
+    _movedIndexPaths = nil;
     [super tearDown];
 }
 
-- (void)testExample
+- (void)loadDataSource:(CanvasBenchmarkDataSource *)dataSource
+{
+    _dataSource = dataSource;
+    _canvas.canvasViewDataSource = dataSource;
+    [_canvas fillCanvas];
+}
+
+- (CanvasBenchmarkDataSource *)chainDataSourceWithNodeCount:(NSInteger)nodeCount
+{
+    CanvasBenchmarkDataSource *dataSource = [[CanvasBenchmarkDataSource alloc] initWithNodeCount:nodeCount];
+    for (NSInteger i = 1; i < nodeCount; i++) {
+        [dataSource connectParent:i - 1 child:i];
+    }
+    return dataSource;
+}
+
+#pragma mark - Touch traces
+
+- (void)processEventWithTarget:(TBCanvasTouchTraceTarget)target phase:(TBCanvasTouchTracePhase)phase nodeTag:(NSInteger)nodeTag location:(CGPoint)location
+{
+    TBCanvasTouchTraceEvent event = {target, phase, (int32_t)nodeTag, -1, location, 0.0};
+    [_canvas processTouchTraceEvent:event];
+}
+
+- (void)recordDragOfNodeWithTag:(NSInteger)nodeTag by:(CGSize)distance steps:(NSInteger)steps
+{
+    CGPoint start = [_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:nodeTag inSection:0]].center;
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:nodeTag location:start];
+    for (NSInteger i = 1; i <= steps; i++) {
+        CGPoint location = CGPointMake(start.x + distance.width * i / steps, start.y + distance.height * i / steps);
+        [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:nodeTag location:location];
+    }
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:nodeTag location:CGPointMake(start.x + distance.width, start.y + distance.height)];
+}
+
+- (void)testTouchTraceReplay
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:200]];
+    
+    // Record a drag of a collapsed segment and of a single node.
+    TBCanvasTouchTrace *trace = [[TBCanvasTouchTrace alloc] init];
+    _canvas.touchTrace = trace;
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseCollapse nodeTag:100 location:CGPointZero];
+    [self recordDragOfNodeWithTag:100 by:CGSizeMake(300.0, 200.0) steps:100];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseExpand nodeTag:100 location:CGPointZero];
+    [self recordDragOfNodeWithTag:0 by:CGSizeMake(500.0, 0.0) steps:100];
+    
+    _canvas.touchTrace = nil;
+    CGPoint expectedCenter = [_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:150 inSection:0]].center;
+    XCTAssertEqual(trace.eventCount, (NSUInteger)206);
+    
+    // Write and read back.
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"canvas.tbtrace"]];
+    NSError *error = nil;
+    XCTAssertTrue([trace writeToURL:url error:&error], @"%@", error);
+    
+    TBCanvasTouchTrace *loadedTrace = [[TBCanvasTouchTrace alloc] initWithContentsOfURL:url error:&error];
+    XCTAssertNotNil(loadedTrace, @"%@", error);
+    XCTAssertEqual(loadedTrace.eventCount, trace.eventCount);
+    XCTAssertEqualWithAccuracy([loadedTrace eventAtIndex:205].timestamp, [trace eventAtIndex:205].timestamp, 0.000001);
+    
+    // Replay on a fresh canvas.
+    [_canvas clearCanvas];
+    [self loadDataSource:[self chainDataSourceWithNodeCount:200]];
+    
+    NSArray *latencies = [loadedTrace replayOnCanvasContentView:_canvas];
+    XCTAssertEqual(latencies.count, loadedTrace.eventCount);
+    
+    CGPoint replayedCenter = [_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:150 inSection:0]].center;
+    XCTAssertEqualWithAccuracy(replayedCenter.x, expectedCenter.x, 0.5);
+    XCTAssertEqualWithAccuracy(replayedCenter.y, expectedCenter.y, 0.5);
+    
+    // Every event of a 200 node chain is handled well within a second.
+    NSDictionary *percentiles = [TBCanvasTouchTrace percentilesForLatencies:latencies];
+    XCTAssertTrue([percentiles[@"p50"] doubleValue] <= [percentiles[@"p90"] doubleValue]);
+    XCTAssertTrue([percentiles[@"p90"] doubleValue] <= [percentiles[@"p99"] doubleValue]);
+    XCTAssertTrue([percentiles[@"p99"] doubleValue] <= [percentiles[@"max"] doubleValue]);
+    XCTAssertTrue([percentiles[@"max"] doubleValue] < 1.0);
+}
+
+#pragma mark - Instrumentation
+
+- (void)recordInstrumentationSamples
+{
+    [TBCanvasInstrumentation reset];
+    
+    TBCanvasInstrumentationEntry *counter = TBCanvasInstrumentationEntryNamed("testCounter");
+    TBCanvasInstrumentationCount(counter, 2);
+    TBCanvasInstrumentationCount(counter, 3);
+    TBCanvasInstrumentationMarkFrame();
+    TBCanvasInstrumentationCount(counter, 1);
+    
+    // Timers of 1 to 100 milliseconds.
+    TBCanvasInstrumentationEntry *timer = TBCanvasInstrumentationEntryNamed("testTimer");
+    for (NSUInteger i = 1; i <= 100; i++) {
+        TBCanvasInstrumentationScope scope = {timer, CACurrentMediaTime() - i * 0.001};
+        TBCanvasInstrumentationEndScope(&scope);
+    }
+}
+
+- (void)testInstrumentationStatistics
+{
+    [self recordInstrumentationSamples];
+    NSDictionary *statistics = [TBCanvasInstrumentation statistics];
+    
+    NSDictionary *counter = statistics[@"testCounter"];
+    XCTAssertEqual([counter[@"count"] unsignedLongLongValue], (uint64_t)6);
+    XCTAssertEqual([counter[@"maxCountPerFrame"] unsignedLongLongValue], (uint64_t)5);
+    XCTAssertNil(counter[@"p50"]);
+    
+    NSDictionary *timer = statistics[@"testTimer"];
+    XCTAssertEqual([timer[@"count"] unsignedLongLongValue], (uint64_t)100);
+    XCTAssertEqualWithAccuracy([timer[@"totalTime"] doubleValue], 5.05, 0.01);
+    XCTAssertEqualWithAccuracy([timer[@"maxTime"] doubleValue], 0.100, 0.0005);
+    XCTAssertEqualWithAccuracy([timer[@"p50"] doubleValue], 0.050, 0.0005);
+    XCTAssertEqualWithAccuracy([timer[@"p90"] doubleValue], 0.090, 0.0005);
+    XCTAssertEqualWithAccuracy([timer[@"p99"] doubleValue], 0.099, 0.0005);
+}
+
+- (void)testInstrumentationWritesTraceEvents
+{
+    [self recordInstrumentationSamples];
+    
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"canvas-instrumentation.json"]];
+    NSError *error = nil;
+    XCTAssertTrue([TBCanvasInstrumentation writeTraceToURL:url error:&error], @"%@", error);
+    
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfURL:url] options:0 error:&error];
+    XCTAssertNotNil(trace, @"%@", error);
+    NSArray *events = trace[@"traceEvents"];
+    XCTAssertEqual(events.count, (NSUInteger)100);
+    
+    // Complete events in recording order with microseconds.
+    NSDictionary *first = events.firstObject;
+    XCTAssertEqualObjects(first[@"name"], @"testTimer");
+    XCTAssertEqualObjects(first[@"ph"], @"X");
+    XCTAssertEqualWithAccuracy([first[@"dur"] doubleValue], 1000.0, 500.0);
+    XCTAssertEqualWithAccuracy([events.lastObject[@"dur"] doubleValue], 100000.0, 500.0);
+    XCTAssertTrue([events.lastObject[@"ts"] doubleValue] < [first[@"ts"] doubleValue]);
+}
+
+- (void)testInstrumentationReset
+{
+    [self recordInstrumentationSamples];
+    [TBCanvasInstrumentation reset];
+    
+    NSDictionary *statistics = [TBCanvasInstrumentation statistics];
+    XCTAssertEqual([statistics[@"testCounter"][@"count"] unsignedLongLongValue], (uint64_t)0);
+    XCTAssertEqual([statistics[@"testCounter"][@"maxCountPerFrame"] unsignedLongLongValue], (uint64_t)0);
+    XCTAssertEqual([statistics[@"testTimer"][@"count"] unsignedLongLongValue], (uint64_t)0);
+    XCTAssertEqual([statistics[@"testTimer"][@"totalTime"] doubleValue], 0.0);
+    XCTAssertNil(statistics[@"testTimer"][@"p50"]);
+    
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"canvas-instrumentation.json"]];
+    NSError *error = nil;
+    XCTAssertTrue([TBCanvasInstrumentation writeTraceToURL:url error:&error], @"%@", error);
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfURL:url] options:0 error:&error];
+    XCTAssertEqual([trace[@"traceEvents"] count], (NSUInteger)0);
+}
+
+#pragma mark - Connection handles
+
+- (NSSet *)connectionHandlesOnCanvas
+{
+    NSMutableSet *handles = [[NSMutableSet alloc] init];
+    for (TBCanvasNodeView *nodeView in _dataSource.nodeViews) {
+        if (nodeView.connectionHandle) {
+            XCTAssertEqual(nodeView.connectionHandle.superview, _canvas);
+            [handles addObject:nodeView.connectionHandle];
+        }
+    }
+    return handles;
+}
+
+- (void)testConnectionHandlesAreMaterializedNearViewportAndReused
+{
+    TBCollectionCanvasView *scrollView = [[TBCollectionCanvasView alloc] initWithFrame:CGRectMake(0.0, 0.0, 400.0, 400.0)];
+    _canvas.scrollView = scrollView;
+    [self loadDataSource:[self chainDataSourceWithNodeCount:1000]];
+    
+    [_canvas toggleConnectMode];
+    NSSet *handles = [self connectionHandlesOnCanvas];
+    XCTAssertTrue(handles.count > 0);
+    XCTAssertTrue(handles.count < _dataSource.nodeViews.count);
+    
+    // Toggling connection mode recycles the handles and reuses them afterwards.
+    [_canvas toggleConnectMode];
+    XCTAssertEqual([self connectionHandlesOnCanvas].count, (NSUInteger)0);
+    [_canvas toggleConnectMode];
+    XCTAssertEqualObjects([self connectionHandlesOnCanvas], handles);
+    
+    // Scrolling moves the handles to the nodes entering the viewport - the wider visible area needs a few more.
+    scrollView.contentOffset = CGPointMake(1000.0, 0.0);
+    [_canvas layoutConnectionHandles];
+    NSSet *scrolledHandles = [self connectionHandlesOnCanvas];
+    XCTAssertTrue([handles isSubsetOfSet:scrolledHandles]);
+    XCTAssertNil([_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:0]].connectionHandle);
+    XCTAssertNotNil([_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:40 inSection:0]].connectionHandle);
+    
+    [_canvas toggleConnectMode];
+}
+
+#pragma mark - Sections
+
+- (void)testSectionsAreIndexedAndReloadedIndependently
+{
+    CanvasBenchmarkDataSource *first = [self chainDataSourceWithNodeCount:100];
+    CanvasBenchmarkDataSource *second = [self chainDataSourceWithNodeCount:100];
+    for (TBCanvasNodeView *nodeView in second.nodeViews) {
+        nodeView.center = CGPointMake(nodeView.center.x, nodeView.center.y + 1000.0);
+    }
+    [self loadDataSource:[[CanvasSectionedDataSource alloc] initWithSectionDataSources:@[first, second]]];
+    
+    TBCanvasNodeView *nodeView = [_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:50 inSection:1]];
+    XCTAssertEqual(nodeView, second.nodeViews[50]);
+    XCTAssertEqualObjects(nodeView.indexPath, [NSIndexPath indexPathForRow:50 inSection:1]);
+    
+    TBCanvasConnectionView *connection = nodeView.childConnections.firstObject;
+    NSUInteger indexes[] = {1, 50, 0};
+    XCTAssertEqualObjects(connection.indexPath, [NSIndexPath indexPathWithIndexes:indexes length:3]);
+    
+    // Reloading the second section leaves the first one untouched.
+    [self recordDragOfNodeWithTag:10 by:CGSizeMake(0.0, 300.0) steps:10];
+    CGPoint movedCenter = [first.nodeViews[10] center];
+    NSArray *firstConnections = [first.nodeViews[10] childConnections];
+    
+    [_canvas reloadSection:1];
+    XCTAssertEqual([_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:10 inSection:0]], first.nodeViews[10]);
+    XCTAssertEqualObjects([first.nodeViews[10] childConnections], firstConnections);
+    XCTAssertEqual([first.nodeViews[10] center].y, movedCenter.y);
+    XCTAssertEqual([_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:50 inSection:1]].childConnections.count, (NSUInteger)1);
+    XCTAssertEqual([second.nodeViews[50] section], (NSInteger)1);
+}
+
+- (void)testIndexesShiftEntriesOnInsertAndDelete
+{
+    CGRect rects[3] = {CGRectMake(0.0, 0.0, 40.0, 40.0), CGRectMake(300.0, 0.0, 40.0, 40.0), CGRectMake(600.0, 0.0, 40.0, 40.0)};
+    TBCanvasSpatialIndex *spatialIndex = [[TBCanvasSpatialIndex alloc] init];
+    TBCanvasClusterIndex *clusterIndex = [[TBCanvasClusterIndex alloc] initWithBaseCellSize:128.0 levelCount:4];
+    TBCanvasAlignmentIndex *alignmentIndex = [[TBCanvasAlignmentIndex alloc] init];
+    TBCanvasGraphIndex *graphIndex = [[TBCanvasGraphIndex alloc] init];
+    TBCanvasRenderModel *renderModel = [[TBCanvasRenderModel alloc] init];
+    NSArray *edgeIndexes = @[clusterIndex, graphIndex, renderModel];
+    
+    [spatialIndex loadRects:rects count:3];
+    [clusterIndex loadRects:rects count:3];
+    [alignmentIndex loadRects:rects count:3];
+    [renderModel loadRects:rects count:3];
+    for (id index in edgeIndexes) {
+        [index addEdgeFromIndex:0 toIndex:1];
+        [index addEdgeFromIndex:1 toIndex:2];
+    }
+    [renderModel setLive:YES forIndex:2];
+    
+    // Insert at 1.
+    for (id index in @[spatialIndex, clusterIndex, alignmentIndex, graphIndex, renderModel]) {
+        [index shiftIndexesStartingAtIndex:1 by:1];
+    }
+    XCTAssertTrue(CGRectIsNull([spatialIndex rectForIndex:1]));
+    XCTAssertEqualObjects([spatialIndex indexesOfRectsIntersectingRect:rects[2]], [NSIndexSet indexSetWithIndex:3]);
+    XCTAssertNil([clusterIndex clusterForIndex:1 atLevel:0]);
+    XCTAssertTrue(CGRectEqualToRect([clusterIndex clusterForIndex:3 atLevel:0].bounds, rects[2]));
+    XCTAssertEqual([alignmentIndex alignmentOfRect:CGRectMake(600.0, 100.0, 40.0, 40.0) onAxis:TBCanvasAlignmentAxisX tolerance:1.0 excludingIndexes:nil].index, (NSUInteger)3);
+    XCTAssertEqualObjects([graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:0] direction:TBCanvasGraphDirectionDownstream],
+                          ([NSIndexSet indexSetWithIndexesInRange:NSMakeRange(2, 2)]));
+    XCTAssertEqual([graphIndex childCountOfIndex:1], (NSUInteger)0);
+    XCTAssertTrue([renderModel isLiveIndex:3]);
+    XCTAssertFalse([renderModel isLiveIndex:2]);
+    
+    // Delete the node at 2 after removing its edges. The renamed edges are found again.
+    for (id index in edgeIndexes) {
+        [index removeEdgeFromIndex:0 toIndex:2];
+        [index removeEdgeFromIndex:2 toIndex:3];
+    }
+    XCTAssertEqual([clusterIndex clusterForIndex:0 atLevel:0].bundles.count, (NSUInteger)0);
+    XCTAssertEqual(graphIndex.edgeCount, (NSUInteger)0);
+    
+    [spatialIndex removeIndex:2];
+    [clusterIndex removeIndex:2];
+    [alignmentIndex removeIndex:2];
+    for (id index in @[spatialIndex, clusterIndex, alignmentIndex, graphIndex, renderModel]) {
+        [index shiftIndexesStartingAtIndex:3 by:-1];
+    }
+    XCTAssertTrue(CGRectEqualToRect([spatialIndex rectForIndex:2], rects[2]));
+    XCTAssertTrue(CGRectIsNull([spatialIndex rectForIndex:3]));
+    XCTAssertTrue(CGRectEqualToRect([clusterIndex clusterForIndex:2 atLevel:0].bounds, rects[2]));
+    XCTAssertNil([clusterIndex clusterForIndex:3 atLevel:0]);
+    XCTAssertEqual([alignmentIndex alignmentOfRect:CGRectMake(300.0, 100.0, 40.0, 40.0) onAxis:TBCanvasAlignmentAxisX tolerance:1.0 excludingIndexes:nil].index, (NSUInteger)NSNotFound);
+    XCTAssertEqual([alignmentIndex alignmentOfRect:CGRectMake(600.0, 100.0, 40.0, 40.0) onAxis:TBCanvasAlignmentAxisX tolerance:1.0 excludingIndexes:nil].index, (NSUInteger)2);
+    XCTAssertTrue([renderModel isLiveIndex:2]);
+    XCTAssertFalse([renderModel isLiveIndex:3]);
+}
+
+- (void)testInsertAndDeleteKeepSectionIndexesInSync
+{
+    CanvasBenchmarkDataSource *dataSource = [self chainDataSourceWithNodeCount:100];
+    [self loadDataSource:dataSource];
+    
+    // Deleting splits the chain. Inserting moves the tags of the first part up again.
+    [_canvas deleteNodeAtIndexPath:[NSIndexPath indexPathForRow:50 inSection:0]];
+    TBCanvasNodeView *nodeView = [[TBCanvasNodeView alloc] initWithFrame:CGRectMake(5000.0, 5000.0, 40.0, 40.0)];
+    [dataSource.nodeViews insertObject:nodeView atIndex:20];
+    [_canvas insertNodeAtIndexPath:[NSIndexPath indexPathForRow:20 inSection:0]];
+    
+    XCTAssertEqual(nodeView.tag, (NSInteger)20);
+    XCTAssertEqualObjects([_canvas indexesOfNodesInSection:0 inRect:nodeView.frame], [NSIndexSet indexSetWithIndex:20]);
+    
+    NSMutableIndexSet *firstPart = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(1, 50)];
+    [firstPart removeIndex:20];
+    XCTAssertEqualObjects([_canvas indexesOfNodesReachableFromNodeAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:0] direction:TBCanvasGraphDirectionDownstream], firstPart);
+    XCTAssertEqualObjects([_canvas indexesOfNodesReachableFromNodeAtIndexPath:[NSIndexPath indexPathForRow:51 inSection:0] direction:TBCanvasGraphDirectionDownstream],
+                          [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(52, 48)]);
+    
+    NSMutableIndexSet *leaves = [NSMutableIndexSet indexSetWithIndex:20];
+    [leaves addIndex:50];
+    [leaves addIndex:99];
+    XCTAssertEqualObjects([_canvas indexesOfNodesInSection:0 withChildCountInRange:NSMakeRange(0, 1)], leaves);
+}
+
+- (void)testDataSourceWithoutSectionsIsLoadedAsSingleSection
+{
+    CanvasBenchmarkDataSource *dataSource = [self chainDataSourceWithNodeCount:100];
+    dataSource.sectionCount = 0;
+    [self loadDataSource:dataSource];
+    
+    TBCanvasNodeView *nodeView = [_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:50 inSection:0]];
+    XCTAssertEqual(nodeView, dataSource.nodeViews[50]);
+    XCTAssertEqual(nodeView.superview, _canvas);
+    XCTAssertEqual(nodeView.childConnections.count, (NSUInteger)1);
+    XCTAssertEqual([nodeView.childConnections.firstObject childNode], dataSource.nodeViews[51]);
+}
+
+#pragma mark - Multiple selection
+
+- (void)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView didMoveNodeAtIndexPath:(NSIndexPath *)indexPath nodeView:(TBCanvasItemView *)nodeView
+{
+    [_movedIndexPaths addObject:@[indexPath]];
+}
+
+- (void)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView didMoveSegmentOfNodesAtIndexPaths:(NSArray *)indexPaths nodeViews:(NSArray *)nodeViews
+{
+    [_movedIndexPaths addObject:indexPaths];
+}
+
+- (NSArray *)indexPathsForRows:(NSArray *)rows
+{
+    NSMutableArray *indexPaths = [[NSMutableArray alloc] init];
+    for (NSNumber *row in rows) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:row.integerValue inSection:0]];
+    }
+    return indexPaths;
+}
+
+- (void)testRubberBandAndLassoSelectionMoveAsGroup
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:1000]];
+    _canvas.canvasViewDelegate = self;
+    _movedIndexPaths = [[NSMutableArray alloc] init];
+    
+    UIBezierPath *lasso = [UIBezierPath bezierPath];
+    [lasso moveToPoint:CGPointMake(150.0, 150.0)];
+    [lasso addLineToPoint:CGPointMake(400.0, 150.0)];
+    [lasso addLineToPoint:CGPointMake(150.0, 400.0)];
+    [lasso closePath];
+    XCTAssertEqualObjects([_canvas selectNodesInLasso:lasso], ([self indexPathsForRows:@[@0, @1, @2, @100, @101, @200]]));
+    
+    NSArray *selection = [_canvas selectNodesInRect:CGRectMake(150.0, 150.0, 180.0, 120.0)];
+    XCTAssertEqualObjects(selection, ([self indexPathsForRows:@[@0, @1, @2, @100, @101, @102]]));
+    XCTAssertEqualObjects([_canvas indexPathsForSelectedNodes], selection);
+    
+    // Dragging one selected node moves the whole selection and reports it once.
+    CGPoint center = [_dataSource.nodeViews[100] center];
+    [self recordDragOfNodeWithTag:1 by:CGSizeMake(300.0, 100.0) steps:20];
+    
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[100] center].x, center.x + 300.0, 0.5);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[100] center].y, center.y + 100.0, 0.5);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[3] center].x, 380.0, 0.5);
+    XCTAssertEqual(_movedIndexPaths.count, (NSUInteger)1);
+    XCTAssertEqualObjects(_movedIndexPaths.firstObject, selection);
+    
+    // The spatial index follows the moved nodes.
+    XCTAssertEqualObjects([_canvas selectNodesInRect:CGRectMake(center.x + 295.0, center.y + 85.0, 10.0, 10.0)], ([self indexPathsForRows:@[@100]]));
+    
+    [_canvas deselectAllNodes];
+    XCTAssertEqual([_canvas indexPathsForSelectedNodes].count, (NSUInteger)0);
+}
+
+#pragma mark - Clustering
+
+- (void)testClusterIndexAggregatesItemsAndBundlesEdges
+{
+    TBCanvasClusterIndex *clusterIndex = [[TBCanvasClusterIndex alloc] initWithBaseCellSize:128.0 levelCount:4];
+    CGRect rects[] = {CGRectMake(0.0, 0.0, 20.0, 20.0), CGRectMake(40.0, 40.0, 20.0, 20.0), CGRectMake(290.0, 0.0, 20.0, 20.0), CGRectMake(290.0, 40.0, 20.0, 20.0)};
+    [clusterIndex loadRects:rects count:4];
+    [clusterIndex addEdgeFromIndex:0 toIndex:1];
+    [clusterIndex addEdgeFromIndex:0 toIndex:2];
+    [clusterIndex addEdgeFromIndex:1 toIndex:3];
+    
+    TBCanvasCluster *left = [clusterIndex clusterForIndex:0 atLevel:0];
+    TBCanvasCluster *right = [clusterIndex clusterForIndex:2 atLevel:0];
+    XCTAssertEqual(left.count, (NSUInteger)2);
+    XCTAssertEqual(left.internalEdgeCount, (NSUInteger)1);
+    XCTAssertTrue(CGRectEqualToRect(left.bounds, CGRectMake(0.0, 0.0, 60.0, 60.0)));
+    XCTAssertEqualObjects(left.bundles, @{@(right.cellKey) : @2});
+    XCTAssertEqual([clusterIndex clustersAtLevel:0 inRect:CGRectInfinite].count, (NSUInteger)2);
+    
+    // One level up both clusters are merged and all edges are internal.
+    TBCanvasCluster *merged = [clusterIndex clusterForIndex:0 atLevel:2];
+    XCTAssertEqual(merged, [clusterIndex clusterForIndex:3 atLevel:2]);
+    XCTAssertEqual(merged.count, (NSUInteger)4);
+    XCTAssertEqual(merged.internalEdgeCount, (NSUInteger)3);
+    XCTAssertEqual(merged.bundles.count, (NSUInteger)0);
+    
+    // Moving a single item updates the clusters and bundles it is part of.
+    [clusterIndex setRect:CGRectMake(0.0, 290.0, 20.0, 20.0) forIndex:3];
+    TBCanvasCluster *bottom = [clusterIndex clusterForIndex:3 atLevel:0];
+    XCTAssertEqual([clusterIndex clusterForIndex:2 atLevel:0].count, (NSUInteger)1);
+    XCTAssertEqualObjects(left.bundles, (@{@(right.cellKey) : @1, @(bottom.cellKey) : @1}));
+    XCTAssertEqual([clusterIndex clusterForIndex:0 atLevel:2].count, (NSUInteger)4);
+    
+    [clusterIndex removeEdgeFromIndex:1 toIndex:3];
+    XCTAssertEqualObjects(left.bundles, @{@(right.cellKey) : @1});
+}
+
+- (void)testSectionRebuildsClusterIndexLazilyWithoutCollapsedNodes
+{
+    TBCanvasSection *canvasSection = [[TBCanvasSection alloc] initWithSection:0];
+    for (NSUInteger i = 0; i < 3; i++) {
+        TBCanvasNodeView *nodeView = [[TBCanvasNodeView alloc] initWithFrame:CGRectMake(10.0 + i * 50.0, 10.0, 40.0, 40.0)];
+        [canvasSection insertNodeView:nodeView atIndex:i];
+    }
+    XCTAssertEqual([canvasSection.clusterIndex clusterForIndex:0 atLevel:2].count, (NSUInteger)3);
+    
+    // Collapsed node views are not counted.
+    TBCanvasNodeView *collapsedNodeView = canvasSection.nodeViews[2];
+    collapsedNodeView.isInCollapsedSegment = YES;
+    [canvasSection updateNodeView:collapsedNodeView];
+    XCTAssertNil([canvasSection.clusterIndex clusterForIndex:2 atLevel:2]);
+    XCTAssertEqual([canvasSection.clusterIndex clusterForIndex:0 atLevel:2].count, (NSUInteger)2);
+    
+    // Moved node views are found at their new position once the index is updated or read.
+    TBCanvasNodeView *movedNodeView = canvasSection.nodeViews[1];
+    for (NSUInteger i = 1; i <= 10; i++) {
+        movedNodeView.center = CGPointMake(movedNodeView.center.x + 200.0, movedNodeView.center.y + 200.0);
+        [canvasSection updateNodeView:movedNodeView];
+    }
+    [canvasSection updateClusterIndex];
+    XCTAssertTrue(CGRectEqualToRect([canvasSection.clusterIndex clusterForIndex:1 atLevel:2].bounds, movedNodeView.frame));
+    XCTAssertEqual([canvasSection.clusterIndex clusterForIndex:0 atLevel:2].count, (NSUInteger)1);
+    
+    collapsedNodeView.isInCollapsedSegment = NO;
+    [canvasSection updateNodeView:collapsedNodeView];
+    XCTAssertEqual([canvasSection.clusterIndex clusterForIndex:0 atLevel:2].count, (NSUInteger)2);
+}
+
+- (void)testCanvasClustersDoNotCountCollapsedNodes
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    [_canvas collapseSegment:_dataSource.nodeViews[50]];
+    
+    [_canvas zoomToScale:0.1];
+    NSUInteger count = 0;
+    for (TBCanvasClusterView *clusterView in [self clusterViewsOnCanvas]) {
+        count += clusterView.count;
+    }
+    XCTAssertEqual(count, (NSUInteger)51);
+}
+
+- (NSUInteger)countOfNodesInClusterViews
+{
+    NSUInteger count = 0;
+    for (TBCanvasClusterView *clusterView in [self clusterViewsOnCanvas]) {
+        count += clusterView.count;
+    }
+    return count;
+}
+
+- (void)testCanvasClustersFollowEditsWhileShowingClusters
+{
+    CanvasBenchmarkDataSource *dataSource = [self chainDataSourceWithNodeCount:100];
+    [self loadDataSource:dataSource];
+    [_canvas zoomToScale:0.1];
+    XCTAssertEqual([self countOfNodesInClusterViews], (NSUInteger)100);
+    
+    [_canvas collapseSegment:dataSource.nodeViews[50]];
+    XCTAssertEqual([self countOfNodesInClusterViews], (NSUInteger)51);
+    
+    [_canvas expandSegment:dataSource.nodeViews[50]];
+    XCTAssertEqual([self countOfNodesInClusterViews], (NSUInteger)100);
+    
+    [_canvas deleteNodeAtIndexPath:[NSIndexPath indexPathForRow:99 inSection:0]];
+    XCTAssertEqual([self countOfNodesInClusterViews], (NSUInteger)99);
+    
+    TBCanvasNodeView *nodeView = [[TBCanvasNodeView alloc] initWithFrame:CGRectMake(230.0, 300.0, 40.0, 40.0)];
+    [dataSource.nodeViews insertObject:nodeView atIndex:20];
+    [_canvas insertNodeAtIndexPath:[NSIndexPath indexPathForRow:20 inSection:0]];
+    XCTAssertEqual([self countOfNodesInClusterViews], (NSUInteger)100);
+}
+
+- (NSArray *)clusterViewsOnCanvas
+{
+    NSMutableArray *clusterViews = [[NSMutableArray alloc] init];
+    for (UIView *subview in _canvas.subviews) {
+        if ([subview isKindOfClass:[TBCanvasClusterView class]]) {
+            [clusterViews addObject:subview];
+        }
+    }
+    return clusterViews;
+}
+
+- (void)testCanvasShowsClustersBelowClusteringZoomScale
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    XCTAssertFalse(_canvas.isShowingClusters);
+    XCTAssertEqual([self clusterViewsOnCanvas].count, (NSUInteger)0);
+    
+    [_canvas zoomToScale:0.1];
+    XCTAssertTrue(_canvas.isShowingClusters);
+    XCTAssertTrue([_dataSource.nodeViews[50] isHidden]);
+    
+    NSArray *clusterViews = [self clusterViewsOnCanvas];
+    XCTAssertTrue(clusterViews.count > 1);
+    XCTAssertTrue(clusterViews.count < _dataSource.nodeViews.count);
+    NSUInteger count = 0;
+    for (TBCanvasClusterView *clusterView in clusterViews) {
+        count += clusterView.count;
+    }
+    XCTAssertEqual(count, _dataSource.nodeViews.count);
+    
+    // Zooming further out reuses the cluster views.
+    [_canvas zoomToScale:0.05];
+    NSArray *fewerClusterViews = [self clusterViewsOnCanvas];
+    XCTAssertTrue(fewerClusterViews.count < clusterViews.count);
+    XCTAssertTrue([[NSSet setWithArray:fewerClusterViews] isSubsetOfSet:[NSSet setWithArray:clusterViews]]);
+    
+    [_canvas zoomToScale:0.5];
+    XCTAssertFalse(_canvas.isShowingClusters);
+    XCTAssertFalse([_dataSource.nodeViews[50] isHidden]);
+    XCTAssertEqual([self clusterViewsOnCanvas].count, (NSUInteger)0);
+}
+
+#pragma mark - Tiled rendering
+
+- (NSData *)pixelsOfImage:(CGImageRef)image
+{
+    CFDataRef data = CGDataProviderCopyData(CGImageGetDataProvider(image));
+    return (__bridge_transfer NSData *)data;
+}
+
+- (uint8_t)alphaOfImage:(CGImageRef)image atPixel:(CGPoint)pixel
+{
+    NSData *pixels = [self pixelsOfImage:image];
+    const uint8_t *bytes = pixels.bytes;
+    return bytes[(size_t)pixel.y * CGImageGetBytesPerRow(image) + (size_t)pixel.x * 4 + 3];
+}
+
+- (void)testRenderModelDrawsTilesDeterministicallyAndInvalidatesOnlyTouchedRegions
+{
+    TBCanvasRenderModel *renderModel = [[TBCanvasRenderModel alloc] init];
+    NSMutableArray *invalidatedRects = [[NSMutableArray alloc] init];
+    renderModel.invalidationHandler = ^(CGRect rect) {
+        [invalidatedRects addObject:[NSValue valueWithCGRect:rect]];
+    };
+    
+    CGRect rects[] = {CGRectMake(0.0, 0.0, 40.0, 40.0), CGRectMake(200.0, 100.0, 40.0, 40.0), CGRectMake(2000.0, 2000.0, 40.0, 40.0)};
+    [renderModel loadRects:rects count:3];
+    [renderModel addEdgeFromIndex:0 toIndex:1];
+    
+    // Drawing is a pure function of the model.
+    CGRect tileRect = CGRectMake(0.0, 0.0, 256.0, 256.0);
+    CGImageRef tile = [renderModel newImageForRect:tileRect scale:2.0];
+    CGImageRef sameTile = [renderModel newImageForRect:tileRect scale:2.0];
+    XCTAssertEqual(CGImageGetWidth(tile), (size_t)512);
+    XCTAssertEqualObjects([self pixelsOfImage:tile], [self pixelsOfImage:sameTile]);
+    XCTAssertEqual([self alphaOfImage:tile atPixel:CGPointMake(440.0, 240.0)], (uint8_t)255);
+    XCTAssertEqual([self alphaOfImage:tile atPixel:CGPointMake(20.0, 400.0)], (uint8_t)0);
+    CGImageRelease(sameTile);
+    
+    // Live nodes and their connections are left out.
+    [invalidatedRects removeAllObjects];
+    [renderModel setLive:YES forIndex:1];
+    XCTAssertEqual(invalidatedRects.count, (NSUInteger)1);
+    XCTAssertTrue(CGRectContainsRect([invalidatedRects[0] CGRectValue], CGRectUnion(rects[0], rects[1])));
+    
+    CGImageRef liveTile = [renderModel newImageForRect:tileRect scale:2.0];
+    XCTAssertEqual([self alphaOfImage:liveTile atPixel:CGPointMake(440.0, 240.0)], (uint8_t)0);
+    XCTAssertEqual([self alphaOfImage:liveTile atPixel:CGPointMake(40.0, 40.0)], (uint8_t)255);
+    CGImageRelease(liveTile);
+    
+    // Moving a live node touches no tile. Moving a static node touches only the tiles around it.
+    [invalidatedRects removeAllObjects];
+    [renderModel setRect:CGRectMake(300.0, 100.0, 40.0, 40.0) forIndex:1];
+    XCTAssertEqual(invalidatedRects.count, (NSUInteger)0);
+    
+    [renderModel setRect:CGRectMake(2100.0, 2000.0, 40.0, 40.0) forIndex:2];
+    XCTAssertEqual(invalidatedRects.count, (NSUInteger)1);
+    XCTAssertFalse(CGRectIntersectsRect([invalidatedRects[0] CGRectValue], tileRect));
+    
+    [renderModel setLive:NO forIndex:1];
+    CGImageRef staticTile = [renderModel newImageForRect:tileRect scale:2.0];
+    XCTAssertNotEqualObjects([self pixelsOfImage:staticTile], [self pixelsOfImage:tile]);
+    CGImageRelease(staticTile);
+    CGImageRelease(tile);
+}
+
+- (void)testTiledRenderingPromotesOnlyTouchedNodeViews
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.tiledRenderingEnabled = YES;
+    
+    TBCanvasNodeView *nodeView = _dataSource.nodeViews[10];
+    TBCanvasConnectionView *connection = nodeView.childConnections.firstObject;
+    XCTAssertTrue(nodeView.isHidden);
+    XCTAssertTrue(connection.isHidden);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:10 location:nodeView.center];
+    XCTAssertFalse(nodeView.isHidden);
+    XCTAssertFalse(connection.isHidden);
+    XCTAssertTrue([_dataSource.nodeViews[11] isHidden]);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:10 location:CGPointMake(nodeView.center.x, nodeView.center.y + 100.0)];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:10 location:nodeView.center];
+    XCTAssertTrue(nodeView.isHidden);
+    XCTAssertTrue(connection.isHidden);
+    
+    // Edited nodes stay live until editing ends.
+    [_canvas setEditing:YES forNodeAtIndexPath:nodeView.indexPath];
+    XCTAssertFalse(nodeView.isHidden);
+    [_canvas setEditing:NO forNodeAtIndexPath:nodeView.indexPath];
+    XCTAssertTrue(nodeView.isHidden);
+    
+    _canvas.tiledRenderingEnabled = NO;
+    XCTAssertFalse(nodeView.isHidden);
+    XCTAssertFalse(connection.isHidden);
+}
+
+- (void)testTiledRenderingHitTestDoesNotPromote
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.tiledRenderingEnabled = YES;
+    
+    TBCanvasNodeView *nodeView = _dataSource.nodeViews[10];
+    XCTAssertEqual([_canvas hitTest:nodeView.center withEvent:nil], nodeView);
+    XCTAssertTrue(nodeView.isHidden);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:10 location:nodeView.center];
+    XCTAssertFalse(nodeView.isHidden);
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:10 location:nodeView.center];
+    XCTAssertTrue(nodeView.isHidden);
+}
+
+- (void)testTiledRenderingKeepsCollapsedSegmentsLive
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.tiledRenderingEnabled = YES;
+    
+    TBCanvasNodeView *headNode = _dataSource.nodeViews[50];
+    [_canvas collapseSegment:headNode];
+    XCTAssertFalse(headNode.isHidden);
+    XCTAssertFalse([_dataSource.nodeViews[99] isHidden]);
+    XCTAssertTrue([_dataSource.nodeViews[49] isHidden]);
+    
+    // Touching another node demotes everything but the collapsed segment.
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:10 location:[_dataSource.nodeViews[10] center]];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:10 location:[_dataSource.nodeViews[10] center]];
+    XCTAssertTrue([_dataSource.nodeViews[10] isHidden]);
+    XCTAssertFalse(headNode.isHidden);
+    XCTAssertFalse([_dataSource.nodeViews[99] isHidden]);
+    
+    // Reloading keeps the segment live.
+    [_canvas reloadSection:0];
+    XCTAssertFalse([_dataSource.nodeViews[99] isHidden]);
+    
+    // The expanded node views return into the tiles after their animation.
+    [_canvas expandSegment:headNode];
+    XCTAssertFalse([_dataSource.nodeViews[99] isHidden]);
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    XCTAssertTrue(headNode.isHidden);
+    XCTAssertTrue([_dataSource.nodeViews[99] isHidden]);
+}
+
+#pragma mark - Export
+
+- (NSData *)exportedDataOfExporter:(TBCanvasExporter *)exporter format:(TBCanvasExportFormat)format
+{
+    NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+    [stream open];
+    
+    NSError *error = nil;
+    BOOL success = (format == TBCanvasExportFormatSVG) ? [exporter writeSVGToStream:stream error:&error] : [exporter writePNGToStream:stream error:&error];
+    XCTAssertTrue(success);
+    XCTAssertNil(error);
+    
+    NSData *data = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    [stream close];
+    return data;
+}
+
+- (void)testExporterStreamsSVGAndPNGTileByTile
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    NSArray *renderModels = [_canvas renderModelsForExport];
+    
+    // Every node and connection is written exactly once, no matter how many tiles it overlaps.
+    TBCanvasExporter *exporter = [[TBCanvasExporter alloc] initWithRenderModels:renderModels];
+    exporter.tileSize = 100.0;
+    NSString *svg = [[NSString alloc] initWithData:[self exportedDataOfExporter:exporter format:TBCanvasExportFormatSVG] encoding:NSUTF8StringEncoding];
+    XCTAssertTrue([svg hasPrefix:@"<?xml"]);
+    XCTAssertTrue([svg hasSuffix:@"</svg>\n"]);
+    XCTAssertEqual([svg componentsSeparatedByString:@"<rect "].count - 1, (NSUInteger)101);
+    XCTAssertEqual([svg componentsSeparatedByString:@"<path "].count - 1, (NSUInteger)99);
+    
+    // Rasterizing in strips of a few rows gives the same image as rasterizing in a single strip.
+    size_t width = (size_t)ceil(exporter.rect.size.width);
+    size_t height = (size_t)ceil(exporter.rect.size.height);
+    exporter.maximumBufferSize = width * 4 * 7;
+    UIImage *stripImage = [UIImage imageWithData:[self exportedDataOfExporter:exporter format:TBCanvasExportFormatPNG]];
+    
+    exporter.maximumBufferSize = width * 4 * height;
+    UIImage *wholeImage = [UIImage imageWithData:[self exportedDataOfExporter:exporter format:TBCanvasExportFormatPNG]];
+    
+    XCTAssertEqual(CGImageGetWidth(stripImage.CGImage), width);
+    XCTAssertEqual(CGImageGetHeight(stripImage.CGImage), height);
+    
+    NSData *stripPixels = [self pixelsOfImage:stripImage.CGImage];
+    NSData *wholePixels = [self pixelsOfImage:wholeImage.CGImage];
+    XCTAssertEqual(stripPixels.length, wholePixels.length);
+    
+    const uint8_t *stripBytes = stripPixels.bytes;
+    const uint8_t *wholeBytes = wholePixels.bytes;
+    NSUInteger differences = 0;
+    for (NSUInteger i = 0; i < MIN(stripPixels.length, wholePixels.length); i++) {
+        if (abs(stripBytes[i] - wholeBytes[i]) > 2) {
+            differences++;
+        }
+    }
+    XCTAssertEqual(differences, (NSUInteger)0);
+    
+    // Exporting an empty canvas fails without writing anything.
+    TBCanvasExporter *emptyExporter = [[TBCanvasExporter alloc] initWithRenderModels:@[]];
+    NSError *error = nil;
+    XCTAssertFalse([emptyExporter writePNGToStream:[NSOutputStream outputStreamToMemory] error:&error]);
+    XCTAssertEqualObjects(error.domain, TBCanvasExporterErrorDomain);
+}
+
+#pragma mark - Alignment guides
+
+- (CGFloat)bruteForceAlignmentDistanceOfRect:(CGRect)rect rects:(const CGRect *)rects count:(NSUInteger)count excludingIndex:(NSUInteger)excludedIndex
+{
+    CGFloat queryLines[3] = {CGRectGetMinX(rect), CGRectGetMidX(rect), CGRectGetMaxX(rect)};
+    CGFloat distance = CGFLOAT_MAX;
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        if (i == excludedIndex) {
+            continue;
+        }
+        CGFloat lines[3] = {CGRectGetMinX(rects[i]), CGRectGetMidX(rects[i]), CGRectGetMaxX(rects[i])};
+        for (NSUInteger q = 0; q < 3; q++) {
+            for (NSUInteger l = 0; l < 3; l++) {
+                distance = MIN(distance, fabs(lines[l] - queryLines[q]));
+            }
+        }
+    }
+    return distance;
+}
+
+- (void)testAlignmentIndexFindsNearestLinesAndSkipsMovedRects
+{
+    TBCanvasAlignmentIndex *alignmentIndex = [[TBCanvasAlignmentIndex alloc] init];
+    CGRect rects[] = {CGRectMake(0.0, 0.0, 40.0, 40.0), CGRectMake(100.0, 200.0, 40.0, 40.0), CGRectMake(300.0, 50.0, 80.0, 20.0)};
+    [alignmentIndex loadRects:rects count:3];
+    
+    // The left edge of the query is 3 points right of the center line of rect 1.
+    CGRect query = CGRectMake(123.0, 500.0, 200.0, 10.0);
+    TBCanvasAlignment alignment = [alignmentIndex alignmentOfRect:query onAxis:TBCanvasAlignmentAxisX tolerance:5.0 excludingIndexes:nil];
+    XCTAssertEqual(alignment.index, (NSUInteger)1);
+    XCTAssertEqualWithAccuracy(alignment.offset, -3.0, 0.001);
+    XCTAssertEqualWithAccuracy(alignment.guide, 120.0, 0.001);
+    
+    XCTAssertEqual([alignmentIndex alignmentOfRect:query onAxis:TBCanvasAlignmentAxisY tolerance:5.0 excludingIndexes:nil].index, (NSUInteger)NSNotFound);
+    XCTAssertEqual([alignmentIndex alignmentOfRect:query onAxis:TBCanvasAlignmentAxisX tolerance:5.0 excludingIndexes:[NSIndexSet indexSetWithIndex:1]].index, (NSUInteger)NSNotFound);
+    
+    // Moved rectangles are found at their new position only.
+    [alignmentIndex setRect:CGRectMake(224.0, 50.0, 80.0, 20.0) forIndex:2];
+    alignment = [alignmentIndex alignmentOfRect:query onAxis:TBCanvasAlignmentAxisX tolerance:5.0 excludingIndexes:nil];
+    XCTAssertEqual(alignment.index, (NSUInteger)2);
+    XCTAssertEqualWithAccuracy(alignment.offset, 1.0, 0.001);
+    
+    [alignmentIndex removeIndex:2];
+    XCTAssertEqual([alignmentIndex alignmentOfRect:query onAxis:TBCanvasAlignmentAxisX tolerance:5.0 excludingIndexes:nil].index, (NSUInteger)1);
+    
+    // Queries match a brute force search while many rectangles move and get merged into the sorted lists.
+    NSUInteger count = 1000;
+    CGRect *randomRects = malloc(count * sizeof(CGRect));
+    srand48(42);
+    for (NSUInteger i = 0; i < count; i++) {
+        randomRects[i] = CGRectMake(drand48() * 10000.0, drand48() * 10000.0, 20.0 + drand48() * 60.0, 20.0 + drand48() * 60.0);
+    }
+    [alignmentIndex loadRects:randomRects count:count];
+    
+    for (NSUInteger step = 0; step < 500; step++) {
+        NSUInteger index = (NSUInteger)(drand48() * count);
+        randomRects[index] = CGRectOffset(randomRects[index], drand48() * 100.0 - 50.0, 0.0);
+        [alignmentIndex setRect:randomRects[index] forIndex:index];
+        
+        CGRect randomQuery = CGRectMake(drand48() * 10000.0, 0.0, 40.0, 40.0);
+        alignment = [alignmentIndex alignmentOfRect:randomQuery onAxis:TBCanvasAlignmentAxisX tolerance:4.0 excludingIndexes:[NSIndexSet indexSetWithIndex:index]];
+        CGFloat distance = [self bruteForceAlignmentDistanceOfRect:randomQuery rects:randomRects count:count excludingIndex:index];
+        
+        if (distance > 4.0) {
+            XCTAssertEqual(alignment.index, (NSUInteger)NSNotFound);
+        } else {
+            XCTAssertNotEqual(alignment.index, index);
+            XCTAssertEqualWithAccuracy(fabs(alignment.offset), distance, 0.0001);
+        }
+    }
+    free(randomRects);
+}
+
+- (void)testAlignmentQueriesOnLargeCanvasPerformance
+{
+    // 50000 rectangles. A dragged one moves and is snapped every frame while the pending list is filled and merged.
+    NSUInteger count = 50000;
+    CGRect *randomRects = malloc(count * sizeof(CGRect));
+    srand48(42);
+    for (NSUInteger i = 0; i < count; i++) {
+        randomRects[i] = CGRectMake(drand48() * 100000.0, drand48() * 100000.0, 20.0 + drand48() * 60.0, 20.0 + drand48() * 60.0);
+    }
+    TBCanvasAlignmentIndex *alignmentIndex = [[TBCanvasAlignmentIndex alloc] init];
+    [alignmentIndex loadRects:randomRects count:count];
+    
+    [self measureBlock:^{
+        NSUInteger foundCount = 0;
+        for (NSUInteger step = 0; step < 2000; step++) {
+            NSUInteger index = (NSUInteger)(drand48() * count);
+            randomRects[index] = CGRectOffset(randomRects[index], drand48() * 10.0 - 5.0, drand48() * 10.0 - 5.0);
+            [alignmentIndex setRect:randomRects[index] forIndex:index];
+            
+            NSIndexSet *excludedIndexes = [NSIndexSet indexSetWithIndex:index];
+            foundCount += ([alignmentIndex alignmentOfRect:randomRects[index] onAxis:TBCanvasAlignmentAxisX tolerance:8.0 excludingIndexes:excludedIndexes].index != NSNotFound);
+            foundCount += ([alignmentIndex alignmentOfRect:randomRects[index] onAxis:TBCanvasAlignmentAxisY tolerance:8.0 excludingIndexes:excludedIndexes].index != NSNotFound);
+        }
+        XCTAssertGreaterThan(foundCount, (NSUInteger)0);
+    }];
+    free(randomRects);
+}
+
+- (void)testDraggedNodeSnapsToNeighbours
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    
+    // Without snapping the node ends up exactly where it is dropped.
+    [self recordDragOfNodeWithTag:10 by:CGSizeMake(0.0, 203.0) steps:10];
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[10] center].y, 403.0, 0.001);
+    
+    // Dropped 2 points right of and 3 points below node 31 it snaps onto its edges and center lines.
+    _canvas.snappingEnabled = YES;
+    [self recordDragOfNodeWithTag:20 by:CGSizeMake(662.0, 3.0) steps:10];
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[20] center].x, [_dataSource.nodeViews[31] center].x, 0.001);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[20] center].y, [_dataSource.nodeViews[31] center].y, 0.001);
+    
+    // Nodes out of reach do not snap.
+    [self recordDragOfNodeWithTag:40 by:CGSizeMake(0.0, 100.0) steps:10];
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[40] center].x, 2600.0, 0.001);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[40] center].y, 300.0, 0.001);
+}
+
+#pragma mark - Frame arena
+
+- (void)testFrameArenaReusesMemoryOfItsBusiestFrame
+{
+    TBCanvasArena *arena = [[TBCanvasArena alloc] initWithCapacity:64];
+    
+    // The last buffer grows in place, a frame larger than the block falls back to the heap.
+    void *bytes = [arena allocateBytes:48];
+    XCTAssertTrue([arena reallocateBytes:bytes fromSize:48 toSize:64] == bytes);
+    XCTAssertEqual(arena.heapAllocationCount, (NSUInteger)0);
+    
+    [arena allocateBytes:100];
+    NSMutableArray *array = [arena borrowArray];
+    [array addObject:@1];
+    XCTAssertEqual(arena.heapAllocationCount, (NSUInteger)2);
+    
+    // The block grows to the size of that frame.
+    [arena reset];
+    XCTAssertEqual(arena.heapAllocationCount, (NSUInteger)3);
+    XCTAssertEqual(arena.capacity, (size_t)176);
+    XCTAssertEqual(arena.bytesInUse, (size_t)0);
+    
+    [arena resetCounters];
+    for (NSInteger frame = 0; frame < 10; frame++) {
+        bytes = [arena allocateBytes:48];
+        [arena reallocateBytes:bytes fromSize:48 toSize:64];
+        [arena allocateBytes:100];
+        
+        NSMutableArray *borrowedArray = [arena borrowArray];
+        XCTAssertTrue(borrowedArray == array);
+        XCTAssertEqual(borrowedArray.count, (NSUInteger)0);
+        [borrowedArray addObject:@(frame)];
+        [arena reset];
+    }
+    XCTAssertEqual(arena.allocationCount, (NSUInteger)40);
+    XCTAssertEqual(arena.heapAllocationCount, (NSUInteger)0);
+}
+
+- (NSInteger)heapBlockGrowthOfDragOfNodeWithTag:(NSInteger)nodeTag from:(CGPoint)start frameCount:(NSInteger)frameCount
+{
+    malloc_statistics_t before;
+    malloc_zone_statistics(NULL, &before);
+    
+    for (NSInteger i = 6; i < 6 + frameCount; i++) {
+        [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:nodeTag location:CGPointMake(start.x + 3.0 * i, start.y + 2.0 * i)];
+    }
+    
+    malloc_statistics_t after;
+    malloc_zone_statistics(NULL, &after);
+    return (NSInteger)after.blocks_in_use - (NSInteger)before.blocks_in_use;
+}
+
+- (void)measureSteadyStateDragOfNodeWithTag:(NSInteger)nodeTag
+{
+    CGPoint start = [_dataSource.nodeViews[nodeTag] center];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:nodeTag location:start];
+    
+    // The first frames fill the arena and its pools.
+    for (NSInteger i = 1; i <= 5; i++) {
+        [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:nodeTag location:CGPointMake(start.x + 3.0 * i, start.y + 2.0 * i)];
+    }
+    [_canvas.frameArena resetCounters];
+    
+    // Heap blocks still in use after the frames. Autoreleased objects are not released before the end of the test and are counted as well.
+    // A steady state does not allocate per frame - ten times as many frames leave no more blocks behind.
+    __block NSInteger growthOverFewFrames = 0;
+    __block NSInteger growthOverManyFrames = 0;
+    [self measureBlock:^{
+        growthOverFewFrames = MAX(growthOverFewFrames, [self heapBlockGrowthOfDragOfNodeWithTag:nodeTag from:start frameCount:5]);
+        growthOverManyFrames = MAX(growthOverManyFrames, [self heapBlockGrowthOfDragOfNodeWithTag:nodeTag from:start frameCount:50]);
+    }];
+    
+    XCTAssertGreaterThan(_canvas.frameArena.allocationCount, (NSUInteger)0);
+    XCTAssertEqual(_canvas.frameArena.heapAllocationCount, (NSUInteger)0);
+    XCTAssertLessThanOrEqual(growthOverManyFrames, growthOverFewFrames, @"%ld heap blocks allocated in 50 frames, %ld in 5 frames", (long)growthOverManyFrames, (long)growthOverFewFrames);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:nodeTag location:CGPointMake(start.x + 165.0, start.y + 110.0)];
+}
+
+- (void)testSteadyStateDragOfCollapsedSegmentPerformance
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:1000]];
+    _canvas.snappingEnabled = YES;
+    [_canvas collapseSegment:_dataSource.nodeViews[500]];
+    
+    [self measureSteadyStateDragOfNodeWithTag:500];
+}
+
+- (void)testSteadyStateDragOfSelectionPerformance
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:1000]];
+    _canvas.snappingEnabled = YES;
+    [_canvas selectNodesInRect:CGRectMake(150.0, 150.0, 180.0, 120.0)];
+    
+    [self measureSteadyStateDragOfNodeWithTag:1];
+}
+
+- (void)testMovingSelectionOutsideAFrameResetsTheArena
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    [_canvas collapseSegment:_dataSource.nodeViews[50]];
+    [_canvas selectNodesInRect:CGRectMake(3190.0, 190.0, 60.0, 60.0)];
+    
+    [_canvas moveSelectedNodesBy:CGSizeMake(100.0, 100.0)];
+    XCTAssertEqual(_canvas.frameArena.bytesInUse, (size_t)0);
+}
+
+#pragma mark - Synchronization
+
+- (TBCollectionCanvasContentView *)remoteCanvasWithDataSource:(CanvasBenchmarkDataSource *)dataSource site:(uint32_t)site
+{
+    TBCollectionCanvasContentView *canvas = [[TBCollectionCanvasContentView alloc] initWithFrame:_canvas.frame];
+    canvas.canvasViewDataSource = dataSource;
+    [canvas fillCanvas];
+    canvas.syncEngine = [[TBCanvasSyncEngine alloc] initWithSite:site];
+    return canvas;
+}
+
+- (void)testSyncEngineMergesBatchesPerFieldWithLastWriterWins
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.syncEngine = [[TBCanvasSyncEngine alloc] initWithSite:1];
+    
+    CanvasBenchmarkDataSource *remoteDataSource = [self chainDataSourceWithNodeCount:100];
+    TBCollectionCanvasContentView *remoteCanvas = [self remoteCanvasWithDataSource:remoteDataSource site:2];
+    
+    // Dragging a node three times sends only its last position.
+    [self recordDragOfNodeWithTag:10 by:CGSizeMake(0.0, 100.0) steps:10];
+    [self recordDragOfNodeWithTag:10 by:CGSizeMake(50.0, 0.0) steps:10];
+    [self recordDragOfNodeWithTag:10 by:CGSizeMake(0.0, 80.0) steps:10];
+    XCTAssertEqual(_canvas.syncEngine.pendingDeltaCount, (NSUInteger)1);
+    
+    NSData *batch = [_canvas.syncEngine takePendingBatch];
+    XCTAssertEqual(batch.length, (NSUInteger)40);
+    XCTAssertNil([_canvas.syncEngine takePendingBatch]);
+    
+    XCTAssertTrue([remoteCanvas.syncEngine applyBatch:batch error:NULL]);
+    XCTAssertEqualWithAccuracy([remoteDataSource.nodeViews[10] center].x, [_dataSource.nodeViews[10] center].x, 0.001);
+    XCTAssertEqualWithAccuracy([remoteDataSource.nodeViews[10] center].y, [_dataSource.nodeViews[10] center].y, 0.001);
+    
+    // Applied edits are not sent back.
+    XCTAssertEqual(remoteCanvas.syncEngine.pendingDeltaCount, (NSUInteger)0);
+    XCTAssertEqual(remoteCanvas.syncEngine.appliedDeltaCount, (NSUInteger)1);
+    
+    // Concurrent moves of the same node converge on the newer edit - equal clocks are ordered by site.
+    [self recordDragOfNodeWithTag:20 by:CGSizeMake(0.0, 100.0) steps:10];
+    [remoteCanvas selectNodesInRect:[remoteDataSource.nodeViews[20] frame]];
+    [remoteCanvas moveSelectedNodesBy:CGSizeMake(0.0, 200.0)];
+    [remoteCanvas collapseSegment:remoteDataSource.nodeViews[50]];
+    
+    NSData *localBatch = [_canvas.syncEngine takePendingBatch];
+    NSData *remoteBatch = [remoteCanvas.syncEngine takePendingBatch];
+    XCTAssertEqual([TBCanvasSyncEngine countOfDeltasInBatch:remoteBatch], (NSUInteger)2);
+    XCTAssertTrue([_canvas.syncEngine applyBatch:remoteBatch error:NULL]);
+    XCTAssertTrue([remoteCanvas.syncEngine applyBatch:localBatch error:NULL]);
+    
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[20] center].y, 400.0, 0.001);
+    XCTAssertEqualWithAccuracy([remoteDataSource.nodeViews[20] center].y, 400.0, 0.001);
+    XCTAssertEqual(remoteCanvas.syncEngine.discardedDeltaCount, (NSUInteger)1);
+    XCTAssertTrue([_dataSource.nodeViews[50] hasCollapsedSubStructure]);
+    
+    // Remote connection edits.
+    TBCanvasDelta deltas[2] = {
+        {TBCanvasDeltaKindAddConnection, 0, 5, 40, CGPointZero, remoteCanvas.syncEngine.clock + 1, 2},
+        {TBCanvasDeltaKindRemoveConnection, 0, 30, 31, CGPointZero, remoteCanvas.syncEngine.clock + 1, 2}
+    };
+    XCTAssertTrue([_canvas.syncEngine applyBatch:[TBCanvasSyncEngine batchWithDeltas:deltas count:2] error:NULL]);
+    XCTAssertEqual([_dataSource.nodeViews[5] childConnections].count, (NSUInteger)2);
+    XCTAssertEqual([_dataSource.nodeViews[30] childConnections].count, (NSUInteger)0);
+    XCTAssertEqual([_dataSource.nodeViews[31] parentConnections].count, (NSUInteger)0);
+    XCTAssertEqual(_canvas.syncEngine.pendingDeltaCount, (NSUInteger)0);
+    
+    // Replaying an old batch changes nothing.
+    XCTAssertTrue([_canvas.syncEngine applyBatch:remoteBatch error:NULL]);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[20] center].y, 400.0, 0.001);
+    XCTAssertFalse([_canvas.syncEngine applyBatch:[NSData dataWithBytes:"TBSY" length:4] error:NULL]);
+    
+    [remoteCanvas clearCanvas];
+}
+
+- (void)testSyncEngineRejectsBatchesOfAnotherEpoch
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.syncEngine = [[TBCanvasSyncEngine alloc] initWithSite:1];
+    
+    CanvasBenchmarkDataSource *remoteDataSource = [self chainDataSourceWithNodeCount:100];
+    TBCollectionCanvasContentView *remoteCanvas = [self remoteCanvasWithDataSource:remoteDataSource site:2];
+    
+    // Deleting a node drops the pending edits of its section - their tags name other node views now.
+    [self recordDragOfNodeWithTag:60 by:CGSizeMake(0.0, 100.0) steps:10];
+    XCTAssertEqual(_canvas.syncEngine.pendingDeltaCount, (NSUInteger)1);
+    [_canvas deleteNodeAtIndexPath:[NSIndexPath indexPathForRow:50 inSection:0]];
+    XCTAssertEqual(_canvas.syncEngine.epoch, (uint16_t)1);
+    XCTAssertEqual(_canvas.syncEngine.pendingDeltaCount, (NSUInteger)0);
+    
+    // Edits recorded before the deletion are rejected.
+    CGPoint center = [_dataSource.nodeViews[70] center];
+    [remoteCanvas selectNodesInRect:[remoteDataSource.nodeViews[70] frame]];
+    [remoteCanvas moveSelectedNodesBy:CGSizeMake(0.0, 200.0)];
+    NSData *staleBatch = [remoteCanvas.syncEngine takePendingBatch];
+    NSError *error = nil;
+    XCTAssertFalse([_canvas.syncEngine applyBatch:staleBatch error:&error]);
+    XCTAssertEqual(error.code, (NSInteger)2);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[70] center].y, center.y, 0.001);
+    
+    // Both canvases meet again in the same epoch.
+    [remoteCanvas deleteNodeAtIndexPath:[NSIndexPath indexPathForRow:50 inSection:0]];
+    [remoteCanvas deselectAllNodes];
+    [remoteCanvas selectNodesInRect:[remoteDataSource.nodeViews[10] frame]];
+    [remoteCanvas moveSelectedNodesBy:CGSizeMake(0.0, 200.0)];
+    NSData *batch = [remoteCanvas.syncEngine takePendingBatch];
+    XCTAssertEqual([TBCanvasSyncEngine epochOfBatch:batch], (uint16_t)1);
+    XCTAssertTrue([_canvas.syncEngine applyBatch:batch error:NULL]);
+    XCTAssertEqualWithAccuracy([_dataSource.nodeViews[10] center].y, [remoteDataSource.nodeViews[10] center].y, 0.001);
+    
+    // Compacting keeps the newest epoch only.
+    NSData *compactedBatch = [TBCanvasSyncEngine compactedBatchWithBatches:@[staleBatch, batch]];
+    XCTAssertEqual([TBCanvasSyncEngine epochOfBatch:compactedBatch], (uint16_t)1);
+    XCTAssertEqual([TBCanvasSyncEngine countOfDeltasInBatch:compactedBatch], (NSUInteger)1);
+    
+    [remoteCanvas clearCanvas];
+}
+
+- (void)testSyncEngineCompactsBatchesToNewestDeltaPerField
+{
+    TBCanvasDelta firstDeltas[3] = {
+        {TBCanvasDeltaKindMoveNode, 0, 10, 0, CGPointMake(100.0, 100.0), 1, 1},
+        {TBCanvasDeltaKindAddConnection, 0, 5, 40, CGPointZero, 2, 1},
+        {TBCanvasDeltaKindCollapseNode, 1, 50, 0, CGPointZero, 3, 2}
+    };
+    TBCanvasDelta secondDeltas[3] = {
+        {TBCanvasDeltaKindMoveNode, 0, 10, 0, CGPointMake(200.0, 100.0), 4, 2},
+        {TBCanvasDeltaKindRemoveConnection, 0, 5, 40, CGPointZero, 5, 1},
+        {TBCanvasDeltaKindMoveNode, 0, 10, 0, CGPointMake(300.0, 100.0), 3, 1}
+    };
+    NSArray *batches = @[[TBCanvasSyncEngine batchWithDeltas:firstDeltas count:3],
+                         [NSData dataWithBytes:"TBSY" length:4],
+                         [TBCanvasSyncEngine batchWithDeltas:secondDeltas count:3]];
+    
+    // The older move arriving last is dropped. The connection keeps its removal.
+    NSData *batch = [TBCanvasSyncEngine compactedBatchWithBatches:batches];
+    XCTAssertEqual([TBCanvasSyncEngine countOfDeltasInBatch:batch], (NSUInteger)3);
+    
+    TBCanvasDelta collapse = [TBCanvasSyncEngine deltaAtIndex:0 inBatch:batch];
+    TBCanvasDelta move = [TBCanvasSyncEngine deltaAtIndex:1 inBatch:batch];
+    TBCanvasDelta connection = [TBCanvasSyncEngine deltaAtIndex:2 inBatch:batch];
+    XCTAssertEqual(collapse.kind, TBCanvasDeltaKindCollapseNode);
+    XCTAssertEqual(collapse.section, (uint16_t)1);
+    XCTAssertEqual(move.kind, TBCanvasDeltaKindMoveNode);
+    XCTAssertEqualWithAccuracy(move.location.x, 200.0, 0.001);
+    XCTAssertEqual(connection.kind, TBCanvasDeltaKindRemoveConnection);
+    
+    XCTAssertEqual([TBCanvasSyncEngine countOfDeltasInBatch:[TBCanvasSyncEngine compactedBatchWithBatches:@[]]], (NSUInteger)0);
+}
+
+- (BOOL)runLoopUntil:(BOOL (^)(void))condition
+{
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:5.0];
+    while (condition() == NO && [timeout timeIntervalSinceNow] > 0.0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+    return condition();
+}
+
+- (void)testSyncServerRelaysBatchesOverLoopback
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.syncEngine = [[TBCanvasSyncEngine alloc] initWithSite:1];
+    
+    CanvasBenchmarkDataSource *remoteDataSource = [self chainDataSourceWithNodeCount:100];
+    TBCollectionCanvasContentView *remoteCanvas = [self remoteCanvasWithDataSource:remoteDataSource site:2];
+    
+    TBCanvasSyncServer *server = [[TBCanvasSyncServer alloc] init];
+    XCTAssertTrue([server startOnPort:0 error:NULL]);
+    XCTAssertGreaterThan(server.port, 0);
+    
+    TBCanvasSyncClient *client = [[TBCanvasSyncClient alloc] initWithSyncEngine:_canvas.syncEngine];
+    TBCanvasSyncClient *remoteClient = [[TBCanvasSyncClient alloc] initWithSyncEngine:remoteCanvas.syncEngine];
+    XCTAssertTrue([client connectToPort:server.port error:NULL]);
+    XCTAssertTrue([remoteClient connectToPort:server.port error:NULL]);
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return server.clientCount == 2; }]);
+    
+    [self recordDragOfNodeWithTag:10 by:CGSizeMake(0.0, 100.0) steps:10];
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return [remoteDataSource.nodeViews[10] center].y == [_dataSource.nodeViews[10] center].y; }]);
+    
+    [remoteCanvas collapseSegment:remoteDataSource.nodeViews[50]];
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return [_dataSource.nodeViews[50] hasCollapsedSubStructure]; }]);
+    XCTAssertEqual(server.batchCount, (NSUInteger)2);
+    
+    // A late client catches up from the history.
+    CanvasBenchmarkDataSource *lateDataSource = [self chainDataSourceWithNodeCount:100];
+    TBCollectionCanvasContentView *lateCanvas = [self remoteCanvasWithDataSource:lateDataSource site:3];
+    TBCanvasSyncClient *lateClient = [[TBCanvasSyncClient alloc] initWithSyncEngine:lateCanvas.syncEngine];
+    XCTAssertTrue([lateClient connectToPort:server.port error:NULL]);
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return [lateDataSource.nodeViews[50] hasCollapsedSubStructure]; }]);
+    XCTAssertEqualWithAccuracy([lateDataSource.nodeViews[10] center].y, [_dataSource.nodeViews[10] center].y, 0.001);
+    
+    [client disconnect];
+    [remoteClient disconnect];
+    [lateClient disconnect];
+    [server stop];
+    [remoteCanvas clearCanvas];
+    [lateCanvas clearCanvas];
+}
+
+- (void)testSyncServerCompactsHistory
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.syncEngine = [[TBCanvasSyncEngine alloc] initWithSite:1];
+    
+    TBCanvasSyncServer *server = [[TBCanvasSyncServer alloc] init];
+    XCTAssertTrue([server startOnPort:0 error:NULL]);
+    
+    TBCanvasSyncClient *client = [[TBCanvasSyncClient alloc] initWithSyncEngine:_canvas.syncEngine];
+    XCTAssertTrue([client connectToPort:server.port error:NULL]);
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return server.clientCount == 1; }]);
+    
+    // Every drag is sent in a batch of its own.
+    for (NSUInteger i = 0; i < 100; i++) {
+        [self recordDragOfNodeWithTag:(i % 2) ? 10 : 20 by:CGSizeMake(0.0, 10.0) steps:2];
+        XCTAssertTrue([self runLoopUntil:^BOOL{ return server.batchCount == i + 1; }]);
+    }
+    [_canvas collapseSegment:_dataSource.nodeViews[50]];
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return server.batchCount == 101; }]);
+    XCTAssertLessThanOrEqual(server.historyBatchCount, (NSUInteger)33);
+    
+    // A late client catches up from the snapshot.
+    CanvasBenchmarkDataSource *lateDataSource = [self chainDataSourceWithNodeCount:100];
+    TBCollectionCanvasContentView *lateCanvas = [self remoteCanvasWithDataSource:lateDataSource site:3];
+    TBCanvasSyncClient *lateClient = [[TBCanvasSyncClient alloc] initWithSyncEngine:lateCanvas.syncEngine];
+    XCTAssertTrue([lateClient connectToPort:server.port error:NULL]);
+    XCTAssertTrue([self runLoopUntil:^BOOL{ return [lateDataSource.nodeViews[50] hasCollapsedSubStructure]; }]);
+    XCTAssertEqualWithAccuracy([lateDataSource.nodeViews[10] center].y, [_dataSource.nodeViews[10] center].y, 0.001);
+    XCTAssertEqualWithAccuracy([lateDataSource.nodeViews[20] center].y, [_dataSource.nodeViews[20] center].y, 0.001);
+    
+    [client disconnect];
+    [lateClient disconnect];
+    [server stop];
+    [lateCanvas clearCanvas];
+}
+
+#pragma mark - Queries
+
+- (NSUInteger)rangeCountOfIndexes:(NSIndexSet *)indexes
+{
+    __block NSUInteger rangeCount = 0;
+    [indexes enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        rangeCount++;
+    }];
+    return rangeCount;
+}
+
+- (void)testGraphIndexAnswersReachabilityAndDegreeQueries
+{
+    TBCanvasGraphIndex *graphIndex = [[TBCanvasGraphIndex alloc] init];
+    graphIndex.nodeCount = 8;
+    
+    // 0 -> 1 -> 2 -> 3 -> 1 (cycle), 0 -> 4, 5 -> 4, 6 and 7 unconnected.
+    [graphIndex addEdgeFromIndex:0 toIndex:1];
+    [graphIndex addEdgeFromIndex:1 toIndex:2];
+    [graphIndex addEdgeFromIndex:2 toIndex:3];
+    [graphIndex addEdgeFromIndex:3 toIndex:1];
+    [graphIndex addEdgeFromIndex:0 toIndex:4];
+    [graphIndex addEdgeFromIndex:5 toIndex:4];
+    XCTAssertEqual(graphIndex.edgeCount, (NSUInteger)6);
+    
+    NSIndexSet *downstream = [graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:0] direction:TBCanvasGraphDirectionDownstream];
+    XCTAssertEqualObjects(downstream, [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(1, 4)]);
+    XCTAssertEqual([self rangeCountOfIndexes:downstream], (NSUInteger)1);
+    
+    // A start node is part of the result only when it lies on a cycle.
+    NSIndexSet *cycle = [graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:2] direction:TBCanvasGraphDirectionDownstream];
+    XCTAssertEqualObjects(cycle, [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(1, 3)]);
+    
+    NSMutableIndexSet *upstream = [NSMutableIndexSet indexSetWithIndex:0];
+    [upstream addIndex:5];
+    XCTAssertEqualObjects([graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:4] direction:TBCanvasGraphDirectionUpstream], upstream);
+    
+    NSMutableIndexSet *roots = [NSMutableIndexSet indexSetWithIndex:0];
+    [roots addIndexesInRange:NSMakeRange(5, 3)];
+    XCTAssertEqualObjects([graphIndex indexesWithParentCountInRange:NSMakeRange(0, 1)], roots);
+    
+    NSMutableIndexSet *joins = [NSMutableIndexSet indexSetWithIndex:1];
+    [joins addIndex:4];
+    XCTAssertEqualObjects([graphIndex indexesWithParentCountInRange:NSMakeRange(2, 10)], joins);
+    
+    // Removing an edge only touches its two nodes.
+    [graphIndex removeEdgeFromIndex:3 toIndex:1];
+    XCTAssertEqual([graphIndex parentCountOfIndex:1], (NSUInteger)1);
+    XCTAssertEqual([graphIndex childCountOfIndex:3], (NSUInteger)0);
+    
+    NSMutableIndexSet *leaves = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(3, 2)];
+    [leaves addIndexesInRange:NSMakeRange(6, 2)];
+    XCTAssertEqualObjects([graphIndex indexesWithChildCountInRange:NSMakeRange(0, 1)], leaves);
+}
+
+- (void)testCanvasQueriesReturnRowsAndHighlightThemInOneLayer
+{
+    CanvasBenchmarkDataSource *dataSource = [self chainDataSourceWithNodeCount:1000];
+    NSMutableArray *weights = [[NSMutableArray alloc] init];
+    for (NSInteger i = 0; i < 1000; i++) {
+        [weights addObject:(i % 100 == 0) ? (id)[NSNull null] : @(i % 10)];
+    }
+    dataSource.attributeValues[@"weight"] = weights;
+    [self loadDataSource:dataSource];
+    
+    XCTAssertEqualObjects([_canvas indexesOfNodesReachableFromNodeAtIndexPath:[NSIndexPath indexPathForRow:990 inSection:0] direction:TBCanvasGraphDirectionDownstream],
+                          [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(991, 9)]);
+    XCTAssertEqualObjects([_canvas indexesOfNodesReachableFromNodeAtIndexPath:[NSIndexPath indexPathForRow:3 inSection:0] direction:TBCanvasGraphDirectionUpstream],
+                          [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 3)]);
+    XCTAssertEqualObjects([_canvas indexesOfNodesInSection:0 withParentCountInRange:NSMakeRange(0, 1)], [NSIndexSet indexSetWithIndex:0]);
+    XCTAssertEqualObjects([_canvas indexesOfNodesInSection:0 withChildCountInRange:NSMakeRange(0, 1)], [NSIndexSet indexSetWithIndex:999]);
+    XCTAssertEqualObjects([_canvas indexesOfNodesInSection:0 inRect:CGRectMake(150.0, 150.0, 180.0, 60.0)], [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 3)]);
+    
+    // NSNull values never match.
+    NSIndexSet *zeroWeights = [_canvas indexesOfNodesInSection:0 whereAttribute:@"weight" matchesPredicate:[NSPredicate predicateWithFormat:@"SELF == 0"]];
+    XCTAssertEqual(zeroWeights.count, (NSUInteger)90);
+    XCTAssertFalse([zeroWeights containsIndex:0]);
+    XCTAssertTrue([zeroWeights containsIndex:10]);
+    XCTAssertEqual([_canvas indexesOfNodesInSection:0 whereAttribute:@"missing" matchesPredicate:[NSPredicate predicateWithValue:YES]].count, (NSUInteger)0);
+    
+    // Connections added later are part of the queries.
+    TBCanvasDelta addition = {TBCanvasDeltaKindAddConnection, 0, 995, 10, CGPointZero, 0, 0};
+    [_canvas applySyncDeltas:&addition count:1];
+    XCTAssertEqualObjects([_canvas indexesOfNodesReachableFromNodeAtIndexPath:[NSIndexPath indexPathForRow:990 inSection:0] direction:TBCanvasGraphDirectionDownstream],
+                          [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(10, 990)]);
+    
+    // Highlights follow deleted rows and are dropped with their section.
+    _canvas.highlightStyle = TBCanvasHighlightStyleDimOthers;
+    [_canvas highlightNodesWithIndexes:zeroWeights inSection:0];
+    XCTAssertEqualObjects([_canvas indexesOfHighlightedNodesInSection:0], zeroWeights);
+    
+    [_canvas deleteNodeAtIndexPath:[NSIndexPath indexPathForRow:5 inSection:0]];
+    XCTAssertTrue([[_canvas indexesOfHighlightedNodesInSection:0] containsIndex:9]);
+    XCTAssertFalse([[_canvas indexesOfHighlightedNodesInSection:0] containsIndex:10]);
+    
+    [_canvas reloadSection:0];
+    XCTAssertEqual([_canvas indexesOfHighlightedNodesInSection:0].count, (NSUInteger)0);
+    
+    [_canvas highlightNodesWithIndexes:[NSIndexSet indexSetWithIndex:1] inSection:0];
+    [_canvas removeAllHighlights];
+    XCTAssertEqual([_canvas indexesOfHighlightedNodesInSection:0].count, (NSUInteger)0);
+}
+
+- (CAShapeLayer *)highlightLayer
+{
+    for (CALayer *layer in _canvas.layer.sublayers) {
+        if ([layer isKindOfClass:[CAShapeLayer class]] && [layer.delegate isKindOfClass:[UIView class]] == NO) {
+            return (CAShapeLayer *)layer;
+        }
+    }
+    return nil;
+}
+
+- (void)testHighlightsFollowDraggedNodesAndDimTheirUnion
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    _canvas.highlightStyle = TBCanvasHighlightStyleDimOthers;
+    [_canvas highlightNodesWithIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 2)] inSection:0];
+    
+    CAShapeLayer *highlightLayer = [self highlightLayer];
+    XCTAssertNotNil(highlightLayer);
+    XCTAssertTrue(CGPathContainsPoint(highlightLayer.path, NULL, CGPointMake(10.0, 10.0), true));
+    
+    // The highlight moves with the node view during the drag.
+    CGPoint start = [_dataSource.nodeViews[1] center];
+    CGPoint location = CGPointMake(start.x - 40.0, start.y);
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:1 location:start];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:1 location:location];
+    XCTAssertFalse(highlightLayer.hidden);
+    XCTAssertFalse(CGPathContainsPoint(highlightLayer.path, NULL, location, true));
+    XCTAssertTrue(CGPathContainsPoint(highlightLayer.path, NULL, CGPointMake(start.x + 15.0, start.y), true));
+    
+    // The overlap of both highlighted frames stays undimmed.
+    CGPoint overlap = CGPointMake(CGRectGetMaxX([_dataSource.nodeViews[0] frame]) - 5.0, start.y);
+    XCTAssertTrue(CGRectContainsPoint([_dataSource.nodeViews[1] frame], overlap));
+    XCTAssertFalse(CGPathContainsPoint(highlightLayer.path, NULL, overlap, true));
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:1 location:location];
+    XCTAssertFalse(CGPathContainsPoint([self highlightLayer].path, NULL, overlap, true));
+}
+
+static void TBCountRectsOfPath(void *info, const CGPathElement *element)
+{
+    if (element->type == kCGPathElementMoveToPoint) {
+        (*(NSUInteger *)info)++;
+    }
+}
+
+- (NSUInteger)countOfRectsInUnionOfRects:(CGRect *)rects count:(NSUInteger)count
+{
+    CGMutablePathRef path = CGPathCreateMutable();
+    [_canvas addUnionOfRects:rects count:count toPath:path];
+    NSUInteger rectCount = 0;
+    CGPathApply(path, &rectCount, TBCountRectsOfPath);
+    CGPathRelease(path);
+    return rectCount;
+}
+
+- (void)testUnionOfRectsMergesAdjacentBandsWithEqualSpans
+{
+    // Overlapping rectangles of equal width are a single rectangle.
+    CGRect column[3] = {CGRectMake(0.0, 0.0, 100.0, 50.0), CGRectMake(0.0, 25.0, 100.0, 50.0), CGRectMake(0.0, 60.0, 100.0, 10.0)};
+    XCTAssertEqual([self countOfRectsInUnionOfRects:column count:3], (NSUInteger)1);
+    
+    // A grid of touching rectangles is one rectangle per column.
+    CGRect grid[100];
+    for (NSUInteger i = 0; i < 100; i++) {
+        grid[i] = CGRectMake((i % 10) * 100.0, (i / 10) * 50.0, 40.0, 50.0);
+    }
+    XCTAssertEqual([self countOfRectsInUnionOfRects:grid count:100], (NSUInteger)10);
+    
+    // Bands with different spans stay apart.
+    CGRect step[2] = {CGRectMake(0.0, 0.0, 100.0, 100.0), CGRectMake(200.0, 0.0, 50.0, 50.0)};
+    XCTAssertEqual([self countOfRectsInUnionOfRects:step count:2], (NSUInteger)3);
+    XCTAssertEqual([self countOfRectsInUnionOfRects:NULL count:0], (NSUInteger)0);
+}
+
+- (void)testReachabilityAndDegreeQueriesOnLargeGraphPerformance
+{
+    // A random tree of 100000 nodes with an additional shared child every 10 nodes.
+    TBCanvasGraphIndex *graphIndex = [[TBCanvasGraphIndex alloc] init];
+    graphIndex.nodeCount = 100000;
+    srand48(42);
+    for (NSUInteger i = 1; i < 100000; i++) {
+        [graphIndex addEdgeFromIndex:(NSUInteger)(drand48() * i) toIndex:i];
+        if (i % 10 == 0) {
+            [graphIndex addEdgeFromIndex:(NSUInteger)(drand48() * i) toIndex:i];
+        }
+    }
+    
+    [self measureBlock:^{
+        NSIndexSet *downstream = [graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:0] direction:TBCanvasGraphDirectionDownstream];
+        XCTAssertEqual(downstream.count, (NSUInteger)99999);
+        
+        NSIndexSet *leaves = [graphIndex indexesWithChildCountInRange:NSMakeRange(0, 1)];
+        XCTAssertGreaterThan(leaves.count, (NSUInteger)0);
+    }];
+}
+
+#pragma mark - Concurrent gestures
+
+- (void)testInteractionsMergeAutoscrollDistancesPerAxis
+{
+    TBCanvasInteraction *first = [[TBCanvasInteraction alloc] initWithItemView:nil];
+    TBCanvasInteraction *second = [[TBCanvasInteraction alloc] initWithItemView:nil];
+    TBCanvasInteraction *third = [[TBCanvasInteraction alloc] initWithItemView:nil];
+    first.autoscrollDistance = CGPointMake(2.0, 0.0);
+    second.autoscrollDistance = CGPointMake(-1.0, -2.0);
+    third.autoscrollDistance = CGPointMake(0.0, 2.0);
+    
+    // The strongest distance wins on each axis, opposing distances of equal strength cancel out.
+    CGPoint distance = [TBCanvasInteraction mergedAutoscrollDistanceOfInteractions:@[first, second, third]];
+    XCTAssertEqual(distance.x, (CGFloat)2.0);
+    XCTAssertEqual(distance.y, (CGFloat)0.0);
+    
+    third.autoscrollDistance = CGPointMake(0.0, 1.0);
+    distance = [TBCanvasInteraction mergedAutoscrollDistanceOfInteractions:@[first, second, third]];
+    XCTAssertEqual(distance.x, (CGFloat)2.0);
+    XCTAssertEqual(distance.y, (CGFloat)-2.0);
+    
+    distance = [TBCanvasInteraction mergedAutoscrollDistanceOfInteractions:@[]];
+    XCTAssertTrue(CGPointEqualToPoint(distance, CGPointZero));
+}
+
+- (void)testConcurrentGesturesKeepTheirOwnState
+{
+    CanvasBenchmarkDataSource *dataSource = [self chainDataSourceWithNodeCount:200];
+    [dataSource connectParent:20 child:150];
+    [self loadDataSource:dataSource];
+    [_canvas collapseSegment:_dataSource.nodeViews[100]];
+    [_canvas toggleConnectMode];
+    
+    TBCanvasNodeView *headNode = _dataSource.nodeViews[100];
+    TBCanvasNodeView *singleNode = _dataSource.nodeViews[50];
+    TBCanvasNodeView *parentNode = _dataSource.nodeViews[10];
+    TBCanvasNodeView *targetNode = _dataSource.nodeViews[30];
+    CGPoint headStart = headNode.center;
+    CGPoint singleStart = singleNode.center;
+    CGPoint handleStart = parentNode.connectionHandle.center;
+    
+    // Drag a collapsed segment, a single node and a connection handle at the same time.
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:100 location:headStart];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:50 location:singleStart];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseBegan nodeTag:10 location:handleStart];
+    XCTAssertFalse([_canvas isInSingleTouchMode]);
+    
+    // Node views moved with another gesture can not be grabbed.
+    XCTAssertFalse([_canvas canProcessCanvasNodeView:_dataSource.nodeViews[150]]);
+    XCTAssertTrue([_canvas canProcessCanvasNodeView:_dataSource.nodeViews[60]]);
+    
+    // Nor the handles of those node views.
+    TBCanvasCreateHandleView *createHandle = [[TBCanvasCreateHandleView alloc] initWithFrame:CGRectZero];
+    createHandle.nodeView = _dataSource.nodeViews[150];
+    XCTAssertFalse([_canvas canProcessCanvasCreateHandle:createHandle]);
+    createHandle.nodeView = _dataSource.nodeViews[60];
+    XCTAssertTrue([_canvas canProcessCanvasCreateHandle:createHandle]);
+    
+    TBCanvasMoveHandleView *moveHandle = [[TBCanvasMoveHandleView alloc] initWithFrame:CGRectZero];
+    for (TBCanvasConnectionView *connection in [_dataSource.nodeViews[20] childConnections]) {
+        if (connection.childNode == _dataSource.nodeViews[150]) {
+            moveHandle.connection = connection;
+        }
+    }
+    XCTAssertNotNil(moveHandle.connection);
+    XCTAssertFalse([_canvas canProcessCanvasMoveHandle:moveHandle]);
+    moveHandle.connection = [_dataSource.nodeViews[60] childConnections].firstObject;
+    XCTAssertTrue([_canvas canProcessCanvasMoveHandle:moveHandle]);
+    
+    // Neither can the ends of a connection dragged by a handle.
+    XCTAssertFalse([_canvas canProcessCanvasNodeView:parentNode]);
+    TBCanvasConnectionView *movedConnection = [_dataSource.nodeViews[1] childConnections].firstObject;
+    XCTAssertNotNil(movedConnection.moveConnectionHandle);
+    CGPoint moveHandleStart = movedConnection.moveConnectionHandle.center;
+    TBCanvasTouchTraceEvent moveHandleEvent = {TBCanvasTouchTraceTargetMoveHandle, TBCanvasTouchTracePhaseBegan, 1, 0, moveHandleStart, 0.0};
+    [_canvas processTouchTraceEvent:moveHandleEvent];
+    XCTAssertFalse([_canvas canProcessCanvasNodeView:_dataSource.nodeViews[1]]);
+    XCTAssertFalse([_canvas canProcessCanvasNodeView:_dataSource.nodeViews[2]]);
+    
+    // Cancelling the handle gesture frees both node views.
+    moveHandleEvent.phase = TBCanvasTouchTracePhaseCancelled;
+    [_canvas processTouchTraceEvent:moveHandleEvent];
+    XCTAssertTrue([_canvas canProcessCanvasNodeView:_dataSource.nodeViews[1]]);
+    XCTAssertTrue([_canvas canProcessCanvasNodeView:_dataSource.nodeViews[2]]);
+    
+    NSInteger steps = 10;
+    for (NSInteger i = 1; i <= steps; i++) {
+        [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:100 location:CGPointMake(headStart.x + 30.0 * i, headStart.y + 20.0 * i)];
+        [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseMoved nodeTag:10 location:CGPointMake(handleStart.x + (targetNode.center.x - handleStart.x) * i / steps, handleStart.y + (targetNode.center.y - handleStart.y) * i / steps)];
+        [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:50 location:CGPointMake(singleStart.x, singleStart.y + 30.0 * i)];
+    }
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:100 location:CGPointMake(headStart.x + 300.0, headStart.y + 200.0)];
+    XCTAssertTrue([_canvas isProcessingViews]);
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseEnded nodeTag:10 location:targetNode.center];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:50 location:CGPointMake(singleStart.x, singleStart.y + 300.0)];
+    XCTAssertFalse([_canvas isProcessingViews]);
+    
+    // Every gesture has moved its own items only.
+    XCTAssertEqualWithAccuracy(headNode.center.x, headStart.x + 300.0, 0.01);
+    XCTAssertEqualWithAccuracy(headNode.center.y, headStart.y + 200.0, 0.01);
+    XCTAssertTrue(CGPointEqualToPoint([_dataSource.nodeViews[150] center], headNode.center));
+    XCTAssertEqualWithAccuracy(singleNode.center.x, singleStart.x, 0.01);
+    XCTAssertEqualWithAccuracy(singleNode.center.y, singleStart.y + 300.0, 0.01);
+    XCTAssertTrue(CGPointEqualToPoint([_dataSource.nodeViews[51] center], CGPointMake(singleStart.x + 60.0, singleStart.y)));
+    
+    // The handle has connected its node view.
+    XCTAssertEqual(targetNode.parentConnections.count, (NSUInteger)2);
+    XCTAssertEqual([targetNode.parentConnections.lastObject parentNode], parentNode);
+    
+    [_canvas toggleConnectMode];
+}
+
+- (void)testAutoscrollMovesItemsOfAllGestures
+{
+    _canvas.scrollView = [[TBCollectionCanvasView alloc] initWithFrame:CGRectMake(0.0, 0.0, 400.0, 400.0)];
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    
+    // One finger rests on a node view while another drags a node view across the right edge.
+    TBCanvasNodeView *restingNode = _dataSource.nodeViews[1];
+    TBCanvasNodeView *draggedNode = _dataSource.nodeViews[5];
+    CGPoint restingStart = restingNode.center;
+    CGPoint draggedStart = draggedNode.center;
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:1 location:restingStart];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseBegan nodeTag:5 location:draggedStart];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseMoved nodeTag:5 location:CGPointMake(draggedStart.x + 10.0, draggedStart.y)];
+    
+    CGPoint offset = _canvas.scrollView.contentOffset;
+    CGPoint draggedCenter = draggedNode.center;
+    [_canvas autoScrollOnEdges];
+    XCTAssertGreaterThan(_canvas.scrollView.contentOffset.x, offset.x);
+    
+    // Both node views stay under their fingers.
+    CGFloat delta = draggedNode.center.x - draggedCenter.x;
+    XCTAssertGreaterThan(delta, 0.0);
+    XCTAssertEqualWithAccuracy(restingNode.center.x - restingStart.x, delta, 0.001);
+    XCTAssertEqualWithAccuracy(restingNode.center.y, restingStart.y, 0.001);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:5 location:draggedNode.center];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetNode phase:TBCanvasTouchTracePhaseEnded nodeTag:1 location:restingNode.center];
+    XCTAssertFalse([_canvas isProcessingViews]);
+}
+
+- (void)testHandleGesturesShareTheirTargetHighlight
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    [_canvas toggleConnectMode];
+    
+    TBCanvasNodeView *targetNode = _dataSource.nodeViews[30];
+    CGPoint empty = CGPointMake(100.0, 900.0);
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseBegan nodeTag:10 location:[_dataSource.nodeViews[10] connectionHandle].center];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseBegan nodeTag:11 location:[_dataSource.nodeViews[11] connectionHandle].center];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseMoved nodeTag:10 location:targetNode.center];
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseMoved nodeTag:11 location:targetNode.center];
+    XCTAssertTrue([[targetNode valueForKey:@"isSelected"] boolValue]);
+    
+    // The target stays highlighted as long as one handle is over it.
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseMoved nodeTag:10 location:empty];
+    XCTAssertTrue([[targetNode valueForKey:@"isSelected"] boolValue]);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseEnded nodeTag:11 location:targetNode.center];
+    XCTAssertFalse([[targetNode valueForKey:@"isSelected"] boolValue]);
+    XCTAssertEqual([targetNode.parentConnections.lastObject parentNode], _dataSource.nodeViews[11]);
+    
+    [self processEventWithTarget:TBCanvasTouchTraceTargetCreateHandle phase:TBCanvasTouchTracePhaseEnded nodeTag:10 location:empty];
+    XCTAssertEqual(targetNode.parentConnections.count, (NSUInteger)2);
+    XCTAssertFalse([_canvas isProcessingViews]);
+    
+    [_canvas toggleConnectMode];
+}
+
+#pragma mark - Scaling benchmarks
+
+- (TBCanvasGraphIndex *)graphIndexOfGenerator:(TBCanvasGraphGenerator *)generator
+{
+    TBCanvasGraphIndex *graphIndex = [[TBCanvasGraphIndex alloc] init];
+    graphIndex.nodeCount = generator.nodeCount;
+    
+    for (NSUInteger i = 0; i < generator.nodeCount; i++) {
+        const uint32_t *children = [generator childrenOfIndex:i];
+        for (NSUInteger j = 0; j < [generator childCountOfIndex:i]; j++) {
+            XCTAssertTrue(children[j] > i, @"edge %lu -> %u leads backwards", (unsigned long)i, children[j]);
+            [graphIndex addEdgeFromIndex:i toIndex:children[j]];
+        }
+    }
+    return graphIndex;
+}
+
+- (void)testGraphGeneratorsBuildConnectedAcyclicShapes
+{
+    NSUInteger nodeCount = 101;
+    NSIndexSet *allButRoot = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(1, nodeCount - 1)];
+    
+    for (TBCanvasGraphShape shape = TBCanvasGraphShapeTree; shape <= TBCanvasGraphShapeRandom; shape++) {
+        TBCanvasGraphGenerator *generator = [[TBCanvasGraphGenerator alloc] initWithShape:shape nodeCount:nodeCount seed:42];
+        TBCanvasGraphIndex *graphIndex = [self graphIndexOfGenerator:generator];
+        
+        XCTAssertEqual(graphIndex.edgeCount, generator.edgeCount);
+        XCTAssertEqualObjects([graphIndex indexesReachableFromIndexes:[NSIndexSet indexSetWithIndex:0] direction:TBCanvasGraphDirectionDownstream], allButRoot, @"%@", [TBCanvasGraphGenerator nameOfShape:shape]);
+        XCTAssertEqualObjects([graphIndex indexesWithParentCountInRange:NSMakeRange(0, 1)], [NSIndexSet indexSetWithIndex:0]);
+    }
+    
+    TBCanvasGraphGenerator *tree = [[TBCanvasGraphGenerator alloc] initWithShape:TBCanvasGraphShapeTree nodeCount:nodeCount seed:0];
+    XCTAssertEqual([tree childCountOfIndex:0], (NSUInteger)4);
+    XCTAssertEqual(tree.edgeCount, nodeCount - 1);
+    
+    TBCanvasGraphGenerator *fan = [[TBCanvasGraphGenerator alloc] initWithShape:TBCanvasGraphShapeFan nodeCount:nodeCount seed:0];
+    XCTAssertEqual([fan childCountOfIndex:0], nodeCount - 1);
+    
+    TBCanvasGraphGenerator *chain = [[TBCanvasGraphGenerator alloc] initWithShape:TBCanvasGraphShapeChain nodeCount:nodeCount seed:0];
+    XCTAssertEqualObjects([[self graphIndexOfGenerator:chain] indexesWithChildCountInRange:NSMakeRange(1, 1)], [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, nodeCount - 1)]);
+    
+    // Layers are 11 nodes wide. Below the first layer every node is shared by two parents.
+    TBCanvasGraphGenerator *sharedDAG = [[TBCanvasGraphGenerator alloc] initWithShape:TBCanvasGraphShapeSharedDAG nodeCount:nodeCount seed:0];
+    XCTAssertEqual([[self graphIndexOfGenerator:sharedDAG] indexesWithParentCountInRange:NSMakeRange(2, 1)].count, nodeCount - 1 - 11);
+    
+    // Random graphs only depend on their seed.
+    TBCanvasGraphGenerator *random = [[TBCanvasGraphGenerator alloc] initWithShape:TBCanvasGraphShapeRandom nodeCount:nodeCount seed:42];
+    TBCanvasGraphGenerator *sameRandom = [[TBCanvasGraphGenerator alloc] initWithShape:TBCanvasGraphShapeRandom nodeCount:nodeCount seed:42];
+    XCTAssertTrue(random.edgeCount > nodeCount);
+    XCTAssertEqual(random.edgeCount, sameRandom.edgeCount);
+    for (NSUInteger i = 0; i < nodeCount; i++) {
+        XCTAssertEqual([random childCountOfIndex:i], [sameRandom childCountOfIndex:i]);
+        XCTAssertTrue(memcmp([random childrenOfIndex:i], [sameRandom childrenOfIndex:i], [random childCountOfIndex:i] * sizeof(uint32_t)) == 0);
+    }
+}
+
+- (void)testScalingBenchmarks
+{
+    // Runs only when TB_CANVAS_BENCHMARK_MAX_NODES is set - to 1000000 for the full series. Set TB_CANVAS_BENCHMARK_OUTPUT to collect
+    // the results and TB_CANVAS_BENCHMARK_REVISION to the commit they belong to.
+    NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+    long long maxNodeCount = [environment[@"TB_CANVAS_BENCHMARK_MAX_NODES"] longLongValue];
+    if (maxNodeCount <= 0) {
+        return;
+    }
+    NSArray *nodeCounts = [TBCanvasBenchmark nodeCountsUpToNodeCount:(NSUInteger)maxNodeCount];
+    NSString *path = environment[@"TB_CANVAS_BENCHMARK_OUTPUT"];
+    if (path.length == 0) {
+        path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"canvas-benchmark.jsonl"];
+    }
+    
+    TBCanvasBenchmark *benchmark = [[TBCanvasBenchmark alloc] init];
+    for (NSNumber *nodeCount in nodeCounts) {
+        for (TBCanvasGraphShape shape = TBCanvasGraphShapeTree; shape <= TBCanvasGraphShapeRandom; shape++) {
+            [benchmark runOnGraph:[[TBCanvasGraphGenerator alloc] initWithShape:shape nodeCount:nodeCount.unsignedIntegerValue seed:42]];
+        }
+    }
+    
+    // Every graph yields all measurements.
+    NSArray *names = @[@"fill", @"collapse", @"expand", @"insert", @"delete", @"sizeToFit", @"dragNode", @"dragSegment", @"hitTest"];
+    XCTAssertEqual(benchmark.results.count, nodeCounts.count * 5 * names.count);
+    XCTAssertEqualObjects([NSSet setWithArray:[benchmark.results valueForKeyPath:@"benchmark"]], [NSSet setWithArray:names]);
+    
+    NSURL *url = [NSURL fileURLWithPath:path];
+    NSError *error = nil;
+    XCTAssertTrue([benchmark writeResultsToURL:url error:&error], @"%@", error);
+    
+    // One JSON object per line.
+    NSString *output = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:&error];
+    NSArray *lines = [[output stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]] componentsSeparatedByString:@"\n"];
+    XCTAssertEqual(lines.count, benchmark.results.count);
+    
+    NSDictionary *result = [NSJSONSerialization JSONObjectWithData:[lines.lastObject dataUsingEncoding:NSUTF8StringEncoding] options:0 error:&error];
+    XCTAssertEqualObjects(result[@"graph"], @"random");
+    XCTAssertEqualObjects(result[@"nodes"], nodeCounts.lastObject);
+    XCTAssertTrue([result[@"p50"] doubleValue] <= [result[@"max"] doubleValue]);
+    XCTAssertEqualObjects(result[@"revision"], benchmark.revision);
+}
+
+#pragma mark - Collapse / expand
+
+- (void)measureCollapseAndExpandWithNestedHeadNodes:(NSArray *)nestedHeadNodes
+{
+    TBCanvasNodeView *rootNode = [_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:0]];
+    
+    [self measureBlock:^{
+        
+        // Collapse bottom up - nested head nodes first.
+        for (NSNumber *tag in nestedHeadNodes.reverseObjectEnumerator) {
+            [_canvas collapseSegment:[_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:tag.integerValue inSection:0]]];
+        }
+        [_canvas collapseSegment:rootNode];
+        [_canvas expandSegment:rootNode];
+        
+        for (NSNumber *tag in nestedHeadNodes) {
+            [_canvas expandSegment:[_canvas nodeAtIndexPath:[NSIndexPath indexPathForRow:tag.integerValue inSection:0]]];
+        }
+    }];
+    
+    for (TBCanvasNodeView *nodeView in _dataSource.nodeViews) {
+        XCTAssertFalse(nodeView.isInCollapsedSegment, @"node view %li still collapsed", (long)nodeView.tag);
+    }
+}
+
+- (void)assertFrameOfNodeView:(TBCanvasNodeView *)nodeView equalsFrame:(CGRect)frame
+{
+    XCTAssertEqualWithAccuracy(nodeView.frame.origin.x, frame.origin.x, 0.001, @"node view %li", (long)nodeView.tag);
+    XCTAssertEqualWithAccuracy(nodeView.frame.origin.y, frame.origin.y, 0.001, @"node view %li", (long)nodeView.tag);
+    XCTAssertEqualWithAccuracy(nodeView.frame.size.width, frame.size.width, 0.001, @"node view %li", (long)nodeView.tag);
+    XCTAssertEqualWithAccuracy(nodeView.frame.size.height, frame.size.height, 0.001, @"node view %li", (long)nodeView.tag);
+}
+
+- (void)testExpandingAncestorRestoresFramesAndKeepsNestedSegmentCollapsed
+{
+    [self loadDataSource:[self chainDataSourceWithNodeCount:100]];
+    NSMutableArray *frames = [[NSMutableArray alloc] init];
+    for (TBCanvasNodeView *nodeView in _dataSource.nodeViews) {
+        [frames addObject:[NSValue valueWithCGRect:nodeView.frame]];
+    }
+    TBCanvasNodeView *ancestor = _dataSource.nodeViews[20];
+    TBCanvasNodeView *nestedHead = _dataSource.nodeViews[50];
+    
+    [_canvas collapseSegment:nestedHead];
+    [_canvas collapseSegment:ancestor];
+    XCTAssertEqual([_dataSource.nodeViews[30] headNodeTag], (NSInteger)20);
+    XCTAssertEqual(nestedHead.headNodeTag, (NSInteger)20);
+    XCTAssertEqual([_dataSource.nodeViews[60] headNodeTag], (NSInteger)50);
+    
+    // Node views between both heads return to their frames. The nested segment stays collapsed below its own head.
+    [_canvas expandSegment:ancestor];
+    XCTAssertFalse(ancestor.hasCollapsedSubStructure);
+    XCTAssertTrue(nestedHead.hasCollapsedSubStructure);
+    
+    for (NSInteger i = 21; i <= 50; i++) {
+        TBCanvasNodeView *nodeView = _dataSource.nodeViews[i];
+        XCTAssertFalse(nodeView.isInCollapsedSegment, @"node view %li", (long)i);
+        XCTAssertEqual(nodeView.headNodeTag, (NSInteger)-1);
+        [self assertFrameOfNodeView:nodeView equalsFrame:[frames[i] CGRectValue]];
+    }
+    for (NSInteger i = 51; i < 100; i++) {
+        TBCanvasNodeView *nodeView = _dataSource.nodeViews[i];
+        XCTAssertTrue(nodeView.isInCollapsedSegment, @"node view %li", (long)i);
+        XCTAssertEqual(nodeView.headNodeTag, (NSInteger)50);
+        XCTAssertEqualWithAccuracy(nodeView.center.x, nestedHead.center.x, 0.001);
+        XCTAssertEqualWithAccuracy(nodeView.center.y, nestedHead.center.y, 0.001);
+    }
+    
+    [_canvas expandSegment:nestedHead];
+    for (TBCanvasNodeView *nodeView in _dataSource.nodeViews) {
+        XCTAssertFalse(nodeView.isInCollapsedSegment, @"node view %li", (long)nodeView.tag);
+        XCTAssertEqual(nodeView.headNodeTag, (NSInteger)-1);
+        [self assertFrameOfNodeView:nodeView equalsFrame:[frames[nodeView.tag] CGRectValue]];
+    }
+}
+
+- (void)testCollapseAndExpandDeeplyNestedSegmentPerformance
+{
+    NSInteger depth = 1000;
+    NSMutableArray *nestedHeadNodes = [[NSMutableArray alloc] init];
+    
+    for (NSInteger i = 10; i < depth; i += 10) {
+        [nestedHeadNodes addObject:@(i)];
+    }
+    [self loadDataSource:[self chainDataSourceWithNodeCount:depth]];
+    [self measureCollapseAndExpandWithNestedHeadNodes:nestedHeadNodes];
+}
+
+- (void)testCollapseAndExpandWideSegmentPerformance
 {
-    XCTFail(@"No implementation for \"%s\"", __PRETTY_FUNCTION__);
+    NSInteger width = 2000;
+    CanvasBenchmarkDataSource *dataSource = [[CanvasBenchmarkDataSource alloc] initWithNodeCount:width + 1];
+    NSMutableArray *nestedHeadNodes = [[NSMutableArray alloc] init];
+    
+    // Root with a wide fan of children - every 100th child heads a small fan on its own.
+    for (NSInteger i = 1; i <= width; i++) {
+        if (i % 100 == 1 && i + 5 <= width) {
+            [dataSource connectParent:0 child:i];
+            [nestedHeadNodes addObject:@(i)];
+            for (NSInteger j = 1; j <= 5; j++) {
+                [dataSource connectParent:i child:i + j];
+            }
+            i += 5;
+        } else {
+            [dataSource connectParent:0 child:i];
+        }
+    }
+    [self loadDataSource:dataSource];
+    [self measureCollapseAndExpandWithNestedHeadNodes:nestedHeadNodes];
 }
 
 @end
@@ -0,0 +1,76 @@
+//
+//  TBCanvasBenchmark.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+@class TBCanvasGraphGenerator;
+
+/**
+ This class measures how a TBCollectionCanvasContentView scales with the size of its graph.
+ 
+ Every run loads a generated graph on a fresh canvas with a viewport of the size of a tablet screen and measures
+ - `fill`: filling and connecting the canvas
+ - `collapse` and `expand`: collapsing and expanding the root
+ - `insert` and `delete`: inserting and deleting a node in the middle of the section
+ - `sizeToFit`: sizing the canvas to fit
+ - `dragNode` and `dragSegment`: a single frame of dragging a node and the collapsed root
+ - `hitTest`: a single frame of dragging a connection handle across the node views
+ 
+ Each measurement yields one result with the percentiles of its samples and the revision it has been measured on. Results are written
+ as JSON Lines, one object per line, so they can be collected and compared over time by any tool on any platform.
+ */
+@interface TBCanvasBenchmark : NSObject
+
+/**
+ *  The number of repetitions of every measurement. Reduced for large graphs. Default is `5`.
+ */
+@property (assign, nonatomic) NSUInteger iterations;
+
+/**
+ *  The number of frames of every drag. Default is `30`.
+ */
+@property (assign, nonatomic) NSUInteger frameCount;
+
+/**
+ *  The commit or build identifier stored with every result. Defaults to the value of the environment variable TB_CANVAS_BENCHMARK_REVISION or `unknown`.
+ */
+@property (copy, nonatomic) NSString *revision;
+
+/**
+ *  The results of all runs so far as NSDictionary objects.
+ */
+@property (strong, nonatomic, readonly) NSArray *results;
+
+/**
+ Runs all measurements on a generated graph and appends their results.
+ 
+ @param graph The generated graph
+ */
+- (void)runOnGraph:(TBCanvasGraphGenerator *)graph;
+
+/**
+ Writes all results to a file as JSON Lines.
+ 
+ @param url   The URL of the file
+ @param error On return the error when the file could not be written.
+ 
+ @return `YES` when the results have been written.
+ */
+- (BOOL)writeResultsToURL:(NSURL *)url error:(NSError **)error;
+
+/**
+ Returns the node counts of a scaling series - all powers of ten from `100` up to a given maximum.
+ 
+ @param maxNodeCount The largest node count
+ 
+ @return The node counts as NSNumber objects in ascending order.
+ */
++ (NSArray *)nodeCountsUpToNodeCount:(NSUInteger)maxNodeCount;
+
+@end
@@ -0,0 +1,345 @@
+//
+//  TBCanvasBenchmark.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <QuartzCore/QuartzCore.h>
+
+#import "TBCanvasBenchmark.h"
+#import "TBCanvasGraphGenerator.h"
+#import "TBCollectionCanvasView.h"
+#import "TBCanvasConnectionView.h"
+#import "TBCanvasCreateHandleView.h"
+#import "TBCanvasMoveHandleView.h"
+
+static const CGRect     BENCHMARK_VIEWPORT      = {{0.0, 0.0}, {1024.0, 768.0}};
+static const CGFloat    BENCHMARK_NODE_SIZE     = 40.0;
+static const CGFloat    BENCHMARK_NODE_SPACING  = 60.0;
+static const CGFloat    BENCHMARK_ORIGIN        = 100.0;
+static const CGFloat    BENCHMARK_HANDLE_SIZE   = 20.0;
+static const CGSize     BENCHMARK_FRAME_STEP    = {3.0, 2.0};
+static const NSUInteger BENCHMARK_NODE_BUDGET   = 1000000;
+
+/**
+ Returns the distance a drag moves per frame in a given iteration. Drags go back and forth, so the dragged items stay inside the viewport.
+ */
+static CGSize TBCanvasBenchmarkFrameStep(NSUInteger iteration)
+{
+    return (iteration % 2 == 0) ? BENCHMARK_FRAME_STEP : CGSizeMake(-BENCHMARK_FRAME_STEP.width, -BENCHMARK_FRAME_STEP.height);
+}
+
+@interface TBCanvasBenchmark() <TBCollectionCanvasContentViewDataSource>
+{
+    NSTimeInterval startDate;
+}
+
+// The results of all runs in the order of measurement.
+@property (strong, nonatomic) NSMutableArray *records;
+
+// The graph and the node views of the current run.
+@property (strong, nonatomic) TBCanvasGraphGenerator *graph;
+@property (strong, nonatomic) NSMutableArray *nodeViews;
+
+// The viewport of the current run. Holds the canvas.
+@property (strong, nonatomic) TBCollectionCanvasView *viewport;
+
+/** @name Measuring */
+
+/**
+ Feeds a single event to the canvas of the current run.
+ 
+ @param target   The kind of item view
+ @param phase    The touch phase or menu action
+ @param nodeTag  The tag of the node view
+ @param location The location of the touch on the canvas
+ 
+ @return The time spent on the event in seconds.
+ */
+- (CFTimeInterval)timeEventWithTarget:(TBCanvasTouchTraceTarget)target phase:(TBCanvasTouchTracePhase)phase nodeTag:(NSInteger)nodeTag location:(CGPoint)location;
+
+/**
+ Drags an item view over a number of frames and collects the time spent on every frame.
+ 
+ @param target  The kind of item view
+ @param nodeTag The tag of the node view
+ @param start   The location of the first touch
+ @param step    The distance moved per frame
+ @param samples The array to add the frame times to
+ */
+- (void)dragWithTarget:(TBCanvasTouchTraceTarget)target nodeTag:(NSInteger)nodeTag from:(CGPoint)start step:(CGSize)step intoSamples:(NSMutableArray *)samples;
+
+/**
+ Adds a result with the percentiles of a number of samples.
+ 
+ @param benchmark The name of the measurement
+ @param samples   The samples in seconds
+ */
+- (void)addResultNamed:(NSString *)benchmark samples:(NSArray *)samples;
+
+@end
+
+@implementation TBCanvasBenchmark
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _iterations = 5;
+        _frameCount = 30;
+        _records = [[NSMutableArray alloc] init];
+        
+        _revision = [[NSProcessInfo processInfo] environment][@"TB_CANVAS_BENCHMARK_REVISION"];
+        if (_revision.length == 0) {
+            _revision = @"unknown";
+        }
+        
+        startDate = [[NSDate date] timeIntervalSince1970];
+    }
+    return self;
+}
+
+- (NSArray *)results
+{
+    return [_records copy];
+}
+
++ (NSArray *)nodeCountsUpToNodeCount:(NSUInteger)maxNodeCount
+{
+    NSMutableArray *nodeCounts = [[NSMutableArray alloc] init];
+    for (NSUInteger nodeCount = 100; nodeCount <= maxNodeCount; nodeCount *= 10) {
+        [nodeCounts addObject:@(nodeCount)];
+    }
+    return nodeCounts;
+}
+
+#pragma mark - Running
+
+- (void)runOnGraph:(TBCanvasGraphGenerator *)graph
+{
+    @autoreleasepool {
+        _graph = graph;
+        _nodeViews = [[NSMutableArray alloc] initWithCapacity:graph.nodeCount];
+        
+        NSUInteger columns = MAX((NSUInteger)ceil(sqrt((double)graph.nodeCount)), (NSUInteger)1);
+        for (NSUInteger i = 0; i < graph.nodeCount; i++) {
+            TBCanvasNodeView *nodeView = [[TBCanvasNodeView alloc] initWithFrame:CGRectMake(0.0, 0.0, BENCHMARK_NODE_SIZE, BENCHMARK_NODE_SIZE)];
+            nodeView.tag = i;
+            nodeView.center = CGPointMake(BENCHMARK_ORIGIN + (i % columns) * BENCHMARK_NODE_SPACING, BENCHMARK_ORIGIN + (i / columns) * BENCHMARK_NODE_SPACING);
+            [_nodeViews addObject:nodeView];
+        }
+        
+        _viewport = [[TBCollectionCanvasView alloc] initWithFrame:BENCHMARK_VIEWPORT];
+        TBCollectionCanvasContentView *canvas = _viewport.collectionCanvasView;
+        canvas.canvasViewDataSource = self;
+        
+        // Large graphs are measured fewer times.
+        NSUInteger iterations = MAX(MIN(_iterations, BENCHMARK_NODE_BUDGET / MAX(graph.nodeCount, (NSUInteger)1)), (NSUInteger)1);
+        NSMutableArray *samples = [[NSMutableArray alloc] init];
+        CFTimeInterval start = 0.0;
+        
+        // Filling includes connecting all nodes.
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [canvas clearCanvas];
+            start = CACurrentMediaTime();
+            [canvas fillCanvas];
+            [samples addObject:@(CACurrentMediaTime() - start)];
+        }
+        [self addResultNamed:@"fill" samples:samples];
+        
+        if (graph.nodeCount > 1) {
+            NSMutableArray *expandSamples = [[NSMutableArray alloc] init];
+            [samples removeAllObjects];
+            for (NSUInteger i = 0; i < iterations; i++) {
+                [samples addObject:@([self timeEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseCollapse nodeTag:0 location:CGPointZero])];
+                [expandSamples addObject:@([self timeEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseExpand nodeTag:0 location:CGPointZero])];
+            }
+            [self addResultNamed:@"collapse" samples:samples];
+            [self addResultNamed:@"expand" samples:expandSamples];
+        }
+        
+        // Insert and delete an unconnected node in the middle. The data source serves it while it is on the canvas.
+        NSMutableArray *deleteSamples = [[NSMutableArray alloc] init];
+        NSIndexPath *indexPath = [NSIndexPath indexPathForRow:graph.nodeCount / 2 inSection:0];
+        [samples removeAllObjects];
+        for (NSUInteger i = 0; i < iterations; i++) {
+            TBCanvasNodeView *nodeView = [[TBCanvasNodeView alloc] initWithFrame:CGRectMake(0.0, 0.0, BENCHMARK_NODE_SIZE, BENCHMARK_NODE_SIZE)];
+            nodeView.center = CGPointMake(BENCHMARK_ORIGIN / 2.0, BENCHMARK_ORIGIN / 2.0);
+            [_nodeViews insertObject:nodeView atIndex:indexPath.row];
+            
+            start = CACurrentMediaTime();
+            [canvas insertNodeAtIndexPath:indexPath];
+            [samples addObject:@(CACurrentMediaTime() - start)];
+            
+            start = CACurrentMediaTime();
+            [canvas deleteNodeAtIndexPath:indexPath];
+            [deleteSamples addObject:@(CACurrentMediaTime() - start)];
+            
+            [_nodeViews removeObjectAtIndex:indexPath.row];
+        }
+        [self addResultNamed:@"insert" samples:samples];
+        [self addResultNamed:@"delete" samples:deleteSamples];
+        
+        [samples removeAllObjects];
+        for (NSUInteger i = 0; i < iterations; i++) {
+            start = CACurrentMediaTime();
+            [canvas sizeCanvasToFit];
+            [samples addObject:@(CACurrentMediaTime() - start)];
+        }
+        [self addResultNamed:@"sizeToFit" samples:samples];
+        
+        // Drags are measured per frame. The root redraws all connections to its children.
+        TBCanvasNodeView *rootNode = _nodeViews.firstObject;
+        [samples removeAllObjects];
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [self dragWithTarget:TBCanvasTouchTraceTargetNode nodeTag:0 from:rootNode.center step:TBCanvasBenchmarkFrameStep(i) intoSamples:samples];
+        }
+        [self addResultNamed:@"dragNode" samples:samples];
+        
+        // The collapsed root moves the whole graph.
+        if (graph.nodeCount > 1) {
+            [samples removeAllObjects];
+            [self timeEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseCollapse nodeTag:0 location:CGPointZero];
+            for (NSUInteger i = 0; i < iterations; i++) {
+                [self dragWithTarget:TBCanvasTouchTraceTargetNode nodeTag:0 from:rootNode.center step:TBCanvasBenchmarkFrameStep(i) intoSamples:samples];
+            }
+            [self timeEventWithTarget:TBCanvasTouchTraceTargetMenu phase:TBCanvasTouchTracePhaseExpand nodeTag:0 location:CGPointZero];
+            [self addResultNamed:@"dragSegment" samples:samples];
+        }
+        
+        // Every frame of a connection handle drag tests the node views below the handle. Cancelling keeps the graph unchanged.
+        [canvas toggleConnectMode];
+        if (rootNode.connectionHandle) {
+            [samples removeAllObjects];
+            for (NSUInteger i = 0; i < iterations; i++) {
+                [self dragWithTarget:TBCanvasTouchTraceTargetCreateHandle nodeTag:0 from:rootNode.connectionHandle.center step:TBCanvasBenchmarkFrameStep(i) intoSamples:samples];
+            }
+            [self addResultNamed:@"hitTest" samples:samples];
+        }
+        [canvas toggleConnectMode];
+        
+        [canvas clearCanvas];
+        canvas.canvasViewDataSource = nil;
+        _viewport = nil;
+        _nodeViews = nil;
+        _graph = nil;
+    }
+}
+
+#pragma mark - Measuring
+
+- (CFTimeInterval)timeEventWithTarget:(TBCanvasTouchTraceTarget)target phase:(TBCanvasTouchTracePhase)phase nodeTag:(NSInteger)nodeTag location:(CGPoint)location
+{
+    TBCanvasTouchTraceEvent event = {target, phase, (int32_t)nodeTag, -1, location, 0.0, 0};
+    
+    CFTimeInterval start = CACurrentMediaTime();
+    [_viewport.collectionCanvasView processTouchTraceEvent:event];
+    return CACurrentMediaTime() - start;
+}
+
+- (void)dragWithTarget:(TBCanvasTouchTraceTarget)target nodeTag:(NSInteger)nodeTag from:(CGPoint)start step:(CGSize)step intoSamples:(NSMutableArray *)samples
+{
+    CGPoint location = start;
+    
+    [self timeEventWithTarget:target phase:TBCanvasTouchTracePhaseBegan nodeTag:nodeTag location:location];
+    for (NSUInteger i = 1; i <= _frameCount; i++) {
+        location = CGPointMake(start.x + step.width * i, start.y + step.height * i);
+        [samples addObject:@([self timeEventWithTarget:target phase:TBCanvasTouchTracePhaseMoved nodeTag:nodeTag location:location])];
+    }
+    
+    // Handles are cancelled, so no connection is added.
+    TBCanvasTouchTracePhase phase = (target == TBCanvasTouchTraceTargetNode) ? TBCanvasTouchTracePhaseEnded : TBCanvasTouchTracePhaseCancelled;
+    [self timeEventWithTarget:target phase:phase nodeTag:nodeTag location:location];
+}
+
+- (void)addResultNamed:(NSString *)benchmark samples:(NSArray *)samples
+{
+    if (samples.count == 0) {
+        return;
+    }
+    
+    NSMutableDictionary *result = [[NSMutableDictionary alloc] init];
+    result[@"benchmark"] = benchmark;
+    result[@"graph"] = [TBCanvasGraphGenerator nameOfShape:_graph.shape];
+    result[@"nodes"] = @(_graph.nodeCount);
+    result[@"edges"] = @(_graph.edgeCount);
+    result[@"samples"] = @(samples.count);
+    result[@"min"] = [samples valueForKeyPath:@"@min.self"];
+    [result addEntriesFromDictionary:[TBCanvasTouchTrace percentilesForLatencies:samples]];
+    result[@"unit"] = @"s";
+    result[@"date"] = @(startDate);
+    result[@"revision"] = _revision;
+    result[@"system"] = [[NSProcessInfo processInfo] operatingSystemVersionString];
+    
+    [_records addObject:result];
+}
+
+#pragma mark - Writing
+
+- (BOOL)writeResultsToURL:(NSURL *)url error:(NSError **)error
+{
+    NSMutableData *data = [[NSMutableData alloc] init];
+    
+    for (NSDictionary *result in _records) {
+        NSData *line = [NSJSONSerialization dataWithJSONObject:result options:0 error:error];
+        if (line == nil) {
+            return NO;
+        }
+        [data appendData:line];
+        [data appendBytes:"\n" length:1];
+    }
+    return [data writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+#pragma mark - TBCollectionCanvasContentViewDataSource
+
+- (NSInteger)numberOfSectionsOnCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView
+{
+    return 1;
+}
+
+- (NSInteger)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView numberOfNodesInSection:(NSInteger)section
+{
+    return _nodeViews.count;
+}
+
+- (TBCanvasNodeView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView nodeViewAtIndexPath:(NSIndexPath *)indexPath
+{
+    return _nodeViews[indexPath.row];
+}
+
+- (TBCanvasConnectionView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView newConectionForNodeAtIndexPath:(NSIndexPath *)indexPath
+{
+    return [[TBCanvasConnectionView alloc] initWithFrame:CGRectZero];
+}
+
+- (NSSet *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView connectionsForNodeAtIndexPath:(NSIndexPath *)indexPath
+{
+    NSUInteger childCount = [_graph childCountOfIndex:indexPath.row];
+    const uint32_t *children = [_graph childrenOfIndex:indexPath.row];
+    
+    NSMutableSet *connections = [[NSMutableSet alloc] initWithCapacity:childCount];
+    for (NSUInteger i = 0; i < childCount; i++) {
+        TBCanvasConnectionView *connection = [[TBCanvasConnectionView alloc] initWithFrame:CGRectZero];
+        connection.tag = i;
+        connection.parentNode = _nodeViews[indexPath.row];
+        connection.childNode = _nodeViews[children[i]];
+        [connections addObject:connection];
+    }
+    return connections;
+}
+
+- (TBCanvasCreateHandleView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView newHandleForConnectionAtPoint:(CGPoint)point
+{
+    return [[TBCanvasCreateHandleView alloc] initWithFrame:CGRectMake(point.x - BENCHMARK_HANDLE_SIZE / 2.0, point.y - BENCHMARK_HANDLE_SIZE / 2.0, BENCHMARK_HANDLE_SIZE, BENCHMARK_HANDLE_SIZE)];
+}
+
+- (TBCanvasMoveHandleView *)collectionCanvasContentView:(TBCollectionCanvasContentView *)collectionCanvasContentView moveHandleForConnectionAtPoint:(CGPoint)point
+{
+    return [[TBCanvasMoveHandleView alloc] initWithFrame:CGRectMake(point.x - BENCHMARK_HANDLE_SIZE / 2.0, point.y - BENCHMARK_HANDLE_SIZE / 2.0, BENCHMARK_HANDLE_SIZE, BENCHMARK_HANDLE_SIZE)];
+}
+
+@end
@@ -0,0 +1,90 @@
+//
+//  TBCanvasGraphGenerator.h
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ The shape of a generated graph.
+ */
+typedef NS_ENUM(NSInteger, TBCanvasGraphShape) {
+    TBCanvasGraphShapeTree = 0,
+    TBCanvasGraphShapeFan,
+    TBCanvasGraphShapeChain,
+    TBCanvasGraphShapeSharedDAG,
+    TBCanvasGraphShapeRandom
+};
+
+/**
+ This class generates synthetic graphs of a given shape and size for benchmarks.
+ 
+ Node `0` is the only root of every shape and reaches all other nodes. Edges always lead from a lower to a higher index, so every graph is acyclic.
+ - TBCanvasGraphShapeTree: a balanced tree with a fixed fan-out
+ - TBCanvasGraphShapeFan: the root with all other nodes as direct children
+ - TBCanvasGraphShapeChain: a single path through all nodes
+ - TBCanvasGraphShapeSharedDAG: layers below the root where every node has two parents in the layer above
+ - TBCanvasGraphShapeRandom: a random spanning tree with one more random edge per node
+ 
+ The children of all nodes are stored in a single flat array. Generation is deterministic for a given seed and does not depend on UIKit.
+ */
+@interface TBCanvasGraphGenerator : NSObject
+
+/**
+ *  The shape of the graph.
+ */
+@property (assign, nonatomic, readonly) TBCanvasGraphShape shape;
+
+/**
+ *  The number of nodes.
+ */
+@property (assign, nonatomic, readonly) NSUInteger nodeCount;
+
+/**
+ *  The number of edges.
+ */
+@property (assign, nonatomic, readonly) NSUInteger edgeCount;
+
+/**
+ Initializes the TBCanvasGraphGenerator object and generates a graph.
+ 
+ @param shape     The shape of the graph
+ @param nodeCount The number of nodes
+ @param seed      The seed of the random numbers used by TBCanvasGraphShapeRandom
+ 
+ @return The initialized TBCanvasGraphGenerator object
+ */
+- (id)initWithShape:(TBCanvasGraphShape)shape nodeCount:(NSUInteger)nodeCount seed:(uint64_t)seed;
+
+/**
+ Returns the number of children of a given index.
+ 
+ @param index The given index
+ 
+ @return The number of children.
+ */
+- (NSUInteger)childCountOfIndex:(NSUInteger)index;
+
+/**
+ Returns the children of a given index in ascending order. The result stays valid as long as the generator.
+ 
+ @param index The given index
+ 
+ @return The child indexes. The number of children is returned by childCountOfIndex:.
+ */
+- (const uint32_t *)childrenOfIndex:(NSUInteger)index;
+
+/**
+ Returns a short name of a given shape used in benchmark results.
+ 
+ @param shape The given shape
+ 
+ @return The name of the shape.
+ */
++ (NSString *)nameOfShape:(TBCanvasGraphShape)shape;
+
+@end
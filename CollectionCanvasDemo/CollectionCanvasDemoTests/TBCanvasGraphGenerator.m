@@ -0,0 +1,199 @@
+//
+//  TBCanvasGraphGenerator.m
+//
+//  Created by Julian Krumow on 19.10.26.
+//
+//  Copyright (c) 2026 Julian Krumow ()
+//
+//
+
+#import "TBCanvasGraphGenerator.h"
+
+static const NSUInteger GRAPH_TREE_FAN_OUT    = 4;
+static const NSUInteger GRAPH_MAX_PARENTS     = 2;
+static const uint64_t   GRAPH_DEFAULT_SEED    = 0x9E3779B97F4A7C15ULL;
+
+/**
+ Returns the next number of a xorshift64* sequence.
+ */
+static uint64_t TBCanvasGraphGeneratorNextRandom(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+@interface TBCanvasGraphGenerator()
+{
+    uint32_t *offsets;
+    uint32_t *children;
+    uint64_t randomState;
+    NSUInteger layerWidth;
+}
+
+@property (assign, nonatomic, readwrite) TBCanvasGraphShape shape;
+@property (assign, nonatomic, readwrite) NSUInteger nodeCount;
+@property (assign, nonatomic, readwrite) NSUInteger edgeCount;
+
+/** @name Generating */
+
+/**
+ Returns the parents of a given index in the generated shape. Indexes are visited in ascending order.
+ 
+ @param index   The given index. Greater than `0`
+ @param parents On return the parent indexes. Holds up to GRAPH_MAX_PARENTS indexes
+ 
+ @return The number of parents.
+ */
+- (NSUInteger)parentsOfIndex:(NSUInteger)index intoArray:(uint32_t *)parents;
+
+/**
+ Generates all edges and stores them grouped by their parent.
+ */
+- (void)generateEdges;
+
+@end
+
+@implementation TBCanvasGraphGenerator
+
+- (id)initWithShape:(TBCanvasGraphShape)shape nodeCount:(NSUInteger)nodeCount seed:(uint64_t)seed
+{
+    self = [super init];
+    if (self) {
+        _shape = shape;
+        _nodeCount = nodeCount;
+        _edgeCount = 0;
+        
+        offsets = NULL;
+        children = NULL;
+        randomState = (seed == 0) ? GRAPH_DEFAULT_SEED : seed;
+        layerWidth = MAX((NSUInteger)ceil(sqrt((double)nodeCount)), (NSUInteger)2);
+        
+        [self generateEdges];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(offsets);
+    free(children);
+}
+
++ (NSString *)nameOfShape:(TBCanvasGraphShape)shape
+{
+    switch (shape) {
+        case TBCanvasGraphShapeTree:
+            return @"tree";
+        case TBCanvasGraphShapeFan:
+            return @"fan";
+        case TBCanvasGraphShapeChain:
+            return @"chain";
+        case TBCanvasGraphShapeSharedDAG:
+            return @"shared-dag";
+        case TBCanvasGraphShapeRandom:
+            return @"random";
+    }
+    return nil;
+}
+
+#pragma mark - Generating
+
+- (NSUInteger)parentsOfIndex:(NSUInteger)index intoArray:(uint32_t *)parents
+{
+    switch (_shape) {
+        case TBCanvasGraphShapeTree:
+            parents[0] = (uint32_t)((index - 1) / GRAPH_TREE_FAN_OUT);
+            return 1;
+        
+        case TBCanvasGraphShapeFan:
+            parents[0] = 0;
+            return 1;
+        
+        case TBCanvasGraphShapeChain:
+            parents[0] = (uint32_t)(index - 1);
+            return 1;
+        
+        case TBCanvasGraphShapeSharedDAG: {
+            
+            // The first layer hangs below the root. Every further node shares the node above with its left neighbour.
+            NSUInteger position = index - 1;
+            NSUInteger layer = position / layerWidth;
+            NSUInteger column = position % layerWidth;
+            if (layer == 0) {
+                parents[0] = 0;
+                return 1;
+            }
+            NSUInteger above = 1 + (layer - 1) * layerWidth;
+            parents[0] = (uint32_t)(above + column);
+            parents[1] = (uint32_t)(above + (column + 1) % layerWidth);
+            return 2;
+        }
+        
+        case TBCanvasGraphShapeRandom: {
+            
+            // A random parent keeps all nodes reachable from the root. A second one is dropped when it repeats the first.
+            parents[0] = (uint32_t)(TBCanvasGraphGeneratorNextRandom(&randomState) % index);
+            parents[1] = (uint32_t)(TBCanvasGraphGeneratorNextRandom(&randomState) % index);
+            return (parents[0] == parents[1]) ? 1 : 2;
+        }
+    }
+    return 0;
+}
+
+- (void)generateEdges
+{
+    offsets = calloc(_nodeCount + 1, sizeof(uint32_t));
+    if (_nodeCount < 2) {
+        return;
+    }
+    
+    // Collect all edges child by child, so every child list ends up sorted.
+    uint32_t *edgeParents = malloc((_nodeCount - 1) * GRAPH_MAX_PARENTS * sizeof(uint32_t));
+    uint32_t *edgeChildren = malloc((_nodeCount - 1) * GRAPH_MAX_PARENTS * sizeof(uint32_t));
+    NSUInteger count = 0;
+    
+    uint32_t parents[GRAPH_MAX_PARENTS];
+    for (NSUInteger i = 1; i < _nodeCount; i++) {
+        NSUInteger parentCount = [self parentsOfIndex:i intoArray:parents];
+        for (NSUInteger j = 0; j < parentCount; j++) {
+            edgeParents[count] = parents[j];
+            edgeChildren[count] = (uint32_t)i;
+            offsets[parents[j] + 1]++;
+            count++;
+        }
+    }
+    
+    for (NSUInteger i = 0; i < _nodeCount; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    
+    children = malloc(count * sizeof(uint32_t));
+    uint32_t *cursors = malloc(_nodeCount * sizeof(uint32_t));
+    memcpy(cursors, offsets, _nodeCount * sizeof(uint32_t));
+    for (NSUInteger i = 0; i < count; i++) {
+        children[cursors[edgeParents[i]]++] = edgeChildren[i];
+    }
+    _edgeCount = count;
+    
+    free(cursors);
+    free(edgeChildren);
+    free(edgeParents);
+}
+
+#pragma mark - Querying
+
+- (NSUInteger)childCountOfIndex:(NSUInteger)index
+{
+    return (index < _nodeCount) ? offsets[index + 1] - offsets[index] : 0;
+}
+
+- (const uint32_t *)childrenOfIndex:(NSUInteger)index
+{
+    return (index < _nodeCount) ? children + offsets[index] : NULL;
+}
+
+@end